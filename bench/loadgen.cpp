@@ -0,0 +1,629 @@
+// bench/loadgen.cpp
+// Генератор HTTP-нагрузки для FlaskCpp: закрытый цикл (фиксированное число запросов в полёте)
+// или открытый цикл (постоянная частота), keep-alive и конвейеризация, перцентили задержек.
+//
+// Пример:
+//   bin/loadgen --port 8080 --path /api/data --connections 32 --threads 4 --duration 10
+//   bin/loadgen --port 8080 --path / --rate 20000 --duration 10 --json --name template
+//   bin/loadgen --port 8443 --path /api/data --tls --no-keep-alive --tls-resume
+#include "Metrics.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <iostream>
+#include <memory>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <string>
+#include <string_view>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    std::string path = "/";
+    std::string method = "GET";
+    std::string name;
+    size_t connections = 16;
+    size_t threads = 2;
+    double duration = 10.0;   // Секунды измерения
+    double warmup = 1.0;      // Секунды прогрева, не попадающие в статистику
+    double rate = 0.0;        // Запросов в секунду на все потоки; 0 - закрытый цикл
+    size_t pipeline = 1;      // Запросов в полёте на соединение
+    bool keepAlive = true;
+    bool json = false;
+    bool tls = false;         // HTTPS без проверки сертификата
+    bool tlsResume = false;   // Новые соединения возобновляют последнюю сессию TLS потока
+};
+
+// Результаты одного потока
+struct WorkerResult {
+    LatencyHistogram latency;
+    uint64_t responses = 0;
+    uint64_t statusClasses[6] = {0, 0, 0, 0, 0, 0}; // 1xx..5xx и прочие
+    uint64_t errors = 0;
+    uint64_t bytes = 0;
+    uint64_t connects = 0;
+    uint64_t resumed = 0;     // Соединения, возобновившие сессию TLS
+};
+
+struct Connection {
+    int fd = -1;
+    SSL* ssl = nullptr;
+    std::string out;
+    size_t outOffset = 0;
+    std::string in;
+    std::deque<Clock::time_point> inflight; // Время (запланированной) отправки запросов без ответа
+    bool wantWrite = false;
+};
+
+static void usage() {
+    std::cerr <<
+        "Usage: loadgen [options]\n"
+        "  --host HOST           адрес сервера (127.0.0.1)\n"
+        "  --port PORT           порт (8080)\n"
+        "  --path PATH           путь запроса (/)\n"
+        "  --method METHOD       HTTP-метод (GET)\n"
+        "  --connections N       число соединений (16)\n"
+        "  --threads N           число потоков (2)\n"
+        "  --duration SEC        длительность измерения (10)\n"
+        "  --warmup SEC          прогрев без учёта в статистике (1)\n"
+        "  --rate RPS            открытый цикл с постоянной частотой; 0 - закрытый цикл (0)\n"
+        "  --pipeline N          запросов в полёте на соединение (1)\n"
+        "  --no-keep-alive       новое соединение на каждый запрос\n"
+        "  --tls                 HTTPS (сертификат сервера не проверяется)\n"
+        "  --tls-resume          возобновлять сессии TLS (вместе с --no-keep-alive - сокращённые рукопожатия)\n"
+        "  --name NAME           имя сценария в отчёте\n"
+        "  --json                отчёт одной JSON-строкой\n";
+}
+
+static bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char* value = nullptr;
+        if (arg == "--no-keep-alive") {
+            options.keepAlive = false;
+        } else if (arg == "--json") {
+            options.json = true;
+        } else if (arg == "--tls") {
+            options.tls = true;
+        } else if (arg == "--tls-resume") {
+            options.tls = true;
+            options.tlsResume = true;
+        } else if (arg == "--help" || arg == "-h") {
+            return false;
+        } else if ((value = next()) == nullptr) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        } else if (arg == "--host") {
+            options.host = value;
+        } else if (arg == "--port") {
+            options.port = std::atoi(value);
+        } else if (arg == "--path") {
+            options.path = value;
+        } else if (arg == "--method") {
+            options.method = value;
+        } else if (arg == "--connections") {
+            options.connections = std::strtoul(value, nullptr, 10);
+        } else if (arg == "--threads") {
+            options.threads = std::strtoul(value, nullptr, 10);
+        } else if (arg == "--duration") {
+            options.duration = std::atof(value);
+        } else if (arg == "--warmup") {
+            options.warmup = std::atof(value);
+        } else if (arg == "--rate") {
+            options.rate = std::atof(value);
+        } else if (arg == "--pipeline") {
+            options.pipeline = std::strtoul(value, nullptr, 10);
+        } else if (arg == "--name") {
+            options.name = value;
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return false;
+        }
+    }
+    if (options.threads == 0) options.threads = 1;
+    if (options.connections < options.threads) options.connections = options.threads;
+    if (options.pipeline == 0) options.pipeline = 1;
+    if (!options.keepAlive) options.pipeline = 1;
+    if (options.name.empty()) options.name = options.path;
+    return options.duration > 0;
+}
+
+static bool equalsIgnoreCase(const char* a, const char* b, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        if (std::tolower((unsigned char)a[i]) != std::tolower((unsigned char)b[i])) return false;
+    }
+    return true;
+}
+
+static size_t parseNumber(std::string_view text, size_t pos) {
+    while (pos < text.size() && text[pos] == ' ') ++pos;
+    size_t value = 0;
+    while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') {
+        value = value * 10 + static_cast<size_t>(text[pos++] - '0');
+    }
+    return value;
+}
+
+// Разбирает один полный ответ в начале буфера. Возвращает его длину или 0, если ответ ещё не получен.
+// Ответ без Content-Length считается завершённым только при закрытии соединения (closed = true)
+static size_t parseResponse(std::string_view in, bool closed, int& status) {
+    size_t headEnd = in.find("\r\n\r\n");
+    if (headEnd == std::string_view::npos) return 0;
+
+    status = 0;
+    if (in.size() >= 12 && in.compare(0, 5, "HTTP/") == 0) {
+        size_t space = in.find(' ');
+        if (space != std::string_view::npos) {
+            status = static_cast<int>(parseNumber(in, space + 1));
+        }
+    }
+
+    const char header[] = "\r\ncontent-length:";
+    const size_t headerLength = sizeof(header) - 1;
+    for (size_t pos = in.find("\r\n"); pos != std::string_view::npos && pos < headEnd; pos = in.find("\r\n", pos + 2)) {
+        if (pos + headerLength <= headEnd && equalsIgnoreCase(in.data() + pos, header, headerLength)) {
+            size_t total = headEnd + 4 + parseNumber(in, pos + headerLength);
+            return in.size() >= total ? total : 0;
+        }
+    }
+    return closed ? in.size() : 0;
+}
+
+static int openConnection(const sockaddr_in& address) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == -1) return -1;
+    if (connect(fd, (const sockaddr*)&address, sizeof(address)) == -1) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+class Worker {
+public:
+    static constexpr uint32_t timerEvent = UINT32_MAX;
+
+    Worker(const Options& options, const sockaddr_in& address, SSL_CTX* tlsContext, size_t connectionCount,
+           double rate, Clock::time_point start, WorkerResult& result)
+        : options(options), address(address), tlsContext(tlsContext), connections(connectionCount), rate(rate),
+          start(start), result(result) {
+        request = options.method + " " + options.path + " HTTP/1.1\r\nHost: " + options.host + ":" +
+                  std::to_string(options.port) + "\r\nUser-Agent: flaskcpp-loadgen\r\n";
+        if (!options.keepAlive) request += "Connection: close\r\n";
+        request += "\r\n";
+    }
+
+    void run() {
+        epollFd = epoll_create1(0);
+        // Таймер с точностью выше миллисекунды для открытого цикла: epoll_wait с нулевым таймаутом
+        // занимал бы процессор, который нужен серверу
+        int timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        {
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.u32 = timerEvent;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, timerFd, &ev);
+        }
+        measureStart = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.warmup));
+        Clock::time_point end = measureStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.duration));
+
+        for (auto& conn : connections) {
+            connect(conn);
+        }
+
+        // Открытый цикл: запросы планируются с фиксированным интервалом независимо от ответов сервера,
+        // а задержка считается от запланированного момента (без «координированного умолчания»)
+        Clock::duration interval = rate > 0
+            ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate))
+            : Clock::duration::zero();
+        Clock::time_point nextSend = start;
+        std::deque<Clock::time_point> backlog;
+
+        epoll_event events[64];
+        while (true) {
+            Clock::time_point now = Clock::now();
+            if (now >= end) break;
+
+            // Закрытые и не открывшиеся соединения открываем снова до отправки запросов: иначе
+            // без keep-alive новое соединение простаивало бы до следующего пробуждения epoll_wait
+            for (auto& conn : connections) {
+                if (conn.fd == -1) connect(conn);
+            }
+
+            if (rate > 0) {
+                while (nextSend <= now) {
+                    backlog.push_back(nextSend);
+                    nextSend += interval;
+                }
+                // Запросы раздаются соединениям по кругу, чтобы нагрузка шла через все соединения
+                for (size_t tried = 0; !backlog.empty() && tried < connections.size(); ) {
+                    Connection& conn = connections[nextConnection];
+                    nextConnection = (nextConnection + 1) % connections.size();
+                    if (conn.fd != -1 && conn.inflight.size() < options.pipeline) {
+                        send(conn, backlog.front());
+                        backlog.pop_front();
+                        tried = 0;
+                    } else {
+                        ++tried;
+                    }
+                }
+            } else {
+                for (auto& conn : connections) {
+                    while (conn.fd != -1 && conn.inflight.size() < options.pipeline) {
+                        send(conn, now);
+                    }
+                }
+            }
+
+            if (rate > 0 && backlog.empty()) {
+                // steady_clock в Linux отсчитывается по CLOCK_MONOTONIC
+                auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(nextSend.time_since_epoch()).count();
+                itimerspec spec{};
+                spec.it_value.tv_sec = static_cast<time_t>(nanos / 1000000000);
+                spec.it_value.tv_nsec = static_cast<long>(nanos % 1000000000);
+                timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+            }
+            int n = epoll_wait(epollFd, events, 64, 10);
+            for (int i = 0; i < n; ++i) {
+                if (events[i].data.u32 == timerEvent) {
+                    uint64_t expirations;
+                    ssize_t ignored = read(timerFd, &expirations, sizeof(expirations));
+                    (void)ignored;
+                    continue;
+                }
+                Connection& conn = connections[events[i].data.u32];
+                if (conn.fd == -1) continue;
+                if (events[i].events & EPOLLOUT) flushOut(conn);
+                if (conn.fd != -1 && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) readIn(conn);
+            }
+        }
+
+        for (auto& conn : connections) {
+            if (conn.fd != -1) disconnect(conn, false);
+        }
+        SSL_SESSION_free(session);
+        close(timerFd);
+        close(epollFd);
+    }
+
+private:
+    const Options& options;
+    sockaddr_in address;
+    SSL_CTX* tlsContext;
+    SSL_SESSION* session = nullptr;   // Для --tls-resume
+    std::vector<Connection> connections;
+    double rate;
+    Clock::time_point start;
+    Clock::time_point measureStart;
+    WorkerResult& result;
+    std::string request;
+    int epollFd = -1;
+    size_t nextConnection = 0;
+
+    void connect(Connection& conn) {
+        conn.fd = openConnection(address);
+        conn.out.clear();
+        conn.outOffset = 0;
+        conn.in.clear();
+        conn.wantWrite = false;
+        if (conn.fd != -1 && tlsContext && !handshake(conn)) {
+            close(conn.fd);
+            conn.fd = -1;
+        }
+        if (conn.fd == -1) {
+            ++result.errors;
+            return;
+        }
+        fcntl(conn.fd, F_SETFL, fcntl(conn.fd, F_GETFL, 0) | O_NONBLOCK);
+        ++result.connects;
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u32 = static_cast<uint32_t>(&conn - connections.data());
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, conn.fd, &ev);
+    }
+
+    // Рукопожатие на блокирующем сокете, как и connect(): время установления соединения
+    // входит в задержку первого запроса
+    bool handshake(Connection& conn) {
+        conn.ssl = SSL_new(tlsContext);
+        SSL_set_fd(conn.ssl, conn.fd);
+        if (session) SSL_set_session(conn.ssl, session);
+        if (SSL_connect(conn.ssl) != 1) {
+            ERR_clear_error();
+            SSL_free(conn.ssl);
+            conn.ssl = nullptr;
+            return false;
+        }
+        if (SSL_session_reused(conn.ssl)) ++result.resumed;
+        return true;
+    }
+
+    void disconnect(Connection& conn, bool failed) {
+        if (failed && !conn.inflight.empty()) {
+            result.errors += conn.inflight.size();
+        }
+        conn.inflight.clear();
+        if (conn.ssl) {
+            // Билет TLS 1.3 приходит после рукопожатия, поэтому сессия берётся при закрытии.
+            // Без close_notify OpenSSL считает сессию непригодной для возобновления; сервер без
+            // keep-alive сам присылает close_notify вместе с ответом
+            if (!failed || (SSL_get_shutdown(conn.ssl) & SSL_RECEIVED_SHUTDOWN)) SSL_shutdown(conn.ssl);
+            SSL_SESSION* last = options.tlsResume ? SSL_get1_session(conn.ssl) : nullptr;
+            if (last && SSL_SESSION_is_resumable(last)) {
+                SSL_SESSION_free(session);
+                session = last;
+            } else {
+                SSL_SESSION_free(last);
+            }
+            ERR_clear_error();
+            SSL_free(conn.ssl);
+            conn.ssl = nullptr;
+        }
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, conn.fd, nullptr);
+        close(conn.fd);
+        conn.fd = -1;
+    }
+
+    void send(Connection& conn, Clock::time_point scheduled) {
+        conn.out += request;
+        conn.inflight.push_back(scheduled);
+        flushOut(conn);
+    }
+
+    void flushOut(Connection& conn) {
+        while (conn.outOffset < conn.out.size()) {
+            if (conn.ssl) {
+                size_t written = 0;
+                if (SSL_write_ex(conn.ssl, conn.out.data() + conn.outOffset, conn.out.size() - conn.outOffset, &written) != 1) {
+                    int error = SSL_get_error(conn.ssl, 0);
+                    ERR_clear_error();
+                    if (error == SSL_ERROR_WANT_WRITE || error == SSL_ERROR_WANT_READ) break;
+                    disconnect(conn, true);
+                    return;
+                }
+                conn.outOffset += written;
+                continue;
+            }
+            ssize_t w = ::send(conn.fd, conn.out.data() + conn.outOffset, conn.out.size() - conn.outOffset, MSG_NOSIGNAL);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                disconnect(conn, true);
+                return;
+            }
+            conn.outOffset += static_cast<size_t>(w);
+        }
+        if (conn.outOffset == conn.out.size()) {
+            conn.out.clear();
+            conn.outOffset = 0;
+        }
+
+        bool wantWrite = !conn.out.empty();
+        if (wantWrite != conn.wantWrite) {
+            epoll_event ev{};
+            ev.events = EPOLLIN | (wantWrite ? EPOLLOUT : 0);
+            ev.data.u32 = static_cast<uint32_t>(&conn - connections.data());
+            epoll_ctl(epollFd, EPOLL_CTL_MOD, conn.fd, &ev);
+            conn.wantWrite = wantWrite;
+        }
+    }
+
+    void readIn(Connection& conn) {
+        bool closed = false;
+        char buffer[65536];
+        while (true) {
+            if (conn.ssl) {
+                size_t got = 0;
+                if (SSL_read_ex(conn.ssl, buffer, sizeof(buffer), &got) == 1) {
+                    conn.in.append(buffer, got);
+                    continue;
+                }
+                int error = SSL_get_error(conn.ssl, 0);
+                ERR_clear_error();
+                if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) break;
+                closed = true;
+                break;
+            }
+            ssize_t r = recv(conn.fd, buffer, sizeof(buffer), 0);
+            if (r > 0) {
+                conn.in.append(buffer, static_cast<size_t>(r));
+                continue;
+            }
+            if (r < 0 && errno == EINTR) continue;
+            if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            closed = true;
+            break;
+        }
+
+        size_t consumed = 0;
+        int status = 0;
+        while (!conn.inflight.empty()) {
+            std::string_view rest(conn.in.data() + consumed, conn.in.size() - consumed);
+            size_t length = parseResponse(rest, closed, status);
+            if (length == 0) break;
+            complete(conn, status, length);
+            consumed += length;
+        }
+        conn.in.erase(0, consumed);
+
+        if (closed) {
+            disconnect(conn, true);
+        } else if (!options.keepAlive && consumed > 0 && conn.inflight.empty()) {
+            // Без ответа соединение не закрывается: при TLS 1.3 первыми приходят билеты сессии
+            disconnect(conn, false);
+        }
+    }
+
+    void complete(Connection& conn, int status, size_t length) {
+        Clock::time_point sent = conn.inflight.front();
+        conn.inflight.pop_front();
+        Clock::time_point now = Clock::now();
+        if (now < measureStart) return;
+
+        ++result.responses;
+        result.bytes += length;
+        int statusClass = status / 100;
+        ++result.statusClasses[(statusClass >= 1 && statusClass <= 5) ? statusClass - 1 : 5];
+        result.latency.record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - sent).count()));
+    }
+};
+
+static std::string formatMicros(uint64_t nanos) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.1f", nanos / 1000.0);
+    return buffer;
+}
+
+static std::string jsonEscape(const std::string& value) {
+    std::string out;
+    for (char c : value) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage();
+        return 1;
+    }
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(options.port));
+    if (inet_pton(AF_INET, options.host.c_str(), &address.sin_addr) != 1) {
+        addrinfo hints{};
+        hints.ai_family = AF_INET;
+        addrinfo* info = nullptr;
+        if (getaddrinfo(options.host.c_str(), nullptr, &hints, &info) != 0 || !info) {
+            std::cerr << "Cannot resolve host: " << options.host << std::endl;
+            return 1;
+        }
+        address.sin_addr = ((sockaddr_in*)info->ai_addr)->sin_addr;
+        freeaddrinfo(info);
+    }
+
+    SSL_CTX* tlsContext = nullptr;
+    if (options.tls) {
+        tlsContext = SSL_CTX_new(TLS_client_method());
+        SSL_CTX_set_verify(tlsContext, SSL_VERIFY_NONE, nullptr);
+        // conn.out растёт, пока запись ждёт сокет: повтор SSL_write идёт с другим адресом буфера
+        SSL_CTX_set_mode(tlsContext, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+        SSL_CTX_set_session_cache_mode(tlsContext, SSL_SESS_CACHE_OFF);
+        static const unsigned char protocols[] = "\x08http/1.1";
+        SSL_CTX_set_alpn_protos(tlsContext, protocols, sizeof(protocols) - 1);
+        // OpenSSL пишет в сокет без MSG_NOSIGNAL
+        std::signal(SIGPIPE, SIG_IGN);
+    }
+
+    std::vector<std::unique_ptr<WorkerResult>> results;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    Clock::time_point start = Clock::now();
+    for (size_t t = 0; t < options.threads; ++t) {
+        size_t connectionCount = options.connections / options.threads + (t < options.connections % options.threads ? 1 : 0);
+        results.push_back(std::make_unique<WorkerResult>());
+        workers.push_back(std::make_unique<Worker>(options, address, tlsContext, connectionCount,
+                                                   options.rate / options.threads, start, *results.back()));
+    }
+    for (auto& worker : workers) {
+        threads.emplace_back([&worker]() { worker->run(); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    HistogramSnapshot latency;
+    WorkerResult total;
+    for (const auto& result : results) {
+        result->latency.addTo(latency);
+        total.responses += result->responses;
+        total.errors += result->errors;
+        total.bytes += result->bytes;
+        total.connects += result->connects;
+        total.resumed += result->resumed;
+        for (int i = 0; i < 6; ++i) total.statusClasses[i] += result->statusClasses[i];
+    }
+
+    double rps = total.responses / options.duration;
+    uint64_t mean = latency.count ? latency.sum / latency.count : 0;
+    const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+    const char* quantileNames[] = {"p50", "p90", "p99", "p999"};
+    const char* classNames[] = {"1xx", "2xx", "3xx", "4xx", "5xx", "other"};
+
+    if (options.json) {
+        std::string out = "{\"name\":\"" + jsonEscape(options.name) + "\",\"path\":\"" + jsonEscape(options.path) + "\"";
+        out += ",\"mode\":\"" + std::string(options.rate > 0 ? "open" : "closed") + "\"";
+        out += ",\"connections\":" + std::to_string(options.connections);
+        out += ",\"threads\":" + std::to_string(options.threads);
+        out += ",\"pipeline\":" + std::to_string(options.pipeline);
+        out += ",\"keep_alive\":" + std::string(options.keepAlive ? "true" : "false");
+        out += ",\"tls\":" + std::string(options.tls ? "true" : "false");
+        out += ",\"target_rate\":" + std::to_string(options.rate);
+        out += ",\"duration_s\":" + std::to_string(options.duration);
+        out += ",\"requests\":" + std::to_string(total.responses);
+        out += ",\"errors\":" + std::to_string(total.errors);
+        out += ",\"rps\":" + std::to_string(rps);
+        out += ",\"bytes\":" + std::to_string(total.bytes);
+        out += ",\"connects\":" + std::to_string(total.connects);
+        out += ",\"resumed\":" + std::to_string(total.resumed);
+        out += ",\"status\":{";
+        for (int i = 0; i < 6; ++i) {
+            if (i) out += ",";
+            out += "\"" + std::string(classNames[i]) + "\":" + std::to_string(total.statusClasses[i]);
+        }
+        out += "},\"latency_us\":{\"mean\":" + formatMicros(mean);
+        for (int i = 0; i < 4; ++i) {
+            out += ",\"" + std::string(quantileNames[i]) + "\":" + formatMicros(latency.quantile(quantiles[i]));
+        }
+        out += ",\"max\":" + formatMicros(latency.max()) + "}}";
+        std::cout << out << std::endl;
+    } else {
+        std::cout << "Scenario:    " << options.name << " (" << options.method << " " << options.path << ")\n"
+                  << "Mode:        " << (options.rate > 0 ? "open loop, " + std::to_string(options.rate) + " req/s" : std::string("closed loop"))
+                  << ", " << options.connections << " connections, " << options.threads << " threads, pipeline "
+                  << options.pipeline << (options.keepAlive ? ", keep-alive" : ", no keep-alive") << "\n"
+                  << "Requests:    " << total.responses << " in " << options.duration << "s (" << rps << " req/s)\n"
+                  << "Errors:      " << total.errors << "\n"
+                  << "Status:     ";
+        for (int i = 0; i < 6; ++i) {
+            if (total.statusClasses[i]) std::cout << " " << classNames[i] << "=" << total.statusClasses[i];
+        }
+        std::cout << "\nLatency us:  mean " << formatMicros(mean);
+        for (int i = 0; i < 4; ++i) {
+            std::cout << "  " << quantileNames[i] << " " << formatMicros(latency.quantile(quantiles[i]));
+        }
+        std::cout << "  max " << formatMicros(latency.max()) << std::endl;
+        if (options.tls) {
+            std::cout << "TLS:         " << total.connects << " handshakes, " << total.resumed << " resumed" << std::endl;
+        }
+    }
+    SSL_CTX_free(tlsContext);
+    return total.responses > 0 ? 0 : 2;
+}
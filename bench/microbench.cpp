@@ -0,0 +1,576 @@
+// bench/microbench.cpp
+// Микробенчмарки горячего пути: разбор запроса, маршрутизация, шаблонизатор, сборка ответа, лимиты частоты, JSON.
+// Каждый бенчмарк работает на фиксированном корпусе входных данных и сообщает ns/op,
+// выделения памяти и байты на операцию. Результаты сравниваются с сохранённым базовым файлом.
+//
+//   bin/microbench                                 все бенчмарки
+//   bin/microbench --filter template               только с подстрокой в имени
+//   bin/microbench --baseline bench/microbench.baseline
+//   bin/microbench --save bench/microbench.baseline
+//
+// Собирается вместе с исходниками библиотеки и -DFLASKCPP_ALLOC_STATS (make microbench)
+#include "FlaskCpp.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+
+#ifndef FLASKCPP_ALLOC_STATS
+#error "microbench требует сборки с -DFLASKCPP_ALLOC_STATS"
+#endif
+
+// Не даёт компилятору выбросить вычисление результата
+template <typename T>
+static void doNotOptimize(const T& value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+struct BenchResult {
+    std::string name;
+    double nsPerOp = 0;
+    double allocsPerOp = 0;
+    double bytesPerOp = 0;
+    uint64_t iterations = 0;
+};
+
+// Доступ к закрытым методам FlaskCpp и TemplateEngine (объявлен другом в обоих классах)
+class MicroBenchmarks {
+public:
+    explicit MicroBenchmarks(double minSeconds) : minSeconds(minSeconds), app(0, false, false, 1, 1) {
+        buildCorpus();
+    }
+
+    std::vector<BenchResult> runAll(const std::string& filter) {
+        std::vector<BenchResult> results;
+        auto add = [&](const std::string& name, const std::function<void()>& body) {
+            if (!filter.empty() && name.find(filter) == std::string::npos) return;
+            results.push_back(measure(name, body));
+            print(results.back());
+        };
+
+        Connection& conn = *connection;
+        add("parseRequest/get_browser_headers", [&]() {
+            resetConnection(conn);
+            app.parseRequest(getRequest, conn);
+            doNotOptimize(conn.request);
+        });
+        add("parseRequest/post_form", [&]() {
+            resetConnection(conn);
+            app.parseRequest(postRequest, conn);
+            doNotOptimize(conn.request);
+        });
+        // Хендлер, который читает всё: строка запроса, cookies и заголовок вне известных разбираются по требованию
+        add("parseRequest/get_browser_headers_read_all", [&]() {
+            resetConnection(conn);
+            app.parseRequest(getRequest, conn);
+            doNotOptimize(conn.request.queryParams());
+            doNotOptimize(conn.request.cookies());
+            doNotOptimize(conn.request.header("Accept-Language"));
+        });
+        resetConnection(conn);
+        app.parseRequest(getRequest, conn);
+        add("RequestData::header/known", [&]() {
+            std::string_view value = conn.request.header("user-agent");
+            doNotOptimize(value);
+        });
+        add("RequestData::header/unknown", [&]() {
+            std::string_view value = conn.request.header("sec-fetch-mode");
+            doNotOptimize(value);
+        });
+        MapNodeCache& nodeCache = conn.request.nodeCache;
+        std::map<std::string, std::string> params;
+        add("parseQueryString/20_params", [&]() {
+            nodeCache.recycle(params);
+            parseQueryString(queryString, params, nodeCache);
+            doNotOptimize(params);
+        });
+        add("parseCookies/long_cookie", [&]() {
+            nodeCache.recycle(params);
+            parseCookies(cookieHeader, params, nodeCache);
+            doNotOptimize(params);
+        });
+        std::string decoded;
+        add("urlDecode/encoded_1k", [&]() {
+            decoded.clear();
+            urlDecode(encodedValue, decoded);
+            doNotOptimize(decoded);
+        });
+        add("matchParamRoute/4_segments", [&]() {
+            nodeCache.recycle(conn.request.routeParams);
+            bool matched = app.matchParamRoute(routePath, routePattern, conn.request.routeParams, nodeCache);
+            doNotOptimize(matched);
+        });
+        add("matchParamRoute/mismatch", [&]() {
+            nodeCache.recycle(conn.request.routeParams);
+            bool matched = app.matchParamRoute(routeMismatch, routePattern, conn.request.routeParams, nodeCache);
+            doNotOptimize(matched);
+        });
+        add("buildResponse/json_with_cookies", [&]() {
+            std::string response = app.buildResponse("200 OK", "application/json", jsonBody, extraHeaders);
+            doNotOptimize(response);
+        });
+        // JSON-ответ со списком заказов: склейка строк, как в хендлерах до JsonWriter, против потоковой записи
+        add("jsonResponse/concat_20_orders", [&]() {
+            std::string body = "{\"status\":\"ok\",\"orders\":[";
+            for (size_t i = 0; i < orders.size(); ++i) {
+                const Order& order = orders[i];
+                if (i) body += ",";
+                body += "{\"id\":" + std::to_string(order.id) + ",\"customer\":\"" + order.customer +
+                        "\",\"comment\":\"" + order.comment + "\",\"total\":" + std::to_string(order.total) +
+                        ",\"paid\":" + (order.paid ? "true" : "false") + "}";
+            }
+            body += "]}";
+            std::string response = app.buildResponse("200 OK", "application/json", body);
+            doNotOptimize(response);
+        });
+        add("jsonResponse/writer_20_orders", [&]() {
+            std::string response = app.jsonResponse("200 OK", [&](JsonWriter& json) {
+                json.beginObject().field("status", "ok").key("orders").beginArray();
+                for (const Order& order : orders) {
+                    json.beginObject()
+                        .field("id", order.id)
+                        .field("customer", order.customer)
+                        .field("comment", order.comment)
+                        .field("total", order.total)
+                        .field("paid", order.paid)
+                        .endObject();
+                }
+                json.endArray().endObject();
+            });
+            doNotOptimize(response);
+        });
+        // Тело заказа ~8 КБ: проверка и лента узлов, затем чтение полей, как в хендлере
+        add("JsonDocument::parse/order_8k", [&]() {
+            jsonDocument.parse(orderJson);
+            doNotOptimize(jsonDocument);
+        });
+        add("JsonDocument::parse/order_8k_pretty", [&]() {
+            jsonDocument.parse(orderJsonPretty);
+            doNotOptimize(jsonDocument);
+        });
+        add("JsonDocument::parse/order_8k_read_fields", [&]() {
+            jsonDocument.parse(orderJson);
+            JsonValue root = jsonDocument.root();
+            double total = 0;
+            for (JsonValue item : root["items"]) {
+                total += item["price"].asDouble() * double(item["quantity"].asInt());
+            }
+            bool express = root["delivery"]["express"].asBool();
+            std::string email = root["customer"]["email"].asString();
+            doNotOptimize(total);
+            doNotOptimize(express);
+            doNotOptimize(email);
+        });
+        // Проверка лимита вместе с чтением часов, как на пути запроса (allow читает их сам)
+        RateLimit limit{10, 20};
+        char key[16];
+        add("RateLimiter::allow/hot_key", [&]() {
+            bool allowed = rateLimiter.allow(formatIPv4(0, key), 1, limit);
+            doNotOptimize(allowed);
+        });
+        // Миллион разных IP в псевдослучайном порядке: таблица не помещается в кэш процессора.
+        // Адрес собирается на месте - в сервере он лежит в Connection и уже в кэше
+        constexpr uint32_t keyCount = 1u << 20;
+        if (filter.empty() || std::string("RateLimiter::allow/1M_keys").find(filter) != std::string::npos) {
+            for (uint32_t i = 0; i < keyCount; ++i) {
+                rateLimiter.allow(formatIPv4(i, key), 1, limit);
+            }
+        }
+        uint32_t keyIndex = 0;
+        add("RateLimiter::allow/1M_keys", [&]() {
+            keyIndex = (keyIndex + 0x9E3779B1u) & (keyCount - 1);
+            bool allowed = rateLimiter.allow(formatIPv4(keyIndex, key), 1, limit);
+            doNotOptimize(allowed);
+        });
+        add("TemplateEngine::replaceVariables/50_vars", [&]() {
+            std::string result = engine.replaceVariables(variablesTemplate, variablesContext);
+            doNotOptimize(result);
+        });
+        add("TemplateEngine::applyFilters/escape_1k", [&]() {
+            std::string result = engine.applyFilters(filterInput, "escape");
+            doNotOptimize(result);
+        });
+        add("TemplateEngine::applyFilters/upper_1k", [&]() {
+            std::string result = engine.applyFilters(filterInput, "upper");
+            doNotOptimize(result);
+        });
+        add("TemplateEngine::render/page", [&]() {
+            std::string result = engine.render("page.html", pageContext);
+            doNotOptimize(result);
+        });
+        add("TemplateEngine::render/inheritance_5_levels", [&]() {
+            std::string result = engine.render("level5.html", pageContext);
+            doNotOptimize(result);
+        });
+        add("TemplateEngine::render/loop_10k_rows", [&]() {
+            std::string result = engine.render("table.html", tableContext);
+            doNotOptimize(result);
+        });
+        return results;
+    }
+
+private:
+    double minSeconds;
+    FlaskCpp app;
+    TemplateEngine engine;
+    std::unique_ptr<Connection> connection = std::make_unique<Connection>();
+
+    std::string getRequest;
+    std::string postRequest;
+    std::string queryString;
+    std::string cookieHeader;
+    std::string encodedValue;
+    std::string routePattern = "/api/<version>/users/<id>/posts/<post>";
+    std::string routePath = "/api/v2/users/123456/posts/hello-world";
+    std::string routeMismatch = "/api/v2/users/123456/comments/hello-world";
+    std::string jsonBody;
+    std::vector<std::pair<std::string, std::string>> extraHeaders;
+    struct Order {
+        long long id;
+        std::string customer;
+        std::string comment;
+        double total;
+        bool paid;
+    };
+    std::vector<Order> orders;
+    std::string orderJson;
+    std::string orderJsonPretty;
+    JsonDocument jsonDocument;
+    std::string variablesTemplate;
+    TemplateEngine::Context variablesContext;
+    std::string filterInput;
+    TemplateEngine::Context pageContext;
+    TemplateEngine::Context tableContext;
+    RateLimiter rateLimiter{1 << 20};
+
+    // Адрес 10.x.y.z из номера без выделения памяти
+    static std::string_view formatIPv4(uint32_t index, char* buffer) {
+        char* out = buffer;
+        auto octet = [&out](uint32_t value) {
+            if (value >= 100) *out++ = char('0' + value / 100);
+            if (value >= 10) *out++ = char('0' + value / 10 % 10);
+            *out++ = char('0' + value % 10);
+        };
+        octet(10);
+        *out++ = '.';
+        octet((index >> 16) & 0xFF);
+        *out++ = '.';
+        octet((index >> 8) & 0xFF);
+        *out++ = '.';
+        octet(index & 0xFF);
+        return std::string_view(buffer, out - buffer);
+    }
+
+    void resetConnection(Connection& conn) {
+        conn.resetRequest();
+        conn.request.arena = RequestArena::forThisThread().resource();
+        RequestArena::forThisThread().reset();
+    }
+
+    void buildCorpus() {
+        // Куки как у типичного сайта с аналитикой: 30 пар, ~1.5 КБ
+        for (int i = 0; i < 30; ++i) {
+            if (i) cookieHeader += "; ";
+            cookieHeader += "cookie_name_" + std::to_string(i) + "=" + std::string(40, char('a' + i % 26));
+        }
+
+        for (int i = 0; i < 20; ++i) {
+            if (i) queryString += "&";
+            queryString += "param" + std::to_string(i) + "=value%20" + std::to_string(i) + "%2Fwith%3Dencoding+and+spaces";
+        }
+
+        for (int i = 0; i < 64; ++i) {
+            encodedValue += "%D0%9F%D1%80%D0%B8+text%2F";
+        }
+
+        getRequest =
+            "GET /api/v2/users/123456/posts?" + queryString + " HTTP/1.1\r\n"
+            "Host: www.example.com\r\n"
+            "Connection: keep-alive\r\n"
+            "Cache-Control: max-age=0\r\n"
+            "sec-ch-ua: \"Chromium\";v=\"118\", \"Google Chrome\";v=\"118\", \"Not=A?Brand\";v=\"99\"\r\n"
+            "sec-ch-ua-mobile: ?0\r\n"
+            "sec-ch-ua-platform: \"Linux\"\r\n"
+            "Upgrade-Insecure-Requests: 1\r\n"
+            "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/118.0.0.0 Safari/537.36\r\n"
+            "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,image/apng,*/*;q=0.8\r\n"
+            "Sec-Fetch-Site: same-origin\r\n"
+            "Sec-Fetch-Mode: navigate\r\n"
+            "Sec-Fetch-User: ?1\r\n"
+            "Sec-Fetch-Dest: document\r\n"
+            "Referer: https://www.example.com/api/v2/users/123456\r\n"
+            "Accept-Encoding: gzip, deflate, br\r\n"
+            "Accept-Language: ru-RU,ru;q=0.9,en-US;q=0.8,en;q=0.7\r\n"
+            "Cookie: " + cookieHeader + "\r\n"
+            "\r\n";
+
+        std::string form = "username=%D0%98%D0%B2%D0%B0%D0%BD&email=ivan%40example.com&comment=" + encodedValue;
+        postRequest =
+            "POST /submit HTTP/1.1\r\n"
+            "Host: www.example.com\r\n"
+            "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/118.0.0.0 Safari/537.36\r\n"
+            "Content-Type: application/x-www-form-urlencoded\r\n"
+            "Content-Length: " + std::to_string(form.size()) + "\r\n"
+            "Cookie: " + cookieHeader + "\r\n"
+            "\r\n" + form;
+
+        jsonBody = R"({"status":"ok","items":[)";
+        for (int i = 0; i < 20; ++i) {
+            if (i) jsonBody += ",";
+            jsonBody += R"({"id":)" + std::to_string(i) + R"(,"name":"item )" + std::to_string(i) + R"("})";
+        }
+        jsonBody += "]}";
+        extraHeaders = {
+            {"Set-Cookie", "User=JohnDoe; Path=/; HttpOnly; SameSite=Lax"},
+            {"Set-Cookie", "SessionID=abc123; Path=/; HttpOnly; Secure; SameSite=Strict"},
+            {"Cache-Control", "no-store"},
+        };
+
+        for (int i = 0; i < 20; ++i) {
+            orders.push_back({100000 + i, "Customer " + std::to_string(i),
+                              "Leave at the door, ring twice. Order number " + std::to_string(i), 1234.5 + i, i % 3 != 0});
+        }
+
+        // Заказ интернет-магазина: покупатель, адрес, 30 позиций с описаниями и тегами
+        orderJson = R"({"id":"ord_8f3a2c","created":"2024-03-01T12:34:56Z","customer":{"id":48213,"name":"Иван Петров",)"
+                    R"("email":"ivan.petrov@example.com","phone":"+7 900 123-45-67"},"delivery":{"express":true,)"
+                    R"("address":{"city":"Москва","street":"ул. Тверская, д. 1","zip":"125009"},"comment":"Домофон \"12\", позвонить заранее"},"items":[)";
+        for (int i = 0; i < 30; ++i) {
+            if (i) orderJson += ",";
+            orderJson += R"({"sku":"SKU-)" + std::to_string(10000 + i) + R"(","name":"Товар номер )" + std::to_string(i) +
+                         R"(","description":"Подробное описание товара с характеристиками и условиями гарантии",)"
+                         R"("price":)" + std::to_string(99 + i) + ".90" + R"(,"quantity":)" + std::to_string(1 + i % 4) +
+                         R"(,"tags":["new","sale","category-)" + std::to_string(i % 7) + R"("],"gift":false})";
+        }
+        orderJson += R"(],"payment":{"method":"card","paid":true,"amount":12345.67}})";
+        // Тот же заказ с отступами, как у клиентов, отправляющих форматированный JSON
+        int depth = 0;
+        bool inString = false;
+        for (size_t i = 0; i < orderJson.size(); ++i) {
+            char c = orderJson[i];
+            orderJsonPretty += c;
+            if (inString) {
+                if (c == '\\') orderJsonPretty += orderJson[++i];
+                else if (c == '"') inString = false;
+                continue;
+            }
+            if (c == '"') inString = true;
+            if (c == '{' || c == '[') ++depth;
+            if (c == '{' || c == '[' || c == ',') orderJsonPretty += "\n" + std::string(depth * 4, ' ');
+            if (c == ':') orderJsonPretty += ' ';
+            if (i + 1 < orderJson.size() && (orderJson[i + 1] == '}' || orderJson[i + 1] == ']')) {
+                --depth;
+                orderJsonPretty += "\n" + std::string(depth * 4, ' ');
+            }
+        }
+
+        for (int i = 0; i < 50; ++i) {
+            std::string name = "var" + std::to_string(i);
+            variablesTemplate += "<span>{{ " + name + (i % 5 == 0 ? " | escape" : "") + " }}</span>\n";
+            variablesContext[name] = std::string("value <") + std::to_string(i) + "> & more";
+        }
+
+        for (int i = 0; i < 64; ++i) {
+            filterInput += "<b>Text & \"quotes\"</b> ";
+        }
+
+        // Страница с include, if и небольшим циклом
+        engine.setTemplate("header.html", "<header><h1>{{ title }}</h1></header>");
+        engine.setTemplate("page.html",
+            "{# Комментарий #}<html><head><title>{{ title | upper }}</title></head><body>\n"
+            "{% include \"header.html\" %}\n"
+            "{% if show %}<p>{{ message | escape }}</p>{% else %}<p>hidden</p>{% endif %}\n"
+            "<ul>{% for item in items %}<li>{{ item.field }}</li>{% endfor %}</ul>\n"
+            "</body></html>");
+        std::vector<std::map<std::string, std::string>> items;
+        for (int i = 0; i < 10; ++i) {
+            items.push_back({{"field", "Элемент " + std::to_string(i)}});
+        }
+        pageContext = {
+            {"title", std::string("Добро пожаловать")},
+            {"show", true},
+            {"message", std::string("<b>Привет, мир!</b>")},
+            {"items", items},
+        };
+
+        // Цепочка наследования из пяти уровней
+        engine.setTemplate("level1.html",
+            "<html><head>{% block head %}<title>{{ title }}</title>{% endblock %}</head>"
+            "<body>{% block nav %}nav{% endblock %}{% block content %}base{% endblock %}{% block footer %}footer{% endblock %}</body></html>");
+        for (int level = 2; level <= 5; ++level) {
+            std::string blockName = level == 2 ? "nav" : level == 3 ? "footer" : "content";
+            engine.setTemplate("level" + std::to_string(level) + ".html",
+                "{% extends \"level" + std::to_string(level - 1) + ".html\" %}"
+                "{% block " + blockName + " %}<div>level " + std::to_string(level) + ": {{ message }}</div>{% endblock %}");
+        }
+
+        // Таблица на 10 000 строк
+        engine.setTemplate("table.html",
+            "<table>{% for row in rows %}<tr><td>{{ row.id }}</td><td>{{ row.name }}</td></tr>{% endfor %}</table>");
+        std::vector<std::map<std::string, std::string>> rows;
+        rows.reserve(10000);
+        for (int i = 0; i < 10000; ++i) {
+            rows.push_back({{"id", std::to_string(i)}, {"name", "row " + std::to_string(i)}});
+        }
+        tableContext = {{"rows", rows}};
+    }
+
+    BenchResult measure(const std::string& name, const std::function<void()>& body) {
+        using Clock = std::chrono::steady_clock;
+        BenchResult result;
+        result.name = name;
+        uint64_t batch = 1;
+        double elapsed = 0;
+        unsigned long long allocations = 0;
+        unsigned long long bytes = 0;
+
+        // Прогрев: кэши, пулы узлов и арена запроса. Операция дольше отведённого времени
+        // (например, цикл на 10 000 строк) не повторяется - прогрев и есть единственный замер
+        {
+            unsigned long long allocationsBefore = AllocationCounter::threadAllocations();
+            unsigned long long bytesBefore = AllocationCounter::threadBytes();
+            auto start = Clock::now();
+            body();
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            if (seconds >= minSeconds) {
+                elapsed = seconds;
+                allocations = AllocationCounter::threadAllocations() - allocationsBefore;
+                bytes = AllocationCounter::threadBytes() - bytesBefore;
+                result.iterations = 1;
+            }
+        }
+
+        while (elapsed < minSeconds) {
+            unsigned long long allocationsBefore = AllocationCounter::threadAllocations();
+            unsigned long long bytesBefore = AllocationCounter::threadBytes();
+            auto start = Clock::now();
+            for (uint64_t i = 0; i < batch; ++i) {
+                body();
+            }
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            allocations += AllocationCounter::threadAllocations() - allocationsBefore;
+            bytes += AllocationCounter::threadBytes() - bytesBefore;
+            elapsed += seconds;
+            result.iterations += batch;
+            // Увеличиваем пачку, пока одна пачка не займёт заметное время
+            if (seconds < minSeconds / 10) batch *= 2;
+        }
+        result.nsPerOp = elapsed * 1e9 / result.iterations;
+        result.allocsPerOp = double(allocations) / result.iterations;
+        result.bytesPerOp = double(bytes) / result.iterations;
+        return result;
+    }
+
+    static void print(const BenchResult& r) {
+        std::cout << std::left << std::setw(48) << r.name << std::right
+                  << std::setw(16) << std::fixed << std::setprecision(1) << r.nsPerOp << " ns/op"
+                  << std::setw(14) << std::setprecision(2) << r.allocsPerOp << " allocs/op"
+                  << std::setw(14) << std::setprecision(0) << r.bytesPerOp << " B/op" << std::endl;
+    }
+};
+
+// Формат базового файла: по строке на бенчмарк - "имя ns/op allocs/op bytes/op"
+static std::map<std::string, BenchResult> loadBaseline(const std::string& path) {
+    std::map<std::string, BenchResult> baseline;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream iss(line);
+        BenchResult r;
+        if (iss >> r.name >> r.nsPerOp >> r.allocsPerOp >> r.bytesPerOp) {
+            baseline[r.name] = r;
+        }
+    }
+    return baseline;
+}
+
+static bool saveBaseline(const std::string& path, const std::vector<BenchResult>& results) {
+    std::ofstream out(path);
+    if (!out) return false;
+    out << "# name ns/op allocs/op bytes/op\n";
+    for (const auto& r : results) {
+        out << r.name << " " << std::fixed << std::setprecision(1) << r.nsPerOp << " "
+            << std::setprecision(3) << r.allocsPerOp << " " << std::setprecision(0) << r.bytesPerOp << "\n";
+    }
+    return bool(out);
+}
+
+static std::string formatDelta(double current, double base) {
+    if (base <= 0) return current >= 0.05 ? "new" : "=";
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%+.1f%%", (current - base) * 100.0 / base);
+    return buffer;
+}
+
+int main(int argc, char* argv[]) {
+    std::string filter;
+    std::string baselinePath;
+    std::string savePath;
+    double minSeconds = 0.5;
+    double timeThreshold = 10.0; // Процент замедления, считающийся регрессией
+    bool failOnTime = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--baseline" && i + 1 < argc) {
+            baselinePath = argv[++i];
+        } else if (arg == "--save" && i + 1 < argc) {
+            savePath = argv[++i];
+        } else if (arg == "--time" && i + 1 < argc) {
+            minSeconds = std::atof(argv[++i]);
+        } else if (arg == "--threshold" && i + 1 < argc) {
+            timeThreshold = std::atof(argv[++i]);
+        } else if (arg == "--fail-on-time") {
+            failOnTime = true;
+        } else {
+            std::cerr << "Usage: microbench [--filter SUBSTR] [--time SEC] [--baseline FILE] [--save FILE]"
+                         " [--threshold PERCENT] [--fail-on-time]" << std::endl;
+            return 1;
+        }
+    }
+
+    MicroBenchmarks benchmarks(minSeconds);
+    std::vector<BenchResult> results = benchmarks.runAll(filter);
+
+    int status = 0;
+    if (!baselinePath.empty()) {
+        std::map<std::string, BenchResult> baseline = loadBaseline(baselinePath);
+        if (baseline.empty()) {
+            std::cerr << "Baseline is empty or missing: " << baselinePath << std::endl;
+        } else {
+            // Число выделений не зависит от машины и сравнивается строго; время - с порогом
+            std::cout << "\nComparison with " << baselinePath << ":\n";
+            for (const auto& r : results) {
+                auto it = baseline.find(r.name);
+                if (it == baseline.end()) {
+                    std::cout << "  " << std::left << std::setw(48) << r.name << " (not in baseline)\n";
+                    continue;
+                }
+                const BenchResult& base = it->second;
+                bool slower = base.nsPerOp > 0 && (r.nsPerOp - base.nsPerOp) * 100.0 / base.nsPerOp > timeThreshold;
+                // Редкие выделения (рост пула узлов, перестройка кэша) дают доли на операцию - их не считаем
+                bool moreAllocations = r.allocsPerOp > base.allocsPerOp * 1.01 + 0.05;
+                std::cout << "  " << std::left << std::setw(48) << r.name << std::right
+                          << std::setw(10) << formatDelta(r.nsPerOp, base.nsPerOp) << " time"
+                          << std::setw(10) << formatDelta(r.allocsPerOp, base.allocsPerOp) << " allocs"
+                          << std::setw(10) << formatDelta(r.bytesPerOp, base.bytesPerOp) << " bytes"
+                          << (moreAllocations ? "  REGRESSION (allocations)" : slower ? "  REGRESSION (time)" : "")
+                          << "\n";
+                if (moreAllocations || (slower && failOnTime)) status = 2;
+            }
+        }
+    }
+
+    if (!savePath.empty()) {
+        if (!saveBaseline(savePath, results)) {
+            std::cerr << "Failed to write baseline: " << savePath << std::endl;
+            return 1;
+        }
+        std::cout << "Baseline saved to " << savePath << std::endl;
+    }
+    return status;
+}
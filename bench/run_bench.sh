@@ -0,0 +1,86 @@
+#!/bin/sh
+# Стандартные сценарии нагрузки для FlaskCpp (make bench).
+# Сервер запускается во временном каталоге с собственными шаблонами и статикой,
+# результаты каждого сценария дописываются JSON-строкой в BENCH_OUTPUT.
+#
+# Переменные окружения:
+#   BENCH_PORT         порт сервера (8099)
+#   BENCH_DURATION     секунд на сценарий (5)
+#   BENCH_CONNECTIONS  соединений (32)
+#   BENCH_THREADS      потоков генератора нагрузки (2)
+#   BENCH_RATE         частота для сценария открытого цикла, запросов/с (2000)
+#   BENCH_OUTPUT       файл результатов (bin/bench-results.jsonl)
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+PORT=${BENCH_PORT:-8099}
+DURATION=${BENCH_DURATION:-5}
+CONNECTIONS=${BENCH_CONNECTIONS:-32}
+THREADS=${BENCH_THREADS:-2}
+RATE=${BENCH_RATE:-2000}
+OUTPUT=${BENCH_OUTPUT:-$ROOT/bin/bench-results.jsonl}
+
+SERVER="$ROOT/bin/server"
+LOADGEN="$ROOT/bin/loadgen"
+WORKDIR=$(mktemp -d)
+SERVER_PID=""
+
+cleanup() {
+    if [ -n "$SERVER_PID" ]; then
+        kill "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+    fi
+    rm -rf "$WORKDIR"
+}
+trap cleanup EXIT INT TERM
+
+# Шаблоны и статика для сценариев
+mkdir -p "$WORKDIR/templates" "$WORKDIR/static"
+cat > "$WORKDIR/templates/main.html" <<'EOF'
+<html><head><title>{{ title }}</title></head><body>
+{% if show %}<p>{{ message }}</p>{% endif %}
+<ul>{% for item in items %}<li>{{ item.field }}</li>{% endfor %}</ul>
+</body></html>
+EOF
+cat > "$WORKDIR/templates/user.html" <<'EOF'
+<html><body><h1>User ID: {{ userId }}</h1></body></html>
+EOF
+head -c 4096 /dev/zero | tr '\0' 'x' > "$WORKDIR/static/bench.txt"
+
+(cd "$WORKDIR" && LD_LIBRARY_PATH="$ROOT/lib${LD_LIBRARY_PATH:+:$LD_LIBRARY_PATH}" \
+    exec "$SERVER" --port "$PORT" --no-hot-reload > "$WORKDIR/server.log" 2>&1) &
+SERVER_PID=$!
+
+# Ждём, пока сервер начнёт принимать соединения
+i=0
+until "$LOADGEN" --port "$PORT" --path /api/data --connections 1 --threads 1 --warmup 0 --duration 0.05 > /dev/null 2>&1; do
+    i=$((i + 1))
+    if [ "$i" -ge 50 ]; then
+        echo "Сервер не запустился, журнал:" >&2
+        cat "$WORKDIR/server.log" >&2
+        exit 1
+    fi
+    sleep 0.2
+done
+
+mkdir -p "$(dirname "$OUTPUT")"
+: > "$OUTPUT"
+
+run() {
+    name=$1
+    shift
+    echo "== $name"
+    "$LOADGEN" --port "$PORT" --connections "$CONNECTIONS" --threads "$THREADS" --duration "$DURATION" \
+        --name "$name" --json "$@" | tee -a "$OUTPUT"
+}
+
+run hello              --path /api/data
+run param_route        --path /user/42
+run template_render    --path /
+run static_file        --path /static/bench.txt
+run not_found          --path /nonexistent
+run hello_pipelined    --path /api/data --pipeline 8
+run hello_no_keepalive --path /api/data --no-keep-alive
+run hello_open_loop    --path /api/data --rate "$RATE"
+
+echo "Результаты записаны в $OUTPUT"
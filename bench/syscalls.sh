@@ -0,0 +1,105 @@
+#!/bin/sh
+# Системные вызовы сервера на запрос: epoll против io_uring (make bench-syscalls).
+# Для каждого бэкенда сервер запускается заново, bin/syscount считает вызовы всех его потоков,
+# пока bin/loadgen выполняет сценарий. ptrace замедляет сервер, поэтому число запросов в секунду
+# здесь не показательно - сравнивается только число вызовов на запрос. Под ptrace цикл io_uring
+# собирает в один io_uring_enter меньше событий, чем без него, так что его результат - оценка сверху.
+#
+# Переменные окружения:
+#   BENCH_PORT         порт сервера (8099)
+#   BENCH_DURATION     секунд на сценарий (2)
+#   BENCH_CONNECTIONS  соединений (16)
+#   BENCH_OUTPUT       файл результатов (bin/syscalls-results.jsonl)
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+PORT=${BENCH_PORT:-8099}
+DURATION=${BENCH_DURATION:-2}
+CONNECTIONS=${BENCH_CONNECTIONS:-16}
+OUTPUT=${BENCH_OUTPUT:-$ROOT/bin/syscalls-results.jsonl}
+
+SERVER="$ROOT/bin/server"
+LOADGEN="$ROOT/bin/loadgen"
+SYSCOUNT="$ROOT/bin/syscount"
+WORKDIR=$(mktemp -d)
+SERVER_PID=""
+
+stop_server() {
+    if [ -n "$SERVER_PID" ]; then
+        kill "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+        SERVER_PID=""
+    fi
+}
+
+cleanup() {
+    stop_server
+    rm -rf "$WORKDIR"
+}
+trap cleanup EXIT INT TERM
+
+mkdir -p "$WORKDIR/templates" "$WORKDIR/static"
+cat > "$WORKDIR/templates/main.html" <<'EOF'
+<html><head><title>{{ title }}</title></head><body><p>{{ message }}</p></body></html>
+EOF
+head -c 4096 /dev/zero | tr '\0' 'x' > "$WORKDIR/static/bench.txt"
+
+start_server() {
+    (cd "$WORKDIR" && LD_LIBRARY_PATH="$ROOT/lib${LD_LIBRARY_PATH:+:$LD_LIBRARY_PATH}" \
+        exec "$SERVER" --port "$PORT" --no-hot-reload "$@" > "$WORKDIR/server.log" 2>&1) &
+    SERVER_PID=$!
+    i=0
+    until "$LOADGEN" --port "$PORT" --path /api/data --connections 1 --threads 1 --warmup 0 --duration 0.05 > /dev/null 2>&1; do
+        i=$((i + 1))
+        if [ "$i" -ge 50 ]; then
+            echo "Сервер не запустился, журнал:" >&2
+            cat "$WORKDIR/server.log" >&2
+            exit 1
+        fi
+        sleep 0.2
+    done
+}
+
+# Число из JSON-строки по имени поля
+field() {
+    printf '%s\n' "$1" | sed -n "s/.*\"$2\":\([0-9.]*\).*/\1/p"
+}
+
+run() {
+    backend=$1
+    name=$2
+    shift 2
+    result=$("$SYSCOUNT" --pid "$SERVER_PID" --json -- "$LOADGEN" --port "$PORT" --connections "$CONNECTIONS" \
+        --threads 2 --warmup 0 --duration "$DURATION" --name "$name" --json "$@")
+    load=$(printf '%s\n' "$result" | head -n 1)
+    counts=$(printf '%s\n' "$result" | tail -n 1)
+    requests=$(field "$load" requests)
+    syscalls=$(field "$counts" syscalls)
+    per_request=$(awk -v s="$syscalls" -v r="$requests" 'BEGIN { printf "%.2f", (r > 0 ? s / r : 0) }')
+    top=$(printf '%s\n' "$counts" | sed -n 's/.*"top":\({.*}\)}$/\1/p')
+    printf '%-9s %-16s requests %-8s syscalls %-9s per request %s\n' "$backend" "$name" "$requests" "$syscalls" "$per_request"
+    printf '{"backend":"%s","name":"%s","requests":%s,"syscalls":%s,"syscalls_per_request":%s,"top":%s}\n' \
+        "$backend" "$name" "$requests" "$syscalls" "$per_request" "$top" >> "$OUTPUT"
+}
+
+mkdir -p "$(dirname "$OUTPUT")"
+: > "$OUTPUT"
+
+for backend in epoll io_uring; do
+    if [ "$backend" = io_uring ]; then
+        start_server --io-uring
+        if grep -q "falling back to epoll" "$WORKDIR/server.log"; then
+            echo "io_uring недоступен, журнал:" >&2
+            cat "$WORKDIR/server.log" >&2
+            exit 1
+        fi
+    else
+        start_server
+    fi
+    run "$backend" hello           --path /api/data
+    run "$backend" static_file     --path /static/bench.txt
+    run "$backend" hello_pipelined --path /api/data --pipeline 8
+    stop_server
+done
+
+echo "Результаты записаны в $OUTPUT"
@@ -0,0 +1,197 @@
+// bench/syscount.cpp
+// Счётчик системных вызовов работающего процесса (все потоки) на время выполнения команды,
+// обычно генератора нагрузки. Работает через ptrace, поэтому сильно замедляет процесс:
+// годится для сравнения числа вызовов на запрос, но не для измерения пропускной способности.
+//
+// Пример:
+//   bin/syscount --pid $(pidof server) -- bin/loadgen --port 8080 --path /api/data --warmup 0 --duration 2
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+struct Options {
+    pid_t pid = 0;
+    size_t top = 10;          // Сколько самых частых вызовов показать
+    bool json = false;
+    std::vector<char*> command;
+};
+
+static void usage() {
+    std::cerr <<
+        "Usage: syscount --pid PID [options] -- COMMAND [ARGS...]\n"
+        "  --pid PID             процесс, вызовы которого считаются\n"
+        "  --top N               показать N самых частых вызовов (10)\n"
+        "  --json                отчёт одной JSON-строкой\n";
+}
+
+static bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char* value = nullptr;
+        if (arg == "--") {
+            options.command.assign(argv + i + 1, argv + argc);
+            break;
+        } else if (arg == "--json") {
+            options.json = true;
+        } else if (arg == "--help" || arg == "-h") {
+            return false;
+        } else if (arg == "--pid") {
+            if (!(value = next())) return false;
+            options.pid = static_cast<pid_t>(std::atol(value));
+        } else if (arg == "--top") {
+            if (!(value = next())) return false;
+            options.top = static_cast<size_t>(std::atol(value));
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return false;
+        }
+    }
+    if (options.command.empty()) return false;
+    options.command.push_back(nullptr);
+    return options.pid > 0;
+}
+
+// Имена вызовов, которые обычно встречаются на пути запроса; остальные выводятся номером
+static std::string syscallName(long nr) {
+    static const std::map<long, const char*> names = {
+        {SYS_read, "read"}, {SYS_write, "write"}, {SYS_readv, "readv"}, {SYS_writev, "writev"},
+        {SYS_recvfrom, "recvfrom"}, {SYS_sendto, "sendto"}, {SYS_recvmsg, "recvmsg"}, {SYS_sendmsg, "sendmsg"},
+        {SYS_accept, "accept"}, {SYS_accept4, "accept4"}, {SYS_close, "close"}, {SYS_shutdown, "shutdown"},
+        {SYS_poll, "poll"}, {SYS_ppoll, "ppoll"}, {SYS_epoll_wait, "epoll_wait"}, {SYS_epoll_pwait, "epoll_pwait"},
+        {SYS_epoll_ctl, "epoll_ctl"}, {SYS_futex, "futex"}, {SYS_io_uring_enter, "io_uring_enter"},
+        {SYS_openat, "openat"}, {SYS_fstat, "fstat"}, {SYS_newfstatat, "newfstatat"}, {SYS_statx, "statx"},
+        {SYS_setsockopt, "setsockopt"}, {SYS_getsockopt, "getsockopt"}, {SYS_getpeername, "getpeername"},
+        {SYS_clock_nanosleep, "clock_nanosleep"}, {SYS_nanosleep, "nanosleep"}, {SYS_mmap, "mmap"},
+        {SYS_munmap, "munmap"}, {SYS_madvise, "madvise"}, {SYS_brk, "brk"}, {SYS_mprotect, "mprotect"},
+        {SYS_getrandom, "getrandom"}, {SYS_sched_yield, "sched_yield"}, {SYS_lseek, "lseek"}, {SYS_pread64, "pread64"},
+    };
+    auto it = names.find(nr);
+    return it != names.end() ? it->second : "syscall_" + std::to_string(nr);
+}
+
+// Потоки процесса на момент подключения; новые подхватываются через PTRACE_O_TRACECLONE
+static std::vector<pid_t> processThreads(pid_t pid) {
+    std::vector<pid_t> threads;
+    std::string path = "/proc/" + std::to_string(pid) + "/task";
+    DIR* dir = opendir(path.c_str());
+    if (!dir) return threads;
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') threads.push_back(static_cast<pid_t>(std::atol(entry->d_name)));
+    }
+    closedir(dir);
+    return threads;
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage();
+        return 1;
+    }
+
+    std::set<pid_t> traced;
+    for (pid_t tid : processThreads(options.pid)) {
+        if (ptrace(PTRACE_SEIZE, tid, nullptr, PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACECLONE) == 0 &&
+            ptrace(PTRACE_INTERRUPT, tid, nullptr, nullptr) == 0) {
+            traced.insert(tid);
+        }
+    }
+    if (traced.empty()) {
+        std::cerr << "Cannot trace process " << options.pid << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    pid_t child = fork();
+    if (child == 0) {
+        execvp(options.command[0], options.command.data());
+        std::perror(options.command[0]);
+        _exit(127);
+    }
+
+    std::map<long, unsigned long long> counts;
+    unsigned long long total = 0;
+    int commandStatus = 0;
+    bool detaching = false;
+    while (!traced.empty()) {
+        int status;
+        pid_t tid = waitpid(-1, &status, __WALL);
+        if (tid == -1) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (tid == child) {
+            // Команда завершилась: останавливаем потоки и отключаемся от каждого при его остановке
+            commandStatus = status;
+            detaching = true;
+            for (pid_t thread : traced) {
+                ptrace(PTRACE_INTERRUPT, thread, nullptr, nullptr);
+            }
+            continue;
+        }
+        if (WIFEXITED(status) || WIFSIGNALED(status)) {
+            traced.erase(tid);
+            continue;
+        }
+        if (!WIFSTOPPED(status)) continue;
+        traced.insert(tid);
+
+        int signal = WSTOPSIG(status);
+        int event = status >> 16;
+        int inject = 0;
+        if (signal == (SIGTRAP | 0x80)) {
+            __ptrace_syscall_info info = {};
+            if (ptrace(PTRACE_GET_SYSCALL_INFO, tid, sizeof(info), &info) > 0 && info.op == PTRACE_SYSCALL_INFO_ENTRY) {
+                ++counts[static_cast<long>(info.entry.nr)];
+                ++total;
+            }
+        } else if (event == 0 && signal != SIGTRAP) {
+            // Сигнал, адресованный процессу, доставляется как обычно
+            inject = signal;
+        }
+        if (detaching) {
+            ptrace(PTRACE_DETACH, tid, nullptr, inject);
+            traced.erase(tid);
+        } else {
+            ptrace(PTRACE_SYSCALL, tid, nullptr, inject);
+        }
+    }
+    if (!detaching) {
+        waitpid(child, &commandStatus, 0);
+    }
+
+    std::vector<std::pair<unsigned long long, long>> sorted;
+    for (const auto& [nr, count] : counts) sorted.emplace_back(count, nr);
+    std::sort(sorted.rbegin(), sorted.rend());
+    sorted.resize(std::min(sorted.size(), options.top));
+
+    if (options.json) {
+        std::string out = "{\"pid\":" + std::to_string(options.pid) + ",\"syscalls\":" + std::to_string(total) + ",\"top\":{";
+        for (size_t i = 0; i < sorted.size(); ++i) {
+            if (i) out += ",";
+            out += "\"" + syscallName(sorted[i].second) + "\":" + std::to_string(sorted[i].first);
+        }
+        out += "}}";
+        std::cout << out << std::endl;
+    } else {
+        std::cout << "Syscalls:    " << total << " (pid " << options.pid << ")\n";
+        for (const auto& [count, nr] : sorted) {
+            std::cout << "  " << syscallName(nr) << " " << count << "\n";
+        }
+        std::cout.flush();
+    }
+    return WIFEXITED(commandStatus) ? WEXITSTATUS(commandStatus) : 1;
+}
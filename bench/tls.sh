@@ -0,0 +1,95 @@
+#!/bin/sh
+# TLS против открытого HTTP (make bench-tls): полные и возобновлённые рукопожатия, запросы
+# по keep-alive соединению и передача большого файла. Для каждого транспорта сервер запускается
+# заново; сертификат (ECDSA P-256) и ключи session tickets создаются во временном каталоге.
+# Генератор нагрузки и сервер делят процессоры машины, поэтому абсолютные числа зависят от неё -
+# сравниваются строки одного сценария.
+#
+# Переменные окружения:
+#   BENCH_PORT         порт сервера (8099)
+#   BENCH_DURATION     секунд на сценарий (3)
+#   BENCH_CONNECTIONS  соединений (8)
+#   BENCH_OUTPUT       файл результатов (bin/tls-results.jsonl)
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+PORT=${BENCH_PORT:-8099}
+DURATION=${BENCH_DURATION:-3}
+CONNECTIONS=${BENCH_CONNECTIONS:-8}
+OUTPUT=${BENCH_OUTPUT:-$ROOT/bin/tls-results.jsonl}
+
+SERVER="$ROOT/bin/server"
+LOADGEN="$ROOT/bin/loadgen"
+WORKDIR=$(mktemp -d)
+SERVER_PID=""
+
+stop_server() {
+    if [ -n "$SERVER_PID" ]; then
+        kill "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+        SERVER_PID=""
+    fi
+}
+
+cleanup() {
+    stop_server
+    rm -rf "$WORKDIR"
+}
+trap cleanup EXIT INT TERM
+
+mkdir -p "$WORKDIR/templates" "$WORKDIR/static"
+cat > "$WORKDIR/templates/main.html" <<'EOF'
+<html><head><title>{{ title }}</title></head><body><p>{{ message }}</p></body></html>
+EOF
+head -c 1048576 /dev/urandom > "$WORKDIR/static/large.bin"
+openssl req -x509 -newkey ec -pkeyopt ec_paramgen_curve:P-256 -nodes -days 1 -subj /CN=localhost \
+    -keyout "$WORKDIR/key.pem" -out "$WORKDIR/cert.pem" > /dev/null 2>&1
+head -c 80 /dev/urandom > "$WORKDIR/tickets.bin"
+
+start_server() {
+    (cd "$WORKDIR" && LD_LIBRARY_PATH="$ROOT/lib${LD_LIBRARY_PATH:+:$LD_LIBRARY_PATH}" \
+        exec "$SERVER" --port "$PORT" --no-hot-reload "$@" > "$WORKDIR/server.log" 2>&1) &
+    SERVER_PID=$!
+}
+
+wait_server() {
+    i=0
+    until "$LOADGEN" --port "$PORT" --path /api/data --connections 1 --threads 1 --warmup 0 --duration 0.05 "$@" > /dev/null 2>&1; do
+        i=$((i + 1))
+        if [ "$i" -ge 50 ]; then
+            echo "Сервер не запустился, журнал:" >&2
+            cat "$WORKDIR/server.log" >&2
+            exit 1
+        fi
+        sleep 0.2
+    done
+}
+
+run() {
+    transport=$1
+    name=$2
+    shift 2
+    echo "== $transport $name"
+    "$LOADGEN" --port "$PORT" --connections "$CONNECTIONS" --threads 2 --duration "$DURATION" \
+        --name "${transport}_$name" --json "$@" | tee -a "$OUTPUT"
+}
+
+mkdir -p "$(dirname "$OUTPUT")"
+: > "$OUTPUT"
+
+start_server
+wait_server
+run plain hello              --path /api/data
+run plain hello_no_keepalive --path /api/data --no-keep-alive
+run plain large_file         --path /static/large.bin
+stop_server
+
+start_server --tls-cert "$WORKDIR/cert.pem" --tls-key "$WORKDIR/key.pem" --tls-ticket-key "$WORKDIR/tickets.bin"
+wait_server --tls
+run tls hello                --path /api/data --tls
+run tls full_handshake       --path /api/data --tls --no-keep-alive
+run tls resumed_handshake    --path /api/data --tls --no-keep-alive --tls-resume
+run tls large_file           --path /static/large.bin --tls
+stop_server
+
+echo "Результаты записаны в $OUTPUT"
@@ -0,0 +1,124 @@
+"""
+Заглушка FastCGI-сервера (роль Responder) для локальной проверки PHP-пула без php-fpm.
+
+Запуск:
+    python3 fastcgi_stub.py /tmp/flaskcpp-php.sock
+    make php && ./bin/server --php-fastcgi /tmp/flaskcpp-php.sock
+
+Ответ на любой скрипт - текст с CGI-окружением, номером FastCGI-соединения (по порядку accept,
+чтобы проверить повторное использование соединений пула) и телом запроса. Заголовок X-Stub-Status
+в запросе задаёт возвращаемый Status, чтобы проверить передачу статуса.
+"""
+import os
+import socket
+import struct
+import sys
+import threading
+
+FCGI_BEGIN_REQUEST = 1
+FCGI_END_REQUEST = 3
+FCGI_PARAMS = 4
+FCGI_STDIN = 5
+FCGI_STDOUT = 6
+FCGI_KEEP_CONN = 1
+
+
+def read_exact(conn, size):
+    data = b""
+    while len(data) < size:
+        chunk = conn.recv(size - len(data))
+        if not chunk:
+            return None
+        data += chunk
+    return data
+
+
+def read_record(conn):
+    header = read_exact(conn, 8)
+    if header is None:
+        return None
+    _, rtype, request_id, length, padding, _ = struct.unpack(">BBHHBB", header)
+    content = read_exact(conn, length + padding)
+    if content is None:
+        return None
+    return rtype, request_id, content[:length]
+
+
+def decode_params(data):
+    params = {}
+    pos = 0
+    while pos < len(data):
+        lengths = []
+        for _ in range(2):
+            if data[pos] < 128:
+                lengths.append(data[pos])
+                pos += 1
+            else:
+                lengths.append(struct.unpack(">I", data[pos:pos + 4])[0] & 0x7FFFFFFF)
+                pos += 4
+        name = data[pos:pos + lengths[0]].decode()
+        pos += lengths[0]
+        params[name] = data[pos:pos + lengths[1]].decode()
+        pos += lengths[1]
+    return params
+
+
+def write_record(conn, rtype, request_id, content):
+    for offset in range(0, max(len(content), 1), 65535):
+        chunk = content[offset:offset + 65535]
+        padding = (8 - len(chunk) % 8) % 8
+        conn.sendall(struct.pack(">BBHHBB", 1, rtype, request_id, len(chunk), padding, 0) + chunk + b"\0" * padding)
+
+
+def serve_connection(conn, number):
+    with conn:
+        while True:
+            keep_conn = False
+            params_data = b""
+            stdin = b""
+            request_id = None
+            while True:
+                record = read_record(conn)
+                if record is None:
+                    return
+                rtype, rid, content = record
+                if rtype == FCGI_BEGIN_REQUEST:
+                    request_id = rid
+                    keep_conn = bool(content[2] & FCGI_KEEP_CONN)
+                elif rtype == FCGI_PARAMS:
+                    params_data += content
+                elif rtype == FCGI_STDIN:
+                    if not content:
+                        break
+                    stdin += content
+
+            params = decode_params(params_data)
+            status = params.get("HTTP_X_STUB_STATUS", "200 OK")
+            body = "".join(f"{name}={params.get(name, '')}\n" for name in (
+                "REQUEST_METHOD", "SCRIPT_FILENAME", "QUERY_STRING", "CONTENT_TYPE",
+                "CONTENT_LENGTH", "REMOTE_ADDR", "HTTP_USER_AGENT")) + f"pid={os.getpid()}\nconnection={number}\nbody={stdin.decode()}\n"
+            output = f"Status: {status}\r\nContent-Type: text/plain\r\nX-Stub: 1\r\n\r\n{body}".encode()
+            write_record(conn, FCGI_STDOUT, request_id, output)
+            write_record(conn, FCGI_STDOUT, request_id, b"")
+            write_record(conn, FCGI_END_REQUEST, request_id, struct.pack(">IB3x", 0, 0))
+            if not keep_conn:
+                return
+
+
+def main():
+    path = sys.argv[1] if len(sys.argv) > 1 else "/tmp/flaskcpp-php.sock"
+    if os.path.exists(path):
+        os.unlink(path)
+    server = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    server.bind(path)
+    server.listen(64)
+    print(f"FastCGI stub listening on {path}", flush=True)
+    number = 0
+    while True:
+        conn, _ = server.accept()
+        number += 1
+        threading.Thread(target=serve_connection, args=(conn, number), daemon=True).start()
+
+
+if __name__ == "__main__":
+    main()
@@ -26,6 +26,38 @@ int main(int argc, char* argv[]) {
     bool enableHotReload = true; // По умолчанию hot_reload включен
     size_t minThreads = 2;
     size_t maxThreads = 8;
+    std::string accessLogPath;
+    AccessLogFormat accessLogFormat = AccessLogFormat::Combined;
+    size_t accessLogMaxSize = 0;
+    long accessLogRotateSeconds = 0;
+    int compressionLevel = 0;
+    size_t compressionMinSize = 1024;
+    std::vector<std::string> proxySpecs;
+    UpstreamOptions proxyOptions;
+    bool http2 = false;
+    Http2Options http2Options;
+    std::string hotRestartPath;
+    long drainSeconds = -1;
+    long long maxRequestBody = -1;
+    bool overload = false;
+    RateLimit clientRateLimit{0, 0};
+    OverloadOptions overloadOptions;
+    std::string sessionSecret;
+    std::string sessionFile;
+    bool ioUring = false;
+    TlsOptions tlsOptions;
+    long preforkWorkers = -1;
+    bool incomingCpu = false;
+    AcceptOptions acceptOptions;
+    std::string profileToken;
+    std::string traceDirectory;
+    TracingOptions tracingOptions;
+    std::vector<std::string> latencyTargetSpecs;
+    ExecutorOptions executorOptions;
+    std::vector<std::string> blockingRoutes;
+#ifdef ENABLE_PHP
+    std::string phpFastCgi;
+#endif
 
     // Простейшая обработка аргументов командной строки
     for(int i = 1; i < argc; ++i){
@@ -45,6 +77,180 @@ int main(int argc, char* argv[]) {
         else if(arg == "--threads-max" && i + 1 < argc){
             maxThreads = std::atoi(argv[++i]);
         }
+        else if(arg == "--access-log" && i + 1 < argc){
+            accessLogPath = argv[++i];
+        }
+        else if(arg == "--access-log-format" && i + 1 < argc){
+            if(!AccessLog::parseFormat(argv[++i], accessLogFormat)){
+                std::cerr << "Неизвестный формат журнала доступа: " << argv[i] << " (common, combined, json)" << std::endl;
+                return 1;
+            }
+        }
+        else if(arg == "--access-log-max-size" && i + 1 < argc){
+            accessLogMaxSize = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if(arg == "--access-log-rotate" && i + 1 < argc){
+            accessLogRotateSeconds = std::atol(argv[++i]);
+        }
+        else if(arg == "--compress"){
+            if(compressionLevel == 0) compressionLevel = 6;
+        }
+        else if(arg == "--compress-level" && i + 1 < argc){
+            compressionLevel = std::atoi(argv[++i]);
+        }
+        else if(arg == "--compress-min-size" && i + 1 < argc){
+            compressionMinSize = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if(arg == "--proxy" && i + 1 < argc){
+            proxySpecs.push_back(argv[++i]);
+        }
+        else if(arg == "--proxy-policy" && i + 1 < argc){
+            std::string policy = argv[++i];
+            if(policy == "round-robin"){
+                proxyOptions.policy = BalancePolicy::RoundRobin;
+            } else if(policy == "least-conn"){
+                proxyOptions.policy = BalancePolicy::LeastConnections;
+            } else {
+                std::cerr << "Неизвестная стратегия балансировки: " << policy << " (round-robin, least-conn)" << std::endl;
+                return 1;
+            }
+        }
+        else if(arg == "--proxy-health" && i + 1 < argc){
+            proxyOptions.healthPath = argv[++i];
+        }
+        else if(arg == "--http2"){
+            http2 = true;
+        }
+        else if(arg == "--http2-max-streams" && i + 1 < argc){
+            http2 = true;
+            http2Options.maxConcurrentStreams = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if(arg == "--http2-max-connections" && i + 1 < argc){
+            http2 = true;
+            http2Options.maxConnections = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if(arg == "--http2-max-resets" && i + 1 < argc){
+            http2 = true;
+            http2Options.maxResetsPerSecond = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if(arg == "--hot-restart" && i + 1 < argc){
+            hotRestartPath = argv[++i];
+        }
+        else if(arg == "--drain-timeout" && i + 1 < argc){
+            drainSeconds = std::atol(argv[++i]);
+        }
+        else if(arg == "--rate-limit" && i + 1 < argc){
+            // RPS или RPS:BURST; без BURST допускается всплеск в две секунды
+            std::string spec = argv[++i];
+            size_t colon = spec.find(':');
+            clientRateLimit.requestsPerSecond = std::atof(spec.substr(0, colon).c_str());
+            clientRateLimit.burst = colon == std::string::npos ? clientRateLimit.requestsPerSecond * 2
+                                                                : std::atof(spec.substr(colon + 1).c_str());
+            if(clientRateLimit.requestsPerSecond <= 0){
+                std::cerr << "Неверный формат --rate-limit: " << spec << " (ожидается RPS[:BURST])" << std::endl;
+                return 1;
+            }
+        }
+        else if(arg == "--session-secret" && i + 1 < argc){
+            sessionSecret = argv[++i];
+        }
+        else if(arg == "--session-file" && i + 1 < argc){
+            sessionFile = argv[++i];
+        }
+        else if(arg == "--tls-cert" && i + 1 < argc){
+            tlsOptions.certificateFile = argv[++i];
+        }
+        else if(arg == "--tls-key" && i + 1 < argc){
+            tlsOptions.privateKeyFile = argv[++i];
+        }
+        else if(arg == "--tls-ticket-key" && i + 1 < argc){
+            tlsOptions.ticketKeyFile = argv[++i];
+        }
+        else if(arg == "--no-ktls"){
+            tlsOptions.kernelTls = false;
+        }
+        else if(arg == "--prefork" && i + 1 < argc){
+            preforkWorkers = std::atol(argv[++i]);
+        }
+        else if(arg == "--incoming-cpu"){
+            incomingCpu = true;
+        }
+        else if(arg == "--accept-batch" && i + 1 < argc){
+            acceptOptions.batch = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if(arg == "--defer-accept" && i + 1 < argc){
+            acceptOptions.deferAccept = std::chrono::seconds(std::atol(argv[++i]));
+        }
+        else if(arg == "--tcp-fastopen" && i + 1 < argc){
+            acceptOptions.fastOpenQueue = std::atoi(argv[++i]);
+        }
+        else if(arg == "--profile-token" && i + 1 < argc){
+            profileToken = argv[++i];
+        }
+        else if(arg == "--trace-dir" && i + 1 < argc){
+            traceDirectory = argv[++i];
+        }
+        else if(arg == "--trace-format" && i + 1 < argc){
+            if(!Tracer::parseFormat(argv[++i], tracingOptions.format)){
+                std::cerr << "Неизвестный формат трасс: " << argv[i] << " (chrome, otlp)" << std::endl;
+                return 1;
+            }
+        }
+        else if(arg == "--trace-sampling" && i + 1 < argc){
+            if(!Tracer::parseSampling(argv[++i], tracingOptions.sampling)){
+                std::cerr << "Неизвестный режим выборки трасс: " << argv[i] << " (head, tail)" << std::endl;
+                return 1;
+            }
+        }
+        else if(arg == "--trace-rate" && i + 1 < argc){
+            tracingOptions.sampleRate = std::atof(argv[++i]);
+        }
+        else if(arg == "--trace-slow-ms" && i + 1 < argc){
+            tracingOptions.slowThreshold = std::chrono::milliseconds(std::atol(argv[++i]));
+        }
+        else if(arg == "--io-uring"){
+            ioUring = true;
+        }
+        else if(arg == "--max-connections" && i + 1 < argc){
+            overload = true;
+            overloadOptions.maxConnections = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if(arg == "--max-inflight" && i + 1 < argc){
+            overload = true;
+            overloadOptions.maxInFlightRequests = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if(arg == "--max-queue" && i + 1 < argc){
+            overload = true;
+            overloadOptions.maxQueueDepth = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if(arg == "--reserve-get" && i + 1 < argc){
+            overload = true;
+            overloadOptions.reserved[1] = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if(arg == "--queue-delay-target" && i + 1 < argc){
+            overload = true;
+            overloadOptions.queueDelayTarget = std::chrono::milliseconds(std::atol(argv[++i]));
+        }
+        else if(arg == "--max-request-body" && i + 1 < argc){
+            maxRequestBody = std::atoll(argv[++i]);
+        }
+        else if(arg == "--latency-target" && i + 1 < argc){
+            latencyTargetSpecs.push_back(argv[++i]);
+        }
+        else if(arg == "--blocking-threads-min" && i + 1 < argc){
+            executorOptions.blockingMinThreads = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if(arg == "--blocking-threads-max" && i + 1 < argc){
+            executorOptions.blockingMaxThreads = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if(arg == "--blocking-route" && i + 1 < argc){
+            blockingRoutes.push_back(argv[++i]);
+        }
+#ifdef ENABLE_PHP
+        else if(arg == "--php-fastcgi" && i + 1 < argc){
+            phpFastCgi = argv[++i];
+        }
+#endif
     }
 
     // Проверка корректности значений
@@ -55,6 +261,152 @@ int main(int argc, char* argv[]) {
 
     FlaskCpp app(port, verbose, enableHotReload, minThreads, maxThreads);
 
+    // Пул блокирующих задач: --blocking-route PATH переносит туда хендлер маршрута целиком
+    try{
+        app.setExecutorOptions(executorOptions);
+    }
+    catch(const std::exception& e){
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    // Журнал доступа (ротация по размеру в байтах и по времени в секундах)
+    if(!accessLogPath.empty()){
+        app.enableAccessLog(accessLogPath, accessLogFormat, accessLogMaxSize, std::chrono::seconds(accessLogRotateSeconds));
+    }
+
+    // Трассировка запросов: --trace-dir DIR, формат chrome (открыть в ui.perfetto.dev) или otlp,
+    // выборка head (доля --trace-rate) или tail (медленнее --trace-slow-ms, 5xx и доля --trace-rate остальных)
+    if(!traceDirectory.empty()){
+        tracingOptions.directory = traceDirectory;
+        try{
+            app.enableTracing(tracingOptions);
+        }
+        catch(const std::exception& e){
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    // Сжатие ответов gzip/deflate: --compress или --compress-level 1..9
+    if(compressionLevel > 0){
+        app.enableCompression(compressionLevel, compressionMinSize);
+    }
+
+    // HTTP/2 без TLS: curl --http2-prior-knowledge или curl --http2 (Upgrade: h2c)
+    if(http2){
+        app.enableHttp2(http2Options);
+    }
+
+    // HTTPS: --tls-cert и --tls-key в PEM. --tls-ticket-key - файл из 80 случайных байт
+    // (head -c 80 /dev/urandom), общий для процессов при горячем перезапуске
+    if(!tlsOptions.certificateFile.empty() || !tlsOptions.privateKeyFile.empty()){
+        if(tlsOptions.certificateFile.empty() || tlsOptions.privateKeyFile.empty()){
+            std::cerr << "Для TLS нужны оба параметра: --tls-cert и --tls-key" << std::endl;
+            return 1;
+        }
+        try{
+            app.enableTls(tlsOptions);
+        }
+        catch(const std::exception& e){
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    // Ввод-вывод через io_uring; если ядро его не поддерживает, сервер работает на epoll
+    if(ioUring){
+        app.enableIoUring();
+    }
+
+    // Горячий перезапуск: новый процесс с тем же --hot-restart забирает порт у работающего,
+    // старый дообслуживает принятые запросы (не дольше --drain-timeout секунд) и завершается
+    if(!hotRestartPath.empty()){
+        app.enableHotRestart(hotRestartPath);
+    }
+    if(drainSeconds >= 0){
+        app.setDrainTimeout(std::chrono::seconds(drainSeconds));
+    }
+
+    // Приём соединений: --defer-accept SECONDS (0 - выключить TCP_DEFER_ACCEPT), --tcp-fastopen QUEUE,
+    // --accept-batch N (соединений за одно пробуждение)
+    app.setAcceptOptions(acceptOptions);
+
+    // Наибольшее тело запроса в байтах; больше - 413
+    if(maxRequestBody >= 0){
+        app.setMaxRequestBodySize(static_cast<size_t>(maxRequestBody));
+    }
+
+    // Несколько процессов на одном порту: --prefork N (0 - по числу ядер). Упавший процесс перезапускается,
+    // метрики и кэш ответов общие для всех процессов. --incoming-cpu закрепляет процессы за ядрами
+    // и направляет соединение процессу того ядра, которое приняло его пакеты
+    if(preforkWorkers >= 0){
+        PreforkOptions preforkOptions;
+        preforkOptions.workers = static_cast<size_t>(preforkWorkers);
+        preforkOptions.incomingCpu = incomingCpu;
+        try{
+            app.enablePrefork(preforkOptions);
+        }
+        catch(const std::exception& e){
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    // Лимит частоты запросов одного IP: --rate-limit 50:100
+    if(clientRateLimit.requestsPerSecond > 0){
+        app.setClientRateLimit(clientRateLimit);
+    }
+
+    // Сессии: --session-secret включает их в памяти процесса, --session-file хранит в файле,
+    // общем для процессов при горячем перезапуске. Секрет из переменной окружения не попадает в список процессов
+    if(sessionSecret.empty()){
+        if(const char* secret = std::getenv("FLASKCPP_SESSION_SECRET")) sessionSecret = secret;
+    }
+    if(!sessionSecret.empty()){
+        std::shared_ptr<SessionStore> store;
+        if(!sessionFile.empty()){
+            store = std::make_shared<MmapSessionStore>(sessionFile);
+        }
+        else if(preforkWorkers >= 0){
+            std::cerr << "Сессии в памяти у каждого процесса --prefork свои: для общих сессий укажите --session-file" << std::endl;
+        }
+        app.enableSessions(sessionSecret, SessionOptions{}, store);
+    }
+    else if(!sessionFile.empty()){
+        std::cerr << "--session-file требует --session-secret или FLASKCPP_SESSION_SECRET" << std::endl;
+        return 1;
+    }
+
+    // Защита от перегрузки: --max-connections, --max-inflight, --max-queue, --reserve-get (мест только для GET),
+    // --queue-delay-target в мс (0 - без сброса по задержке)
+    if(overload){
+        app.setOverloadProtection(overloadOptions);
+    }
+
+    // Проксируемые маршруты: --proxy /api=127.0.0.1:9001,127.0.0.1:9002
+    for(const auto& spec : proxySpecs){
+        size_t eqPos = spec.find('=');
+        if(eqPos == std::string::npos || eqPos == 0 || eqPos + 1 == spec.size()){
+            std::cerr << "Неверный формат --proxy: " << spec << " (ожидается PREFIX=host:port[,host:port])" << std::endl;
+            return 1;
+        }
+        std::vector<std::string> servers;
+        std::istringstream list(spec.substr(eqPos + 1));
+        std::string server;
+        while(std::getline(list, server, ',')){
+            if(!server.empty()) servers.push_back(server);
+        }
+        app.proxy(spec.substr(0, eqPos), servers, proxyOptions);
+    }
+
+#ifdef ENABLE_PHP
+    // FastCGI-сервер PHP: путь к Unix-сокету или host:port
+    if(!phpFastCgi.empty()){
+        app.setPHPFastCgi(phpFastCgi);
+    }
+#endif
+
     // Загрузка шаблонов из директории "templates"
     app.loadTemplatesFromDirectory("templates");
 
@@ -76,6 +428,19 @@ int main(int argc, char* argv[]) {
 
         return app.buildResponse("200 OK", "text/html", body);
     });
+    // Главная страница не зависит от запроса: рендерим её не чаще раза в секунду
+    app.cacheRoute("/", CacheOptions{std::chrono::seconds(1), {}, {}});
+
+    // Поиск: ответ зависит только от параметров a и b, кэшируется по ним
+    app.route("/search", [&](const RequestData& req) -> std::string {
+        std::string body;
+        for (const char* name : {"a", "b"}) {
+            auto it = req.queryParams().find(name);
+            body += std::string(name) + "=" + (it != req.queryParams().end() ? it->second : std::string()) + "\n";
+        }
+        return app.buildResponse("200 OK", "text/plain", body);
+    });
+    app.cacheRoute("/search", CacheOptions{std::chrono::seconds(10), {"a", "b"}, {}});
 
     app.route("/form", [&](const RequestData& req) -> std::string {
         std::string body = app.renderTemplate("form.html", {});
@@ -84,8 +449,9 @@ int main(int argc, char* argv[]) {
 
     app.route("/submit", [&](const RequestData& req) -> std::string {
         std::string user = "";
-        auto it = req.formData.find("username");
-        if (it != req.formData.end()) user = it->second;
+        const auto& form = req.formData();
+        auto it = form.find("username");
+        if (it != form.end()) user = it->second;
 
         // Формирование ответа с использованием шаблона
         TemplateEngine::Context ctx {
@@ -120,6 +486,26 @@ int main(int argc, char* argv[]) {
         return app.buildResponse("200 OK", "application/json", json);
     });
 
+    // Заказ в JSON: {"items":[{"name":"...","price":1.5,"quantity":2}, ...]} -> сумма по позициям
+    app.route("/api/order", [&](const RequestData& req) -> std::string {
+        double total = 0;
+        long long quantity = 0;
+        try {
+            for (JsonValue item : req.json()["items"]) {
+                long long itemQuantity = item.contains("quantity") ? item["quantity"].asInt() : 1;
+                total += item["price"].asDouble() * double(itemQuantity);
+                quantity += itemQuantity;
+            }
+        } catch (const std::exception& e) {
+            return app.jsonResponse("400 Bad Request", [&](JsonWriter& json) {
+                json.beginObject().field("error", e.what()).endObject();
+            });
+        }
+        return app.jsonResponse("200 OK", [&](JsonWriter& json) {
+            json.beginObject().field("items", quantity).field("total", total).endObject();
+        });
+    });
+
     app.route("/error", [&](const RequestData& req) -> std::string {
         throw std::runtime_error("Тестовая ошибка");
         return std::string();
@@ -146,8 +532,9 @@ int main(int argc, char* argv[]) {
     // Получение cookie
     app.route("/get_cookie", [&](const RequestData& req) -> std::string {
         std::string body = "<h1>Get Cookie</h1>";
-        auto it = req.cookies.find("User");
-        if (it != req.cookies.end()) {
+        const auto& cookies = req.cookies();
+        auto it = cookies.find("User");
+        if (it != cookies.end()) {
             body += "<p>Cookie 'User' = " + it->second + "</p>";
         } else {
             body += "<p>Cookie 'User' не найден.</p>";
@@ -168,11 +555,99 @@ int main(int argc, char* argv[]) {
         return app.buildResponse("200 OK", "text/html", body, extra_headers);
     });
 
+    // Счётчик посещений в сессии (при включённых сессиях); ?logout=1 завершает сессию
+    app.route("/visits", [&](const RequestData& req) -> std::string {
+        if(!req.session){
+            return app.buildResponse("404 Not Found", "text/plain", "Sessions are disabled");
+        }
+        if(req.queryParams().count("logout")){
+            req.session->destroy();
+            return app.buildResponse("200 OK", "application/json", R"({"visits":0})");
+        }
+        int visits = std::atoi(req.session->get("visits", "0").c_str()) + 1;
+        req.session->set("visits", std::to_string(visits));
+        return app.jsonResponse("200 OK", [&](JsonWriter& json) {
+            json.beginObject().field("visits", visits).endObject();
+        });
+    });
+
+    // WebSocket-чат: эхо отправителю и рассылка всем участникам группы "chat"
+    app.websocket("/ws", WebSocketHandler{
+        [](WebSocket& ws) {
+            ws.join("chat");
+        },
+        [&](WebSocket& ws, std::string_view message, bool binary) {
+            if(binary){
+                ws.sendBinary(message);
+                return;
+            }
+            ws.sendText(message);
+            app.broadcast("chat", "[" + std::to_string(ws.id()) + "] " + std::string(message));
+        },
+        nullptr
+    });
+
+    // Метрики в формате Prometheus
+    app.enableMetrics("/metrics");
+
+    // Профилировщик CPU: curl -H "Authorization: Bearer $TOKEN" 'localhost:8080/debug/profile?seconds=30' > out.folded,
+    // затем flamegraph.pl out.folded > out.svg. Токен из переменной окружения не попадает в список процессов
+    if(profileToken.empty()){
+        if(const char* token = std::getenv("FLASKCPP_PROFILE_TOKEN")) profileToken = token;
+    }
+    if(!profileToken.empty()){
+        try{
+            app.enableProfiler(profileToken);
+        }
+        catch(const std::exception& e){
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+#ifdef FLASKCPP_ALLOC_STATS
+    // Тестовый хук: среднее количество выделений памяти на запрос (сборка с ENABLE_ALLOC_STATS=1)
+    app.route("/debug/allocations", [&](const RequestData& req) -> std::string {
+        AllocationStats stats = app.getAllocationStats();
+        std::string json = "{\"requests\":" + std::to_string(stats.requests) +
+                           ",\"allocations_per_request\":" + std::to_string(stats.allocationsPerRequest()) +
+                           ",\"bytes_per_request\":" + std::to_string(stats.bytesPerRequest()) + "}";
+        return app.buildResponse("200 OK", "application/json", json);
+    });
+#endif
+
+    // Цели задержки маршрутов: --latency-target /submit=10 (мс). Остальным маршрутам цель назначается
+    // по изученной стоимости, поэтому дешёвые запросы не ждут за долгими рендерами шаблонов
+    for(const auto& spec : latencyTargetSpecs){
+        size_t eqPos = spec.rfind('=');
+        if(eqPos == std::string::npos || eqPos == 0 || eqPos + 1 == spec.size()){
+            std::cerr << "Неверный формат --latency-target: " << spec << " (ожидается PATH=MS)" << std::endl;
+            return 1;
+        }
+        try{
+            app.setLatencyTarget(spec.substr(0, eqPos), std::chrono::milliseconds(std::atol(spec.c_str() + eqPos + 1)));
+        }
+        catch(const std::exception& e){
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    for(const auto& path : blockingRoutes){
+        try{
+            app.blockingRoute(path);
+        }
+        catch(const std::exception& e){
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
     // Запуск сервера асинхронно
     app.runAsync();
 
-    // Ожидание сигнала для остановки сервера
-    while(globalRunning){
+    // Ожидание сигнала для остановки сервера или передачи порта новому процессу
+    while(globalRunning && app.isRunning()){
         std::this_thread::sleep_for(std::chrono::seconds(1));
     }
 
@@ -0,0 +1,433 @@
+#include "headers/AccessLog.h"
+#include <algorithm>
+#include <charconv>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert((AccessLog::ringCapacity & (AccessLog::ringCapacity - 1)) == 0,
+              "AccessLog::ringCapacity должен быть степенью двойки");
+
+// Строка фиксированной ёмкости внутри записи: копирование без выделения памяти, длинные значения обрезаются
+template <size_t N>
+struct FixedField {
+    char data[N];
+    uint16_t size = 0;
+
+    void assign(std::string_view value) {
+        size = static_cast<uint16_t>(std::min(value.size(), N));
+        std::memcpy(data, value.data(), size);
+    }
+
+    std::string_view view() const { return std::string_view(data, size); }
+};
+
+// Запись в кольцевом буфере. Форматирование выполняет поток записи, а не рабочий поток
+struct AccessLogEntry {
+    int64_t timeMicros = 0; // Время завершения запроса (с начала эпохи)
+    uint64_t durationMicros = 0;
+    uint64_t bytes = 0;
+    int status = 0;
+    FixedField<46> clientIP;
+    FixedField<512> requestLine;
+    FixedField<256> referer;
+    FixedField<256> userAgent;
+};
+
+// Кольцевой буфер одного рабочего потока: один писатель (рабочий поток), один читатель (поток записи)
+struct AccessLogRing {
+    std::atomic<bool> inUse{true};
+    alignas(64) std::atomic<size_t> head{0}; // Следующая позиция записи
+    alignas(64) std::atomic<size_t> tail{0}; // Следующая позиция чтения
+    alignas(64) std::atomic<uint64_t> dropped{0};
+    std::unique_ptr<AccessLogEntry[]> entries;
+
+    AccessLogRing() : entries(new AccessLogEntry[AccessLog::ringCapacity]) {}
+};
+
+namespace {
+// Буферы, занятые текущим потоком. При завершении потока буферы освобождаются
+// и достаются новым потокам пула вместе с ещё не записанными записями
+struct RingLease {
+    std::vector<std::pair<uint64_t, std::shared_ptr<AccessLogRing>>> rings;
+
+    ~RingLease() {
+        for (auto& entry : rings) {
+            entry.second->inUse.store(false);
+        }
+    }
+};
+
+thread_local RingLease ringLease;
+thread_local uint64_t cachedAccessLogId = 0;
+thread_local AccessLogRing* cachedRing = nullptr;
+
+std::atomic<uint64_t> nextAccessLogId{1};
+
+void appendNumber(std::string& out, uint64_t value) {
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr - buffer);
+}
+
+// Экранирование в стиле Apache: кавычки, обратная косая черта и управляющие символы как \xHH
+void appendLogEscaped(std::string& out, std::string_view value) {
+    static const char hex[] = "0123456789abcdef";
+    for (unsigned char c : value) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c < 0x20 || c == 0x7f) {
+            out += "\\x";
+            out += hex[c >> 4];
+            out += hex[c & 0xf];
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+}
+
+void appendJsonEscaped(std::string& out, std::string_view value) {
+    static const char hex[] = "0123456789abcdef";
+    for (unsigned char c : value) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    out += "\\u00";
+                    out += hex[c >> 4];
+                    out += hex[c & 0xf];
+                } else {
+                    out += static_cast<char>(c);
+                }
+        }
+    }
+}
+
+void appendJsonField(std::string& out, const char* name, std::string_view value) {
+    out += ",\"";
+    out += name;
+    out += "\":\"";
+    appendJsonEscaped(out, value);
+    out += '"';
+}
+}
+
+// Реализация AccessLog
+
+AccessLog::AccessLog(const std::string& path, AccessLogFormat format,
+                     size_t rotateBytes, std::chrono::seconds rotateInterval,
+                     std::chrono::milliseconds flushInterval)
+    : path(path), format(format), rotateBytes(rotateBytes), rotateInterval(rotateInterval),
+      flushInterval(flushInterval), id(nextAccessLogId.fetch_add(1)), running(false),
+      fd(-1), fileSize(0), batchEntries(0), droppedOnWrite(0), written(0), cachedSecond(-1) {
+    cachedCommonTime[0] = '\0';
+    cachedIsoTime[0] = '\0';
+    batch.reserve(batchSize + 4096);
+}
+
+AccessLog::~AccessLog() {
+    stop();
+}
+
+void AccessLog::start() {
+    if (running.load()) return;
+    openFile();
+    if (fd == -1) {
+        throw std::runtime_error("Failed to open access log: " + path);
+    }
+    running.store(true);
+    writerThread = std::thread(&AccessLog::writerLoop, this);
+}
+
+void AccessLog::stop() {
+    if (!writerThread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        running.store(false);
+    }
+    wakeCondition.notify_one();
+    writerThread.join();
+
+    if (fd != -1 && path != "-") {
+        close(fd);
+    }
+    fd = -1;
+}
+
+AccessLogRing& AccessLog::localRing() {
+    if (cachedAccessLogId == id) return *cachedRing;
+
+    for (auto& entry : ringLease.rings) {
+        if (entry.first == id) {
+            cachedAccessLogId = id;
+            cachedRing = entry.second.get();
+            return *cachedRing;
+        }
+    }
+
+    // Первое обращение потока: берём освободившийся буфер или создаём новый
+    std::shared_ptr<AccessLogRing> ring;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        for (auto& candidate : rings) {
+            bool expected = false;
+            if (candidate->inUse.compare_exchange_strong(expected, true)) {
+                ring = candidate;
+                break;
+            }
+        }
+        if (!ring) {
+            ring = std::make_shared<AccessLogRing>();
+            rings.push_back(ring);
+        }
+    }
+    ringLease.rings.emplace_back(id, ring);
+    cachedAccessLogId = id;
+    cachedRing = ring.get();
+    return *cachedRing;
+}
+
+void AccessLog::record(const AccessLogRecord& record) {
+    AccessLogRing& ring = localRing();
+    size_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) >= ringCapacity) {
+        // Поток записи не успевает: не ждём, а теряем запись
+        ring.dropped.store(ring.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+
+    AccessLogEntry& entry = ring.entries[head & (ringCapacity - 1)];
+    entry.timeMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    entry.durationMicros = record.durationMicros;
+    entry.bytes = record.bytes;
+    entry.status = record.status;
+    entry.clientIP.assign(record.clientIP);
+    entry.requestLine.assign(record.requestLine);
+    entry.referer.assign(record.referer);
+    entry.userAgent.assign(record.userAgent);
+
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+uint64_t AccessLog::droppedCount() const {
+    uint64_t total = droppedOnWrite.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    for (const auto& ring : rings) {
+        total += ring->dropped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t AccessLog::writtenCount() const {
+    return written.load(std::memory_order_relaxed);
+}
+
+bool AccessLog::parseFormat(const std::string& name, AccessLogFormat& format) {
+    if (name == "common") {
+        format = AccessLogFormat::Common;
+    } else if (name == "combined") {
+        format = AccessLogFormat::Combined;
+    } else if (name == "json") {
+        format = AccessLogFormat::Json;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void AccessLog::writerLoop() {
+    while (running.load()) {
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCondition.wait_for(lock, flushInterval, [this]() { return !running.load(); });
+        }
+        drain();
+    }
+    // Записи, поступившие до остановки
+    drain();
+}
+
+void AccessLog::drain() {
+    std::vector<std::shared_ptr<AccessLogRing>> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        snapshot = rings;
+    }
+
+    // Записи разных потоков попадают в файл пачками по потокам, а не строго по времени
+    for (const auto& ring : snapshot) {
+        size_t tail = ring->tail.load(std::memory_order_relaxed);
+        size_t head = ring->head.load(std::memory_order_acquire);
+        while (tail != head) {
+            formatEntry(ring->entries[tail & (ringCapacity - 1)]);
+            ++tail;
+            if (batch.size() >= batchSize) {
+                // Запись уже скопирована в пачку: освобождаем место до медленного write()
+                ring->tail.store(tail, std::memory_order_release);
+                flush();
+            }
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+    flush();
+}
+
+void AccessLog::updateTimeCache(int64_t second) {
+    std::time_t t = static_cast<std::time_t>(second);
+    std::tm tm;
+    gmtime_r(&t, &tm);
+    std::strftime(cachedCommonTime, sizeof(cachedCommonTime), "%d/%b/%Y:%H:%M:%S +0000", &tm);
+    std::strftime(cachedIsoTime, sizeof(cachedIsoTime), "%Y-%m-%dT%H:%M:%S", &tm);
+    cachedSecond = second;
+}
+
+void AccessLog::formatEntry(const AccessLogEntry& entry) {
+    int64_t second = entry.timeMicros / 1000000;
+    if (second != cachedSecond) {
+        updateTimeCache(second);
+    }
+
+    if (format == AccessLogFormat::Json) {
+        std::string_view request = entry.requestLine.view();
+        size_t methodEnd = request.find(' ');
+        size_t targetEnd = methodEnd == std::string_view::npos ? std::string_view::npos : request.find(' ', methodEnd + 1);
+        std::string_view method = request.substr(0, methodEnd);
+        std::string_view target = methodEnd == std::string_view::npos ? std::string_view()
+                                  : request.substr(methodEnd + 1, targetEnd == std::string_view::npos ? std::string_view::npos : targetEnd - methodEnd - 1);
+        std::string_view protocol = targetEnd == std::string_view::npos ? std::string_view() : request.substr(targetEnd + 1);
+
+        char millis[8];
+        std::snprintf(millis, sizeof(millis), ".%03dZ", static_cast<int>((entry.timeMicros / 1000) % 1000));
+
+        batch += "{\"time\":\"";
+        batch += cachedIsoTime;
+        batch += millis;
+        batch += '"';
+        appendJsonField(batch, "remote_addr", entry.clientIP.view());
+        appendJsonField(batch, "method", method);
+        appendJsonField(batch, "path", target);
+        appendJsonField(batch, "protocol", protocol);
+        batch += ",\"status\":";
+        appendNumber(batch, static_cast<uint64_t>(entry.status));
+        batch += ",\"bytes\":";
+        appendNumber(batch, entry.bytes);
+        batch += ",\"duration_us\":";
+        appendNumber(batch, entry.durationMicros);
+        appendJsonField(batch, "referer", entry.referer.view());
+        appendJsonField(batch, "user_agent", entry.userAgent.view());
+        batch += "}\n";
+    } else {
+        // %h - - [%t] "%r" %>s %b
+        batch += entry.clientIP.view();
+        batch += " - - [";
+        batch += cachedCommonTime;
+        batch += "] \"";
+        appendLogEscaped(batch, entry.requestLine.view());
+        batch += "\" ";
+        appendNumber(batch, static_cast<uint64_t>(entry.status));
+        batch += ' ';
+        if (entry.bytes > 0) {
+            appendNumber(batch, entry.bytes);
+        } else {
+            batch += '-';
+        }
+        if (format == AccessLogFormat::Combined) {
+            // "%{Referer}i" "%{User-agent}i"
+            batch += " \"";
+            appendLogEscaped(batch, entry.referer.size ? entry.referer.view() : std::string_view("-"));
+            batch += "\" \"";
+            appendLogEscaped(batch, entry.userAgent.size ? entry.userAgent.view() : std::string_view("-"));
+            batch += '"';
+        }
+        batch += '\n';
+    }
+    ++batchEntries;
+}
+
+void AccessLog::flush() {
+    if (batch.empty()) return;
+
+    rotateIfNeeded(batch.size());
+    if (fd == -1) {
+        // Файл не удалось открыть заново (например, после ротации): пробуем при каждой пачке
+        openFile();
+    }
+
+    const char* data = batch.data();
+    size_t left = batch.size();
+    while (fd != -1 && left > 0) {
+        ssize_t w = ::write(fd, data, left);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        data += w;
+        left -= static_cast<size_t>(w);
+    }
+
+    // Незаписанный остаток (диск заполнен, ошибка ввода-вывода) учитывается как потерянные записи
+    uint64_t lost = static_cast<uint64_t>(std::count(data, data + left, '\n'));
+    droppedOnWrite.fetch_add(lost, std::memory_order_relaxed);
+    written.fetch_add(batchEntries - lost, std::memory_order_relaxed);
+    fileSize += batch.size() - left;
+
+    batch.clear();
+    batchEntries = 0;
+}
+
+void AccessLog::openFile() {
+    openedAt = std::chrono::steady_clock::now();
+    if (path == "-") {
+        fd = STDOUT_FILENO;
+        fileSize = 0;
+        return;
+    }
+
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        std::cerr << "Failed to open access log " << path << ": " << std::strerror(errno) << std::endl;
+        return;
+    }
+    struct stat st;
+    fileSize = (fstat(fd, &st) == 0) ? static_cast<size_t>(st.st_size) : 0;
+}
+
+void AccessLog::rotateIfNeeded(size_t incoming) {
+    if (path == "-" || fd == -1) return;
+
+    bool bySize = rotateBytes > 0 && fileSize > 0 && fileSize + incoming > rotateBytes;
+    bool byTime = rotateInterval.count() > 0 && fileSize > 0 &&
+                  std::chrono::steady_clock::now() - openedAt >= rotateInterval;
+    if (!bySize && !byTime) return;
+
+    // access.log -> access.log.20260118-153000 (с суффиксом .N, если имя уже занято)
+    std::time_t now = std::time(nullptr);
+    std::tm tm;
+    localtime_r(&now, &tm);
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm);
+
+    std::string rotated = path + "." + stamp;
+    for (int n = 1; ::access(rotated.c_str(), F_OK) == 0; ++n) {
+        rotated = path + "." + stamp + "." + std::to_string(n);
+    }
+
+    close(fd);
+    fd = -1;
+    if (std::rename(path.c_str(), rotated.c_str()) != 0) {
+        std::cerr << "Failed to rotate access log " << path << ": " << std::strerror(errno) << std::endl;
+    }
+    openFile();
+}
@@ -0,0 +1,262 @@
+#include "headers/Compression.h"
+#include "headers/StringUtils.h"
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <cerrno>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace {
+std::string_view trim(std::string_view value) {
+    while (!value.empty() && std::isspace((unsigned char)value.front())) value.remove_prefix(1);
+    while (!value.empty() && std::isspace((unsigned char)value.back())) value.remove_suffix(1);
+    return value;
+}
+
+// gzip - заголовок и CRC32 вокруг deflate (windowBits + 16), deflate по RFC 9110 - формат zlib
+int windowBitsFor(ContentEncoding encoding) {
+    return encoding == ContentEncoding::Gzip ? MAX_WBITS + 16 : MAX_WBITS;
+}
+
+// Сжимает data одним вызовом deflate: выходной буфер сразу размечается по deflateBound
+bool runDeflate(z_stream& stream, std::string_view data, std::string& out) {
+    if (data.size() > UINT_MAX) return false;
+    size_t offset = out.size();
+    size_t bound = deflateBound(&stream, static_cast<uLong>(data.size()));
+    out.resize(offset + bound);
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&out[offset]);
+    stream.avail_out = static_cast<uInt>(bound);
+    if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+        out.resize(offset);
+        return false;
+    }
+    out.resize(offset + (bound - stream.avail_out));
+    return true;
+}
+
+// Состояние deflate рабочего потока для одного формата
+struct DeflateStream {
+    z_stream stream = {};
+    bool initialized = false;
+    int level = 0;
+
+    ~DeflateStream() {
+        if (initialized) deflateEnd(&stream);
+    }
+};
+
+thread_local DeflateStream threadStreams[2]; // gzip, deflate
+}
+
+const char* contentEncodingName(ContentEncoding encoding) {
+    switch (encoding) {
+        case ContentEncoding::Gzip: return "gzip";
+        case ContentEncoding::Deflate: return "deflate";
+        default: return "";
+    }
+}
+
+ContentEncoding negotiateEncoding(std::string_view acceptEncoding) {
+    double gzipQ = -1, deflateQ = -1, anyQ = -1;
+    size_t start = 0;
+    while (start < acceptEncoding.size()) {
+        size_t comma = acceptEncoding.find(',', start);
+        if (comma == std::string_view::npos) comma = acceptEncoding.size();
+        std::string_view token = acceptEncoding.substr(start, comma - start);
+        start = comma + 1;
+
+        double q = 1.0;
+        size_t semicolon = token.find(';');
+        if (semicolon != std::string_view::npos) {
+            std::string_view param = trim(token.substr(semicolon + 1));
+            if (startsWithIgnoreCase(param, "q=")) {
+                q = std::strtod(std::string(param.substr(2)).c_str(), nullptr);
+            }
+            token = token.substr(0, semicolon);
+        }
+        token = trim(token);
+        if (equalsIgnoreCase(token, "gzip") || equalsIgnoreCase(token, "x-gzip")) gzipQ = q;
+        else if (equalsIgnoreCase(token, "deflate")) deflateQ = q;
+        else if (token == "*") anyQ = q;
+    }
+    // Кодирование, не названное явно, получает вес "*"
+    if (gzipQ < 0) gzipQ = anyQ;
+    if (deflateQ < 0) deflateQ = anyQ;
+    if (gzipQ > 0 && gzipQ >= deflateQ) return ContentEncoding::Gzip;
+    if (deflateQ > 0) return ContentEncoding::Deflate;
+    return ContentEncoding::Identity;
+}
+
+bool isCompressibleType(std::string_view contentType) {
+    contentType = trim(contentType.substr(0, contentType.find(';')));
+    if (startsWithIgnoreCase(contentType, "text/")) return true;
+    static const std::string_view compressible[] = {
+        "application/javascript", "application/json", "application/xml", "application/xhtml+xml",
+        "application/rss+xml", "application/atom+xml", "application/ld+json", "application/manifest+json",
+        "application/wasm", "image/svg+xml", "image/x-icon", "font/ttf", "font/otf",
+    };
+    for (std::string_view type : compressible) {
+        if (equalsIgnoreCase(contentType, type)) return true;
+    }
+    // Суффиксы структурированного синтаксиса (RFC 6839): application/problem+json и т.п.
+    return contentType.size() > 5 && (equalsIgnoreCase(contentType.substr(contentType.size() - 5), "+json") ||
+                                      equalsIgnoreCase(contentType.substr(contentType.size() - 4), "+xml"));
+}
+
+bool compressBody(std::string_view data, ContentEncoding encoding, int level, std::string& out) {
+    if (encoding == ContentEncoding::Identity) return false;
+    DeflateStream& state = threadStreams[encoding == ContentEncoding::Gzip ? 0 : 1];
+    if (state.initialized && state.level != level) {
+        deflateEnd(&state.stream);
+        state.initialized = false;
+    }
+    if (!state.initialized) {
+        state.stream = z_stream();
+        if (deflateInit2(&state.stream, level, Z_DEFLATED, windowBitsFor(encoding), 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return false;
+        }
+        state.initialized = true;
+        state.level = level;
+    } else {
+        deflateReset(&state.stream);
+    }
+    return runDeflate(state.stream, data, out);
+}
+
+bool compressResponse(std::string& response, ContentEncoding encoding, int level, size_t minSize) {
+    if (encoding == ContentEncoding::Identity) return false;
+    size_t headEnd = response.find("\r\n\r\n");
+    if (headEnd == std::string::npos) return false;
+    size_t bodySize = response.size() - headEnd - 4;
+    if (bodySize < minSize) return false;
+
+    std::string_view head(response.data(), headEnd);
+    size_t lineEnd = head.find("\r\n");
+    if (lineEnd == std::string_view::npos) return false;
+    // 1xx, 204 и 304 не имеют тела, 206 описывает диапазон исходного представления
+    std::string_view statusLine = head.substr(0, lineEnd);
+    if (statusLine.size() < 12) return false;
+    std::string_view status = statusLine.substr(9, 3);
+    if (status[0] == '1' || status == "204" || status == "304" || status == "206") return false;
+
+    bool compressible = false;
+    size_t pos = lineEnd + 2;
+    while (pos < head.size()) {
+        size_t next = head.find("\r\n", pos);
+        if (next == std::string_view::npos) next = head.size();
+        std::string_view line = head.substr(pos, next - pos);
+        pos = next + 2;
+        size_t colonPos = line.find(':');
+        if (colonPos == std::string_view::npos) continue;
+        std::string_view name = line.substr(0, colonPos);
+        std::string_view value = line.substr(colonPos + 1);
+        if (equalsIgnoreCase(name, "Content-Encoding")) return false;
+        if (equalsIgnoreCase(name, "Cache-Control") && containsIgnoreCase(value, "no-transform")) return false;
+        if (equalsIgnoreCase(name, "Content-Type")) compressible = isCompressibleType(trim(value));
+    }
+    if (!compressible) return false;
+
+    // Новый ответ: стартовая строка и заголовки с заменой Content-Length и Vary, затем сжатое тело
+    std::string compressed;
+    compressed.reserve(headEnd + 64 + bodySize / 2);
+    compressed.append(response, 0, lineEnd + 2);
+    bool hasVary = false;
+    pos = lineEnd + 2;
+    while (pos < head.size()) {
+        size_t next = head.find("\r\n", pos);
+        if (next == std::string_view::npos) next = head.size();
+        std::string_view line = head.substr(pos, next - pos);
+        pos = next + 2;
+        size_t colonPos = line.find(':');
+        std::string_view name = colonPos == std::string_view::npos ? line : line.substr(0, colonPos);
+        if (equalsIgnoreCase(name, "Content-Length")) continue;
+        compressed.append(line.data(), line.size());
+        if (equalsIgnoreCase(name, "Vary")) {
+            hasVary = true;
+            if (!containsIgnoreCase(line, "Accept-Encoding")) compressed += ", Accept-Encoding";
+        }
+        compressed += "\r\n";
+    }
+    if (!hasVary) compressed += "Vary: Accept-Encoding\r\n";
+    compressed += "Content-Encoding: ";
+    compressed += contentEncodingName(encoding);
+    compressed += "\r\nContent-Length: ";
+    size_t lengthPos = compressed.size();
+    compressed += "\r\n\r\n";
+    size_t bodyStart = compressed.size();
+
+    if (!compressBody(std::string_view(response).substr(headEnd + 4), encoding, level, compressed)) return false;
+    size_t compressedSize = compressed.size() - bodyStart;
+    if (compressedSize >= bodySize) return false; // Несжимаемые данные отдаём как есть
+    compressed.insert(lengthPos, std::to_string(compressedSize));
+    response.swap(compressed);
+    return true;
+}
+
+// Реализация CompressedFileCache
+
+CompressedFileCache::CompressedFileCache(size_t maxBytes) : maxBytes(maxBytes), usedBytes(0) {}
+
+std::shared_ptr<const std::string> CompressedFileCache::get(const std::string& path, int fd, size_t fileSize,
+                                                            std::chrono::nanoseconds modified, ContentEncoding encoding) {
+    // Файлы больше бюджета кэша пришлось бы сжимать на каждый запрос - отдаём их без сжатия
+    if (fileSize > maxBytes) return nullptr;
+
+    std::string key = path;
+    key += encoding == ContentEncoding::Gzip ? "\ngzip" : "\ndeflate";
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(key);
+        if (it != entries.end() && it->second.fileSize == fileSize && it->second.modified == modified) {
+            return it->second.data;
+        }
+    }
+
+    // Файл сжимается один раз, поэтому используем максимальную степень сжатия
+    std::string content(fileSize, '\0');
+    size_t totalRead = 0;
+    while (totalRead < fileSize) {
+        ssize_t r = pread(fd, &content[totalRead], fileSize - totalRead, static_cast<off_t>(totalRead));
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return nullptr;
+        totalRead += static_cast<size_t>(r);
+    }
+    z_stream stream = {};
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, windowBitsFor(encoding), 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return nullptr;
+    }
+    auto data = std::make_shared<std::string>();
+    bool ok = runDeflate(stream, content, *data);
+    deflateEnd(&stream);
+    if (!ok) return nullptr;
+    data->shrink_to_fit();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        // Файл изменился: заменяем запись, её место в очереди вытеснения сохраняется
+        usedBytes -= it->second.data->size();
+        it->second = Entry{data, fileSize, modified};
+    } else {
+        insertionOrder.push_back(key);
+        entries.emplace(key, Entry{data, fileSize, modified});
+    }
+    usedBytes += data->size();
+    while (usedBytes > maxBytes && !insertionOrder.empty()) {
+        auto oldest = entries.find(insertionOrder.front());
+        if (oldest != entries.end()) {
+            usedBytes -= oldest->second.data->size();
+            entries.erase(oldest);
+        }
+        insertionOrder.pop_front();
+    }
+    return data;
+}
+
+size_t CompressedFileCache::sizeBytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return usedBytes;
+}
@@ -0,0 +1,167 @@
+#include "headers/Connection.h"
+#include <cstdlib>
+#include <new>
+
+// Ограничения кэша узлов: не держим бесконечно узлы от аномально больших запросов
+static constexpr size_t maxCachedNodes = 256;
+static constexpr size_t maxCachedNodeString = 4096;
+
+void MapNodeCache::recycle(Map& map) {
+    while (!map.empty()) {
+        Node node = map.extract(map.begin());
+        if (nodes.size() < maxCachedNodes &&
+            node.key().capacity() <= maxCachedNodeString &&
+            node.mapped().capacity() <= maxCachedNodeString) {
+            nodes.push_back(std::move(node));
+        }
+    }
+}
+
+std::string& MapNodeCache::emplace(Map& map, std::string_view key) {
+    Node node;
+    if (!nodes.empty()) {
+        node = std::move(nodes.back());
+        nodes.pop_back();
+    } else {
+        // Кэш пуст: создаём новый узел через временную карту
+        Map tmp;
+        tmp.emplace(std::string(), std::string());
+        node = tmp.extract(tmp.begin());
+    }
+    node.key().assign(key.data(), key.size());
+    node.mapped().clear();
+
+    auto result = map.insert(std::move(node));
+    if (!result.inserted) {
+        // Ключ уже есть: значение перезаписывается (как queryParams[key] = value), узел возвращаем в кэш
+        nodes.push_back(std::move(result.node));
+        result.position->second.clear();
+    }
+    return result.position->second;
+}
+
+void Connection::resetRequest() {
+    request.clear();
+}
+
+void Connection::consumeRequest() {
+    if (requestLength >= readBuffer.size()) {
+        readBuffer.clear();
+    } else {
+        readBuffer.erase(0, requestLength);
+    }
+    requestLength = 0;
+    pendingBody = 0;
+}
+
+// Свободные соединения рабочего потока
+static thread_local std::vector<std::unique_ptr<Connection>> freeConnections;
+
+std::unique_ptr<Connection> ConnectionPool::acquire() {
+    if (!freeConnections.empty()) {
+        std::unique_ptr<Connection> conn = std::move(freeConnections.back());
+        freeConnections.pop_back();
+        return conn;
+    }
+    return std::make_unique<Connection>();
+}
+
+void ConnectionPool::release(std::unique_ptr<Connection> conn) {
+    if (!conn) return;
+    if (freeConnections.size() >= maxCachedPerThread) return;
+
+    conn->resetRequest();
+    conn->socket = -1;
+    conn->clientIP.clear();
+    conn->readBuffer.clear();
+    conn->requestLength = 0;
+    conn->pendingBody = 0;
+    conn->writeBuffer.clear();
+    conn->responseSink = nullptr;
+    conn->uring = nullptr;
+    conn->responseFile = -1;
+    conn->responseFileSize = 0;
+    conn->tls = nullptr;
+    if (conn->readBuffer.capacity() > maxCachedBufferSize) std::string().swap(conn->readBuffer);
+    if (conn->writeBuffer.capacity() > maxCachedBufferSize) std::string().swap(conn->writeBuffer);
+    conn->keepAlive = false;
+    conn->priority = 5;
+    conn->requestsServed = 0;
+    conn->offloaded = false;
+    conn->idlePrev = nullptr;
+    conn->idleNext = nullptr;
+    conn->parked = false;
+    conn->reactorRegistered = false;
+
+    freeConnections.push_back(std::move(conn));
+}
+
+RequestArena::RequestArena() : monotonic(initialBuffer, initialSize) {}
+
+RequestArena& RequestArena::forThisThread() {
+    static thread_local RequestArena arena;
+    return arena;
+}
+
+// Подсчёт выделений памяти (только при сборке с ENABLE_ALLOC_STATS=1)
+
+static thread_local unsigned long long threadAllocationCount = 0;
+static thread_local unsigned long long threadAllocationBytes = 0;
+
+bool AllocationCounter::enabled() {
+#ifdef FLASKCPP_ALLOC_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+unsigned long long AllocationCounter::threadAllocations() {
+    return threadAllocationCount;
+}
+
+unsigned long long AllocationCounter::threadBytes() {
+    return threadAllocationBytes;
+}
+
+#ifdef FLASKCPP_ALLOC_STATS
+static void* countedAlloc(std::size_t size) {
+    ++threadAllocationCount;
+    threadAllocationBytes += size;
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+static void* countedAlignedAlloc(std::size_t size, std::align_val_t align) {
+    ++threadAllocationCount;
+    threadAllocationBytes += size;
+    std::size_t a = static_cast<std::size_t>(align);
+    std::size_t rounded = (size + a - 1) / a * a;
+    void* p = std::aligned_alloc(a, rounded ? rounded : a);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(std::size_t size) { return countedAlloc(size); }
+void* operator new[](std::size_t size) { return countedAlloc(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try { return countedAlloc(size); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    try { return countedAlloc(size); } catch (...) { return nullptr; }
+}
+void* operator new(std::size_t size, std::align_val_t align) { return countedAlignedAlloc(size, align); }
+void* operator new[](std::size_t size, std::align_val_t align) { return countedAlignedAlloc(size, align); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+#endif
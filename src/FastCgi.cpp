@@ -0,0 +1,298 @@
+#include "headers/FastCgi.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Константы протокола FastCGI 1.0
+namespace {
+constexpr uint8_t fcgiVersion = 1;
+
+constexpr uint8_t fcgiBeginRequest = 1;
+constexpr uint8_t fcgiEndRequest = 3;
+constexpr uint8_t fcgiParams = 4;
+constexpr uint8_t fcgiStdin = 5;
+constexpr uint8_t fcgiStdout = 6;
+constexpr uint8_t fcgiStderr = 7;
+
+constexpr uint16_t fcgiResponder = 1;
+constexpr uint8_t fcgiKeepConn = 1;
+
+constexpr uint8_t fcgiRequestComplete = 0;
+
+constexpr size_t headerSize = 8;
+
+void putHeader(unsigned char* header, uint8_t type, uint16_t requestId, size_t contentLength, uint8_t paddingLength) {
+    header[0] = fcgiVersion;
+    header[1] = type;
+    header[2] = static_cast<unsigned char>(requestId >> 8);
+    header[3] = static_cast<unsigned char>(requestId & 0xff);
+    header[4] = static_cast<unsigned char>((contentLength >> 8) & 0xff);
+    header[5] = static_cast<unsigned char>(contentLength & 0xff);
+    header[6] = paddingLength;
+    header[7] = 0;
+}
+
+void appendLength(std::string& out, size_t length) {
+    if (length < 128) {
+        out += static_cast<char>(length);
+    } else {
+        out += static_cast<char>(((length >> 24) & 0x7f) | 0x80);
+        out += static_cast<char>((length >> 16) & 0xff);
+        out += static_cast<char>((length >> 8) & 0xff);
+        out += static_cast<char>(length & 0xff);
+    }
+}
+
+// Записывает всё содержимое iovec, досылая остаток при частичной записи
+bool writeAll(int fd, struct iovec* iov, int count) {
+    while (count > 0) {
+        ssize_t written = writev(fd, iov, count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        size_t left = static_cast<size_t>(written);
+        while (count > 0 && left >= iov->iov_len) {
+            left -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + left;
+            iov->iov_len -= left;
+        }
+    }
+    return true;
+}
+
+// Отправляет поток (PARAMS или STDIN) записями не длиннее maxRecordContent, завершая пустой записью
+bool writeStream(int fd, uint8_t type, uint16_t requestId, std::string_view data) {
+    static const char padding[8] = {0};
+    size_t offset = 0;
+    while (offset < data.size()) {
+        size_t chunk = std::min(data.size() - offset, FastCgiPool::maxRecordContent);
+        uint8_t paddingLength = static_cast<uint8_t>((8 - chunk % 8) % 8);
+        unsigned char header[headerSize];
+        putHeader(header, type, requestId, chunk, paddingLength);
+        struct iovec iov[3] = {
+            {header, headerSize},
+            {const_cast<char*>(data.data() + offset), chunk},
+            {const_cast<char*>(padding), paddingLength},
+        };
+        if (!writeAll(fd, iov, paddingLength ? 3 : 2)) return false;
+        offset += chunk;
+    }
+    unsigned char header[headerSize];
+    putHeader(header, type, requestId, 0, 0);
+    struct iovec iov[1] = {{header, headerSize}};
+    return writeAll(fd, iov, 1);
+}
+}
+
+// Реализация FastCgiPool
+
+FastCgiPool::FastCgiPool(const std::string& address, size_t maxConnections, std::chrono::milliseconds timeout)
+    : address(address), maxConnections(maxConnections ? maxConnections : 1), timeout(timeout),
+      openSockets(0), nextRequestId(1) {}
+
+FastCgiPool::~FastCgiPool() {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    for (int fd : idleSockets) {
+        close(fd);
+    }
+    idleSockets.clear();
+}
+
+size_t FastCgiPool::openCount() {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    return openSockets;
+}
+
+size_t FastCgiPool::idleCount() {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    return idleSockets.size();
+}
+
+int FastCgiPool::connectSocket() {
+    int fd = -1;
+    std::string path = address.rfind("unix:", 0) == 0 ? address.substr(5) : address;
+    if (!path.empty() && path[0] == '/') {
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) return -1;
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd == -1) return -1;
+        if (connect(fd, (sockaddr*)&addr, sizeof(addr)) == -1) {
+            close(fd);
+            return -1;
+        }
+    } else {
+        size_t colonPos = address.rfind(':');
+        if (colonPos == std::string::npos) return -1;
+        std::string host = address.substr(0, colonPos);
+        std::string port = address.substr(colonPos + 1);
+
+        addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* result = nullptr;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0) return -1;
+        for (addrinfo* ai = result; ai; ai = ai->ai_next) {
+            fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+            if (fd == -1) continue;
+            if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+            close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(result);
+        if (fd == -1) return -1;
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    struct timeval tv;
+    tv.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+    tv.tv_usec = static_cast<suseconds_t>((timeout.count() % 1000) * 1000);
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+int FastCgiPool::acquire(bool& reused) {
+    std::unique_lock<std::mutex> lock(poolMutex);
+    // Все соединения заняты: ждём освобождения, а не открываем лишние процессы php
+    poolCondition.wait(lock, [this]() { return !idleSockets.empty() || openSockets < maxConnections; });
+    if (!idleSockets.empty()) {
+        int fd = idleSockets.back();
+        idleSockets.pop_back();
+        reused = true;
+        return fd;
+    }
+    ++openSockets;
+    lock.unlock();
+
+    reused = false;
+    int fd = connectSocket();
+    if (fd == -1) {
+        lock.lock();
+        --openSockets;
+        lock.unlock();
+        poolCondition.notify_one();
+    }
+    return fd;
+}
+
+void FastCgiPool::release(int fd, bool reusable) {
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (reusable) {
+            idleSockets.push_back(fd);
+        } else {
+            close(fd);
+            --openSockets;
+        }
+    }
+    poolCondition.notify_one();
+}
+
+bool FastCgiPool::execute(const Params& params, std::string_view input, std::string& output, std::string& errors) {
+    // Повторяем один раз: переиспользуемое соединение могло быть закрыто сервером
+    // (php-cgi перезапускается после PHP_FCGI_MAX_REQUESTS, php-fpm - по pm.max_requests)
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        bool reused = false;
+        int fd = acquire(reused);
+        if (fd == -1) return false;
+
+        uint16_t requestId = nextRequestId.fetch_add(1);
+        if (requestId == 0) requestId = nextRequestId.fetch_add(1); // 0 зарезервирован для управляющих записей
+
+        output.clear();
+        errors.clear();
+        bool received = false;
+        bool keepConnection = false;
+        bool ok = roundTrip(fd, requestId, params, input, output, errors, received, keepConnection);
+        release(fd, ok && keepConnection);
+        if (ok) return true;
+        if (!reused || received) return false;
+    }
+    return false;
+}
+
+bool FastCgiPool::roundTrip(int fd, uint16_t requestId, const Params& params, std::string_view input,
+                            std::string& output, std::string& errors, bool& received, bool& keepConnection) {
+    // FCGI_BEGIN_REQUEST: роль Responder, соединение не закрывать после ответа
+    unsigned char begin[headerSize + 8] = {0};
+    putHeader(begin, fcgiBeginRequest, requestId, 8, 0);
+    begin[headerSize] = static_cast<unsigned char>(fcgiResponder >> 8);
+    begin[headerSize + 1] = static_cast<unsigned char>(fcgiResponder & 0xff);
+    begin[headerSize + 2] = fcgiKeepConn;
+    struct iovec iov[1] = {{begin, sizeof(begin)}};
+    if (!writeAll(fd, iov, 1)) return false;
+
+    // FCGI_PARAMS: пары имя-значение с длинами в 1 или 4 байта
+    std::string encoded;
+    size_t encodedSize = 0;
+    for (const auto& param : params) {
+        encodedSize += param.first.size() + param.second.size() + 8;
+    }
+    encoded.reserve(encodedSize);
+    for (const auto& param : params) {
+        appendLength(encoded, param.first.size());
+        appendLength(encoded, param.second.size());
+        encoded += param.first;
+        encoded += param.second;
+    }
+    if (!writeStream(fd, fcgiParams, requestId, encoded)) return false;
+
+    // FCGI_STDIN: тело запроса потоком записей
+    if (!writeStream(fd, fcgiStdin, requestId, input)) return false;
+
+    // Читаем записи до FCGI_END_REQUEST нашего запроса; чужие и управляющие записи пропускаем
+    std::string buffer;
+    size_t parsed = 0;
+    char chunk[16384];
+    while (true) {
+        while (buffer.size() - parsed >= headerSize) {
+            const unsigned char* header = reinterpret_cast<const unsigned char*>(buffer.data() + parsed);
+            uint8_t type = header[1];
+            uint16_t id = static_cast<uint16_t>((header[2] << 8) | header[3]);
+            size_t contentLength = (static_cast<size_t>(header[4]) << 8) | header[5];
+            size_t recordSize = headerSize + contentLength + header[6];
+            if (buffer.size() - parsed < recordSize) break;
+
+            const char* content = buffer.data() + parsed + headerSize;
+            if (id == requestId) {
+                if (type == fcgiStdout) {
+                    output.append(content, contentLength);
+                } else if (type == fcgiStderr) {
+                    errors.append(content, contentLength);
+                } else if (type == fcgiEndRequest) {
+                    uint8_t protocolStatus = contentLength >= 5 ? static_cast<uint8_t>(content[4]) : fcgiRequestComplete;
+                    // Соединение можно переиспользовать, только если после END_REQUEST нет лишних данных
+                    keepConnection = parsed + recordSize == buffer.size();
+                    return protocolStatus == fcgiRequestComplete;
+                }
+            }
+            parsed += recordSize;
+        }
+        if (parsed > 0 && parsed == buffer.size()) {
+            buffer.clear();
+            parsed = 0;
+        }
+
+        ssize_t r = recv(fd, chunk, sizeof(chunk), 0);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        received = true;
+        buffer.append(chunk, static_cast<size_t>(r));
+    }
+}
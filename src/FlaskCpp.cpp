@@ -1,14 +1,316 @@
 #include "headers/FlaskCpp.h"
+#include "headers/StringUtils.h"
 #include <cstdlib> // Для atoi
 #include <csignal> // Для обработки сигналов
 #include <thread>
 #include <atomic>
 #include <sys/select.h> // Для select
 #include <fcntl.h>      // Для fcntl
+#include <sys/stat.h>   // Для fstat
+#include <cerrno>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <netinet/tcp.h> // Для TCP_DEFER_ACCEPT и TCP_FASTOPEN
+#include <optional>
+#include <cstdint>
+
+// Соединение, запрос которого сейчас обрабатывает текущий поток.
+// По нему buildResponse и генераторы ошибок выбирают значение заголовка Connection
+static thread_local Connection* currentConnection = nullptr;
+
+static const char* connectionHeaderValue() {
+    return (currentConnection && currentConnection->keepAlive) ? "keep-alive" : "close";
+}
+
+static uint64_t elapsedNanos(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+// Код статуса из строки ответа "HTTP/1.1 200 OK" (0, если разобрать не удалось)
+static int responseStatus(const std::string& response) {
+    if (response.size() < 12 || response.compare(0, 5, "HTTP/") != 0) return 0;
+    size_t pos = response.find(' ');
+    if (pos == std::string::npos || pos + 3 >= response.size()) return 0;
+    int status = 0;
+    for (size_t i = pos + 1; i < pos + 4; ++i) {
+        if (response[i] < '0' || response[i] > '9') return 0;
+        status = status * 10 + (response[i] - '0');
+    }
+    return status;
+}
+
+// Кодирование ответа, которое принимает клиент (Identity, если сжатие выключено)
+static ContentEncoding acceptedEncoding(const RequestData& reqData, bool compressionEnabled) {
+    return compressionEnabled ? negotiateEncoding(reqData.header(KnownHeader::AcceptEncoding)) : ContentEncoding::Identity;
+}
+
+// Компонент ключа кэша с префиксом длины: декодированные значения могут содержать любые байты,
+// включая разделители, поэтому без длины "?a=x%0Ab%3Dy" и "?a=x&b=y" дали бы один ключ
+static void appendCacheKeyPart(std::string& key, std::string_view part) {
+    key += std::to_string(part.size());
+    key += ':';
+    key += part;
+}
+
+// Ключ кэша ответов: метод, путь, выбранные параметры запроса, заголовки Vary и кодирование ответа
+static std::string responseCacheKey(const RequestData& reqData, const CacheOptions& options, ContentEncoding encoding) {
+    std::string key;
+    key.reserve(reqData.method.size() + reqData.path.size() + 64);
+    key += reqData.method;
+    key += ' ';
+    appendCacheKeyPart(key, reqData.path);
+    for (const auto& name : options.queryParams) {
+        auto it = reqData.queryParams().find(name);
+        if (it == reqData.queryParams().end()) continue;
+        key += "\nQ";
+        appendCacheKeyPart(key, name);
+        appendCacheKeyPart(key, it->second);
+    }
+    for (const auto& name : options.varyHeaders) {
+        key += "\nH";
+        appendCacheKeyPart(key, name);
+        appendCacheKeyPart(key, reqData.header(name));
+    }
+    if (encoding != ContentEncoding::Identity) {
+        key += "\nContent-Encoding:";
+        key += contentEncodingName(encoding);
+    }
+    return key;
+}
+
+// Приоритет запроса в пуле потоков по HTTP-методу
+static int methodPriority(std::string_view method) {
+    if (method == "GET") {
+        return 1; // Высокий приоритет для GET
+    } else if (method == "POST") {
+        return 2; // Средний приоритет для POST
+    } else if (method == "PUT" || method == "DELETE") {
+        return 3; // Низкий приоритет для PUT и DELETE
+    }
+    return 4; // Очень низкий приоритет для остальных методов
+}
+
+// Новое соединение ставится в очередь как GET: поток accept не читает данных клиента,
+// метод становится известен рабочему потоку после чтения запроса - тогда запрос проходит допуск
+// по своему приоритету (см. serveConnection и withinAdmissionLimits)
+static const int newConnectionPriority = methodPriority("GET");
+
+// Путь из стартовой строки запроса, без query string
+static std::string_view requestTargetPath(std::string_view head) {
+    size_t start = head.find(' ');
+    if (start == std::string_view::npos) return std::string_view();
+    ++start;
+    size_t end = head.find_first_of(" ?\r\n", start);
+    if (end == std::string_view::npos) end = head.size();
+    return head.substr(start, end - start);
+}
+
+// Таймаут чтения запроса из сокета. Принятые соединения наследуют SO_RCVTIMEO слушающего сокета
+static const timeval receiveTimeout = {5, 0};
+
+// Тела страниц ошибок не зависят от запроса
+static const std::string notFoundBody = R"(
+<!DOCTYPE html>
+<html lang="ru">
+<head>
+    <meta charset="UTF-8">
+    <title>404 Not Found</title>
+    <style>
+        body {
+            background-color: #f0f2f5;
+            color: #333;
+            font-family: 'Segoe UI', Tahoma, Geneva, Verdana, sans-serif;
+            margin: 0;
+            padding: 0;
+            display: flex;
+            justify-content: center;
+            align-items: center;
+            height: 100vh;
+            text-align: center;
+        }
+        .container {
+            background-color: #fff;
+            padding: 40px 60px;
+            border-radius: 8px;
+            box-shadow: 0 4px 6px rgba(0,0,0,0.1);
+        }
+        h1 {
+            font-size: 80px;
+            margin-bottom: 20px;
+            color: #e74c3c;
+        }
+        p {
+            font-size: 24px;
+            margin-bottom: 30px;
+        }
+        a {
+            display: inline-block;
+            padding: 12px 25px;
+            background-color: #3498db;
+            color: #fff;
+            text-decoration: none;
+            border-radius: 4px;
+            font-size: 18px;
+            transition: background-color 0.3s ease;
+        }
+        a:hover {
+            background-color: #2980b9;
+        }
+        .illustration {
+            margin-bottom: 30px;
+        }
+        @media (max-width: 600px) {
+            .container {
+                padding: 20px 30px;
+            }
+            h1 {
+                font-size: 60px;
+            }
+            p {
+                font-size: 20px;
+            }
+            a {
+                font-size: 16px;
+                padding: 10px 20px;
+            }
+        }
+    </style>
+</head>
+<body>
+    <div class="container">
+        <div class="illustration">
+            <!-- Можно добавить SVG или изображение здесь -->
+            <svg width="100" height="100" viewBox="0 0 24 24" fill="#e74c3c" xmlns="http://www.w3.org/2000/svg">
+                <path d="M12 0C5.371 0 0 5.371 0 12c0 6.629 5.371 12 12 12s12-5.371 12-12C24 5.371 18.629 0 12 0zm5.707 16.293L16.293 17.707 12 13.414 7.707 17.707 6.293 16.293 10.586 12 6.293 7.707 7.707 6.293 12 10.586 16.293 6.293 17.707 7.707 13.414 12 17.707z"/>
+            </svg>
+        </div>
+        <h1>404</h1>
+        <p>Упс! Страница, которую вы ищете, не найдена.</p>
+        <a href="/">Вернуться на главную</a>
+    </div>
+</body>
+</html>
+)";
+
+static const std::string internalErrorBody = R"(
+<!DOCTYPE html>
+<html lang="ru">
+<head>
+    <meta charset="UTF-8">
+    <title>500 Internal Server Error</title>
+    <style>
+        body {
+            background-color: #f8d7da;
+            color: #721c24;
+            font-family: 'Segoe UI', Tahoma, Geneva, Verdana, sans-serif;
+            margin: 0;
+            padding: 0;
+            display: flex;
+            justify-content: center;
+            align-items: center;
+            height: 100vh;
+            text-align: center;
+        }
+        .container {
+            background-color: #f5c6cb;
+            padding: 40px 60px;
+            border-radius: 8px;
+            box-shadow: 0 4px 6px rgba(0,0,0,0.1);
+            max-width: 600px;
+            margin: 20px;
+        }
+        h1 {
+            font-size: 80px;
+            margin-bottom: 20px;
+            color: #c82333;
+        }
+        p {
+            font-size: 24px;
+            margin-bottom: 30px;
+        }
+        a {
+            display: inline-block;
+            padding: 12px 25px;
+            background-color: #c82333;
+            color: #fff;
+            text-decoration: none;
+            border-radius: 4px;
+            font-size: 18px;
+            transition: background-color 0.3s ease;
+        }
+        a:hover {
+            background-color: #a71d2a;
+        }
+        .illustration {
+            margin-bottom: 30px;
+        }
+        @media (max-width: 600px) {
+            .container {
+                padding: 20px 30px;
+            }
+            h1 {
+                font-size: 60px;
+            }
+            p {
+                font-size: 20px;
+            }
+            a {
+                font-size: 16px;
+                padding: 10px 20px;
+            }
+        }
+    </style>
+</head>
+<body>
+    <div class="container">
+        <div class="illustration">
+            <!-- SVG-иллюстрация для визуального эффекта -->
+            <svg width="100" height="100" viewBox="0 0 24 24" fill="#c82333" xmlns="http://www.w3.org/2000/svg">
+                <path d="M12 0C5.371 0 0 5.371 0 12c0 6.629 5.371 12 12 12s12-5.371 12-12C24 5.371 18.629 0 12 0zm5.707 16.293L16.293 17.707 12 13.414 7.707 17.707 6.293 16.293 10.586 12 6.293 7.707 7.707 6.293 12 10.586 16.293 6.293 17.707 7.707 13.414 12 17.707z"/>
+            </svg>
+        </div>
+        <h1>500</h1>
+        <p>Упс! Произошла внутренняя ошибка сервера.</p>
+        <a href="/">Вернуться на главную</a>
+    </div>
+</body>
+</html>
+)";
+
+static std::string buildErrorPage(const char* status, const std::string& body, const char* connection) {
+    std::string response;
+    response.reserve(128 + body.size());
+    response += "HTTP/1.1 ";
+    response += status;
+    response += "\r\nContent-Type: text/html; charset=UTF-8\r\nContent-Length: ";
+    response += std::to_string(body.size());
+    response += "\r\nConnection: ";
+    response += connection;
+    response += "\r\n\r\n";
+    response += body;
+    return response;
+}
 
 // Конструктор
 FlaskCpp::FlaskCpp(int port, bool verbose, bool enableHotReload, size_t minThreads, size_t maxThreads) 
-    : port(port), verbose(verbose), enableHotReload(enableHotReload), running(false), threadPool(minThreads, maxThreads) {
+    : port(port), verbose(verbose), enableHotReload(enableHotReload), running(false), threadPool(minThreads, maxThreads),
+      blockingPool(std::make_unique<ThreadPool>(ExecutorOptions{}.blockingMinThreads, ExecutorOptions{}.blockingMaxThreads)),
+      blockingRouteIds(Metrics::maxRoutes, false), blockingRoutesEnabled(false), http2Enabled(false),
+      overloadEnabled(false), inFlightRequests(0), shedRequests(0), scheduler(Metrics::maxRoutes),
+      acceptWakeFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)), drainTimeout(std::chrono::seconds(30)), drained(false),
+      preforkEnabled(false), preforkWorkerProcess(false),
+      keepAliveTimeout(std::chrono::seconds(5)), maxRequestBodySize(16 * 1024 * 1024), metricsEnabled(false), openConnections(0),
+      compressionEnabled(false), compressionLevel(6), compressionMinSize(1024), allocStatRequests(0), allocStatAllocations(0), allocStatBytes(0),
+      nextRateLimitScope(1), rateLimitedRequests(0) {
+    // Без eventfd stop() не смог бы разбудить цикл accept
+    if (acceptWakeFd == -1) {
+        throw std::runtime_error(std::string("Failed to create eventfd: ") + std::strerror(errno));
+    }
+#ifdef ENABLE_PHP
+    // Пул по умолчанию создаётся до запуска рабочих потоков: executePHP только читает phpPool
+    phpPool = std::make_unique<FastCgiPool>("127.0.0.1:9000");
+#endif
     if (verbose) {
         std::cout << "Initialized FlaskCpp on port: " << port 
                   << (enableHotReload ? " with" : " without") << " hot_reload" << std::endl;
@@ -17,834 +319,2428 @@ FlaskCpp::FlaskCpp(int port, bool verbose, bool enableHotReload, size_t minThrea
     }
 }
 
+FlaskCpp::~FlaskCpp() {
+    // Сервер, запущенный runAsync() и не остановленный stop(), выходит из цикла accept здесь
+    if (serverThread.joinable()) {
+        running.store(false);
+        wakeAcceptLoop();
+        serverThread.join();
+    }
+    close(acceptWakeFd);
+}
+
 void FlaskCpp::setTemplate(const std::string& name, const std::string& content) {
     templateEngine.setTemplate(name, content);
 }
 
 void FlaskCpp::route(const std::string& path, SimpleHandler handler) {
-    routes[path] = [handler](const RequestData& req) {
+    routes[path] = Route{[handler](const RequestData& req) {
         return handler(req);
-    };
+    }, metrics.registerRoute(path), nullptr, nullptr};
     if (verbose) {
         std::cout << "Route added: " << path << std::endl;
     }
 }
 
-void FlaskCpp::routeParam(const std::string& pattern, ComplexHandler handler) {
-    paramRoutes.push_back({pattern, handler});
-    if (verbose) {
-        std::cout << "Param route added: " << pattern << std::endl;
+void FlaskCpp::routeParam(const std::string& pattern, ComplexHandler handler) {
+    paramRoutes.push_back({pattern, handler, metrics.registerRoute(pattern), nullptr, nullptr});
+    if (verbose) {
+        std::cout << "Param route added: " << pattern << std::endl;
+    }
+}
+
+void FlaskCpp::cacheRoute(const std::string& path, const CacheOptions& options) {
+    auto cache = std::make_shared<const CacheOptions>(options);
+    auto it = routes.find(path);
+    if (it != routes.end()) {
+        it->second.cache = cache;
+    } else {
+        auto pr = std::find_if(paramRoutes.begin(), paramRoutes.end(), [&path](const ParamRoute& r) { return r.pattern == path; });
+        if (pr == paramRoutes.end()) {
+            throw std::invalid_argument("cacheRoute: no route registered for " + path);
+        }
+        pr->cache = cache;
+    }
+    if (!responseCache) {
+        responseCache = std::make_unique<ResponseCache>(defaultResponseCacheBytes);
+    }
+    if (verbose) {
+        std::cout << "Response cache enabled for " << path << " (ttl " << options.ttl.count() << " ms)" << std::endl;
+    }
+}
+
+void FlaskCpp::setResponseCacheSize(size_t bytes) {
+    if (responseCache) {
+        responseCache->setMaxBytes(bytes);
+    } else {
+        responseCache = std::make_unique<ResponseCache>(bytes);
+    }
+}
+
+void FlaskCpp::rateLimit(const std::string& path, const RateLimit& limit) {
+    if (limit.requestsPerSecond <= 0) {
+        throw std::invalid_argument("rateLimit: requestsPerSecond must be positive for " + path);
+    }
+    auto rule = std::make_shared<const RateLimitRule>(RateLimitRule{limit, nextRateLimitScope++});
+    auto it = routes.find(path);
+    if (it != routes.end()) {
+        it->second.rateLimit = rule;
+    } else {
+        auto pr = std::find_if(paramRoutes.begin(), paramRoutes.end(), [&path](const ParamRoute& r) { return r.pattern == path; });
+        if (pr == paramRoutes.end()) {
+            throw std::invalid_argument("rateLimit: no route registered for " + path);
+        }
+        pr->rateLimit = rule;
+    }
+    if (!rateLimiter) {
+        rateLimiter = std::make_unique<RateLimiter>();
+    }
+    if (verbose) {
+        std::cout << "Rate limit for " << path << ": " << limit.requestsPerSecond << " req/s, burst " << limit.burst << std::endl;
+    }
+}
+
+void FlaskCpp::setClientRateLimit(const RateLimit& limit) {
+    if (limit.requestsPerSecond <= 0) {
+        throw std::invalid_argument("setClientRateLimit: requestsPerSecond must be positive");
+    }
+    clientRateLimit = std::make_shared<const RateLimitRule>(RateLimitRule{limit, 0});
+    if (!rateLimiter) {
+        rateLimiter = std::make_unique<RateLimiter>();
+    }
+    if (verbose) {
+        std::cout << "Client rate limit: " << limit.requestsPerSecond << " req/s, burst " << limit.burst << std::endl;
+    }
+}
+
+void FlaskCpp::enableSessions(const std::string& secret, const SessionOptions& options, std::shared_ptr<SessionStore> store) {
+    sessions = std::make_unique<SessionManager>(secret, options, std::move(store));
+    if (verbose) {
+        std::cout << "Sessions enabled: cookie " << options.cookieName << ", ttl " << options.ttl.count() << "s" << std::endl;
+    }
+}
+
+void FlaskCpp::proxy(const std::string& prefix, const std::vector<std::string>& servers, const UpstreamOptions& options) {
+    if (servers.empty()) {
+        throw std::invalid_argument("proxy route " + prefix + " has no upstream servers");
+    }
+    std::string normalized = prefix;
+    while (normalized.size() > 1 && normalized.back() == '/') normalized.pop_back();
+    proxyRoutes.push_back({normalized, std::make_unique<UpstreamPool>(servers, options), metrics.registerRoute(normalized)});
+    if (verbose) {
+        std::cout << "Proxy route added: " << normalized << " -> " << servers.size() << " upstream(s)" << std::endl;
+    }
+}
+
+void FlaskCpp::websocket(const std::string& path, WebSocketHandler handler) {
+    websocketRoutes[path] = WebSocketRoute{std::make_shared<const WebSocketHandler>(std::move(handler)), metrics.registerRoute(path)};
+    if (verbose) {
+        std::cout << "WebSocket route added: " << path << std::endl;
+    }
+}
+
+void FlaskCpp::setWebSocketOptions(const WebSocketOptions& options) {
+    websocketOptions = options;
+}
+
+size_t FlaskCpp::broadcast(const std::string& group, std::string_view message, bool binary) {
+    return websocketHub ? websocketHub->broadcast(group, message, binary) : 0;
+}
+
+void FlaskCpp::enableHttp2(const Http2Options& options) {
+    http2Enabled = true;
+    http2Options = options;
+    if (verbose) {
+        std::cout << "HTTP/2 (h2c) enabled: up to " << options.maxConcurrentStreams << " concurrent streams per connection" << std::endl;
+    }
+}
+
+void FlaskCpp::setOverloadProtection(const OverloadOptions& options) {
+    overloadEnabled = true;
+    overloadOptions = options;
+    threadPool.setAdmission(options);
+    static const std::string body = "Service Unavailable";
+    overloadResponse = "HTTP/1.1 503 Service Unavailable\r\nContent-Type: text/plain; charset=UTF-8\r\nRetry-After: ";
+    overloadResponse += std::to_string(options.retryAfter.count());
+    overloadResponse += "\r\nContent-Length: ";
+    overloadResponse += std::to_string(body.size());
+    overloadResponse += "\r\nConnection: close\r\n\r\n";
+    overloadResponse += body;
+    if (verbose) {
+        std::cout << "Overload protection enabled: maxConnections=" << options.maxConnections
+                  << ", maxInFlightRequests=" << options.maxInFlightRequests
+                  << ", maxQueueDepth=" << options.maxQueueDepth
+                  << ", queueDelayTarget=" << options.queueDelayTarget.count() << "ms" << std::endl;
+    }
+}
+
+// Идентификатор Metrics маршрута route(), шаблона routeParam() или префикса proxy()
+size_t FlaskCpp::registeredRouteId(const std::string& path, const char* caller) {
+    auto it = routes.find(path);
+    if (it != routes.end()) {
+        return it->second.metricsId;
+    }
+    auto pr = std::find_if(paramRoutes.begin(), paramRoutes.end(), [&path](const ParamRoute& r) { return r.pattern == path; });
+    if (pr != paramRoutes.end()) {
+        return pr->metricsId;
+    }
+    auto proxyRoute = std::find_if(proxyRoutes.begin(), proxyRoutes.end(), [&path](const ProxyRoute& r) { return r.prefix == path; });
+    if (proxyRoute != proxyRoutes.end()) {
+        return proxyRoute->metricsId;
+    }
+    throw std::invalid_argument(std::string(caller) + ": no route registered for " + path);
+}
+
+void FlaskCpp::setLatencyTarget(const std::string& path, std::chrono::milliseconds target) {
+    scheduler.setTarget(registeredRouteId(path, "setLatencyTarget"), target);
+    if (verbose) {
+        std::cout << "Latency target for " << path << ": "
+                  << (target.count() > 0 ? std::to_string(target.count()) + " ms" : std::string("learned")) << std::endl;
+    }
+}
+
+void FlaskCpp::setSchedulingOptions(const SchedulingOptions& options) {
+    scheduler.setOptions(options);
+}
+
+void FlaskCpp::setExecutorOptions(const ExecutorOptions& options) {
+    if (options.blockingMaxThreads == 0 || options.blockingMinThreads > options.blockingMaxThreads) {
+        throw std::invalid_argument("ExecutorOptions: blockingMaxThreads must be positive and not less than blockingMinThreads");
+    }
+    blockingPool = std::make_unique<ThreadPool>(options.blockingMinThreads, options.blockingMaxThreads);
+    if (verbose) {
+        std::cout << "Blocking pool: minThreads=" << options.blockingMinThreads
+                  << ", maxThreads=" << options.blockingMaxThreads << std::endl;
+    }
+}
+
+void FlaskCpp::blockingRoute(const std::string& path) {
+    blockingRouteIds[registeredRouteId(path, "blockingRoute")] = true;
+    blockingRoutesEnabled = true;
+    if (verbose) {
+        std::cout << "Blocking route: " << path << std::endl;
+    }
+}
+
+void FlaskCpp::setAcceptOptions(const AcceptOptions& options) {
+    acceptOptions = options;
+    acceptOptions.batch = std::max<size_t>(acceptOptions.batch, 1);
+}
+
+void FlaskCpp::setDrainTimeout(std::chrono::milliseconds timeout) {
+    drainTimeout = timeout;
+}
+
+void FlaskCpp::enableHotRestart(const std::string& controlSocketPath) {
+    listenerHandoff = std::make_unique<ListenerHandoff>(controlSocketPath);
+    if (verbose) {
+        std::cout << "Hot restart enabled: control socket " << controlSocketPath << std::endl;
+    }
+}
+
+void FlaskCpp::enablePrefork(const PreforkOptions& options) {
+    preforkEnabled = true;
+    preforkOptions = options;
+    if (PreforkWorker::fromEnvironment(preforkWorker)) {
+        // Процесс запущен главным процессом prefork: общая память уже создана, подключаемся к ней
+        preforkWorkerProcess = true;
+        preforkSegment = std::make_unique<PreforkSegment>(preforkWorker.segmentFd);
+        size_t perWorker = preforkSegment->shardsPerWorker();
+        metrics.useSharedShards(preforkSegment->metricsShards(), preforkSegment->workerCount() * perWorker,
+                                preforkWorker.index * perWorker, (preforkWorker.index + 1) * perWorker);
+        if (preforkWorker.cacheFd != -1) {
+            sharedCacheSegment = std::make_shared<SharedCache>(preforkWorker.cacheFd);
+        }
+        if (verbose) {
+            std::cout << "Prefork worker " << preforkWorker.index << " (pid " << getpid() << ")" << std::endl;
+        }
+        return;
+    }
+
+    if (preforkOptions.workers == 0) {
+        preforkOptions.workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    preforkSegment = std::make_unique<PreforkSegment>(preforkOptions.workers, preforkOptions.metricsShardsPerWorker);
+    if (preforkOptions.sharedCacheSlots > 0) {
+        sharedCacheSegment = std::make_shared<SharedCache>(preforkOptions.sharedCacheSlots, preforkOptions.sharedCacheSlotSize);
+    }
+    if (verbose) {
+        std::cout << "Prefork enabled: " << preforkOptions.workers << " worker(s), shared cache "
+                  << preforkOptions.sharedCacheSlots << " x " << preforkOptions.sharedCacheSlotSize << " bytes" << std::endl;
+    }
+}
+
+void FlaskCpp::loadTemplatesFromDirectory(const std::string& directoryPath) {
+    namespace fs = std::filesystem;
+    templatesDirectory = directoryPath;
+
+    if (!fs::exists(directoryPath) || !fs::is_directory(directoryPath)) {
+        std::cerr << "Templates directory does not exist: " << directoryPath << std::endl;
+        return;
+    }
+
+    for (const auto& entry : fs::directory_iterator(directoryPath)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".html") {
+            std::ifstream file(entry.path());
+            if (file) {
+                std::ostringstream ss;
+                ss << file.rdbuf();
+                std::string content = ss.str();
+                std::string filename = entry.path().filename().string();
+                setTemplate(filename, content);
+
+                // Сохраняем временную метку файла
+                templatesTimestamps[entry.path().string()] = fs::last_write_time(entry);
+
+                if (verbose) {
+                    std::cout << "Loaded template: " << filename << std::endl;
+                }
+            } else {
+                std::cerr << "Failed to open template file: " << entry.path() << std::endl;
+            }
+        }
+    }
+}
+
+void FlaskCpp::monitorTemplates() {
+    namespace fs = std::filesystem;
+
+    while (running.load()) {
+        std::this_thread::sleep_for(std::chrono::seconds(2)); // Умеренный интервал проверки
+
+        if (templatesDirectory.empty()) continue;
+
+        for (const auto& entry : fs::directory_iterator(templatesDirectory)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".html") {
+                std::string filePath = entry.path().string();
+                auto currentTimestamp = fs::last_write_time(entry);
+
+                // Если файл изменился, перезагрузим его
+                if (templatesTimestamps.find(filePath) != templatesTimestamps.end()) {
+                    if (templatesTimestamps[filePath] != currentTimestamp) {
+                        std::ifstream file(entry.path());
+                        if (file) {
+                            std::ostringstream ss;
+                            ss << file.rdbuf();
+                            std::string content = ss.str();
+                            std::string filename = entry.path().filename().string();
+                            setTemplate(filename, content);
+
+                            templatesTimestamps[filePath] = currentTimestamp;
+
+                            if (verbose) {
+                                std::cout << "Template reloaded: " << filename << std::endl;
+                            }
+                        }
+                    }
+                } else {
+                    // Новый файл
+                    templatesTimestamps[filePath] = currentTimestamp;
+                }
+            }
+        }
+    }
+}
+
+void FlaskCpp::runAsync() {
+    if (running.load()) {
+        std::cerr << "Server is already running." << std::endl;
+        return;
+    }
+
+    running.store(true);
+
+    // Запускаем поток мониторинга только если hot_reload включен
+    if (enableHotReload) {
+        hotReloadThread = std::thread(&FlaskCpp::monitorTemplates, this);
+        if (verbose) {
+            std::cout << "Hot reload is enabled. Monitoring templates for changes." << std::endl;
+        }
+    } else {
+        if (verbose) {
+            std::cout << "Hot reload is disabled." << std::endl;
+        }
+    }
+
+    // Цикл accept получает собственный поток: в пуле он навсегда занял бы один из потоков обработчиков
+    serverThread = std::thread(&FlaskCpp::run, this);
+}
+
+void FlaskCpp::run() {
+    int serverSocket = -1;
+    if (preforkWorkerProcess) {
+        // Порт открыл главный процесс prefork; передачей сокета при горячем перезапуске тоже занимается он
+        serverSocket = preforkWorker.listenSocket;
+        listenerHandoff.reset();
+        if (responseCache && sharedCacheSegment) {
+            responseCache->setSharedCache(sharedCacheSegment);
+        }
+    } else if (listenerHandoff) {
+        // При горячем перезапуске слушающий сокет забирается у работающего процесса вместе с очередью соединений
+        serverSocket = listenerHandoff->receive();
+        if (serverSocket != -1 && verbose) {
+            std::cout << "Listening socket inherited from the previous process" << std::endl;
+        }
+    }
+    if (serverSocket == -1) {
+        serverSocket = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (serverSocket == -1) {
+            std::cerr << "Failed to create socket." << std::endl;
+            running.store(false);
+            return;
+        }
+
+        int opt = 1;
+        setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        // Сокеты обработчиков prefork с SO_INCOMING_CPU входят в одну группу reuseport с этим
+        if (preforkEnabled && !preforkWorkerProcess && preforkOptions.incomingCpu) {
+            setsockopt(serverSocket, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
+        }
+
+        sockaddr_in serverAddr = {};
+        serverAddr.sin_family = AF_INET;
+        serverAddr.sin_addr.s_addr = INADDR_ANY;
+        serverAddr.sin_port = htons(port);
+
+        if (bind(serverSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) == -1) {
+            std::cerr << "Bind failed." << std::endl;
+            close(serverSocket);
+            running.store(false);
+            return;
+        }
+
+        if (listen(serverSocket, 100) == -1) { // Увеличиваем backlog для большей нагрузки
+            std::cerr << "Listen failed." << std::endl;
+            close(serverSocket);
+            running.store(false);
+            return;
+        }
+    }
+    // Неблокирующий: соединение из общей очереди может забрать другой процесс, пока этот выходил из poll,
+    // а цикл accept забирает очередь пачкой до EAGAIN
+    fcntl(serverSocket, F_SETFL, fcntl(serverSocket, F_GETFL) | O_NONBLOCK);
+    // Параметры слушающего сокета задаёт каждый процесс, который на нём принимает: сокет мог прийти
+    // от главного процесса prefork или от предыдущего процесса при горячем перезапуске
+    setsockopt(serverSocket, SOL_SOCKET, SO_RCVTIMEO, &receiveTimeout, sizeof(receiveTimeout));
+    int deferSeconds = static_cast<int>(acceptOptions.deferAccept.count());
+    setsockopt(serverSocket, IPPROTO_TCP, TCP_DEFER_ACCEPT, &deferSeconds, sizeof(deferSeconds));
+    if (acceptOptions.fastOpenQueue > 0 &&
+        setsockopt(serverSocket, IPPROTO_TCP, TCP_FASTOPEN, &acceptOptions.fastOpenQueue, sizeof(acceptOptions.fastOpenQueue)) != 0) {
+        std::cerr << "TCP_FASTOPEN is not available: " << std::strerror(errno) << std::endl;
+    }
+
+    if (listenerHandoff) {
+        try {
+            listenerHandoff->serve(serverSocket, [this]() {
+                // Новый процесс уже принимает соединения; этот перестаёт и дообслуживает принятые
+                if (verbose) {
+                    std::cout << "Listening socket handed off to the new process" << std::endl;
+                }
+                running.store(false);
+                wakeAcceptLoop();
+            });
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+
+    // Главный процесс prefork запросов не обслуживает: журнал, upstream, WebSocket и HTTP/2 живут в обработчиках
+    if (preforkEnabled && !preforkWorkerProcess) {
+        std::cout << "Server started on port " << port << " with " << preforkOptions.workers << " prefork worker(s)" << std::endl;
+        try {
+            PreforkMaster master(preforkOptions, serverSocket, *preforkSegment, sharedCacheSegment.get(), verbose);
+            master.run(running, acceptWakeFd, drainTimeout);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            running.store(false);
+        }
+        close(serverSocket);
+        return;
+    }
+
+    // В режиме verbose запросы по-прежнему видны в консоли, но через асинхронный журнал
+    if (verbose && !accessLog) {
+        accessLog = std::make_unique<AccessLog>("-", AccessLogFormat::Common);
+        accessLog->start();
+    }
+
+    // Без файла трасс сервер работает дальше, как без трассировки
+    if (tracer) {
+        try {
+            tracer->start();
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            tracer.reset();
+        }
+    }
+
+    // Проверки здоровья upstream-серверов
+    for (auto& proxyRoute : proxyRoutes) {
+        proxyRoute.pool->start();
+    }
+
+    // Поток WebSocket-соединений; события обработчикам проходят тот же допуск, что и запросы GET
+    if (!websocketRoutes.empty()) {
+        websocketHub = std::make_unique<WebSocketHub>(
+            [this](std::function<void()> task, std::function<void()> shed) {
+                // onOpen выполняется в счёт уже допущенного запроса на переключение протокола
+                if (!shed) {
+                    threadPool.post(methodPriority("GET"), std::move(task));
+                    return;
+                }
+                admitRequest(methodPriority("GET"), TaskSchedule{}, std::move(task), std::move(shed));
+            },
+            websocketOptions);
+        websocketHub->start();
+    }
+
+    // Потоки HTTP/2 выполняются в пуле с тем же приоритетом по методу и сроком по маршруту, что и запросы HTTP/1.1
+    if (http2Enabled) {
+        http2Server = std::make_unique<Http2Server>(
+            [this](std::string request, const std::string& clientIP) {
+                return handleHttp2Request(std::move(request), clientIP);
+            },
+            [this](std::string_view method, std::string_view path, std::function<void()> task) {
+                // Отказ превращается в ответ 503 на этот поток, остальные потоки соединения не затрагиваются
+                size_t routeId = scheduledRoute(path);
+                if (isBlockingRoute(routeId)) {
+                    blockingPool->post(0, std::move(task));
+                    return;
+                }
+                TaskSchedule schedule = scheduler.schedule(routeId, threadPool.virtualTime());
+                if (!admitRequest(methodPriority(method), schedule, std::move(task), nullptr)) {
+                    throw std::runtime_error("Server overloaded");
+                }
+            },
+            http2Options);
+    }
+
+    // Реактор для простаивающих keep-alive соединений
+    if (keepAliveTimeout.count() > 0) {
+        keepAliveReactor = std::make_unique<Reactor>(
+            [this](Connection* conn) {
+                // Запрос ещё не прочитан: срок на чтение, маршрут определит рабочий поток
+                conn->queuedAt = std::chrono::steady_clock::now();
+                conn->scheduled = false;
+                try {
+                    admitRequest(conn->priority, readSchedule(),
+                                 [this, conn]() { this->handleConnection(conn); },
+                                 [this, conn]() { sendOverloaded(*conn); closeConnection(conn); });
+                } catch (...) {
+                    closeConnection(conn);
+                }
+            },
+            [this](Connection* conn) { closeConnection(conn); },
+            keepAliveTimeout);
+        keepAliveReactor->start();
+    }
+
+    if (verbose) {
+        std::cout << "Server is running on " << (tlsContext ? "https" : "http") << "://localhost:" << port << std::endl;
+    } else {
+        std::cout << "Server started on port " << port << std::endl;
+    }
+
+    if (ioUringServer && tlsContext) {
+        // Рукопожатие и шифрование выполняются в рабочих потоках
+        std::cerr << "io_uring is not used with TLS; serving on epoll" << std::endl;
+    } else if (ioUringServer) {
+        // Соединения без запросов закрываются по таймауту keep-alive, как первый recv обычного пути
+        std::chrono::milliseconds idleTimeout = keepAliveTimeout.count() > 0 ? keepAliveTimeout : std::chrono::seconds(5);
+        std::string error;
+        if (ioUringServer->run(serverSocket, running, idleTimeout, error)) {
+            close(serverSocket);
+            return;
+        }
+        std::cerr << error << "; falling back to epoll" << std::endl;
+    }
+
+    pollfd acceptFds[2] = {{serverSocket, POLLIN, 0}, {acceptWakeFd, POLLIN, 0}};
+    while (running.load()) { //  цикл для поддержки остановки сервера
+        // stop() и передача сокета новому процессу будят цикл через eventfd
+        if (poll(acceptFds, 2, -1) == -1 && errno != EINTR) {
+            std::cerr << "Failed to poll listening socket." << std::endl;
+            break;
+        }
+        if (acceptFds[1].revents || !running.load()) break;
+        if (!(acceptFds[0].revents & POLLIN)) continue;
+
+        // Очередь слушающего сокета забирается пачкой: один poll на много соединений. Поток accept
+        // не читает данных клиента, поэтому молчащий клиент не задерживает приём остальных
+        for (size_t accepted = 0; accepted < acceptOptions.batch; ++accepted) {
+            sockaddr_in clientAddr;
+            socklen_t clientLen = sizeof(clientAddr);
+            int clientSocket = accept4(serverSocket, (sockaddr*)&clientAddr, &clientLen, SOCK_CLOEXEC);
+            if (clientSocket == -1) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    std::cerr << "Failed to accept connection." << std::endl;
+                }
+                break;
+            }
+
+            char clientIP[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &clientAddr.sin_addr, clientIP, INET_ADDRSTRLEN);
+
+            // Соединение считается открытым с момента accept: ожидающие в очереди пула тоже занимают ресурсы
+            if (overloadEnabled && overloadOptions.maxConnections > 0 &&
+                openConnections.load() >= overloadOptions.maxConnections) {
+                shedRequests.fetch_add(1);
+                // Клиенту TLS ответ без шифрования не прочитать - он увидит закрытое соединение
+                if (!tlsContext) sendOverloaded(clientSocket);
+                close(clientSocket);
+                continue;
+            }
+            openConnections.fetch_add(1);
+
+            auto queuedAt = std::chrono::steady_clock::now();
+            admitRequest(newConnectionPriority, readSchedule(),
+                         [this, clientSocket, ip = std::string(clientIP), queuedAt]() { this->handleClient(clientSocket, ip, queuedAt); },
+                         [this, clientSocket]() {
+                             if (!tlsContext) sendOverloaded(clientSocket);
+                             close(clientSocket);
+                             openConnections.fetch_sub(1);
+                         });
+        }
+    }
+
+    close(serverSocket);
+}
+
+void FlaskCpp::wakeAcceptLoop() {
+    uint64_t one = 1;
+    ssize_t written = write(acceptWakeFd, &one, sizeof(one));
+    (void)written;
+    if (ioUringServer) {
+        ioUringServer->wake();
+    }
+}
+
+void FlaskCpp::stop() {
+    // После передачи сокета новому процессу running уже сброшен, но дообслуживание ещё не выполнено
+    bool handedOff = listenerHandoff && listenerHandoff->handedOff();
+    if (!running.load() && (!handedOff || drained.load())) return;
+
+    running.store(false);
+    drained.store(true);
+    wakeAcceptLoop();
+
+    // Управляющий сокет горячего перезапуска больше не нужен; если сокет не передан, путь удаляется
+    if (listenerHandoff) {
+        listenerHandoff->stop();
+    }
+
+    // Закрываем простаивающие keep-alive соединения
+    if (keepAliveReactor) {
+        keepAliveReactor->stop();
+    }
+
+    // Дожидаемся ответов на уже принятые запросы: в очереди пула и в обработке.
+    // Ответы на них идут с Connection: close, после ответа соединение закрывается
+    auto drainDeadline = std::chrono::steady_clock::now() + drainTimeout;
+    while (openConnections.load() > 0 && std::chrono::steady_clock::now() < drainDeadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (verbose) {
+        size_t remaining = openConnections.load();
+        if (remaining > 0) {
+            std::cout << "Drain timeout: " << remaining << " connection(s) still open" << std::endl;
+        } else {
+            std::cout << "All connections drained" << std::endl;
+        }
+    }
+    // Цикл io_uring завершается сам, когда соединений не осталось; после таймаута - принудительно
+    if (ioUringServer) {
+        ioUringServer->stop();
+    }
+
+    // Закрываем WebSocket-соединения; обработчики onClose ещё успеют выполниться в пуле
+    if (websocketHub) {
+        websocketHub->stop();
+    }
+
+    // HTTP/2: GOAWAY клиентам, уже принятые потоки дообслуживаются пулом
+    if (http2Server) {
+        http2Server->stop();
+    }
+
+    // Ожидаем завершения потока мониторинга
+    if (enableHotReload && hotReloadThread.joinable()) {
+        hotReloadThread.join();
+    }
+
+    // Поток цикла accept уже вышел из цикла или выходит (stop() из него самого не ждёт себя)
+    if (serverThread.joinable() && serverThread.get_id() != std::this_thread::get_id()) {
+        serverThread.join();
+    }
+
+    // Останавливаем пул обработчиков, затем пул блокирующих задач: хендлеры могли поставить в него работу
+    threadPool.shutdown();
+    blockingPool->shutdown();
+
+    for (auto& proxyRoute : proxyRoutes) {
+        proxyRoute.pool->stop();
+    }
+
+    // Дописываем накопленные записи журнала доступа и трассы
+    if (accessLog) {
+        accessLog->stop();
+    }
+    if (tracer) {
+        tracer->stop();
+    }
+
+    if (verbose) {
+        std::cout << "Server has been stopped." << std::endl;
+    }
+}
+
+std::string FlaskCpp::renderTemplate(const std::string& templateName, const TemplateEngine::Context& context) {
+    if (!metricsEnabled) {
+        return templateEngine.render(templateName, context);
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::string result = templateEngine.render(templateName, context);
+    metrics.recordPhase(MetricsPhase::Render, elapsedNanos(start));
+    return result;
+}
+
+std::string FlaskCpp::buildResponse(const std::string& status_code,
+                                    const std::string& content_type,
+                                    const std::string& body,
+                                    const std::vector<std::pair<std::string, std::string>>& extra_headers) {
+    // Собираем ответ в одну строку с заранее рассчитанной ёмкостью: одно выделение памяти на ответ
+    size_t headersSize = 0;
+    for (const auto& header : extra_headers) {
+        headersSize += header.first.size() + header.second.size() + 4;
+    }
+    std::string response;
+    response.reserve(128 + status_code.size() + content_type.size() + headersSize + body.size());
+
+    response += "HTTP/1.1 ";
+    response += status_code;
+    response += "\r\nContent-Type: ";
+    response += content_type;
+
+    // Добавляем charset=utf-8 для текстовых типов контента
+    if (content_type.find("text/") != std::string::npos || content_type.find("application/json") != std::string::npos) {
+        response += "; charset=utf-8";
+    }
+    response += "\r\nContent-Length: ";
+    response += std::to_string(body.size());
+    response += "\r\n";
+
+    // Добавление дополнительных заголовков, включая несколько Set-Cookie
+    for (const auto& header : extra_headers) {
+        response += header.first;
+        response += ": ";
+        response += header.second;
+        response += "\r\n";
+    }
+
+    response += "Connection: ";
+    response += connectionHeaderValue();
+    response += "\r\n\r\n";
+    response += body;
+    return response;
+}
+
+std::string FlaskCpp::jsonResponse(const std::string& status_code,
+                                   const std::function<void(JsonWriter&)>& writeBody,
+                                   const std::vector<std::pair<std::string, std::string>>& extra_headers) {
+    size_t headersSize = 0;
+    for (const auto& header : extra_headers) {
+        headersSize += header.first.size() + header.second.size() + 4;
+    }
+    std::string response;
+    response.reserve(512 + status_code.size() + headersSize);
+
+    response += "HTTP/1.1 ";
+    response += status_code;
+    response += "\r\nContent-Type: application/json; charset=utf-8\r\nContent-Length: ";
+    size_t lengthPosition = response.size();
+    response += "\r\n";
+    for (const auto& header : extra_headers) {
+        response += header.first;
+        response += ": ";
+        response += header.second;
+        response += "\r\n";
+    }
+    response += "Connection: ";
+    response += connectionHeaderValue();
+    response += "\r\n\r\n";
+
+    size_t bodyStart = response.size();
+    JsonWriter writer(response);
+    writeBody(writer);
+
+    // Длина тела известна только теперь: вставка сдвигает готовое тело на несколько байт
+    char length[24];
+    auto result = std::to_chars(length, length + sizeof(length), response.size() - bodyStart);
+    response.insert(lengthPosition, length, static_cast<size_t>(result.ptr - length));
+    return response;
+}
+
+std::string FlaskCpp::setCookie(const std::string& name, const std::string& value,
+                                const std::string& path, const std::string& expires,
+                                bool httpOnly, bool secure, const std::string& sameSite) {
+    std::ostringstream cookie;
+    cookie << name << "=" << value;
+    cookie << "; Path=" << path;
+    if (!expires.empty()) {
+        cookie << "; Expires=" << expires;
+    }
+    if (httpOnly) {
+        cookie << "; HttpOnly";
+    }
+    if (secure) {
+        cookie << "; Secure";
+    }
+    if (!sameSite.empty()) {
+        cookie << "; SameSite=" << sameSite;
+    }
+    return cookie.str();
+}
+
+std::string FlaskCpp::deleteCookie(const std::string& name,
+                                   const std::string& path) {
+    std::ostringstream cookie;
+    cookie << name << "=deleted";
+    cookie << "; Path=" << path;
+    cookie << "; Expires=Thu, 01 Jan 1970 00:00:00 GMT";
+    cookie << "; HttpOnly";
+    return cookie.str();
+}
+
+void FlaskCpp::enableCompression(int level, size_t minSize) {
+    if (level < 1 || level > 9) {
+        throw std::invalid_argument("compression level must be between 1 and 9");
+    }
+    compressionEnabled = true;
+    compressionLevel = level;
+    compressionMinSize = minSize;
+    if (verbose) {
+        std::cout << "Compression enabled: level " << level << ", responses from " << minSize << " bytes" << std::endl;
+    }
+}
+
+void FlaskCpp::enableIoUring(const IoUringOptions& options) {
+    IoUringServer::Callbacks callbacks;
+    callbacks.accept = [this](int clientSocket, const sockaddr_in& address) {
+        return acceptIoUringConnection(clientSocket, address);
+    };
+    callbacks.inspect = [this](Connection& conn) { return inspectRequest(conn); };
+    callbacks.dispatch = [this](Connection* conn) { dispatchIoUringRequest(conn); };
+    callbacks.takeOver = [this](Connection* conn) {
+        // Запрос уже в readBuffer: handleConnection прочитает из сокета только то, что не пришло
+        conn->responseSink = nullptr;
+        std::string_view request(conn->readBuffer);
+        conn->queuedAt = std::chrono::steady_clock::now();
+        conn->scheduled = true;
+        try {
+            admitRequest(methodPriority(request.substr(0, request.find(' '))), requestSchedule(request),
+                         [this, conn]() { handleConnection(conn); },
+                         [this, conn]() { sendOverloaded(conn->socket); closeConnection(conn); });
+        } catch (...) {
+            closeConnection(conn);
+        }
+    };
+    callbacks.release = [this](Connection* conn) {
+        openConnections.fetch_sub(1);
+        ConnectionPool::release(std::unique_ptr<Connection>(conn));
+    };
+    ioUringServer = std::make_unique<IoUringServer>(std::move(callbacks), options);
+    if (verbose) {
+        std::cout << "io_uring enabled: " << options.entries << " entries, " << options.bufferCount << " x "
+                  << options.bufferSize << " byte receive buffers" << std::endl;
+    }
+}
+
+void FlaskCpp::enableTls(const TlsOptions& options) {
+    tlsContext = std::make_unique<TlsContext>(options);
+    if (verbose) {
+        std::cout << "TLS enabled: certificate " << options.certificateFile
+                  << (options.sessionTickets ? ", session tickets" : "")
+                  << (options.kernelTls ? ", kernel TLS when available" : "") << std::endl;
+    }
+}
+
+void FlaskCpp::setKeepAliveTimeout(std::chrono::milliseconds timeout) {
+    keepAliveTimeout = timeout;
+}
+
+void FlaskCpp::setMaxRequestBodySize(size_t bytes) {
+    maxRequestBodySize = bytes;
+}
+
+void FlaskCpp::enableMetrics(const std::string& path) {
+    metricsEnabled = true;
+    route(path, [this](const RequestData&) {
+        std::string body = renderMetrics();
+        return buildResponse("200 OK", "text/plain; version=0.0.4", body);
+    });
+}
+
+void FlaskCpp::enableProfiler(const std::string& token, const std::string& path) {
+    if (token.size() < 16) {
+        throw std::invalid_argument("profiler: token must be at least 16 bytes");
+    }
+    profiler = std::make_unique<SamplingProfiler>();
+    // Профиль длится секунды: запрос ждёт его в пуле блокирующих задач, а не в потоке обработчиков
+    route(path, [this, expected = "Bearer " + token](const RequestData& req) {
+        // Сравнение за постоянное время, как подписи cookie сессии
+        std::string_view authorization = req.header(KnownHeader::Authorization);
+        unsigned char difference = authorization.size() != expected.size();
+        for (size_t i = 0; i < expected.size() && i < authorization.size(); ++i) {
+            difference |= static_cast<unsigned char>(authorization[i] ^ expected[i]);
+        }
+        if (difference) {
+            return buildResponse("401 Unauthorized", "text/plain", "Unauthorized\n", {{"WWW-Authenticate", "Bearer"}});
+        }
+
+        ProfileOptions options;
+        const auto& params = req.queryParams();
+        auto seconds = params.find("seconds");
+        if (seconds != params.end()) {
+            long value = std::strtol(seconds->second.c_str(), nullptr, 10);
+            if (value < 1 || value > 600) {
+                return buildResponse("400 Bad Request", "text/plain", "seconds must be within 1..600\n");
+            }
+            options.duration = std::chrono::seconds(value);
+        }
+        auto hz = params.find("hz");
+        if (hz != params.end()) {
+            options.frequency = std::atoi(hz->second.c_str());
+        }
+
+        std::string body;
+        try {
+            body = profiler->profile(options, running);
+        } catch (const std::invalid_argument& e) {
+            return buildResponse("400 Bad Request", "text/plain", std::string(e.what()) + "\n");
+        } catch (const std::runtime_error& e) {
+            return buildResponse("409 Conflict", "text/plain", std::string(e.what()) + "\n");
+        }
+        return buildResponse("200 OK", "text/plain", body, {{"Cache-Control", "no-store"}});
+    });
+    blockingRoute(path);
+    if (verbose) {
+        std::cout << "CPU profiler enabled at " << path << std::endl;
+    }
+}
+
+void FlaskCpp::enableTracing(const TracingOptions& options) {
+    tracer = std::make_unique<Tracer>(options);
+    if (verbose) {
+        std::cout << "Request tracing enabled: " << options.directory << " ("
+                  << (options.sampling == TraceSampling::Head ? "head" : "tail") << " sampling, rate "
+                  << options.sampleRate << ")" << std::endl;
+    }
+}
+
+void FlaskCpp::enableAccessLog(const std::string& path, AccessLogFormat format,
+                               size_t rotateBytes, std::chrono::seconds rotateInterval) {
+    if (accessLog) {
+        accessLog->stop();
+    }
+    accessLog = std::make_unique<AccessLog>(path, format, rotateBytes, rotateInterval);
+    accessLog->start();
+    if (verbose) {
+        std::cout << "Access log enabled: " << path << std::endl;
+    }
+}
+
+std::string FlaskCpp::renderMetrics() {
+    std::vector<MetricsGauge> gauges = {
+        {"flaskcpp_threadpool_queue_depth", "Tasks waiting in the ThreadPool queue.", double(threadPool.queueSize())},
+        {"flaskcpp_threadpool_threads", "Worker threads in the ThreadPool.", double(threadPool.threadCount())},
+        {"flaskcpp_threadpool_active_threads", "Worker threads currently running a task.", double(threadPool.activeThreadCount())},
+        {"flaskcpp_threadpool_saturation", "Share of the maximum worker threads currently running a task.",
+            double(threadPool.activeThreadCount()) / double(std::max<size_t>(threadPool.maxThreadCount(), 1))},
+        {"flaskcpp_blocking_pool_queue_depth", "Tasks waiting in the blocking pool queue.", double(blockingPool->queueSize())},
+        {"flaskcpp_blocking_pool_threads", "Threads in the blocking pool.", double(blockingPool->threadCount())},
+        {"flaskcpp_blocking_pool_active_threads", "Blocking pool threads currently running a task.", double(blockingPool->activeThreadCount())},
+        {"flaskcpp_blocking_pool_saturation", "Share of the maximum blocking pool threads currently running a task.",
+            double(blockingPool->activeThreadCount()) / double(std::max<size_t>(blockingPool->maxThreadCount(), 1))},
+        {"flaskcpp_open_connections", "Client connections currently open.", double(openConnections.load())},
+        {"flaskcpp_idle_connections", "Keep-alive connections waiting for the next request.",
+            double(keepAliveReactor ? keepAliveReactor->idleCount() : 0)},
+    };
+    if (rateLimiter) {
+        gauges.push_back({"flaskcpp_rate_limited_total", "Requests rejected with 429 by rate limits.",
+                          double(rateLimitedRequests.load()), "counter"});
+        gauges.push_back({"flaskcpp_rate_limit_keys", "Client keys tracked by the rate limiter.", double(rateLimiter->size())});
+    }
+    if (tlsContext) {
+        gauges.push_back({"flaskcpp_tls_handshakes_total", "Completed TLS handshakes.", double(tlsContext->handshakes()), "counter"});
+        gauges.push_back({"flaskcpp_tls_resumed_handshakes_total", "TLS handshakes that resumed a session.",
+                          double(tlsContext->resumedHandshakes()), "counter"});
+        gauges.push_back({"flaskcpp_tls_failed_handshakes_total", "TLS handshakes that failed or timed out.",
+                          double(tlsContext->failedHandshakes()), "counter"});
+        gauges.push_back({"flaskcpp_tls_kernel_connections_total", "TLS connections with kernel TLS transmit offload.",
+                          double(tlsContext->kernelTlsConnections()), "counter"});
+    }
+    if (ioUringServer) {
+        gauges.push_back({"flaskcpp_io_uring_connections", "Client connections served by the io_uring loop.",
+                          double(ioUringServer->connectionCount())});
+        gauges.push_back({"flaskcpp_io_uring_enter_total", "io_uring_enter system calls made by the io_uring loop.",
+                          double(ioUringServer->enterCalls()), "counter"});
+    }
+    if (sessions) {
+        gauges.push_back({"flaskcpp_sessions", "Live sessions in the session store.", double(sessions->backend().size())});
+    }
+    if (overloadEnabled) {
+        gauges.push_back({"flaskcpp_inflight_requests", "Requests queued or being handled.", double(inFlightRequests.load())});
+        gauges.push_back({"flaskcpp_requests_shed_total", "Requests rejected with 503 by overload protection.",
+                          double(shedRequests.load()), "counter"});
+        gauges.push_back({"flaskcpp_threadpool_overloaded", "1 while queue delay stays above the target.",
+                          threadPool.overloaded() ? 1.0 : 0.0});
+    }
+    if (http2Server) {
+        gauges.push_back({"flaskcpp_http2_connections", "Open HTTP/2 connections.", double(http2Server->connectionCount())});
+        gauges.push_back({"flaskcpp_http2_streams_total", "HTTP/2 streams accepted.", double(http2Server->streamCount()), "counter"});
+    }
+    if (websocketHub) {
+        gauges.push_back({"flaskcpp_websocket_connections", "Open WebSocket connections.", double(websocketHub->connectionCount())});
+    }
+    if (responseCache) {
+        gauges.push_back({"flaskcpp_response_cache_hits_total", "Responses served from the response cache.",
+                          double(responseCache->hitCount()), "counter"});
+        gauges.push_back({"flaskcpp_response_cache_misses_total", "Cacheable requests that ran the route handler.",
+                          double(responseCache->missCount()), "counter"});
+        gauges.push_back({"flaskcpp_response_cache_coalesced_total", "Cache misses that waited for a concurrent handler run.",
+                          double(responseCache->coalescedCount()), "counter"});
+        gauges.push_back({"flaskcpp_response_cache_bytes", "Bytes held by the response cache.", double(responseCache->sizeBytes())});
+        if (sharedCacheSegment) {
+            gauges.push_back({"flaskcpp_response_cache_shared_hits_total", "Local cache misses served from the shared-memory cache.",
+                              double(responseCache->sharedHitCount()), "counter"});
+        }
+    }
+    if (preforkSegment) {
+        gauges.push_back({"flaskcpp_prefork_workers", "Prefork worker processes currently running.", double(preforkSegment->aliveWorkers())});
+        gauges.push_back({"flaskcpp_prefork_worker_restarts_total", "Prefork workers restarted after exiting unexpectedly.",
+                          double(preforkSegment->restartCount()), "counter"});
+    }
+    if (sharedCacheSegment) {
+        gauges.push_back({"flaskcpp_shared_cache_hits_total", "Shared-memory cache lookups that found a value.",
+                          double(sharedCacheSegment->hitCount()), "counter"});
+        gauges.push_back({"flaskcpp_shared_cache_misses_total", "Shared-memory cache lookups that found nothing.",
+                          double(sharedCacheSegment->missCount()), "counter"});
+        gauges.push_back({"flaskcpp_shared_cache_entries", "Live entries in the shared-memory cache.",
+                          double(sharedCacheSegment->entryCount())});
+    }
+    if (profiler) {
+        gauges.push_back({"flaskcpp_profiler_samples_total", "Stack samples collected by the CPU profiler.",
+                          double(profiler->sampleCount()), "counter"});
+        gauges.push_back({"flaskcpp_profiler_dropped_samples_total", "CPU profiler samples lost to full ring buffers.",
+                          double(profiler->droppedCount()), "counter"});
+    }
+    if (tracer) {
+        gauges.push_back({"flaskcpp_traces_written_total", "Request traces written to trace files.",
+                          double(tracer->tracesWritten()), "counter"});
+        gauges.push_back({"flaskcpp_traces_dropped_total", "Sampled request traces lost because the writer fell behind.",
+                          double(tracer->tracesDropped()), "counter"});
+    }
+    if (accessLog) {
+        gauges.push_back({"flaskcpp_access_log_dropped_total", "Access log entries dropped because the writer fell behind.",
+                          double(accessLog->droppedCount()), "counter"});
+    }
+    // Планирование: изученная стоимость, действующая цель и пропущенные сроки по маршрутам
+    MetricsRouteSeries routeCost{"flaskcpp_route_cost_seconds", "Average time to handle a request, learned per route.", {}};
+    MetricsRouteSeries routeTarget{"flaskcpp_route_latency_target_seconds", "Latency target used to schedule requests of the route.", {}};
+    MetricsRouteSeries routeMisses{"flaskcpp_route_deadline_misses_total", "Requests that finished after their latency target.", {}, "counter"};
+    for (size_t r = 0; r < scheduler.routeCount(); ++r) {
+        routeCost.values.push_back(scheduler.averageCost(r) / 1e9);
+        routeTarget.values.push_back(std::chrono::duration<double>(scheduler.target(r)).count());
+        routeMisses.values.push_back(double(scheduler.misses(r)));
+    }
+    return metrics.renderPrometheus(gauges, {routeCost, routeTarget, routeMisses});
+}
+
+AllocationStats FlaskCpp::getAllocationStats() const {
+    AllocationStats stats;
+    stats.requests = allocStatRequests.load();
+    stats.allocations = allocStatAllocations.load();
+    stats.bytes = allocStatBytes.load();
+    return stats;
+}
+
+// Допуск запроса в пул потоков. Сверх лимитов запросов в обработке и очереди (с учётом резервов приоритетов)
+// вместо task сразу выполняется shed; он же выполняется в рабочем потоке, если запрос слишком долго ждал
+// в очереди. Без shed (HTTP/2) отказ сообщается только возвращаемым значением.
+// Место в очереди задаёт schedule; priority действует только на резервы лимитов
+bool FlaskCpp::admitRequest(int priority, const TaskSchedule& schedule, std::function<void()> task, std::function<void()> shed) {
+    if (!overloadEnabled) {
+        threadPool.post(priority, schedule, std::move(task));
+        return true;
+    }
+    size_t limit = overloadOptions.maxInFlightRequests;
+    if (limit == 0 || inFlightRequests.load() < overloadOptions.limitFor(priority, limit)) {
+        inFlightRequests.fetch_add(1);
+        std::function<void()> lateShed;
+        if (shed) {
+            lateShed = [this, shed]() {
+                shedRequests.fetch_add(1);
+                shed();
+                inFlightRequests.fetch_sub(1);
+            };
+        }
+        bool queued;
+        try {
+            queued = threadPool.tryPost(priority, schedule, [this, task = std::move(task)]() {
+                task();
+                inFlightRequests.fetch_sub(1);
+            }, std::move(lateShed));
+        } catch (...) {
+            inFlightRequests.fetch_sub(1);
+            throw;
+        }
+        if (queued) return true;
+        inFlightRequests.fetch_sub(1);
+    }
+    shedRequests.fetch_add(1);
+    if (shed) shed();
+    return false;
+}
+
+// Лимиты допуска для приоритета уже выполняющегося запроса: сам он учтён в inFlightRequests, но не в очереди
+bool FlaskCpp::withinAdmissionLimits(int priority) {
+    size_t inFlightLimit = overloadOptions.maxInFlightRequests;
+    if (inFlightLimit > 0 && inFlightRequests.load() > overloadOptions.limitFor(priority, inFlightLimit)) {
+        return false;
+    }
+    size_t queueLimit = overloadOptions.maxQueueDepth;
+    return queueLimit == 0 || threadPool.queueSize() < overloadOptions.limitFor(priority, queueLimit);
+}
+
+// Быстрый отказ при перегрузке: 503 без обращения к хендлерам. Запрос дочитывается из буфера сокета,
+// иначе close() отправит клиенту RST и ответ может потеряться
+static void sendAndShutdown(int clientSocket, std::string_view response) {
+    send(clientSocket, response.data(), response.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+    shutdown(clientSocket, SHUT_WR);
+    char drain[4096];
+    while (recv(clientSocket, drain, sizeof(drain), MSG_DONTWAIT) > 0) {
+    }
+}
+
+void FlaskCpp::sendOverloaded(int clientSocket) {
+    sendAndShutdown(clientSocket, overloadResponse);
+}
+
+void FlaskCpp::sendOverloaded(Connection& conn) {
+    if (conn.tls) {
+        TlsContext::write(conn, overloadResponse.data(), overloadResponse.size());
+    } else {
+        sendOverloaded(conn.socket);
+    }
+}
+
+// Отказ до разбора запроса (длина тела, тело не пришло): хендлер не вызывается, соединение затем закрывается
+void FlaskCpp::rejectRequest(Connection& conn, const char* status) {
+    std::string response = "HTTP/1.1 ";
+    response += status;
+    response += "\r\nContent-Type: text/plain; charset=UTF-8\r\nContent-Length: ";
+    response += std::to_string(std::strlen(status) + 1);
+    response += "\r\nConnection: close\r\n\r\n";
+    response += status;
+    response += '\n';
+    if (conn.tls) {
+        TlsContext::write(conn, response.data(), response.size());
+    } else {
+        sendAndShutdown(conn.socket, response);
+    }
+}
+
+void FlaskCpp::handleClient(int clientSocket, const std::string& clientIP, std::chrono::steady_clock::time_point queuedAt) {
+    std::unique_ptr<Connection> conn;
+    try {
+        conn = ConnectionPool::acquire();
+        conn->socket = clientSocket;
+        conn->clientIP = clientIP;
+        conn->priority = newConnectionPriority;
+        conn->queuedAt = queuedAt;
+        conn->scheduled = false;
+        if (tlsContext && !tlsContext->accept(*conn)) {
+            closeConnection(conn.release());
+            return;
+        }
+        // Клиент ещё не прислал запрос (TCP_DEFER_ACCEPT выключен или истёк): поток не ждёт его
+        // на блокирующем сокете, соединение ждёт данных в реакторе, как простаивающее keep-alive
+        char probe;
+        if (keepAliveReactor && !(conn->tls && TlsContext::pending(*conn)) &&
+            recv(conn->socket, &probe, 1, MSG_PEEK | MSG_DONTWAIT) == -1 && (errno == EAGAIN || errno == EWOULDBLOCK) &&
+            keepAliveReactor->watch(conn.get())) {
+            conn.release();
+            return;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Connection error: " << e.what() << std::endl;
+        if (conn) {
+            closeConnection(conn.release());
+        } else {
+            close(clientSocket);
+            openConnections.fetch_sub(1);
+        }
+        return;
+    }
+    handleConnection(conn.release());
+}
+
+// Обрабатывает запрос, уже прочитанный в readBuffer, и убирает его из буфера
+bool FlaskCpp::serveBufferedRequest(Connection& conn) {
+    unsigned long long allocationsBefore = AllocationCounter::threadAllocations();
+    unsigned long long bytesBefore = AllocationCounter::threadBytes();
+
+    // Трассу запроса из соединения io_uring начинаем здесь; handleConnection начинает её до чтения
+    bool traced = tracer && tracer->beginRequest();
+    auto serviceStart = std::chrono::steady_clock::now();
+    bool keepAlive = processRequest(conn);
+    if (traced) {
+        tracer->endRequest(conn.request.method, conn.request.path);
+    }
+    conn.consumeRequest();
+
+    // Стоимость учитывается по маршруту, найденному при обработке; срок - по цели этого маршрута,
+    // даже если запрос не переставлялся в очереди
+    auto finished = std::chrono::steady_clock::now();
+    scheduler.recordCost(conn.routeId, finished - serviceStart);
+    if (finished - conn.queuedAt > scheduler.target(conn.routeId)) {
+        scheduler.recordMiss(conn.routeId);
+    }
+    conn.scheduled = false;
+    conn.offloaded = false;
+
+    if (AllocationCounter::enabled()) {
+        allocStatRequests.fetch_add(1, std::memory_order_relaxed);
+        allocStatAllocations.fetch_add(AllocationCounter::threadAllocations() - allocationsBefore, std::memory_order_relaxed);
+        allocStatBytes.fetch_add(AllocationCounter::threadBytes() - bytesBefore, std::memory_order_relaxed);
+    }
+    return keepAlive;
+}
+
+// Исключение вне обработки запроса (чтение, TLS, нехватка памяти) закрывает только это соединение:
+// из задачи пула оно завершило бы процесс. Соединение, переданное реактору или в очередь, уже не трогаем -
+// такие места исключений не бросают
+void FlaskCpp::handleConnection(Connection* conn) {
+    try {
+        serveConnection(conn);
+    } catch (const std::exception& e) {
+        std::cerr << "Connection error: " << e.what() << std::endl;
+        if (tracer) tracer->cancelRequest();
+        closeConnection(conn);
+    } catch (...) {
+        std::cerr << "Connection error: unknown exception" << std::endl;
+        if (tracer) tracer->cancelRequest();
+        closeConnection(conn);
     }
 }
 
-void FlaskCpp::loadTemplatesFromDirectory(const std::string& directoryPath) {
-    namespace fs = std::filesystem;
-    templatesDirectory = directoryPath;
+void FlaskCpp::serveConnection(Connection* conn) {
+    while (true) {
+        bool traced = tracer && tracer->beginRequest();
+        bool received;
+        {
+            TraceSpan span("readRequest");
+            received = readRequest(*conn);
+        }
+        if (!received) {
+            if (traced) tracer->cancelRequest();
+            closeConnection(conn);
+            return;
+        }
+        // Соединение допущено до чтения запроса с приоритетом GET (или предыдущего запроса). Запрос с более
+        // низким приоритетом проходит резервы допуска заново, иначе поток POST/PUT занял бы места GET
+        if (overloadEnabled && !conn->scheduled) {
+            std::string_view request(conn->readBuffer);
+            int priority = methodPriority(request.substr(0, request.find(' ')));
+            if (priority > newConnectionPriority && !withinAdmissionLimits(priority)) {
+                if (traced) tracer->cancelRequest();
+                shedRequests.fetch_add(1);
+                sendOverloaded(*conn);
+                closeConnection(conn);
+                return;
+            }
+        }
+        // Запрос блокирующего маршрута обслуживается в пуле блокирующих задач, поток обработчиков свободен
+        if (blockingRoutesEnabled && !conn->offloaded &&
+            isBlockingRoute(scheduledRoute(requestTargetPath(conn->readBuffer)))) {
+            if (traced) tracer->cancelRequest();
+            offloadConnection(conn);
+            return;
+        }
+        // Соединение стояло в очереди со сроком на чтение. Теперь известен маршрут: если его цель длиннее
+        // и в очереди есть задачи с более ранним сроком, запрос возвращается в очередь со своим сроком
+        // (один раз за запрос). Пустую очередь запрос не ждёт, маршрут тогда не ищется
+        if (!conn->scheduled) {
+            auto earliest = threadPool.earliestDeadline();
+            if (earliest != std::chrono::steady_clock::time_point::max()) {
+                std::string_view request(conn->readBuffer);
+                TaskSchedule schedule = requestSchedule(request);
+                conn->scheduled = true;
+                if (earliest < schedule.deadline && schedule.deadline - schedule.start > scheduler.readTarget()) {
+                    if (traced) tracer->cancelRequest();
+                    int priority = methodPriority(request.substr(0, request.find(' ')));
+                    try {
+                        admitRequest(priority, schedule, [this, conn]() { this->handleConnection(conn); },
+                                     [this, conn]() { sendOverloaded(*conn); closeConnection(conn); });
+                    } catch (...) {
+                        closeConnection(conn);
+                    }
+                    return;
+                }
+            }
+        }
+        bool keepAlive = serveBufferedRequest(*conn);
+        if (traced) {
+            tracer->endRequest(conn->request.method, conn->request.path);
+        }
 
-    if (!fs::exists(directoryPath) || !fs::is_directory(directoryPath)) {
-        std::cerr << "Templates directory does not exist: " << directoryPath << std::endl;
+        if (!keepAlive || !running.load()) {
+            closeConnection(conn);
+            return;
+        }
+        // Клиент уже прислал следующий запрос (конвейер) - обрабатываем его сразу
+        if (conn->hasBufferedData() || (conn->tls && TlsContext::pending(*conn))) {
+            conn->queuedAt = std::chrono::steady_clock::now();
+            continue;
+        }
+        // Иначе освобождаем рабочий поток: соединение ждёт данных в реакторе
+        if (!keepAliveReactor || !keepAliveReactor->watch(conn)) {
+            closeConnection(conn);
+        }
         return;
     }
+}
 
-    for (const auto& entry : fs::directory_iterator(directoryPath)) {
-        if (entry.is_regular_file() && entry.path().extension() == ".html") {
-            std::ifstream file(entry.path());
-            if (file) {
-                std::ostringstream ss;
-                ss << file.rdbuf();
-                std::string content = ss.str();
-                std::string filename = entry.path().filename().string();
-                setTemplate(filename, content);
+// Соединение с прочитанным запросом блокирующего маршрута переходит в пул блокирующих задач;
+// в лимите запросов в обработке (OverloadOptions) оно учитывается и там
+void FlaskCpp::offloadConnection(Connection* conn) {
+    conn->offloaded = true;
+    if (overloadEnabled) inFlightRequests.fetch_add(1);
+    try {
+        blockingPool->post(0, [this, conn]() {
+            handleConnection(conn);
+            if (overloadEnabled) inFlightRequests.fetch_sub(1);
+        });
+    } catch (...) {
+        if (overloadEnabled) inFlightRequests.fetch_sub(1);
+        closeConnection(conn);
+    }
+}
 
-                // Сохраняем временную метку файла
-                templatesTimestamps[entry.path().string()] = fs::last_write_time(entry);
+bool FlaskCpp::processRequest(Connection& conn) {
+    RequestArena& arena = RequestArena::forThisThread();
+    RequestData& reqData = conn.request;
+    conn.resetRequest();
+    reqData.arena = arena.resource();
+    currentConnection = &conn;
+
+    // Ответ хендлера приходит новой строкой; ответы самого сервера собираются в conn.writeBuffer
+    std::string handlerResponse;
+    ResponseCache::Entry cachedResponse;
+    bool useWriteBuffer = false;
+    size_t metricsId = Metrics::otherRouteId;
+    bool collectMetrics = metricsEnabled;
+    auto phaseStart = (collectMetrics || accessLog) ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    auto requestStart = phaseStart;
+    ProxyRoute* proxyRoute = nullptr;
+    const WebSocketRoute* websocketRoute = nullptr;
+    // Ответ передаётся в responseSink: поток HTTP/2 или соединение io_uring (им не нужен сокет)
+    bool sinkResponse = conn.responseSink != nullptr;
+    bool http2Upgrade = false, http2PriorKnowledge = false;
+    try {
+        {
+            TraceSpan span("parseRequest");
+            parseRequest(std::string_view(conn.readBuffer.data(), conn.requestLength), conn);
+        }
+        // Сервер останавливается: клиент должен отправить следующий запрос в новое соединение
+        if (!running.load(std::memory_order_relaxed)) {
+            conn.keepAlive = false;
+        }
+        if (collectMetrics) {
+            metrics.recordPhase(MetricsPhase::Parse, elapsedNanos(phaseStart));
+            phaseStart = std::chrono::steady_clock::now();
+        }
 
-                if (verbose) {
-                    std::cout << "Loaded template: " << filename << std::endl;
+        if (http2Server && !sinkResponse && !conn.tls) {
+            http2PriorKnowledge = reqData.method == "PRI" && reqData.path == "*";
+            http2Upgrade = !http2PriorKnowledge && equalsIgnoreCase(reqData.header(KnownHeader::Upgrade), "h2c") &&
+                           !reqData.header(KnownHeader::Http2Settings).empty();
+        }
+        if (!websocketRoutes.empty()) {
+            auto it = websocketRoutes.find(reqData.path);
+            if (it != websocketRoutes.end()) websocketRoute = &it->second;
+        }
+        proxyRoute = websocketRoute ? nullptr : findProxyRoute(reqData.path);
+        const CacheOptions* cacheOptions = nullptr;
+        const RateLimitRule* routeRateLimit = nullptr;
+        const ComplexHandler* handler = (proxyRoute || websocketRoute || http2PriorKnowledge || http2Upgrade)
+                                            ? nullptr : findHandler(conn, metricsId, cacheOptions, routeRateLimit);
+        std::chrono::steady_clock::duration retryAfter{};
+        if (rateLimiter && !http2PriorKnowledge && !http2Upgrade && rateLimited(conn, routeRateLimit, retryAfter)) {
+            // Ни хендлер, ни upstream, ни переключение протокола не выполняются
+            useWriteBuffer = true;
+            if (proxyRoute) metricsId = proxyRoute->metricsId;
+            if (websocketRoute) metricsId = websocketRoute->metricsId;
+            proxyRoute = nullptr;
+            websocketRoute = nullptr;
+            static const std::string tooManyBody = "Too Many Requests";
+            auto seconds = std::chrono::ceil<std::chrono::seconds>(retryAfter).count();
+            conn.writeBuffer = buildResponse("429 Too Many Requests", "text/plain", tooManyBody,
+                                             {{"Retry-After", std::to_string(std::max<long long>(seconds, 1))}});
+        } else if (http2PriorKnowledge || http2Upgrade) {
+            // Соединение переходит на HTTP/2 в upgradeHttp2
+        } else if ((sinkResponse || conn.tls) && (proxyRoute || websocketRoute)) {
+            // Проксирование и WebSocket работают с сокетом клиента напрямую - только HTTP/1.1 без TLS
+            // (соединения io_uring с такими запросами уходят в обычный путь до processRequest)
+            useWriteBuffer = true;
+            metricsId = proxyRoute ? proxyRoute->metricsId : websocketRoute->metricsId;
+            proxyRoute = nullptr;
+            websocketRoute = nullptr;
+            static const std::string versionBody = "<h1>505 HTTP Version Not Supported</h1><p>This route requires HTTP/1.1.</p>";
+            conn.writeBuffer = buildResponse("505 HTTP Version Not Supported", "text/html", versionBody);
+        } else if (websocketRoute) {
+            // Рукопожатие и передача сокета в WebSocketHub - в upgradeWebSocket
+        } else if (proxyRoute) {
+            // Ответ upstream передаётся клиенту потоком в proxyRequest
+        } else if (!handler) {
+            // Проверим статические файлы
+            useWriteBuffer = true;
+            metricsId = Metrics::staticRouteId;
+            bool deferFile = conn.uring || (conn.tls && TlsContext::kernelSend(conn));
+            TraceSpan span("serveStaticFile");
+            if (!serveStaticFile(reqData, conn.writeBuffer, deferFile ? &conn : nullptr)) {
+                metricsId = Metrics::notFoundRouteId;
+                // Оба варианта 404 собираются один раз и копируются в буфер без выделения памяти
+                static const std::string notFoundKeepAlive = buildErrorPage("404 Not Found", notFoundBody, "keep-alive");
+                static const std::string notFoundClose = buildErrorPage("404 Not Found", notFoundBody, "close");
+                conn.writeBuffer.assign(conn.keepAlive ? notFoundKeepAlive : notFoundClose);
+            }
+        } else {
+            // Сжатый ответ попадает в кэш уже сжатым, поэтому кодирование входит в ключ
+            ContentEncoding encoding = acceptedEncoding(reqData, compressionEnabled);
+            bool cacheable = cacheOptions && (reqData.method == "GET" || reqData.method == "HEAD");
+            // Кэшированный ответ общий для всех клиентов, поэтому кэшируемым маршрутам сессия не передаётся
+            std::optional<Session> session;
+            if (sessions && !cacheable) {
+                static const std::string noCookie;
+                const auto& cookies = reqData.cookies();
+                auto cookie = cookies.find(sessions->settings().cookieName);
+                session.emplace(*sessions, cookie != cookies.end() ? cookie->second : noCookie);
+                reqData.session = &*session;
+            }
+            auto produce = [&]() {
+                std::string result;
+                {
+                    TraceSpan span("handler", reqData.path);
+                    result = (*handler)(reqData);
+                }
+                if (session) {
+                    sessions->commit(*session, result);
                 }
+                if (encoding != ContentEncoding::Identity) {
+                    TraceSpan span("compress");
+                    compressResponse(result, encoding, compressionLevel, compressionMinSize);
+                }
+                return result;
+            };
+            if (cacheable) {
+                cachedResponse = responseCache->fetch(responseCacheKey(reqData, *cacheOptions, encoding), *cacheOptions,
+                                                      produce, handlerResponse);
             } else {
-                std::cerr << "Failed to open template file: " << entry.path() << std::endl;
+                handlerResponse = produce();
             }
         }
+    } catch (std::exception& e) {
+        conn.keepAlive = false;
+        useWriteBuffer = false;
+        cachedResponse = nullptr;
+        handlerResponse = generate500Error(e.what());
+    } catch (...) {
+        conn.keepAlive = false;
+        useWriteBuffer = false;
+        cachedResponse = nullptr;
+        handlerResponse = generate500Error("Unknown error");
     }
-}
-
-void FlaskCpp::monitorTemplates() {
-    namespace fs = std::filesystem;
-
-    while (running.load()) {
-        std::this_thread::sleep_for(std::chrono::seconds(2)); // Умеренный интервал проверки
 
-        if (templatesDirectory.empty()) continue;
+    conn.routeId = proxyRoute ? proxyRoute->metricsId : websocketRoute ? websocketRoute->metricsId : metricsId;
 
-        for (const auto& entry : fs::directory_iterator(templatesDirectory)) {
-            if (entry.is_regular_file() && entry.path().extension() == ".html") {
-                std::string filePath = entry.path().string();
-                auto currentTimestamp = fs::last_write_time(entry);
+    if (http2PriorKnowledge || http2Upgrade) {
+        bool keepAlive = upgradeHttp2(conn, http2PriorKnowledge, requestStart);
+        currentConnection = nullptr;
+        arena.reset();
+        ++conn.requestsServed;
+        return keepAlive;
+    }
 
-                // Если файл изменился, перезагрузим его
-                if (templatesTimestamps.find(filePath) != templatesTimestamps.end()) {
-                    if (templatesTimestamps[filePath] != currentTimestamp) {
-                        std::ifstream file(entry.path());
-                        if (file) {
-                            std::ostringstream ss;
-                            ss << file.rdbuf();
-                            std::string content = ss.str();
-                            std::string filename = entry.path().filename().string();
-                            setTemplate(filename, content);
+    if (websocketRoute) {
+        bool keepAlive = upgradeWebSocket(conn, *websocketRoute, requestStart);
+        currentConnection = nullptr;
+        arena.reset();
+        ++conn.requestsServed;
+        return keepAlive;
+    }
 
-                            templatesTimestamps[filePath] = currentTimestamp;
+    if (proxyRoute) {
+        TraceSpan span("proxyRequest", proxyRoute->prefix);
+        bool keepAlive = proxyRequest(conn, *proxyRoute, requestStart);
+        currentConnection = nullptr;
+        arena.reset();
+        ++conn.requestsServed;
+        return keepAlive;
+    }
 
-                            if (verbose) {
-                                std::cout << "Template reloaded: " << filename << std::endl;
-                            }
-                        }
-                    }
-                } else {
-                    // Новый файл
-                    templatesTimestamps[filePath] = currentTimestamp;
-                }
-            }
-        }
+    const std::string& response = cachedResponse ? cachedResponse->forConnection(conn.keepAlive)
+                                  : useWriteBuffer ? conn.writeBuffer : handlerResponse;
+    // Отложенный файл статики отправляется следом за writeBuffer; если ответ заменила страница ошибки, он не нужен
+    size_t fileBytes = conn.responseFile != -1 ? conn.responseFileSize : 0;
+    if (fileBytes && &response != &conn.writeBuffer) {
+        close(conn.responseFile);
+        conn.responseFile = -1;
+        fileBytes = 0;
+    }
+    if (collectMetrics) {
+        metrics.recordPhase(MetricsPhase::Handler, elapsedNanos(phaseStart));
     }
-}
 
-void FlaskCpp::runAsync() {
-    if (running.load()) {
-        std::cerr << "Server is already running." << std::endl;
-        return;
+    if (Tracer::recording()) {
+        Tracer::setStatus(responseStatus(response));
     }
 
-    running.store(true);
+    // Соединение остаётся открытым, только если ответ сам объявил keep-alive и имеет известную длину
+    bool keepAlive = false;
+    if (conn.keepAlive) {
+        size_t headEnd = response.find("\r\n\r\n");
+        std::string_view head(response.data(), headEnd == std::string::npos ? 0 : headEnd);
+        keepAlive = head.find("\r\nConnection: keep-alive") != std::string_view::npos &&
+                    head.find("\r\nContent-Length:") != std::string_view::npos;
+    }
 
-    // Запускаем поток мониторинга только если hot_reload включен
-    if (enableHotReload) {
-        hotReloadThread = std::thread(&FlaskCpp::monitorTemplates, this);
-        if (verbose) {
-            std::cout << "Hot reload is enabled. Monitoring templates for changes." << std::endl;
-        }
+    if (collectMetrics) {
+        phaseStart = std::chrono::steady_clock::now();
+        TraceSpan span("sendResponse");
+        if (sinkResponse) conn.responseSink->assign(response); else sendResponse(conn, response);
+        metrics.recordPhase(MetricsPhase::Send, elapsedNanos(phaseStart));
+        metrics.recordRequest(metricsId, responseStatus(response));
+    } else if (sinkResponse) {
+        TraceSpan span("sendResponse");
+        conn.responseSink->assign(response);
     } else {
-        if (verbose) {
-            std::cout << "Hot reload is disabled." << std::endl;
+        TraceSpan span("sendResponse");
+        sendResponse(conn, response);
+    }
+    if (accessLog) {
+        if (fileBytes && !conn.uring) {
+            // Тело файла передано через sendfile, в ответе только заголовки
+            logRequest(conn, responseStatus(response), fileBytes, requestStart);
+        } else {
+            logRequest(conn, response, requestStart);
         }
     }
 
-    // Добавляем задачу запуска сервера в пул потоков с высоким приоритетом
-    // Предполагаем, что приоритет 0 - самый высокий
-    threadPool.enqueue(0, [this](){
-        this->run();
-    });
+    currentConnection = nullptr;
+    arena.reset();
+    ++conn.requestsServed;
+    return keepAlive;
 }
 
-void FlaskCpp::run() {
-    int serverSocket = socket(AF_INET, SOCK_STREAM, 0);
-    if (serverSocket == -1) {
-        std::cerr << "Failed to create socket." << std::endl;
-        running.store(false);
-        return;
-    }
-
-    int opt = 1;
-    setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+void FlaskCpp::logRequest(const Connection& conn, const std::string& response, std::chrono::steady_clock::time_point start) {
+    size_t headEnd = response.find("\r\n\r\n");
+    logRequest(conn, responseStatus(response), headEnd == std::string::npos ? 0 : response.size() - headEnd - 4, start);
+}
 
-    sockaddr_in serverAddr = {};
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_addr.s_addr = INADDR_ANY;
-    serverAddr.sin_port = htons(port);
+void FlaskCpp::logRequest(const Connection& conn, int status, size_t bytes, std::chrono::steady_clock::time_point start) {
+    // Стартовая строка запроса берётся из входного буфера как есть
+    std::string_view request(conn.readBuffer.data(), conn.requestLength);
+    std::string_view requestLine = request.substr(0, request.find('\n'));
+    if (!requestLine.empty() && requestLine.back() == '\r') requestLine.remove_suffix(1);
+
+    AccessLogRecord record;
+    record.clientIP = conn.clientIP;
+    record.requestLine = requestLine;
+    record.referer = conn.request.header(KnownHeader::Referer);
+    record.userAgent = conn.request.header(KnownHeader::UserAgent);
+    record.status = status;
+    record.bytes = bytes;
+    record.durationMicros = elapsedNanos(start) / 1000;
+    accessLog->record(record);
+}
 
-    if (bind(serverSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) == -1) {
-        std::cerr << "Bind failed." << std::endl;
-        close(serverSocket);
-        running.store(false);
-        return;
+void FlaskCpp::closeConnection(Connection* conn) {
+    if (conn->tls) {
+        TlsContext::close(*conn);
     }
-
-    if (listen(serverSocket, 100) == -1) { // Увеличиваем backlog для большей нагрузки
-        std::cerr << "Listen failed." << std::endl;
-        close(serverSocket);
-        running.store(false);
-        return;
+    if (conn->socket != -1) {
+        close(conn->socket);
+        openConnections.fetch_sub(1);
     }
+    ConnectionPool::release(std::unique_ptr<Connection>(conn));
+}
 
-    if (verbose) {
-        std::cout << "Server is running on http://localhost:" << port << std::endl;
+// Дочитывает из сокета порцию данных в конец входного буфера
+static bool receiveMore(Connection& conn, size_t want) {
+    std::string& buffer = conn.readBuffer;
+    size_t oldSize = buffer.size();
+    buffer.resize(oldSize + want);
+    // Сокет с SO_RCVTIMEO не перезапускает recv после сигнала (например, SIGPROF профилировщика)
+    ssize_t r;
+    if (conn.tls) {
+        r = TlsContext::read(conn, &buffer[oldSize], want);
     } else {
-        std::cout << "Server started on port " << port << std::endl;
+        do {
+            r = recv(conn.socket, &buffer[oldSize], want, 0);
+        } while (r == -1 && errno == EINTR);
     }
+    buffer.resize(oldSize + (r > 0 ? static_cast<size_t>(r) : 0));
+    return r > 0;
+}
 
-    while (running.load()) { //  цикл для поддержки остановки сервера
-        sockaddr_in clientAddr;
-        socklen_t clientLen = sizeof(clientAddr);
-        int clientSocket = accept(serverSocket, (sockaddr*)&clientAddr, &clientLen);
-        if (clientSocket == -1) {
-            if (running.load()) { // Проверяем, не была ли остановка сервера
-                std::cerr << "Failed to accept connection." << std::endl;
+// Значение Content-Length из блока заголовков (0, если заголовка нет). false - значение не число,
+// переполняет size_t или несколько заголовков Content-Length расходятся
+static bool parseContentLength(std::string_view head, size_t& contentLength) {
+    contentLength = 0;
+    bool found = false;
+    size_t pos = 0;
+    while (pos < head.size()) {
+        size_t lineEnd = head.find('\n', pos);
+        if (lineEnd == std::string_view::npos) lineEnd = head.size();
+        std::string_view line = head.substr(pos, lineEnd - pos);
+        pos = lineEnd + 1;
+
+        size_t colonPos = line.find(':');
+        if (colonPos == std::string_view::npos || !equalsIgnoreCase(line.substr(0, colonPos), "Content-Length")) continue;
+
+        size_t value = 0;
+        bool digits = false;
+        for (size_t i = colonPos + 1; i < line.size(); ++i) {
+            char c = line[i];
+            if (c >= '0' && c <= '9') {
+                size_t digit = static_cast<size_t>(c - '0');
+                if (value > (SIZE_MAX - digit) / 10) return false;
+                value = value * 10 + digit;
+                digits = true;
+            } else if (c != ' ' && c != '\t' && c != '\r') {
+                return false;
             }
-            continue;
         }
+        if (!digits || (found && value != contentLength)) return false;
+        contentLength = value;
+        found = true;
+    }
+    return true;
+}
 
-        // Устанавливаем таймаут для чтения первого блока данных (например, 5 секунд)
-        struct timeval timeout;
-        timeout.tv_sec = 5;
-        timeout.tv_usec = 0;
-        setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
-
-        // Читаем первые 4096 байт для определения метода запроса
-        char buffer[4096];
-        ssize_t bytesRead = recv(clientSocket, buffer, sizeof(buffer), MSG_PEEK);
-        std::string requestSample;
-        if (bytesRead > 0) {
-            requestSample = std::string(buffer, bytesRead);
-        }
-
-        // Извлекаем метод запроса из первой строки
-        std::string method = "GET"; // По умолчанию
-        size_t firstLineEnd = requestSample.find("\r\n");
-        if (firstLineEnd != std::string::npos) {
-            std::string firstLine = requestSample.substr(0, firstLineEnd);
-            std::istringstream iss(firstLine);
-            iss >> method;
-        }
-
-        // Присваиваем приоритет на основе метода запроса
-        int priority = 5; // Средний приоритет по умолчанию
-        if (method == "GET") {
-            priority = 1; // Высокий приоритет для GET
-        } else if (method == "POST") {
-            priority = 2; // Средний приоритет для POST
-        } else if (method == "PUT" || method == "DELETE") {
-            priority = 3; // Низкий приоритет для PUT и DELETE
-        } else {
-            priority = 4; // Очень низкий приоритет для остальных методов
-        }
+// Заголовок Transfer-Encoding в блоке заголовков. Тела chunked сервер не разбирает: без отказа части
+// тела читались бы как следующий запрос соединения, а в прокси - как запрос другого клиента к upstream
+static bool hasTransferEncoding(std::string_view head) {
+    size_t pos = 0;
+    while ((pos = head.find('\n', pos)) != std::string_view::npos) {
+        ++pos;
+        if (equalsIgnoreCase(head.substr(pos, 18), "Transfer-Encoding:")) return true;
+    }
+    return false;
+}
 
-        if (verbose) {
-            std::cout << "Request Method: " << method << " - Assigned Priority: " << priority << std::endl;
-        }
+bool FlaskCpp::readRequest(Connection& conn) {
+    // Максимальный размер блока заголовков
+    constexpr size_t maxHeaderSize = 64 * 1024;
+
+    std::string& buffer = conn.readBuffer;
+    size_t scanFrom = 0;
+    size_t headerEnd;
+    // Читаем заголовки; буфер может уже содержать данные конвейеризованного запроса
+    while ((headerEnd = buffer.find("\r\n\r\n", scanFrom)) == std::string::npos) {
+        if (buffer.size() > maxHeaderSize) return false;
+        scanFrom = buffer.size() > 3 ? buffer.size() - 3 : 0;
+        if (!receiveMore(conn, 4096)) return false;
+    }
 
-        char clientIP[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &clientAddr.sin_addr, clientIP, INET_ADDRSTRLEN);
+    size_t headersLength = headerEnd + 4;
+    size_t contentLength;
+    std::string_view head(buffer.data(), headerEnd);
+    if (!parseContentLength(head, contentLength)) {
+        rejectRequest(conn, "400 Bad Request");
+        return false;
+    }
+    // Content-Length вместе с Transfer-Encoding - приём подмены запросов (CL.TE); одно chunked - 411
+    if (hasTransferEncoding(head)) {
+        bool hasLength = false;
+        for (size_t pos = 0; !hasLength && (pos = head.find('\n', pos)) != std::string_view::npos;) {
+            ++pos;
+            hasLength = equalsIgnoreCase(head.substr(pos, 15), "Content-Length:");
+        }
+        rejectRequest(conn, hasLength ? "400 Bad Request" : "411 Length Required");
+        return false;
+    }
+    if (contentLength > maxRequestBodySize) {
+        rejectRequest(conn, "413 Payload Too Large");
+        return false;
+    }
 
-        // Добавляем обработку клиента в пул потоков с определённым приоритетом
-        threadPool.enqueue(priority, [this, clientSocket, clientIP]() {
-            this->handleClient(clientSocket, std::string(clientIP));
-        });
+    // Тело проксируемого запроса не буферизуется: upstream получит его потоком прямо из сокета
+    if (!proxyRoutes.empty() && findProxyRoute(requestTargetPath(std::string_view(buffer.data(), headerEnd)))) {
+        conn.requestLength = std::min(buffer.size(), headersLength + contentLength);
+        conn.pendingBody = headersLength + contentLength - conn.requestLength;
+        return true;
     }
 
-    close(serverSocket);
+    // Дочитываем тело порциями: буфер растёт по мере прихода данных, а не до объявленной длины сразу
+    while (buffer.size() < headersLength + contentLength) {
+        size_t missing = headersLength + contentLength - buffer.size();
+        if (!receiveMore(conn, std::clamp<size_t>(missing, 4096, 64 * 1024))) {
+            // Тело не пришло за таймаут чтения: остаток нельзя принять за следующий запрос соединения
+            rejectRequest(conn, "408 Request Timeout");
+            return false;
+        }
+    }
+    conn.requestLength = headersLength + contentLength;
+    return true;
 }
 
-void FlaskCpp::stop() {
-    if (!running.load()) return;
+Connection* FlaskCpp::acceptIoUringConnection(int clientSocket, const sockaddr_in& address) {
+    if (overloadEnabled && overloadOptions.maxConnections > 0 &&
+        openConnections.load() >= overloadOptions.maxConnections) {
+        shedRequests.fetch_add(1);
+        sendOverloaded(clientSocket);
+        close(clientSocket);
+        return nullptr;
+    }
+    openConnections.fetch_add(1);
+
+    char clientIP[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &address.sin_addr, clientIP, INET_ADDRSTRLEN);
+    std::unique_ptr<Connection> conn = ConnectionPool::acquire();
+    conn->socket = clientSocket;
+    conn->clientIP = clientIP;
+    // Ответ остаётся в writeBuffer, отправляет его цикл io_uring
+    conn->responseSink = &conn->writeBuffer;
+    return conn.release();
+}
 
-    running.store(false);
+IoUringServer::RequestState FlaskCpp::inspectRequest(Connection& conn) {
+    constexpr size_t maxHeaderSize = 64 * 1024;
 
-    // Создаем соединение с серверным сокетом, чтобы прервать блокировку accept
-    int dummySocket = socket(AF_INET, SOCK_STREAM, 0);
-    if(dummySocket != -1){
-        sockaddr_in serverAddr = {};
-        serverAddr.sin_family = AF_INET;
-        serverAddr.sin_addr.s_addr = inet_addr("127.0.0.1");
-        serverAddr.sin_port = htons(port);
-        connect(dummySocket, (sockaddr*)&serverAddr, sizeof(serverAddr));
-        close(dummySocket);
+    const std::string& buffer = conn.readBuffer;
+    size_t headerEnd = buffer.find("\r\n\r\n");
+    if (headerEnd == std::string::npos) {
+        return buffer.size() > maxHeaderSize ? IoUringServer::RequestState::Invalid : IoUringServer::RequestState::Incomplete;
     }
+    std::string_view head(buffer.data(), headerEnd);
 
-    // Ожидаем завершения потока мониторинга
-    if (enableHotReload && hotReloadThread.joinable()) {
-        hotReloadThread.join();
+    // Проксирование, WebSocket и HTTP/2 работают с сокетом напрямую - их ведёт обычный путь
+    std::string_view path = requestTargetPath(head);
+    if ((!proxyRoutes.empty() && findProxyRoute(path)) ||
+        (!websocketRoutes.empty() && websocketRoutes.count(std::string(path)))) {
+        return IoUringServer::RequestState::TakeOver;
+    }
+    if (http2Server) {
+        if (head.compare(0, 4, "PRI ") == 0) return IoUringServer::RequestState::TakeOver;
+        size_t pos = 0;
+        while ((pos = head.find('\n', pos)) != std::string_view::npos) {
+            ++pos;
+            if (equalsIgnoreCase(head.substr(pos, 8), "Upgrade:")) return IoUringServer::RequestState::TakeOver;
+        }
     }
 
-    // Останавливаем пул потоков
-    threadPool.shutdown();
-
-    if (verbose) {
-        std::cout << "Server has been stopped." << std::endl;
+    // Некорректную или слишком большую длину тела и Transfer-Encoding отклоняет обычный путь (readRequest)
+    size_t contentLength;
+    if (!parseContentLength(head, contentLength) || contentLength > maxRequestBodySize || hasTransferEncoding(head)) {
+        return IoUringServer::RequestState::TakeOver;
     }
+    size_t length = headerEnd + 4 + contentLength;
+    if (buffer.size() < length) return IoUringServer::RequestState::Incomplete;
+    conn.requestLength = length;
+    return IoUringServer::RequestState::Ready;
 }
 
-std::string FlaskCpp::renderTemplate(const std::string& templateName, const TemplateEngine::Context& context) {
-    return templateEngine.render(templateName, context);
+void FlaskCpp::dispatchIoUringRequest(Connection* conn) {
+    std::string_view request(conn->readBuffer);
+    conn->queuedAt = std::chrono::steady_clock::now();
+    conn->scheduled = true;
+    size_t routeId = scheduledRoute(requestTargetPath(request));
+    auto serve = [this, conn]() {
+        // Соединение io_uring закрывает только его цикл: после исключения ему всё равно нужно complete
+        bool keepAlive = false;
+        try {
+            keepAlive = serveBufferedRequest(*conn);
+        } catch (const std::exception& e) {
+            std::cerr << "Connection error: " << e.what() << std::endl;
+        }
+        ioUringServer->complete(conn, keepAlive && running.load(std::memory_order_relaxed));
+    };
+    try {
+        if (isBlockingRoute(routeId)) {
+            blockingPool->post(0, std::move(serve));
+            return;
+        }
+        admitRequest(methodPriority(request.substr(0, request.find(' '))), scheduler.schedule(routeId, threadPool.virtualTime()),
+                     std::move(serve),
+                     [this, conn]() {
+                         conn->writeBuffer = overloadResponse;
+                         ioUringServer->complete(conn, false);
+                     });
+    } catch (...) {
+        ioUringServer->complete(conn, false);
+    }
 }
 
-std::string FlaskCpp::buildResponse(const std::string& status_code,
-                                    const std::string& content_type,
-                                    const std::string& body,
-                                    const std::vector<std::pair<std::string, std::string>>& extra_headers) {
-    std::ostringstream response;
-    response << "HTTP/1.1 " << status_code << "\r\n";
-    response << "Content-Type: " << content_type;
-
-    // Добавляем charset=utf-8 для текстовых типов контента
-    if (content_type.find("text/") != std::string::npos || content_type.find("application/json") != std::string::npos) {
-        response << "; charset=utf-8";
-    }
-    response << "\r\n";
+void FlaskCpp::parseRequest(std::string_view request, Connection& conn) {
+    RequestData& reqData = conn.request;
 
-    response << "Content-Length: " << body.size() << "\r\n";
+    // Стартовая строка: METHOD TARGET VERSION
+    size_t lineEnd = request.find('\n');
+    std::string_view firstLine = request.substr(0, lineEnd);
+    if (!firstLine.empty() && firstLine.back() == '\r') firstLine.remove_suffix(1);
 
-    // Добавление дополнительных заголовков, включая несколько Set-Cookie
-    for (const auto& header : extra_headers) {
-        response << header.first << ": " << header.second << "\r\n";
+    std::string_view parts[3];
+    {
+        size_t pos = 0;
+        for (auto& part : parts) {
+            while (pos < firstLine.size() && firstLine[pos] == ' ') ++pos;
+            size_t start = pos;
+            while (pos < firstLine.size() && firstLine[pos] != ' ') ++pos;
+            part = firstLine.substr(start, pos - start);
+        }
     }
+    reqData.method.assign(parts[0].data(), parts[0].size());
+    std::string_view fullPath = parts[1];
+    std::string_view version = parts[2];
 
-    response << "Connection: close\r\n\r\n";
-    response << body;
-    return response.str();
-}
+    // Заголовки: сохраняем строки как есть, известные сразу получают ячейки.
+    // Параметры строки запроса, cookies и форма разбираются при первом обращении хендлера
+    size_t headersPos = lineEnd == std::string_view::npos ? request.size() : lineEnd + 1;
+    reqData.setHeaders(request.substr(headersPos));
+    std::string_view connectionHeader = reqData.header(KnownHeader::Connection);
 
-std::string FlaskCpp::setCookie(const std::string& name, const std::string& value,
-                                const std::string& path, const std::string& expires,
-                                bool httpOnly, bool secure, const std::string& sameSite) {
-    std::ostringstream cookie;
-    cookie << name << "=" << value;
-    cookie << "; Path=" << path;
-    if (!expires.empty()) {
-        cookie << "; Expires=" << expires;
-    }
-    if (httpOnly) {
-        cookie << "; HttpOnly";
+    // Остаток - тело
+    size_t bodyPos = request.find("\r\n\r\n");
+    if (bodyPos != std::string_view::npos) {
+        std::string_view body = request.substr(bodyPos + 4);
+        reqData.body.assign(body.data(), body.size());
     }
-    if (secure) {
-        cookie << "; Secure";
+
+    size_t questionMarkPos = fullPath.find('?');
+    if (questionMarkPos != std::string_view::npos) {
+        std::string_view pathPart = fullPath.substr(0, questionMarkPos);
+        std::string_view queryPart = fullPath.substr(questionMarkPos + 1);
+        reqData.path.assign(pathPart.data(), pathPart.size());
+        reqData.queryString.assign(queryPart.data(), queryPart.size());
+    } else {
+        reqData.path.assign(fullPath.data(), fullPath.size());
     }
-    if (!sameSite.empty()) {
-        cookie << "; SameSite=" << sameSite;
+
+    // HTTP/1.1 по умолчанию держит соединение, HTTP/1.0 - только по явному запросу клиента
+    if (keepAliveTimeout.count() <= 0) {
+        conn.keepAlive = false;
+    } else if (version == "HTTP/1.1") {
+        conn.keepAlive = !containsIgnoreCase(connectionHeader, "close");
+    } else {
+        conn.keepAlive = containsIgnoreCase(connectionHeader, "keep-alive");
     }
-    return cookie.str();
+    conn.priority = methodPriority(reqData.method);
 }
 
-std::string FlaskCpp::deleteCookie(const std::string& name,
-                                   const std::string& path) {
-    std::ostringstream cookie;
-    cookie << name << "=deleted";
-    cookie << "; Path=" << path;
-    cookie << "; Expires=Thu, 01 Jan 1970 00:00:00 GMT";
-    cookie << "; HttpOnly";
-    return cookie.str();
+// Следующий непустой сегмент пути, разделённого '/'
+static std::string_view nextPathSegment(std::string_view s, size_t& pos) {
+    while (pos < s.size() && s[pos] == '/') ++pos;
+    size_t start = pos;
+    while (pos < s.size() && s[pos] != '/') ++pos;
+    return s.substr(start, pos - start);
 }
 
-void FlaskCpp::handleClient(int clientSocket, const std::string& clientIP) {
-    try {
-        std::string requestStr = readRequest(clientSocket);
-        RequestData reqData;
-        parseRequest(requestStr, reqData);
+static bool isParamSegment(std::string_view segment) {
+    return segment.size() > 2 && segment.front() == '<' && segment.back() == '>';
+}
 
-        if (verbose) {
-            std::cout << reqData.method << " " << reqData.path << " from " << clientIP << std::endl;
+// Сверяет сегменты path и pattern попарно
+static bool paramRouteMatches(std::string_view path, std::string_view pattern) {
+    size_t pathPos = 0, patternPos = 0;
+    while (true) {
+        std::string_view pathPart = nextPathSegment(path, pathPos);
+        std::string_view patternPart = nextPathSegment(pattern, patternPos);
+        if (pathPart.empty() || patternPart.empty()) {
+            return pathPart.empty() && patternPart.empty();
         }
+        if (!isParamSegment(patternPart) && patternPart != pathPart) return false;
+    }
+}
 
-        std::string response;
-        {
-            std::lock_guard<std::mutex> lock(routeMutex);
+bool FlaskCpp::matchParamRoute(const std::string& path, const std::string& pattern, std::map<std::string,std::string>& routeParams, MapNodeCache& nodeCache) {
+    // Сначала сверяем сегменты, не трогая routeParams
+    if (!paramRouteMatches(path, pattern)) return false;
+
+    // Маршрут совпал - извлекаем параметры
+    size_t pathPos = 0, patternPos = 0;
+    while (true) {
+        std::string_view pathPart = nextPathSegment(path, pathPos);
+        std::string_view patternPart = nextPathSegment(pattern, patternPos);
+        if (patternPart.empty()) break;
+        if (isParamSegment(patternPart)) {
+            nodeCache.emplace(routeParams, patternPart.substr(1, patternPart.size() - 2)).assign(pathPart.data(), pathPart.size());
+        }
+    }
 
-            ComplexHandler handler = nullptr;
-            // Пытаемся найти точный маршрут
-            auto it = routes.find(reqData.path);
-            if (it != routes.end()) {
-                handler = it->second;
-            } else {
-                // Проверяем маршруты с параметрами
-                for (auto &pr : paramRoutes) {
-                    if (matchParamRoute(reqData.path, pr.pattern, reqData.routeParams)) {
-                        handler = pr.handler;
-                        break;
-                    }
-                }
-            }
+    return true;
+}
 
-            if (!handler) {
-                // Проверим статические файлы
-                if (!serveStaticFile(reqData, response)) {
-                    response = generate404Error();
-                }
-            } else {
-                response = handler(reqData);
-            }
-        }
+const ComplexHandler* FlaskCpp::findHandler(Connection& conn, size_t& metricsId, const CacheOptions*& cacheOptions,
+                                            const RateLimitRule*& rateLimit) {
+    // Под мьютексом только поиск: сам хендлер вызывается без блокировки,
+    // поэтому медленный хендлер не задерживает остальные запросы
+    TraceSpan span("findHandler");
+    std::unique_lock<std::mutex> lock(routeMutex, std::defer_lock);
+    {
+        // Ожидание мьютекса - отдельный спан, чтобы конкуренцию за routeMutex не путать с самим поиском
+        TraceSpan waitSpan("routeMutex");
+        lock.lock();
+    }
 
-        sendResponse(clientSocket, response);
-        close(clientSocket);
-    } catch (std::exception& e) {
-        std::string response = generate500Error(e.what());
-        sendResponse(clientSocket, response);
-        close(clientSocket);
-    } catch (...) {
-        std::string response = generate500Error("Unknown error");
-        sendResponse(clientSocket, response);
-        close(clientSocket);
+    // Пытаемся найти точный маршрут
+    auto it = routes.find(conn.request.path);
+    if (it != routes.end()) {
+        metricsId = it->second.metricsId;
+        cacheOptions = it->second.cache.get();
+        rateLimit = it->second.rateLimit.get();
+        return &it->second.handler;
+    }
+    // Проверяем маршруты с параметрами
+    for (auto &pr : paramRoutes) {
+        if (matchParamRoute(conn.request.path, pr.pattern, conn.request.routeParams, conn.request.nodeCache)) {
+            metricsId = pr.metricsId;
+            cacheOptions = pr.cache.get();
+            rateLimit = pr.rateLimit.get();
+            return &pr.handler;
+        }
+    }
+    return nullptr;
+}
+
+// Маршрут запроса для планирования - тот же поиск, что в processRequest, но по стартовой строке,
+// без разбора запроса и извлечения параметров. Путь без маршрута считается статикой
+size_t FlaskCpp::scheduledRoute(std::string_view path) {
+    if (!proxyRoutes.empty()) {
+        if (ProxyRoute* proxyRoute = findProxyRoute(path)) return proxyRoute->metricsId;
+    }
+    std::lock_guard<std::mutex> lock(routeMutex);
+    auto it = routes.find(std::string(path));
+    if (it != routes.end()) return it->second.metricsId;
+    for (const auto& pr : paramRoutes) {
+        if (paramRouteMatches(path, pr.pattern)) return pr.metricsId;
     }
+    return Metrics::staticRouteId;
 }
 
-std::string FlaskCpp::readRequest(int clientSocket) {
-    std::string request;
-    char buffer[4096];
-    ssize_t bytesRead;
-    // Читаем заголовки
-    while ((bytesRead = recv(clientSocket, buffer, sizeof(buffer), MSG_PEEK)) > 0) {
-        std::string temp(buffer, bytesRead);
-        size_t pos = temp.find("\r\n\r\n");
-        if (pos != std::string::npos) {
-            recv(clientSocket, buffer, pos+4, 0);
-            request.append(buffer, pos+4);
-            break;
-        } else {
-            recv(clientSocket, buffer, bytesRead, 0);
-            request.append(buffer, bytesRead);
-        }
-    }
-
-    // Проверим Content-Length для чтения тела
-    std::string headers = request;
-    size_t bodyPos = headers.find("\r\n\r\n");
-    int contentLength = 0;
-    if (bodyPos != std::string::npos) {
-        std::string headerPart = headers.substr(0, bodyPos);
-        std::istringstream iss(headerPart);
-        std::string line;
-        while (std::getline(iss, line)) {
-            line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
-            if (line.find("Content-Length:") != std::string::npos) {
-                std::string lenStr = line.substr(line.find(":")+1);
-                lenStr.erase(0,lenStr.find_first_not_of(' '));
-                contentLength = std::stoi(lenStr);
-            }
-        }
+// Срок на чтение запроса, маршрут которого ещё не известен
+TaskSchedule FlaskCpp::readSchedule() {
+    auto now = threadPool.virtualTime();
+    return TaskSchedule{now, now + scheduler.readTarget()};
+}
 
-        if (contentLength > 0) {
-            std::string body;
-            body.resize(contentLength);
-            int totalRead = 0;
-            while (totalRead < contentLength) {
-                ssize_t r = recv(clientSocket, &body[totalRead], contentLength - totalRead, 0);
-                if (r <= 0) break;
-                totalRead += r;
-            }
-            request.append(body);
+TaskSchedule FlaskCpp::requestSchedule(std::string_view request) {
+    return scheduler.schedule(scheduledRoute(requestTargetPath(request)), threadPool.virtualTime());
+}
+
+// Общий лимит клиента проверяется первым: запрос, отклонённый им, не расходует лимит маршрута
+bool FlaskCpp::rateLimited(const Connection& conn, const RateLimitRule* routeLimit, std::chrono::steady_clock::duration& retryAfter) {
+    const RateLimitRule* rules[] = {clientRateLimit.get(), routeLimit};
+    uint64_t keyHashes[2] = {};
+    for (size_t i = 0; i < 2; ++i) {
+        if (!rules[i]) continue;
+        keyHashes[i] = RateLimiter::hashKey(conn.clientIP, rules[i]->scope);
+        rateLimiter->prefetch(keyHashes[i]);
+    }
+    auto now = RateLimiter::now();
+    for (size_t i = 0; i < 2; ++i) {
+        if (rules[i] && !rateLimiter->allowHash(keyHashes[i], rules[i]->limit, now, &retryAfter)) {
+            rateLimitedRequests.fetch_add(1, std::memory_order_relaxed);
+            return true;
         }
     }
-
-    return request;
+    return false;
 }
 
-void FlaskCpp::parseRequest(const std::string& request, RequestData& reqData) {
-    std::istringstream stream(request);
-    std::string firstLine;
-    std::getline(stream, firstLine);
-    firstLine.erase(std::remove(firstLine.begin(), firstLine.end(), '\r'), firstLine.end());
-    {
-        std::istringstream fls(firstLine);
-        fls >> reqData.method;
-        std::string fullPath;
-        fls >> fullPath;
-        // Версию HTTP можно не обрабатывать подробно
-    }
-
-    // Заголовки
-    std::string line;
-    while (std::getline(stream, line)) {
-        line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
-        if (line.empty()) break;
-        size_t colonPos = line.find(':');
-        if (colonPos != std::string::npos) {
-            std::string key = line.substr(0, colonPos);
-            std::string val = line.substr(colonPos+1);
-            while(!val.empty() && isspace((unsigned char)val.front())) val.erase(val.begin());
-            reqData.headers[key] = val;
+FlaskCpp::ProxyRoute* FlaskCpp::findProxyRoute(std::string_view path) {
+    // Маршруты прокси задаются до запуска сервера, поэтому поиск идёт без блокировки
+    for (auto& proxyRoute : proxyRoutes) {
+        const std::string& prefix = proxyRoute.prefix;
+        if (path.compare(0, prefix.size(), prefix) != 0) continue;
+        if (path.size() == prefix.size() || prefix.size() == 1 || path[prefix.size()] == '/') {
+            return &proxyRoute;
         }
     }
+    return nullptr;
+}
 
-    // Остаток - тело
-    {
-        std::string all = request;
-        size_t bodyPos = all.find("\r\n\r\n");
-        if (bodyPos != std::string::npos) {
-            reqData.body = all.substr(bodyPos+4);
+bool FlaskCpp::proxyRequest(Connection& conn, ProxyRoute& route, std::chrono::steady_clock::time_point start) {
+    const RequestData& reqData = conn.request;
+    std::string_view request(conn.readBuffer.data(), conn.requestLength);
+    size_t headEnd = request.find("\r\n\r\n");
+    std::string_view headers = request.substr(0, headEnd);
+    std::string_view bufferedBody = headEnd == std::string_view::npos ? std::string_view() : request.substr(headEnd + 4);
+    size_t lineEnd = headers.find("\r\n");
+    std::string_view requestLine = headers.substr(0, lineEnd);
+
+    // Стартовая строка для upstream; клиенту HTTP/1.0 нельзя отдавать chunked, поэтому версию сохраняем
+    std::string_view path = reqData.path;
+    if (route.pool->getOptions().stripPrefix && route.prefix.size() > 1) {
+        path.remove_prefix(route.prefix.size());
+    }
+    bool http10 = requestLine.size() >= 8 && requestLine.substr(requestLine.size() - 8) == "HTTP/1.0";
+    std::string head;
+    head.reserve(headers.size() + 128);
+    head += reqData.method;
+    head += ' ';
+    if (path.empty() || path.front() != '/') head += '/';
+    head += path;
+    if (!reqData.queryString.empty()) {
+        head += '?';
+        head += reqData.queryString;
+    }
+    head += http10 ? " HTTP/1.0\r\n" : " HTTP/1.1\r\n";
+
+    // Заголовки клиента, кроме относящихся к соединению с ним
+    std::string_view forwardedFor;
+    bool expectContinue = false;
+    size_t pos = lineEnd == std::string_view::npos ? headers.size() : lineEnd + 2;
+    while (pos < headers.size()) {
+        size_t next = headers.find("\r\n", pos);
+        if (next == std::string_view::npos) next = headers.size();
+        std::string_view line = headers.substr(pos, next - pos);
+        pos = next + 2;
+        size_t colonPos = line.find(':');
+        if (colonPos == std::string_view::npos) continue;
+        std::string_view name = line.substr(0, colonPos);
+        std::string_view value = line.substr(colonPos + 1);
+        while (!value.empty() && isspace((unsigned char)value.front())) value.remove_prefix(1);
+        if (UpstreamPool::isHopByHopHeader(name)) continue;
+        if (equalsIgnoreCase(name, "Expect")) {
+            expectContinue = containsIgnoreCase(value, "100-continue");
+            continue;
+        }
+        if (equalsIgnoreCase(name, "X-Forwarded-For")) {
+            forwardedFor = value;
+            continue;
         }
+        head.append(line.data(), line.size());
+        head += "\r\n";
+    }
+    head += "X-Forwarded-For: ";
+    if (!forwardedFor.empty()) {
+        head.append(forwardedFor.data(), forwardedFor.size());
+        head += ", ";
     }
+    head += conn.clientIP;
+    head += "\r\nX-Forwarded-Proto: http\r\nConnection: keep-alive\r\n\r\n";
 
-    // Парсим query string
-    {
-        std::istringstream fls(firstLine);
-        std::string tmp, fullPath;
-        fls >> tmp >> fullPath;
-        size_t questionMarkPos = fullPath.find('?');
-        if (questionMarkPos != std::string::npos) {
-            reqData.path = fullPath.substr(0, questionMarkPos);
-            std::string queryString = fullPath.substr(questionMarkPos + 1);
-            parseQueryString(queryString, reqData.queryParams);
-        } else {
-            reqData.path = fullPath;
-        }
+    // Клиент ждёт разрешения, прежде чем слать тело: иначе upstream не получит его до таймаута клиента
+    if (expectContinue && conn.pendingBody > 0) {
+        static const std::string continueResponse = "HTTP/1.1 100 Continue\r\n\r\n";
+        sendResponse(conn.socket, continueResponse);
     }
 
-    // Если POST и Content-Type: application/x-www-form-urlencoded, парсим formData
-    if (reqData.method == "POST") {
-        auto ctypeIt = reqData.headers.find("Content-Type");
-        if (ctypeIt != reqData.headers.end() && ctypeIt->second.find("application/x-www-form-urlencoded") != std::string::npos) {
-            parseQueryString(reqData.body, reqData.formData);
-        }
+    ProxyResult result;
+    // Остановка могла начаться, пока upstream готовил ответ: тогда клиент получает Connection: close
+    auto keepAlive = [this, &conn]() { return conn.keepAlive && running.load(std::memory_order_relaxed); };
+    if (!route.pool->forward(conn.socket, head, bufferedBody, conn.pendingBody, reqData.method == "HEAD", keepAlive, result)) {
+        // Часть тела запроса могла остаться непрочитанной: после ошибки соединение закрываем
+        if (conn.pendingBody > 0) conn.keepAlive = false;
+        static const std::string badGatewayBody = "<h1>502 Bad Gateway</h1><p>Upstream server is unavailable.</p>";
+        std::string response = buildResponse("502 Bad Gateway", "text/html", badGatewayBody);
+        sendResponse(conn.socket, response);
+        result.status = 502;
+        result.bytes = badGatewayBody.size();
+        result.clientKeepAlive = conn.keepAlive;
     }
 
-    // Парсинг cookies
-    auto cookieIt = reqData.headers.find("Cookie");
-    if (cookieIt != reqData.headers.end()) {
-        parseCookies(cookieIt->second, reqData.cookies);
+    if (metricsEnabled) {
+        metrics.recordPhase(MetricsPhase::Handler, elapsedNanos(start));
+        metrics.recordRequest(route.metricsId, result.status);
     }
+    if (accessLog) {
+        logRequest(conn, result.status, result.bytes, start);
+    }
+    return result.clientKeepAlive;
 }
 
-void FlaskCpp::parseQueryString(const std::string& queryString, std::map<std::string, std::string>& queryParams) {
-    std::istringstream stream(queryString);
-    std::string pair;
-    while (std::getline(stream, pair, '&')) {
-        size_t equalSignPos = pair.find('=');
-        std::string key, value;
-        if (equalSignPos != std::string::npos) {
-            key = pair.substr(0, equalSignPos);
-            value = pair.substr(equalSignPos + 1);
-        } else {
-            key = pair;
-        }
-        queryParams[key] = urlDecode(value);
+bool FlaskCpp::upgradeHttp2(Connection& conn, bool priorKnowledge, std::chrono::steady_clock::time_point start) {
+    std::string_view rest(conn.readBuffer.data() + conn.requestLength, conn.readBuffer.size() - conn.requestLength);
+    std::string buffered, upgradeRequest;
+    std::string_view settings;
+    if (priorKnowledge) {
+        // "PRI * HTTP/2.0" разобран как запрос без тела; сессия проверит preface целиком
+        buffered.assign(conn.readBuffer, 0, conn.requestLength);
+        buffered.append(rest.data(), rest.size());
+    } else {
+        // Upgrade: h2c (RFC 7540, 3.2): исходный запрос выполняется как поток 1
+        static const std::string switchingProtocols = "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n";
+        sendResponse(conn.socket, switchingProtocols);
+        if (metricsEnabled) metrics.recordRequest(Metrics::otherRouteId, 101);
+        if (accessLog) logRequest(conn, 101, 0, start);
+        upgradeRequest.assign(conn.readBuffer, 0, conn.requestLength);
+        buffered.assign(rest.data(), rest.size());
+        settings = conn.request.header(KnownHeader::Http2Settings);
+    }
+
+    bool adopted = false;
+    try {
+        adopted = http2Server->adopt(conn.socket, conn.clientIP, std::move(buffered), std::move(upgradeRequest), settings);
+    } catch (const std::exception& e) {
+        std::cerr << "HTTP/2 upgrade failed: " << e.what() << std::endl;
+    }
+    if (!adopted) return false;
+    if (verbose) {
+        std::cout << "HTTP/2 connection from " << conn.clientIP << (priorKnowledge ? " (prior knowledge)" : " (h2c upgrade)") << std::endl;
     }
+
+    // Сокет теперь принадлежит Http2Server
+    conn.socket = -1;
+    openConnections.fetch_sub(1);
+    return false;
 }
 
-bool FlaskCpp::matchParamRoute(const std::string& path, const std::string& pattern, std::map<std::string,std::string>& routeParams) {
-    // Разбиваем path и pattern по '/'
-    auto splitPath = [](const std::string&s){
-        std::vector<std::string> parts;
-        std::istringstream iss(s);
-        std::string p;
-        while(std::getline(iss, p, '/')) {
-            if (!p.empty()) parts.push_back(p);
-        }
-        return parts;
-    };
+std::string FlaskCpp::handleHttp2Request(std::string request, const std::string& clientIP) {
+    // Поток HTTP/2 проходит тот же путь, что и запрос HTTP/1.1: разбор, маршрут, кэш, сжатие, метрики
+    std::unique_ptr<Connection> conn = ConnectionPool::acquire();
+    conn->clientIP = clientIP;
+    conn->readBuffer = std::move(request);
+    conn->requestLength = conn->readBuffer.size();
+    std::string response;
+    conn->responseSink = &response;
+    bool traced = tracer && tracer->beginRequest();
+    auto serviceStart = std::chrono::steady_clock::now();
+    processRequest(*conn);
+    if (traced) {
+        tracer->endRequest(conn->request.method, conn->request.path);
+    }
+    scheduler.recordCost(conn->routeId, std::chrono::steady_clock::now() - serviceStart);
+    conn->responseSink = nullptr;
+    ConnectionPool::release(std::move(conn));
+    return response;
+}
 
-    auto pathParts = splitPath(path);
-    auto patternParts = splitPath(pattern);
-    if (pathParts.size() != patternParts.size()) return false;
+bool FlaskCpp::upgradeWebSocket(Connection& conn, const WebSocketRoute& route, std::chrono::steady_clock::time_point start) {
+    const RequestData& reqData = conn.request;
+
+    // RFC 6455, 4.2.1: GET с Upgrade: websocket, Connection: Upgrade, версией 13 и ключом клиента
+    std::string_view key = reqData.header(KnownHeader::SecWebSocketKey);
+    bool isUpgrade = reqData.method == "GET" && containsIgnoreCase(reqData.header(KnownHeader::Upgrade), "websocket") &&
+                     containsIgnoreCase(reqData.header(KnownHeader::Connection), "upgrade") && !key.empty();
+    if (!isUpgrade || reqData.header(KnownHeader::SecWebSocketVersion) != "13" || !websocketHub) {
+        static const std::string upgradeRequiredBody = "<h1>426 Upgrade Required</h1><p>This endpoint accepts WebSocket connections only.</p>";
+        std::string response = buildResponse("426 Upgrade Required", "text/html", upgradeRequiredBody,
+                                             {{"Upgrade", "websocket"}, {"Sec-WebSocket-Version", "13"}});
+        sendResponse(conn.socket, response);
+        if (metricsEnabled) metrics.recordRequest(route.metricsId, 426);
+        if (accessLog) logRequest(conn, response, start);
+        return conn.keepAlive;
+    }
 
-    for (size_t i=0; i<pathParts.size(); i++) {
-        if (patternParts[i].size()>2 && patternParts[i].front()=='<' && patternParts[i].back()=='>') {
-            std::string paramName = patternParts[i].substr(1, patternParts[i].size()-2);
-            routeParams[paramName] = pathParts[i];
-        } else {
-            if (patternParts[i] != pathParts[i]) return false;
-        }
+    std::string response = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: ";
+    response += WebSocketHub::acceptKey(key);
+    response += "\r\n\r\n";
+    sendResponse(conn.socket, response);
+    if (metricsEnabled) metrics.recordRequest(route.metricsId, 101);
+    if (accessLog) logRequest(conn, 101, 0, start);
+
+    // Копия запроса живёт вместе с соединением, арена рабочего потока ей не принадлежит
+    RequestData request = reqData;
+    request.arena = nullptr;
+    std::string_view buffered(conn.readBuffer.data() + conn.requestLength, conn.readBuffer.size() - conn.requestLength);
+    bool adopted = false;
+    try {
+        adopted = websocketHub->adopt(conn.socket, conn.clientIP, request, route.handler, buffered);
+    } catch (const std::exception& e) {
+        std::cerr << "WebSocket upgrade failed: " << e.what() << std::endl;
     }
+    if (!adopted) return false;
 
-    return true;
+    // Сокет теперь принадлежит WebSocketHub: соединение возвращается в пул без закрытия сокета
+    conn.socket = -1;
+    openConnections.fetch_sub(1);
+    return false;
 }
 
-bool FlaskCpp::serveStaticFile(const RequestData& reqData, std::string& response) {
-    if (reqData.path.rfind("/static/", 0) == 0) {
-        std::string filename = reqData.path.substr(8); // Убираем /static/
-        std::filesystem::path filePath = std::filesystem::current_path() / "static" / filename;
-        if (std::filesystem::exists(filePath) && std::filesystem::is_regular_file(filePath)) {
-            std::string ext = filePath.extension().string();
+bool FlaskCpp::serveStaticFile(const RequestData& reqData, std::string& response, Connection* deferredFile) {
+    if (reqData.path.rfind("/static/", 0) != 0) return false;
+
+    std::string_view filename = std::string_view(reqData.path).substr(8); // Убираем /static/
+    // Не выпускаем запрос за пределы директории static
+    if (filename.find("..") != std::string_view::npos) return false;
+
+    // Путь собираем во временной арене запроса
+    std::pmr::memory_resource* resource = reqData.arena ? reqData.arena : std::pmr::get_default_resource();
+    std::pmr::string filePath(resource);
+    filePath.reserve(7 + filename.size());
+    filePath += "static/";
+    filePath += filename;
+
+    int fd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return false;
+    struct stat st;
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return false;
+    }
+
+    std::string_view ext;
+    size_t dotPos = filename.rfind('.');
+    if (dotPos != std::string_view::npos && filename.find('/', dotPos) == std::string_view::npos) {
+        ext = filename.substr(dotPos);
+    }
 #ifdef ENABLE_PHP
-            if(ext == ".php"){
-                // Поддержка PHP через php-cgi
-                std::string phpOutput = executePHP(reqData, filePath);
-                response = phpOutput;
-                return true;
-            }
+    if(ext == ".php"){
+        close(fd);
+        // Поддержка PHP через php-cgi
+        response = executePHP(reqData, std::filesystem::current_path() / "static" / std::string(filename));
+        return true;
+    }
 #endif
 
-            std::string ct = "text/plain";
-            if (ext == ".html") ct = "text/html";
-            else if (ext == ".css") ct = "text/css";
-            else if (ext == ".js") ct = "application/javascript";
-            else if (ext == ".json") ct = "application/json";
-            else if (ext == ".png") ct = "image/png";
-            else if (ext == ".jpg" || ext == ".jpeg") ct = "image/jpeg";
-            else if (ext == ".gif") ct = "image/gif";
-
-            std::ifstream f(filePath, std::ios::binary);
-            if (!f) return false;
-            std::ostringstream oss;
-            oss << f.rdbuf();
-            std::string body = oss.str();
-
-            std::ostringstream resp;
-            resp << "HTTP/1.1 200 OK\r\n"
-                 << "Content-Type: " << ct << "\r\n"
-                 << "Content-Length: " << body.size() << "\r\n"
-                 << "Connection: close\r\n\r\n"
-                 << body;
-
-            response = resp.str();
-            return true;
+    const char* ct = "text/plain";
+    if (ext == ".html") ct = "text/html";
+    else if (ext == ".css") ct = "text/css";
+    else if (ext == ".js") ct = "application/javascript";
+    else if (ext == ".json") ct = "application/json";
+    else if (ext == ".png") ct = "image/png";
+    else if (ext == ".jpg" || ext == ".jpeg") ct = "image/jpeg";
+    else if (ext == ".gif") ct = "image/gif";
+
+    size_t fileSize = static_cast<size_t>(st.st_size);
+    bool compressible = compressionEnabled && isCompressibleType(ct);
+    ContentEncoding encoding = compressible && fileSize >= compressionMinSize ? acceptedEncoding(reqData, true) : ContentEncoding::Identity;
+    std::shared_ptr<const std::string> compressed;
+    bool precompressed = false;
+    if (encoding == ContentEncoding::Gzip) {
+        // Заранее сжатый файл рядом с исходным (app.js.gz), если он не старше исходного
+        filePath += ".gz";
+        int gzFd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+        filePath.resize(filePath.size() - 3);
+        struct stat gzSt;
+        if (gzFd != -1 && fstat(gzFd, &gzSt) == 0 && S_ISREG(gzSt.st_mode) && gzSt.st_mtime >= st.st_mtime) {
+            close(fd);
+            fd = gzFd;
+            fileSize = static_cast<size_t>(gzSt.st_size);
+            precompressed = true;
+        } else if (gzFd != -1) {
+            close(gzFd);
         }
     }
-    return false;
+    if (encoding != ContentEncoding::Identity && !precompressed) {
+        // Иначе сжимаем файл один раз и храним результат до его изменения
+        auto modified = std::chrono::seconds(st.st_mtim.tv_sec) + std::chrono::nanoseconds(st.st_mtim.tv_nsec);
+        compressed = compressedFiles.get(std::string(filePath), fd, fileSize, modified, encoding);
+        if (!compressed || compressed->size() >= fileSize) {
+            encoding = ContentEncoding::Identity;
+            compressed = nullptr;
+        }
+    }
+
+    // Заголовки и содержимое файла пишем прямо в буфер ответа соединения
+    size_t bodySize = compressed ? compressed->size() : fileSize;
+    response.clear();
+    response += "HTTP/1.1 200 OK\r\nContent-Type: ";
+    response += ct;
+    response += "\r\nContent-Length: ";
+    response += std::to_string(bodySize);
+    if (encoding != ContentEncoding::Identity) {
+        response += "\r\nContent-Encoding: ";
+        response += contentEncodingName(encoding);
+    }
+    if (compressible) {
+        response += "\r\nVary: Accept-Encoding";
+    }
+    response += "\r\nConnection: ";
+    response += connectionHeaderValue();
+    response += "\r\n\r\n";
+
+    if (compressed) {
+        close(fd);
+        response += *compressed;
+        return true;
+    }
+
+    size_t headerSize = response.size();
+    if (deferredFile) {
+        // Цикл io_uring дочитает файл в конец ответа, связав чтение с отправкой; соединение с kTLS
+        // передаст его через sendfile следом за заголовками
+        if (deferredFile->uring) response.resize(headerSize + fileSize);
+        deferredFile->responseFile = fd;
+        deferredFile->responseFileSize = fileSize;
+        return true;
+    }
+    response.resize(headerSize + fileSize);
+    size_t totalRead = 0;
+    while (totalRead < fileSize) {
+        ssize_t r = read(fd, &response[headerSize + totalRead], fileSize - totalRead);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) break;
+        totalRead += static_cast<size_t>(r);
+    }
+    close(fd);
+    if (totalRead != fileSize) return false;
+    return true;
+}
+
+void FlaskCpp::sendResponse(Connection& conn, const std::string& content) {
+    if (!conn.tls) {
+        sendResponse(conn.socket, content);
+        return;
+    }
+    bool sent = TlsContext::write(conn, content.data(), content.size());
+    if (conn.responseFile != -1) {
+        if (sent) TlsContext::sendFile(conn, conn.responseFile, conn.responseFileSize);
+        close(conn.responseFile);
+        conn.responseFile = -1;
+    }
 }
 
 void FlaskCpp::sendResponse(int clientSocket, const std::string& content) {
-    send(clientSocket, content.c_str(), content.size(), 0);
+    // send может записать ответ частично - досылаем остаток
+    size_t totalSent = 0;
+    while (totalSent < content.size()) {
+        ssize_t sent = send(clientSocket, content.data() + totalSent, content.size() - totalSent, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) break;
+        totalSent += static_cast<size_t>(sent);
+    }
 }
 
 std::string FlaskCpp::generate404Error() {
-    std::ostringstream response;
-    std::string body = R"(
-<!DOCTYPE html>
-<html lang="ru">
-<head>
-    <meta charset="UTF-8">
-    <title>404 Not Found</title>
-    <style>
-        body {
-            background-color: #f0f2f5;
-            color: #333;
-            font-family: 'Segoe UI', Tahoma, Geneva, Verdana, sans-serif;
-            margin: 0;
-            padding: 0;
-            display: flex;
-            justify-content: center;
-            align-items: center;
-            height: 100vh;
-            text-align: center;
-        }
-        .container {
-            background-color: #fff;
-            padding: 40px 60px;
-            border-radius: 8px;
-            box-shadow: 0 4px 6px rgba(0,0,0,0.1);
-        }
-        h1 {
-            font-size: 80px;
-            margin-bottom: 20px;
-            color: #e74c3c;
-        }
-        p {
-            font-size: 24px;
-            margin-bottom: 30px;
-        }
-        a {
-            display: inline-block;
-            padding: 12px 25px;
-            background-color: #3498db;
-            color: #fff;
-            text-decoration: none;
-            border-radius: 4px;
-            font-size: 18px;
-            transition: background-color 0.3s ease;
-        }
-        a:hover {
-            background-color: #2980b9;
-        }
-        .illustration {
-            margin-bottom: 30px;
-        }
-        @media (max-width: 600px) {
-            .container {
-                padding: 20px 30px;
-            }
-            h1 {
-                font-size: 60px;
-            }
-            p {
-                font-size: 20px;
-            }
-            a {
-                font-size: 16px;
-                padding: 10px 20px;
-            }
-        }
-    </style>
-</head>
-<body>
-    <div class="container">
-        <div class="illustration">
-            <!-- Можно добавить SVG или изображение здесь -->
-            <svg width="100" height="100" viewBox="0 0 24 24" fill="#e74c3c" xmlns="http://www.w3.org/2000/svg">
-                <path d="M12 0C5.371 0 0 5.371 0 12c0 6.629 5.371 12 12 12s12-5.371 12-12C24 5.371 18.629 0 12 0zm5.707 16.293L16.293 17.707 12 13.414 7.707 17.707 6.293 16.293 10.586 12 6.293 7.707 7.707 6.293 12 10.586 16.293 6.293 17.707 7.707 13.414 12 17.707z"/>
-            </svg>
-        </div>
-        <h1>404</h1>
-        <p>Упс! Страница, которую вы ищете, не найдена.</p>
-        <a href="/">Вернуться на главную</a>
-    </div>
-</body>
-</html>
-)";
-    response << "HTTP/1.1 404 Not Found\r\n"
-             << "Content-Type: text/html; charset=UTF-8\r\n"
-             << "Content-Length: " << body.size() << "\r\n"
-             << "Connection: close\r\n\r\n"
-             << body;
-    return response.str();
+    return buildErrorPage("404 Not Found", notFoundBody, connectionHeaderValue());
 }
 
 std::string FlaskCpp::generate500Error(const std::string& msg) {
-    std::ostringstream response;
-    std::string body = R"(
-<!DOCTYPE html>
-<html lang="ru">
-<head>
-    <meta charset="UTF-8">
-    <title>500 Internal Server Error</title>
-    <style>
-        body {
-            background-color: #f8d7da;
-            color: #721c24;
-            font-family: 'Segoe UI', Tahoma, Geneva, Verdana, sans-serif;
-            margin: 0;
-            padding: 0;
-            display: flex;
-            justify-content: center;
-            align-items: center;
-            height: 100vh;
-            text-align: center;
-        }
-        .container {
-            background-color: #f5c6cb;
-            padding: 40px 60px;
-            border-radius: 8px;
-            box-shadow: 0 4px 6px rgba(0,0,0,0.1);
-            max-width: 600px;
-            margin: 20px;
-        }
-        h1 {
-            font-size: 80px;
-            margin-bottom: 20px;
-            color: #c82333;
-        }
-        p {
-            font-size: 24px;
-            margin-bottom: 30px;
-        }
-        a {
-            display: inline-block;
-            padding: 12px 25px;
-            background-color: #c82333;
-            color: #fff;
-            text-decoration: none;
-            border-radius: 4px;
-            font-size: 18px;
-            transition: background-color 0.3s ease;
-        }
-        a:hover {
-            background-color: #a71d2a;
-        }
-        .illustration {
-            margin-bottom: 30px;
-        }
-        @media (max-width: 600px) {
-            .container {
-                padding: 20px 30px;
-            }
-            h1 {
-                font-size: 60px;
-            }
-            p {
-                font-size: 20px;
-            }
-            a {
-                font-size: 16px;
-                padding: 10px 20px;
-            }
-        }
-    </style>
-</head>
-<body>
-    <div class="container">
-        <div class="illustration">
-            <!-- SVG-иллюстрация для визуального эффекта -->
-            <svg width="100" height="100" viewBox="0 0 24 24" fill="#c82333" xmlns="http://www.w3.org/2000/svg">
-                <path d="M12 0C5.371 0 0 5.371 0 12c0 6.629 5.371 12 12 12s12-5.371 12-12C24 5.371 18.629 0 12 0zm5.707 16.293L16.293 17.707 12 13.414 7.707 17.707 6.293 16.293 10.586 12 6.293 7.707 7.707 6.293 12 10.586 16.293 6.293 17.707 7.707 13.414 12 17.707z"/>
-            </svg>
-        </div>
-        <h1>500</h1>
-        <p>Упс! Произошла внутренняя ошибка сервера.</p>
-        <a href="/">Вернуться на главную</a>
-    </div>
-</body>
-</html>
-)";
+    return buildErrorPage("500 Internal Server Error", internalErrorBody, connectionHeaderValue());
+}
 
-    response << "HTTP/1.1 500 Internal Server Error\r\n"
-             << "Content-Type: text/html; charset=UTF-8\r\n"
-             << "Content-Length: " << body.size() << "\r\n"
-             << "Connection: close\r\n\r\n"
-             << body;
-    return response.str();
-}
-
-// Реализация parseCookies
-void FlaskCpp::parseCookies(const std::string& cookieHeader, std::map<std::string, std::string>& cookies) {
-    std::istringstream stream(cookieHeader);
-    std::string pair;
-    while (std::getline(stream, pair, ';')) {
-        size_t equalPos = pair.find('=');
-        if (equalPos != std::string::npos) {
-            std::string key = pair.substr(0, equalPos);
-            std::string value = pair.substr(equalPos + 1);
-            // Удаляем пробелы в начале ключа
-            key.erase(0, key.find_first_not_of(' '));
-            cookies[key] = urlDecode(value);
-        }
-    }
-}
-
-// Реализация urlDecode
-std::string FlaskCpp::urlDecode(const std::string &value) {
-    std::string result;
-    result.reserve(value.size());
-    for (size_t i = 0; i < value.size(); ++i) {
-        if (value[i] == '%' && i + 2 < value.size()) {
-            std::string hex = value.substr(i + 1, 2);
-            char decoded_char = static_cast<char>(std::stoi(hex, nullptr, 16));
-            result += decoded_char;
-            i += 2;
-        } else if (value[i] == '+') {
-            result += ' ';
-        } else {
-            result += value[i];
-        }
+#ifdef ENABLE_PHP
+void FlaskCpp::setPHPFastCgi(const std::string& address, size_t maxConnections) {
+    phpPool = std::make_unique<FastCgiPool>(address, maxConnections);
+    if (verbose) {
+        std::cout << "PHP FastCGI: " << address << " (up to " << maxConnections << " connections)" << std::endl;
     }
-    return result;
 }
 
-#ifdef ENABLE_PHP
-// Реализация executePHP через php-cgi с использованием popen
+// Реализация executePHP через пул постоянных FastCGI-соединений
 std::string FlaskCpp::executePHP(const RequestData& reqData, const std::filesystem::path& scriptPath) {
-    // Команда для выполнения php-cgi
-    std::string command = "php-cgi " + scriptPath.string();
+    std::string contentType(reqData.header(KnownHeader::ContentType));
+    std::string serverName = "localhost";
+    std::string_view host = reqData.header(KnownHeader::Host);
+    if (!host.empty()) {
+        serverName.assign(host.substr(0, host.find(':')));
+    }
 
-    // Открываем процесс для чтения вывода PHP-скрипта
-    FILE* pipe = popen(command.c_str(), "r");
-    if (!pipe) {
-        return generate500Error("Failed to execute PHP script");
+    // CGI-окружение (RFC 3875) и переменные, которых ждут php-cgi и php-fpm
+    std::string requestUri = reqData.path;
+    if (!reqData.queryString.empty()) {
+        requestUri += "?";
+        requestUri += reqData.queryString;
     }
+    FastCgiPool::Params params;
+    params.reserve(40);
+    params.emplace_back("GATEWAY_INTERFACE", "CGI/1.1");
+    params.emplace_back("SERVER_SOFTWARE", "FlaskCpp");
+    params.emplace_back("SERVER_PROTOCOL", "HTTP/1.1");
+    params.emplace_back("SERVER_NAME", serverName);
+    params.emplace_back("SERVER_PORT", std::to_string(port));
+    params.emplace_back("REQUEST_METHOD", reqData.method);
+    params.emplace_back("REQUEST_URI", requestUri);
+    params.emplace_back("DOCUMENT_URI", reqData.path);
+    params.emplace_back("DOCUMENT_ROOT", std::filesystem::current_path().string());
+    params.emplace_back("SCRIPT_NAME", reqData.path);
+    params.emplace_back("SCRIPT_FILENAME", scriptPath.string());
+    params.emplace_back("QUERY_STRING", reqData.queryString);
+    params.emplace_back("REMOTE_ADDR", currentConnection ? currentConnection->clientIP : std::string());
+    params.emplace_back("REDIRECT_STATUS", "200"); // Требуется php-cgi при cgi.force_redirect
+    if (!contentType.empty()) {
+        params.emplace_back("CONTENT_TYPE", contentType);
+    }
+    params.emplace_back("CONTENT_LENGTH", std::to_string(reqData.body.size()));
+    reqData.forEachHeader([&params](std::string_view headerName, std::string_view value) {
+        // Content-Type и Content-Length уже переданы; Proxy не передаём (httpoxy)
+        if (equalsIgnoreCase(headerName, "Content-Type") || equalsIgnoreCase(headerName, "Content-Length") ||
+            equalsIgnoreCase(headerName, "Proxy")) {
+            return;
+        }
+        std::string name = "HTTP_";
+        for (char c : headerName) {
+            name += (c == '-') ? '_' : static_cast<char>(std::toupper((unsigned char)c));
+        }
+        params.emplace_back(std::move(name), std::string(value));
+    });
 
-    // Читаем вывод PHP-скрипта
     std::string phpOutput;
-    char buffer[4096];
-    while (fgets(buffer, sizeof(buffer), pipe)) {
-        phpOutput += buffer;
+    std::string phpErrors;
+    if (!phpPool->execute(params, reqData.body, phpOutput, phpErrors)) {
+        std::cerr << "PHP FastCGI request failed: " << phpPool->getAddress() << std::endl;
+        return buildResponse("502 Bad Gateway", "text/html", "<h1>502 Bad Gateway</h1><p>PHP backend is unavailable.</p>");
+    }
+    if (!phpErrors.empty() && verbose) {
+        std::cerr << "PHP stderr (" << scriptPath.string() << "): " << phpErrors << std::endl;
     }
 
-    int returnCode = pclose(pipe);
-    if (returnCode != 0) {
-        return generate500Error("PHP script execution failed");
+    // Разбираем CGI-заголовки ответа: Status задаёт строку состояния, Content-Length пересчитываем сами
+    size_t headerEnd = phpOutput.find("\r\n\r\n");
+    size_t bodyStart = headerEnd == std::string::npos ? std::string::npos : headerEnd + 4;
+    if (headerEnd == std::string::npos) {
+        headerEnd = phpOutput.find("\n\n");
+        bodyStart = headerEnd == std::string::npos ? std::string::npos : headerEnd + 2;
+    }
+    if (headerEnd == std::string::npos) {
+        headerEnd = 0;
+        bodyStart = 0;
     }
 
-    // Проверяем, начинается ли вывод PHP с "Status:"
-    // Если да, извлекаем статус и удаляем его из вывода
-    std::string statusLine = "HTTP/1.1 200 OK\r\n"; // По умолчанию
-    size_t statusPos = phpOutput.find("Status:");
-    if(statusPos != std::string::npos){
-        size_t endLine = phpOutput.find("\r\n", statusPos);
-        if(endLine != std::string::npos){
-            statusLine = phpOutput.substr(statusPos, endLine - statusPos) + "\r\n";
-            phpOutput.erase(statusPos, endLine - statusPos + 2); // Удаляем строку состояния из вывода
+    std::string status = "200 OK";
+    bool hasContentType = false;
+    bool hasLocation = false;
+    bool hasStatus = false;
+    std::string headers;
+    std::string_view head(phpOutput.data(), headerEnd);
+    size_t pos = 0;
+    while (pos < head.size()) {
+        size_t lineEnd = head.find('\n', pos);
+        if (lineEnd == std::string_view::npos) lineEnd = head.size();
+        std::string_view line = head.substr(pos, lineEnd - pos);
+        pos = lineEnd + 1;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        size_t colonPos = line.find(':');
+        if (colonPos == std::string_view::npos) continue;
+
+        std::string_view name = line.substr(0, colonPos);
+        std::string_view value = line.substr(colonPos + 1);
+        while (!value.empty() && value.front() == ' ') value.remove_prefix(1);
+        if (equalsIgnoreCase(name, "Status")) {
+            status.assign(value.data(), value.size());
+            hasStatus = true;
+            continue;
         }
+        if (equalsIgnoreCase(name, "Content-Length") || equalsIgnoreCase(name, "Connection")) continue;
+        if (equalsIgnoreCase(name, "Content-Type")) hasContentType = true;
+        if (equalsIgnoreCase(name, "Location")) hasLocation = true;
+        headers.append(line.data(), line.size());
+        headers += "\r\n";
+    }
+    if (hasLocation && !hasStatus) {
+        status = "302 Found";
     }
 
-    // Формируем окончательный ответ
-    std::string finalResponse = statusLine + phpOutput;
-    return finalResponse;
+    size_t bodySize = phpOutput.size() - bodyStart;
+    std::string response;
+    response.reserve(128 + status.size() + headers.size() + bodySize);
+    response += "HTTP/1.1 ";
+    response += status;
+    response += "\r\n";
+    if (!hasContentType) {
+        response += "Content-Type: text/html; charset=UTF-8\r\n";
+    }
+    response += headers;
+    response += "Content-Length: ";
+    response += std::to_string(bodySize);
+    response += "\r\nConnection: ";
+    response += connectionHeaderValue();
+    response += "\r\n\r\n";
+    response.append(phpOutput, bodyStart, bodySize);
+    return response;
 }
 #endif
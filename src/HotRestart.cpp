@@ -0,0 +1,149 @@
+#include "headers/HotRestart.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+sockaddr_un controlAddress(const std::string& path) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+}
+
+ListenerHandoff::ListenerHandoff(std::string controlPath)
+    : path(std::move(controlPath)), listener(-1), wakeFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)), transferred(false) {
+    if (path.empty() || path.size() >= sizeof(sockaddr_un::sun_path)) {
+        throw std::invalid_argument("hot restart: invalid control socket path " + path);
+    }
+    if (wakeFd == -1) {
+        throw std::runtime_error("hot restart: eventfd failed");
+    }
+}
+
+ListenerHandoff::~ListenerHandoff() {
+    stop();
+    close(wakeFd);
+}
+
+int ListenerHandoff::receive() {
+    int control = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (control == -1) return -1;
+    sockaddr_un address = controlAddress(path);
+    if (connect(control, (sockaddr*)&address, sizeof(address)) == -1) {
+        // Нет файла или он остался от упавшего процесса - обычный запуск
+        close(control);
+        return -1;
+    }
+    // Работающий процесс отвечает сразу; зависший не должен задерживать запуск бесконечно
+    timeval timeout = {5, 0};
+    setsockopt(control, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    char byte = 0;
+    iovec iov = {&byte, 1};
+    alignas(cmsghdr) char controlBuffer[CMSG_SPACE(sizeof(int))];
+    msghdr message = {};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = controlBuffer;
+    message.msg_controllen = sizeof(controlBuffer);
+
+    int listenSocket = -1;
+    ssize_t received;
+    do {
+        received = recvmsg(control, &message, MSG_CMSG_CLOEXEC);
+    } while (received == -1 && errno == EINTR);
+    if (received == 1) {
+        cmsghdr* header = CMSG_FIRSTHDR(&message);
+        if (header && header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+            std::memcpy(&listenSocket, CMSG_DATA(header), sizeof(int));
+        }
+    }
+    if (listenSocket != -1) {
+        // Соединение закрывается, когда старый процесс перестал принимать и освободил путь
+        while (recv(control, &byte, 1, 0) > 0) {
+        }
+    }
+    close(control);
+    return listenSocket;
+}
+
+void ListenerHandoff::serve(int listenSocket, std::function<void()> onHandoff) {
+    listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener == -1) {
+        throw std::runtime_error("hot restart: socket failed");
+    }
+    sockaddr_un address = controlAddress(path);
+    unlink(path.c_str());
+    if (bind(listener, (sockaddr*)&address, sizeof(address)) == -1 || listen(listener, 4) == -1) {
+        int error = errno;
+        close(listener);
+        listener = -1;
+        throw std::runtime_error("hot restart: cannot listen on " + path + ": " + std::strerror(error));
+    }
+    // Через управляющий сокет можно забрать порт сервера - только для владельца
+    chmod(path.c_str(), 0600);
+    thread = std::thread(&ListenerHandoff::loop, this, listenSocket, std::move(onHandoff));
+}
+
+void ListenerHandoff::loop(int listenSocket, std::function<void()> onHandoff) {
+    pollfd fds[2] = {{listener, POLLIN, 0}, {wakeFd, POLLIN, 0}};
+    while (true) {
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (fds[1].revents) return;
+        int peer = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (peer == -1) continue;
+
+        char byte = 'L';
+        iovec iov = {&byte, 1};
+        alignas(cmsghdr) char controlBuffer[CMSG_SPACE(sizeof(int))] = {};
+        msghdr message = {};
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+        message.msg_control = controlBuffer;
+        message.msg_controllen = sizeof(controlBuffer);
+        cmsghdr* header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(header), &listenSocket, sizeof(int));
+        if (sendmsg(peer, &message, MSG_NOSIGNAL) != 1) {
+            close(peer);
+            continue;
+        }
+
+        transferred.store(true);
+        onHandoff();
+        // Путь освобождается до закрытия соединения: новый процесс займёт его, дождавшись EOF
+        close(listener);
+        listener = -1;
+        unlink(path.c_str());
+        close(peer);
+        return;
+    }
+}
+
+void ListenerHandoff::stop() {
+    if (thread.joinable()) {
+        uint64_t one = 1;
+        ssize_t written = write(wakeFd, &one, sizeof(one));
+        (void)written;
+        thread.join();
+    }
+    if (listener != -1) {
+        close(listener);
+        listener = -1;
+        unlink(path.c_str());
+    }
+}
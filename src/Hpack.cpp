@@ -0,0 +1,382 @@
+#include "headers/Hpack.h"
+#include <algorithm>
+
+namespace {
+struct StaticEntry {
+    std::string_view name;
+    std::string_view value;
+};
+
+// Статическая таблица (RFC 7541, приложение A)
+constexpr StaticEntry staticTable[] = {
+    {":authority", ""}, {":method", "GET"}, {":method", "POST"}, {":path", "/"}, {":path", "/index.html"},
+    {":scheme", "http"}, {":scheme", "https"}, {":status", "200"}, {":status", "204"}, {":status", "206"},
+    {":status", "304"}, {":status", "400"}, {":status", "404"}, {":status", "500"}, {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"}, {"accept-language", ""}, {"accept-ranges", ""}, {"accept", ""},
+    {"access-control-allow-origin", ""}, {"age", ""}, {"allow", ""}, {"authorization", ""}, {"cache-control", ""},
+    {"content-disposition", ""}, {"content-encoding", ""}, {"content-language", ""}, {"content-length", ""},
+    {"content-location", ""}, {"content-range", ""}, {"content-type", ""}, {"cookie", ""}, {"date", ""},
+    {"etag", ""}, {"expect", ""}, {"expires", ""}, {"from", ""}, {"host", ""}, {"if-match", ""},
+    {"if-modified-since", ""}, {"if-none-match", ""}, {"if-range", ""}, {"if-unmodified-since", ""},
+    {"last-modified", ""}, {"link", ""}, {"location", ""}, {"max-forwards", ""}, {"proxy-authenticate", ""},
+    {"proxy-authorization", ""}, {"range", ""}, {"referer", ""}, {"refresh", ""}, {"retry-after", ""},
+    {"server", ""}, {"set-cookie", ""}, {"strict-transport-security", ""}, {"transfer-encoding", ""},
+    {"user-agent", ""}, {"vary", ""}, {"via", ""}, {"www-authenticate", ""},
+};
+constexpr size_t staticTableSize = sizeof(staticTable) / sizeof(staticTable[0]);
+
+struct HuffmanCode {
+    uint32_t code;
+    uint8_t length;
+};
+
+// Канонический код Хаффмана HPACK (RFC 7541, приложение B), символы 0-255
+constexpr HuffmanCode huffmanCodes[256] = {
+    {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28},
+    {0xfffffe4, 28}, {0xfffffe5, 28}, {0xfffffe6, 28}, {0xfffffe7, 28},
+    {0xfffffe8, 28}, {0xffffea, 24}, {0x3ffffffc, 30}, {0xfffffe9, 28},
+    {0xfffffea, 28}, {0x3ffffffd, 30}, {0xfffffeb, 28}, {0xfffffec, 28},
+    {0xfffffed, 28}, {0xfffffee, 28}, {0xfffffef, 28}, {0xffffff0, 28},
+    {0xffffff1, 28}, {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28},
+    {0xffffff4, 28}, {0xffffff5, 28}, {0xffffff6, 28}, {0xffffff7, 28},
+    {0xffffff8, 28}, {0xffffff9, 28}, {0xffffffa, 28}, {0xffffffb, 28},
+    {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12},
+    {0x1ff9, 13}, {0x15, 6}, {0xf8, 8}, {0x7fa, 11},
+    {0x3fa, 10}, {0x3fb, 10}, {0xf9, 8}, {0x7fb, 11},
+    {0xfa, 8}, {0x16, 6}, {0x17, 6}, {0x18, 6},
+    {0x0, 5}, {0x1, 5}, {0x2, 5}, {0x19, 6},
+    {0x1a, 6}, {0x1b, 6}, {0x1c, 6}, {0x1d, 6},
+    {0x1e, 6}, {0x1f, 6}, {0x5c, 7}, {0xfb, 8},
+    {0x7ffc, 15}, {0x20, 6}, {0xffb, 12}, {0x3fc, 10},
+    {0x1ffa, 13}, {0x21, 6}, {0x5d, 7}, {0x5e, 7},
+    {0x5f, 7}, {0x60, 7}, {0x61, 7}, {0x62, 7},
+    {0x63, 7}, {0x64, 7}, {0x65, 7}, {0x66, 7},
+    {0x67, 7}, {0x68, 7}, {0x69, 7}, {0x6a, 7},
+    {0x6b, 7}, {0x6c, 7}, {0x6d, 7}, {0x6e, 7},
+    {0x6f, 7}, {0x70, 7}, {0x71, 7}, {0x72, 7},
+    {0xfc, 8}, {0x73, 7}, {0xfd, 8}, {0x1ffb, 13},
+    {0x7fff0, 19}, {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6},
+    {0x7ffd, 15}, {0x3, 5}, {0x23, 6}, {0x4, 5},
+    {0x24, 6}, {0x5, 5}, {0x25, 6}, {0x26, 6},
+    {0x27, 6}, {0x6, 5}, {0x74, 7}, {0x75, 7},
+    {0x28, 6}, {0x29, 6}, {0x2a, 6}, {0x7, 5},
+    {0x2b, 6}, {0x76, 7}, {0x2c, 6}, {0x8, 5},
+    {0x9, 5}, {0x2d, 6}, {0x77, 7}, {0x78, 7},
+    {0x79, 7}, {0x7a, 7}, {0x7b, 7}, {0x7ffe, 15},
+    {0x7fc, 11}, {0x3ffd, 14}, {0x1ffd, 13}, {0xffffffc, 28},
+    {0xfffe6, 20}, {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20},
+    {0x3fffd3, 22}, {0x3fffd4, 22}, {0x3fffd5, 22}, {0x7fffd9, 23},
+    {0x3fffd6, 22}, {0x7fffda, 23}, {0x7fffdb, 23}, {0x7fffdc, 23},
+    {0x7fffdd, 23}, {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23},
+    {0xffffec, 24}, {0xffffed, 24}, {0x3fffd7, 22}, {0x7fffe0, 23},
+    {0xffffee, 24}, {0x7fffe1, 23}, {0x7fffe2, 23}, {0x7fffe3, 23},
+    {0x7fffe4, 23}, {0x1fffdc, 21}, {0x3fffd8, 22}, {0x7fffe5, 23},
+    {0x3fffd9, 22}, {0x7fffe6, 23}, {0x7fffe7, 23}, {0xffffef, 24},
+    {0x3fffda, 22}, {0x1fffdd, 21}, {0xfffe9, 20}, {0x3fffdb, 22},
+    {0x3fffdc, 22}, {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21},
+    {0x7fffea, 23}, {0x3fffdd, 22}, {0x3fffde, 22}, {0xfffff0, 24},
+    {0x1fffdf, 21}, {0x3fffdf, 22}, {0x7fffeb, 23}, {0x7fffec, 23},
+    {0x1fffe0, 21}, {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21},
+    {0x7fffed, 23}, {0x3fffe1, 22}, {0x7fffee, 23}, {0x7fffef, 23},
+    {0xfffea, 20}, {0x3fffe2, 22}, {0x3fffe3, 22}, {0x3fffe4, 22},
+    {0x7ffff0, 23}, {0x3fffe5, 22}, {0x3fffe6, 22}, {0x7ffff1, 23},
+    {0x3ffffe0, 26}, {0x3ffffe1, 26}, {0xfffeb, 20}, {0x7fff1, 19},
+    {0x3fffe7, 22}, {0x7ffff2, 23}, {0x3fffe8, 22}, {0x1ffffec, 25},
+    {0x3ffffe2, 26}, {0x3ffffe3, 26}, {0x3ffffe4, 26}, {0x7ffffde, 27},
+    {0x7ffffdf, 27}, {0x3ffffe5, 26}, {0xfffff1, 24}, {0x1ffffed, 25},
+    {0x7fff2, 19}, {0x1fffe3, 21}, {0x3ffffe6, 26}, {0x7ffffe0, 27},
+    {0x7ffffe1, 27}, {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24},
+    {0x1fffe4, 21}, {0x1fffe5, 21}, {0x3ffffe8, 26}, {0x3ffffe9, 26},
+    {0xffffffd, 28}, {0x7ffffe3, 27}, {0x7ffffe4, 27}, {0x7ffffe5, 27},
+    {0xfffec, 20}, {0xfffff3, 24}, {0xfffed, 20}, {0x1fffe6, 21},
+    {0x3fffe9, 22}, {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23},
+    {0x3fffea, 22}, {0x3fffeb, 22}, {0x1ffffee, 25}, {0x1ffffef, 25},
+    {0xfffff4, 24}, {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23},
+    {0x3ffffeb, 26}, {0x7ffffe6, 27}, {0x3ffffec, 26}, {0x3ffffed, 26},
+    {0x7ffffe7, 27}, {0x7ffffe8, 27}, {0x7ffffe9, 27}, {0x7ffffea, 27},
+    {0x7ffffeb, 27}, {0xffffffe, 28}, {0x7ffffec, 27}, {0x7ffffed, 27},
+    {0x7ffffee, 27}, {0x7ffffef, 27}, {0x7fffff0, 27}, {0x3ffffee, 26},
+};
+
+// Дерево декодирования строится один раз из таблицы кодов: узел - два потомка или символ
+struct HuffmanTree {
+    struct Node {
+        int16_t children[2] = {-1, -1};
+        int16_t symbol = -1;
+    };
+    std::vector<Node> nodes;
+
+    HuffmanTree() {
+        nodes.reserve(512);
+        nodes.emplace_back();
+        for (int symbol = 0; symbol < 256; ++symbol) {
+            const HuffmanCode& code = huffmanCodes[symbol];
+            size_t current = 0;
+            for (int bit = code.length - 1; bit >= 0; --bit) {
+                int branch = (code.code >> bit) & 1;
+                if (nodes[current].children[branch] < 0) {
+                    nodes[current].children[branch] = static_cast<int16_t>(nodes.size());
+                    nodes.emplace_back();
+                }
+                current = static_cast<size_t>(nodes[current].children[branch]);
+            }
+            nodes[current].symbol = static_cast<int16_t>(symbol);
+        }
+    }
+};
+
+const HuffmanTree& huffmanTree() {
+    static const HuffmanTree tree;
+    return tree;
+}
+
+// Имена заголовков, которые меняются от ответа к ответу или не должны оседать в таблице
+bool skipIndexing(std::string_view name) {
+    return name == "content-length" || name == "date" || name == "set-cookie" || name == "etag" ||
+           name == "last-modified" || name == "authorization";
+}
+
+uint64_t decodeInteger(const uint8_t*& p, const uint8_t* end, int prefixBits) {
+    if (p >= end) throw HpackError("truncated integer");
+    uint64_t limit = (1u << prefixBits) - 1;
+    uint64_t value = *p++ & limit;
+    if (value < limit) return value;
+    int shift = 0;
+    while (true) {
+        if (p >= end) throw HpackError("truncated integer");
+        uint8_t byte = *p++;
+        if (shift > 56) throw HpackError("integer overflow");
+        value += uint64_t(byte & 0x7F) << shift;
+        shift += 7;
+        if (!(byte & 0x80)) return value;
+    }
+}
+
+std::string decodeString(const uint8_t*& p, const uint8_t* end) {
+    if (p >= end) throw HpackError("truncated string");
+    bool huffman = *p & 0x80;
+    uint64_t length = decodeInteger(p, end, 7);
+    if (length > static_cast<uint64_t>(end - p)) throw HpackError("truncated string");
+    std::string result;
+    if (huffman) {
+        if (!huffmanDecode(p, static_cast<size_t>(length), result)) throw HpackError("invalid huffman string");
+    } else {
+        result.assign(reinterpret_cast<const char*>(p), static_cast<size_t>(length));
+    }
+    p += length;
+    return result;
+}
+}
+
+// Реализация HpackTable
+
+void HpackTable::add(std::string name, std::string value) {
+    size_t entrySize = name.size() + value.size() + 32;
+    if (entrySize > maxSize) {
+        // Запись больше таблицы очищает её и не добавляется (RFC 7541, 4.4)
+        entries.clear();
+        currentSize = 0;
+        return;
+    }
+    evict(entrySize);
+    currentSize += entrySize;
+    entries.emplace_front(std::move(name), std::move(value));
+}
+
+void HpackTable::setMaxSize(size_t size) {
+    maxSize = size;
+    evict(0);
+}
+
+void HpackTable::evict(size_t required) {
+    while (!entries.empty() && currentSize + required > maxSize) {
+        currentSize -= entries.back().first.size() + entries.back().second.size() + 32;
+        entries.pop_back();
+    }
+}
+
+bool HpackTable::lookup(size_t index, std::string_view& name, std::string_view& value) const {
+    if (index == 0) return false;
+    if (index <= staticTableSize) {
+        name = staticTable[index - 1].name;
+        value = staticTable[index - 1].value;
+        return true;
+    }
+    index -= staticTableSize + 1;
+    if (index >= entries.size()) return false;
+    name = entries[index].first;
+    value = entries[index].second;
+    return true;
+}
+
+size_t HpackTable::find(std::string_view name, std::string_view value, bool& nameOnly) const {
+    size_t nameMatch = 0;
+    for (size_t i = 0; i < staticTableSize; ++i) {
+        if (staticTable[i].name != name) continue;
+        if (staticTable[i].value == value) {
+            nameOnly = false;
+            return i + 1;
+        }
+        if (!nameMatch) nameMatch = i + 1;
+    }
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].first != name) continue;
+        if (entries[i].second == value) {
+            nameOnly = false;
+            return staticTableSize + 1 + i;
+        }
+        if (!nameMatch) nameMatch = staticTableSize + 1 + i;
+    }
+    nameOnly = true;
+    return nameMatch;
+}
+
+// Реализация HpackDecoder
+
+bool HpackDecoder::decode(const uint8_t* data, size_t size, HeaderList& headers, size_t maxHeaderListSize) {
+    const uint8_t* p = data;
+    const uint8_t* end = data + size;
+    size_t listSize = 0;
+    bool fieldSeen = false;
+
+    while (p < end) {
+        uint8_t first = *p;
+        std::string name, value;
+        if (first & 0x80) {
+            // Индексированное поле
+            std::string_view tableName, tableValue;
+            if (!table.lookup(decodeInteger(p, end, 7), tableName, tableValue)) throw HpackError("invalid index");
+            name.assign(tableName);
+            value.assign(tableValue);
+        } else if ((first & 0xE0) == 0x20) {
+            // Изменение размера динамической таблицы допустимо только в начале блока
+            if (fieldSeen) throw HpackError("table size update after header field");
+            uint64_t newSize = decodeInteger(p, end, 5);
+            if (newSize > maxTableSize) throw HpackError("table size update exceeds SETTINGS_HEADER_TABLE_SIZE");
+            table.setMaxSize(static_cast<size_t>(newSize));
+            continue;
+        } else {
+            // Литерал: с индексированием (01), без индексирования (0000) или никогда не индексируемый (0001)
+            bool indexing = (first & 0xC0) == 0x40;
+            uint64_t index = decodeInteger(p, end, indexing ? 6 : 4);
+            if (index) {
+                std::string_view tableName, tableValue;
+                if (!table.lookup(index, tableName, tableValue)) throw HpackError("invalid index");
+                name.assign(tableName);
+            } else {
+                name = decodeString(p, end);
+            }
+            value = decodeString(p, end);
+            if (indexing) table.add(name, value);
+        }
+        fieldSeen = true;
+        listSize += name.size() + value.size() + 32;
+        if (listSize <= maxHeaderListSize) headers.emplace_back(std::move(name), std::move(value));
+    }
+    return listSize <= maxHeaderListSize;
+}
+
+// Реализация HpackEncoder
+
+void HpackEncoder::setMaxTableSize(size_t size) {
+    size = std::min<size_t>(size, 4096);
+    if (size == table.capacity()) return;
+    table.setMaxSize(size);
+    pendingSizeUpdate = true;
+}
+
+void HpackEncoder::encode(const HeaderList& headers, std::string& out) {
+    if (pendingSizeUpdate) {
+        hpackEncodeInteger(table.capacity(), 5, 0x20, out);
+        pendingSizeUpdate = false;
+    }
+    for (const auto& header : headers) {
+        bool nameOnly = false;
+        size_t index = table.find(header.first, header.second, nameOnly);
+        if (index && !nameOnly) {
+            hpackEncodeInteger(index, 7, 0x80, out);
+            continue;
+        }
+        bool indexing = !skipIndexing(header.first);
+        if (indexing) {
+            hpackEncodeInteger(index, 6, 0x40, out);
+        } else {
+            hpackEncodeInteger(index, 4, header.first == "set-cookie" || header.first == "authorization" ? 0x10 : 0x00, out);
+        }
+        if (!index) hpackEncodeString(header.first, out);
+        hpackEncodeString(header.second, out);
+        if (indexing) table.add(header.first, header.second);
+    }
+}
+
+// Примитивы
+
+void hpackEncodeInteger(uint64_t value, int prefixBits, uint8_t firstByte, std::string& out) {
+    uint64_t limit = (1u << prefixBits) - 1;
+    if (value < limit) {
+        out += static_cast<char>(firstByte | value);
+        return;
+    }
+    out += static_cast<char>(firstByte | limit);
+    value -= limit;
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+void hpackEncodeString(std::string_view value, std::string& out) {
+    size_t bits = 0;
+    for (unsigned char c : value) bits += huffmanCodes[c].length;
+    size_t huffmanLength = (bits + 7) / 8;
+    if (huffmanLength >= value.size()) {
+        hpackEncodeInteger(value.size(), 7, 0x00, out);
+        out.append(value.data(), value.size());
+        return;
+    }
+
+    hpackEncodeInteger(huffmanLength, 7, 0x80, out);
+    uint64_t accumulator = 0;
+    int pending = 0;
+    for (unsigned char c : value) {
+        const HuffmanCode& code = huffmanCodes[c];
+        accumulator = (accumulator << code.length) | code.code;
+        pending += code.length;
+        while (pending >= 8) {
+            pending -= 8;
+            out += static_cast<char>((accumulator >> pending) & 0xFF);
+        }
+    }
+    // Дополнение старшими битами кода EOS (все единицы)
+    if (pending > 0) {
+        out += static_cast<char>(((accumulator << (8 - pending)) | (0xFF >> pending)) & 0xFF);
+    }
+}
+
+bool huffmanDecode(const uint8_t* data, size_t size, std::string& out) {
+    const HuffmanTree& tree = huffmanTree();
+    out.reserve(out.size() + size * 8 / 5);
+    size_t node = 0;
+    int bitsSinceSymbol = 0;
+    bool allOnes = true;
+    for (size_t i = 0; i < size; ++i) {
+        uint8_t byte = data[i];
+        for (int bit = 7; bit >= 0; --bit) {
+            int branch = (byte >> bit) & 1;
+            int16_t next = tree.nodes[node].children[branch];
+            if (next < 0) return false;
+            node = static_cast<size_t>(next);
+            ++bitsSinceSymbol;
+            allOnes = allOnes && branch;
+            if (tree.nodes[node].symbol >= 0) {
+                out += static_cast<char>(tree.nodes[node].symbol);
+                node = 0;
+                bitsSinceSymbol = 0;
+                allOnes = true;
+            }
+        }
+    }
+    // Хвост - не более 7 единичных битов префикса EOS
+    return bitsSinceSymbol < 8 && allOnes;
+}
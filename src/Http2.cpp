@@ -0,0 +1,1003 @@
+#include "headers/Http2.h"
+#include "headers/Hpack.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+// Типы кадров (RFC 9113, 6)
+constexpr uint8_t frameData = 0x0;
+constexpr uint8_t frameHeaders = 0x1;
+constexpr uint8_t framePriority = 0x2;
+constexpr uint8_t frameRstStream = 0x3;
+constexpr uint8_t frameSettings = 0x4;
+constexpr uint8_t framePushPromise = 0x5;
+constexpr uint8_t framePing = 0x6;
+constexpr uint8_t frameGoAway = 0x7;
+constexpr uint8_t frameWindowUpdate = 0x8;
+constexpr uint8_t frameContinuation = 0x9;
+
+constexpr uint8_t flagEndStream = 0x1;
+constexpr uint8_t flagAck = 0x1;
+constexpr uint8_t flagEndHeaders = 0x4;
+constexpr uint8_t flagPadded = 0x8;
+constexpr uint8_t flagPriority = 0x20;
+
+// Коды ошибок (RFC 9113, 7)
+constexpr uint32_t errorNone = 0x0;
+constexpr uint32_t errorProtocol = 0x1;
+constexpr uint32_t errorFlowControl = 0x3;
+constexpr uint32_t errorStreamClosed = 0x5;
+constexpr uint32_t errorFrameSize = 0x6;
+constexpr uint32_t errorRefusedStream = 0x7;
+constexpr uint32_t errorCompression = 0x9;
+constexpr uint32_t errorEnhanceYourCalm = 0xb;
+
+constexpr uint16_t settingHeaderTableSize = 0x1;
+constexpr uint16_t settingEnablePush = 0x2;
+constexpr uint16_t settingMaxConcurrentStreams = 0x3;
+constexpr uint16_t settingInitialWindowSize = 0x4;
+constexpr uint16_t settingMaxFrameSize = 0x5;
+constexpr uint16_t settingMaxHeaderListSize = 0x6;
+
+constexpr std::string_view clientPreface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+constexpr int64_t maxWindowSize = 0x7FFFFFFF;
+constexpr uint32_t defaultWindowSize = 65535;
+constexpr size_t frameHeaderSize = 9;
+
+// Ответы на завершённые потоки досылаются после GOAWAY не дольше этого времени
+constexpr std::chrono::seconds drainTimeout(10);
+
+// Ошибка соединения: отправляется GOAWAY с кодом, соединение закрывается
+struct ConnectionError : std::runtime_error {
+    uint32_t code;
+    ConnectionError(uint32_t code, const char* message) : std::runtime_error(message), code(code) {}
+};
+
+void appendUint32(std::string& out, uint32_t value) {
+    out += static_cast<char>((value >> 24) & 0xFF);
+    out += static_cast<char>((value >> 16) & 0xFF);
+    out += static_cast<char>((value >> 8) & 0xFF);
+    out += static_cast<char>(value & 0xFF);
+}
+
+uint32_t readUint32(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+void appendFrameHeader(std::string& out, size_t length, uint8_t type, uint8_t flags, uint32_t streamId) {
+    out += static_cast<char>((length >> 16) & 0xFF);
+    out += static_cast<char>((length >> 8) & 0xFF);
+    out += static_cast<char>(length & 0xFF);
+    out += static_cast<char>(type);
+    out += static_cast<char>(flags);
+    appendUint32(out, streamId & 0x7FFFFFFF);
+}
+
+void appendSetting(std::string& out, uint16_t id, uint32_t value) {
+    out += static_cast<char>(id >> 8);
+    out += static_cast<char>(id & 0xFF);
+    appendUint32(out, value);
+}
+
+void appendRstStream(std::string& out, uint32_t streamId, uint32_t code) {
+    appendFrameHeader(out, 4, frameRstStream, 0, streamId);
+    appendUint32(out, code);
+}
+
+void appendWindowUpdate(std::string& out, uint32_t streamId, uint32_t increment) {
+    appendFrameHeader(out, 4, frameWindowUpdate, 0, streamId);
+    appendUint32(out, increment);
+}
+
+// Заголовки HTTP/1.1, относящиеся к соединению; в HTTP/2 они запрещены (RFC 9113, 8.2.2)
+bool isConnectionSpecific(std::string_view name) {
+    return name == "connection" || name == "keep-alive" || name == "proxy-connection" ||
+           name == "transfer-encoding" || name == "upgrade";
+}
+
+// content-type -> Content-Type: хендлеры FlaskCpp ищут заголовки в привычном написании
+void appendCanonicalName(std::string& out, std::string_view name) {
+    bool upper = true;
+    for (char c : name) {
+        out += upper && c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c;
+        upper = c == '-';
+    }
+}
+
+bool decodeBase64Url(std::string_view input, std::string& out) {
+    uint32_t accumulator = 0;
+    int bits = 0;
+    for (char c : input) {
+        int value;
+        if (c >= 'A' && c <= 'Z') value = c - 'A';
+        else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+        else if (c >= '0' && c <= '9') value = c - '0' + 52;
+        else if (c == '-' || c == '+') value = 62;
+        else if (c == '_' || c == '/') value = 63;
+        else if (c == '=' || c == ' ') continue;
+        else return false;
+        accumulator = (accumulator << 6) | static_cast<uint32_t>(value);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out += static_cast<char>((accumulator >> bits) & 0xFF);
+        }
+    }
+    return true;
+}
+
+// Запрос HTTP/2 в виде HTTP/1.1 для FlaskCpp. false - запрос некорректен (RFC 9113, 8.1.1)
+// Путь из стартовой строки собранного запроса, без query string
+std::string requestPath(const std::string& request) {
+    size_t start = request.find(' ');
+    if (start == std::string::npos) return std::string();
+    ++start;
+    size_t end = request.find_first_of(" ?\r\n", start);
+    return request.substr(start, end == std::string::npos ? std::string::npos : end - start);
+}
+
+bool buildHttp1Request(const HeaderList& headers, const std::string& body, std::string& request, std::string& method) {
+    std::string_view path, scheme, authority;
+    bool regularSeen = false, hasHost = false, hasContentLength = false;
+    std::string cookies;
+    size_t headersSize = 0;
+
+    for (const auto& header : headers) {
+        const std::string& name = header.first;
+        const std::string& value = header.second;
+        // Значение переносится в текст HTTP/1.1, поэтому переводы строк и NUL недопустимы
+        if (value.find_first_of("\r\n", 0) != std::string::npos || value.find('\0') != std::string::npos) return false;
+        if (name.empty()) return false;
+        if (name[0] == ':') {
+            if (regularSeen) return false;
+            if (name == ":method" && method.empty()) method = value;
+            else if (name == ":path" && path.empty()) path = value;
+            else if (name == ":scheme" && scheme.empty()) scheme = value;
+            else if (name == ":authority" && authority.empty()) authority = value;
+            else return false;
+            continue;
+        }
+        regularSeen = true;
+        for (char c : name) {
+            if ((c >= 'A' && c <= 'Z') || c == ':' || c == ' ' || c == '\r' || c == '\n' || c == '\0') return false;
+        }
+        if (isConnectionSpecific(name) || (name == "te" && value != "trailers")) return false;
+        if (name == "host") hasHost = true;
+        if (name == "content-length") hasContentLength = true;
+        headersSize += name.size() + value.size() + 4;
+    }
+    if (method.empty() || path.empty() || scheme.empty() || method.find(' ') != std::string::npos ||
+        path.find(' ') != std::string_view::npos) {
+        return false;
+    }
+
+    request.reserve(method.size() + path.size() + authority.size() + headersSize + body.size() + 64);
+    request += method;
+    request += ' ';
+    request.append(path.data(), path.size());
+    request += " HTTP/2.0\r\n";
+    if (!authority.empty() && !hasHost) {
+        request += "Host: ";
+        request.append(authority.data(), authority.size());
+        request += "\r\n";
+    }
+    for (const auto& header : headers) {
+        if (header.first[0] == ':') continue;
+        // Клиент HTTP/2 может разбить Cookie на несколько полей (RFC 9113, 8.2.3)
+        if (header.first == "cookie") {
+            if (!cookies.empty()) cookies += "; ";
+            cookies += header.second;
+            continue;
+        }
+        appendCanonicalName(request, header.first);
+        request += ": ";
+        request += header.second;
+        request += "\r\n";
+    }
+    if (!cookies.empty()) {
+        request += "Cookie: ";
+        request += cookies;
+        request += "\r\n";
+    }
+    if (!body.empty() && !hasContentLength) {
+        request += "Content-Length: ";
+        request += std::to_string(body.size());
+        request += "\r\n";
+    }
+    request += "\r\n";
+    request += body;
+    return true;
+}
+
+// Разбирает ответ FlaskCpp в формате HTTP/1.1: статус и заголовки для HEADERS, тело для DATA
+bool parseHttp1Response(const std::string& response, HeaderList& headers, std::string_view& body) {
+    size_t headEnd = response.find("\r\n\r\n");
+    if (headEnd == std::string::npos || response.compare(0, 5, "HTTP/") != 0) return false;
+    size_t statusStart = response.find(' ');
+    if (statusStart == std::string::npos || statusStart + 4 > headEnd) return false;
+    headers.emplace_back(":status", response.substr(statusStart + 1, 3));
+
+    size_t pos = response.find("\r\n");
+    while (pos < headEnd) {
+        pos += 2;
+        size_t lineEnd = response.find("\r\n", pos);
+        std::string_view line(response.data() + pos, lineEnd - pos);
+        pos = lineEnd;
+        size_t colonPos = line.find(':');
+        if (colonPos == std::string_view::npos || colonPos == 0) continue;
+        std::string name(line.substr(0, colonPos));
+        for (char& c : name) {
+            if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+        }
+        if (isConnectionSpecific(name)) continue;
+        std::string_view value = line.substr(colonPos + 1);
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.remove_suffix(1);
+        headers.emplace_back(std::move(name), std::string(value));
+    }
+    body = std::string_view(response).substr(headEnd + 4);
+    return true;
+}
+
+const std::string& simpleResponse(int status) {
+    static const std::string payloadTooLarge =
+        "HTTP/1.1 413 Payload Too Large\r\nContent-Type: text/plain\r\nContent-Length: 17\r\n\r\nPayload Too Large";
+    static const std::string headersTooLarge =
+        "HTTP/1.1 431 Request Header Fields Too Large\r\nContent-Type: text/plain\r\nContent-Length: 31\r\n\r\n"
+        "Request Header Fields Too Large";
+    static const std::string internalError =
+        "HTTP/1.1 500 Internal Server Error\r\nContent-Type: text/plain\r\nContent-Length: 21\r\n\r\nInternal Server Error";
+    static const std::string unavailable =
+        "HTTP/1.1 503 Service Unavailable\r\nContent-Type: text/plain\r\nRetry-After: 1\r\nContent-Length: 19\r\n\r\n"
+        "Service Unavailable";
+    switch (status) {
+        case 413: return payloadTooLarge;
+        case 431: return headersTooLarge;
+        case 503: return unavailable;
+        default: return internalError;
+    }
+}
+}
+
+// Одно HTTP/2-соединение. Поток чтения разбирает кадры и ставит завершённые запросы в пул потоков;
+// рабочие потоки отправляют ответы через complete(). Состояние потоков и запись в сокет - под mutex
+class Http2Server::Session : public std::enable_shared_from_this<Session> {
+public:
+    Session(Http2Server& server, uint64_t id, int socket, std::string clientIP, std::string buffered);
+    ~Session();
+
+    void run(std::string upgradeRequest, std::string upgradeSettings);
+    // Остановка сервера: GOAWAY и завершение чтения; уже принятые запросы дообслуживаются
+    void goAway();
+    void complete(uint32_t streamId, const std::string& response);
+
+    const uint64_t id;
+
+private:
+    struct Stream {
+        HeaderList headers;
+        std::string body;
+        bool requestDone = false;   // Клиент завершил запрос (END_STREAM)
+        bool headersTooLarge = false;
+        bool headRequest = false;
+        int64_t receiveWindow = 0;
+        size_t unacknowledged = 0;  // Принято байт DATA без ответного WINDOW_UPDATE
+        int64_t sendWindow = 0;
+        bool responding = false;    // HEADERS ответа отправлены, тело досылается по окнам
+        std::string pending;
+        size_t pendingOffset = 0;
+    };
+
+    Http2Server& server;
+    const int socket;
+    const std::string clientIP;
+    const std::shared_ptr<const RequestHandler> handler;
+    const Http2Options options;
+    std::atomic<bool> stopRequested;
+
+    // Состояние потока чтения
+    std::string readBuffer;
+    size_t readOffset;
+    HpackDecoder decoder;
+    bool settingsReceived;
+    uint32_t continuationStream;
+    uint8_t continuationFlags;
+    std::string headerBlock;
+    int64_t connectionReceiveWindow;
+    std::chrono::steady_clock::time_point lastActivity;
+    std::chrono::steady_clock::time_point resetWindowStart;
+    uint32_t resetsInWindow;
+
+    // Под mutex
+    std::mutex mutex;
+    std::condition_variable drained;
+    std::unordered_map<uint32_t, Stream> streams;
+    HpackEncoder encoder;
+    uint32_t lastStreamId;
+    int64_t connectionSendWindow;
+    uint32_t peerInitialWindow;
+    uint32_t peerMaxFrameSize;
+    bool goAwaySent;
+    bool broken;
+
+    bool fill();
+    bool readFrame(uint8_t& type, uint8_t& flags, uint32_t& streamId, const uint8_t*& payload, size_t& length);
+    void handleFrame(uint8_t type, uint8_t flags, uint32_t streamId, const uint8_t* payload, size_t length);
+    void handleData(uint8_t flags, uint32_t streamId, const uint8_t* payload, size_t length);
+    void handleHeaderBlock(uint32_t streamId, bool endStream);
+    void applySettings(const uint8_t* payload, size_t length);
+    void finishRequestLocked(uint32_t streamId, Stream& stream, std::string& out);
+    void respondLocked(uint32_t streamId, Stream& stream, const std::string& response, std::string& out);
+    void flushPendingLocked(std::string& out);
+    void sendLocked(const std::string& data);
+    void send(const std::string& data);
+};
+
+Http2Server::Session::Session(Http2Server& server, uint64_t id, int socket, std::string clientIP, std::string buffered)
+    : id(id), server(server), socket(socket), clientIP(std::move(clientIP)), handler(server.handler),
+      options(server.options), stopRequested(false), readBuffer(std::move(buffered)), readOffset(0),
+      settingsReceived(false), continuationStream(0), continuationFlags(0),
+      connectionReceiveWindow(defaultWindowSize), lastActivity(std::chrono::steady_clock::now()),
+      resetWindowStart(lastActivity), resetsInWindow(0), lastStreamId(0),
+      connectionSendWindow(defaultWindowSize), peerInitialWindow(defaultWindowSize), peerMaxFrameSize(16384),
+      goAwaySent(false), broken(false) {}
+
+Http2Server::Session::~Session() {
+    ::close(socket);
+}
+
+void Http2Server::Session::run(std::string upgradeRequest, std::string upgradeSettings) {
+    // Таймаут чтения - шаг проверки простоя и остановки; таймаут записи защищает от клиента, который не читает
+    timeval readTimeout{1, 0};
+    timeval writeTimeout{10, 0};
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &readTimeout, sizeof(readTimeout));
+    setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, &writeTimeout, sizeof(writeTimeout));
+    int flag = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+
+    bool graceful = false;
+    try {
+        // Preface сервера: наши SETTINGS и расширение окна соединения
+        std::string preface;
+        appendFrameHeader(preface, 24, frameSettings, 0, 0);
+        appendSetting(preface, settingMaxConcurrentStreams, options.maxConcurrentStreams);
+        appendSetting(preface, settingInitialWindowSize, options.streamWindowSize);
+        appendSetting(preface, settingMaxFrameSize, options.maxFrameSize);
+        appendSetting(preface, settingMaxHeaderListSize, static_cast<uint32_t>(options.maxHeaderListSize));
+        if (options.connectionWindowSize > defaultWindowSize) {
+            appendWindowUpdate(preface, 0, options.connectionWindowSize - defaultWindowSize);
+            connectionReceiveWindow = options.connectionWindowSize;
+        }
+        send(preface);
+
+        // Upgrade: h2c - HTTP2-Settings применяются как первые SETTINGS клиента, исходный запрос - поток 1
+        if (!upgradeRequest.empty()) {
+            std::string settings;
+            if (!decodeBase64Url(upgradeSettings, settings) || settings.size() % 6 != 0) {
+                throw ConnectionError(errorProtocol, "invalid HTTP2-Settings");
+            }
+            applySettings(reinterpret_cast<const uint8_t*>(settings.data()), settings.size());
+            std::string method = upgradeRequest.substr(0, upgradeRequest.find(' '));
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                lastStreamId = 1;
+                Stream& stream = streams[1];
+                stream.requestDone = true;
+                stream.headRequest = method == "HEAD";
+                stream.sendWindow = peerInitialWindow;
+            }
+            server.streamsTotal.fetch_add(1, std::memory_order_relaxed);
+            auto self = shared_from_this();
+            auto requestHandler = handler;
+            std::string path = requestPath(upgradeRequest);
+            server.dispatch(method, path, [self, requestHandler, request = std::move(upgradeRequest)]() mutable {
+                std::string response;
+                try {
+                    response = (*requestHandler)(std::move(request), self->clientIP);
+                } catch (...) {
+                    response = simpleResponse(500);
+                }
+                self->complete(1, response);
+            });
+        }
+
+        // Preface клиента
+        while (readBuffer.size() < clientPreface.size()) {
+            if (!fill()) return;
+        }
+        if (std::string_view(readBuffer).substr(0, clientPreface.size()) != clientPreface) {
+            throw ConnectionError(errorProtocol, "invalid connection preface");
+        }
+        readOffset = clientPreface.size();
+
+        uint8_t type = 0xFF, flags;
+        uint32_t streamId;
+        const uint8_t* payload;
+        size_t length;
+        while (readFrame(type, flags, streamId, payload, length)) {
+            lastActivity = std::chrono::steady_clock::now();
+            handleFrame(type, flags, streamId, payload, length);
+            if (type == frameGoAway) break;
+        }
+        // Соединение закрыла наша сторона (GOAWAY) или клиент объявил GOAWAY: ответы ещё можно дослать
+        std::lock_guard<std::mutex> lock(mutex);
+        graceful = goAwaySent || type == frameGoAway;
+    } catch (const ConnectionError& e) {
+        std::string frame;
+        std::lock_guard<std::mutex> lock(mutex);
+        appendFrameHeader(frame, 8, frameGoAway, 0, 0);
+        appendUint32(frame, lastStreamId);
+        appendUint32(frame, e.code);
+        goAwaySent = true;
+        sendLocked(frame);
+        broken = true;
+    } catch (const std::exception&) {
+        std::lock_guard<std::mutex> lock(mutex);
+        broken = true;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (graceful) {
+        drained.wait_for(lock, drainTimeout, [this]() { return streams.empty() || broken; });
+    }
+    broken = true;
+    streams.clear();
+    ::shutdown(socket, SHUT_RDWR);
+}
+
+void Http2Server::Session::goAway() {
+    stopRequested = true;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!goAwaySent && !broken) {
+            std::string frame;
+            appendFrameHeader(frame, 8, frameGoAway, 0, 0);
+            appendUint32(frame, lastStreamId);
+            appendUint32(frame, errorNone);
+            goAwaySent = true;
+            sendLocked(frame);
+        }
+    }
+    // Поток чтения получит EOF; отправка ответов продолжает работать
+    ::shutdown(socket, SHUT_RD);
+}
+
+bool Http2Server::Session::fill() {
+    if (readOffset > 0 && readOffset * 2 >= readBuffer.size()) {
+        readBuffer.erase(0, readOffset);
+        readOffset = 0;
+    }
+    char buffer[16384];
+    while (true) {
+        ssize_t r = recv(socket, buffer, sizeof(buffer), 0);
+        if (r > 0) {
+            readBuffer.append(buffer, static_cast<size_t>(r));
+            return true;
+        }
+        if (r == 0) return false;
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+        if (stopRequested.load()) return false;
+
+        // Таймаут чтения: соединение без активных запросов закрывается после idleTimeout
+        bool idle;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            idle = streams.empty() && std::chrono::steady_clock::now() - lastActivity > options.idleTimeout;
+        }
+        if (idle) {
+            goAway();
+            return false;
+        }
+    }
+}
+
+bool Http2Server::Session::readFrame(uint8_t& type, uint8_t& flags, uint32_t& streamId,
+                                     const uint8_t*& payload, size_t& length) {
+    while (readBuffer.size() - readOffset < frameHeaderSize) {
+        if (!fill()) return false;
+    }
+    const uint8_t* header = reinterpret_cast<const uint8_t*>(readBuffer.data() + readOffset);
+    length = (size_t(header[0]) << 16) | (size_t(header[1]) << 8) | size_t(header[2]);
+    type = header[3];
+    flags = header[4];
+    streamId = readUint32(header + 5) & 0x7FFFFFFF;
+    if (length > options.maxFrameSize) throw ConnectionError(errorFrameSize, "frame exceeds SETTINGS_MAX_FRAME_SIZE");
+
+    while (readBuffer.size() - readOffset < frameHeaderSize + length) {
+        if (!fill()) return false;
+    }
+    payload = reinterpret_cast<const uint8_t*>(readBuffer.data() + readOffset + frameHeaderSize);
+    readOffset += frameHeaderSize + length;
+    return true;
+}
+
+void Http2Server::Session::handleFrame(uint8_t type, uint8_t flags, uint32_t streamId, const uint8_t* payload, size_t length) {
+    // Блок заголовков не прерывается другими кадрами (RFC 9113, 6.10)
+    if (continuationStream != 0 && (type != frameContinuation || streamId != continuationStream)) {
+        throw ConnectionError(errorProtocol, "expected CONTINUATION");
+    }
+    if (!settingsReceived && type != frameSettings) throw ConnectionError(errorProtocol, "expected SETTINGS");
+
+    switch (type) {
+        case frameData:
+            handleData(flags, streamId, payload, length);
+            break;
+
+        case frameHeaders: {
+            if (streamId == 0 || streamId % 2 == 0) throw ConnectionError(errorProtocol, "invalid stream id for HEADERS");
+            size_t padding = 0;
+            if (flags & flagPadded) {
+                if (length < 1) throw ConnectionError(errorFrameSize, "invalid padding");
+                padding = payload[0];
+                ++payload;
+                --length;
+            }
+            if (flags & flagPriority) {
+                if (length < 5) throw ConnectionError(errorFrameSize, "invalid priority");
+                payload += 5;
+                length -= 5;
+            }
+            if (padding > length) throw ConnectionError(errorProtocol, "padding exceeds payload");
+            headerBlock.assign(reinterpret_cast<const char*>(payload), length - padding);
+            continuationFlags = flags;
+            if (flags & flagEndHeaders) {
+                handleHeaderBlock(streamId, flags & flagEndStream);
+            } else {
+                continuationStream = streamId;
+            }
+            break;
+        }
+
+        case frameContinuation:
+            if (continuationStream == 0) throw ConnectionError(errorProtocol, "unexpected CONTINUATION");
+            if (headerBlock.size() + length > options.maxHeaderListSize * 2) {
+                throw ConnectionError(errorCompression, "header block too large");
+            }
+            headerBlock.append(reinterpret_cast<const char*>(payload), length);
+            if (flags & flagEndHeaders) {
+                continuationStream = 0;
+                handleHeaderBlock(streamId, continuationFlags & flagEndStream);
+            }
+            break;
+
+        case framePriority:
+            if (streamId == 0) throw ConnectionError(errorProtocol, "PRIORITY on stream 0");
+            if (length != 5) {
+                std::string frame;
+                appendRstStream(frame, streamId, errorFrameSize);
+                send(frame);
+            }
+            break;
+
+        case frameRstStream: {
+            if (streamId == 0) throw ConnectionError(errorProtocol, "RST_STREAM on stream 0");
+            if (length != 4) throw ConnectionError(errorFrameSize, "invalid RST_STREAM");
+            auto now = std::chrono::steady_clock::now();
+            if (now - resetWindowStart >= std::chrono::seconds(1)) {
+                resetWindowStart = now;
+                resetsInWindow = 0;
+            }
+            if (++resetsInWindow > options.maxResetsPerSecond) {
+                throw ConnectionError(errorEnhanceYourCalm, "too many stream resets");
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (streamId > lastStreamId) throw ConnectionError(errorProtocol, "RST_STREAM on idle stream");
+            // Ответ, который ещё выполняется в пуле, будет отброшен в complete()
+            streams.erase(streamId);
+            if (streams.empty()) drained.notify_all();
+            break;
+        }
+
+        case frameSettings:
+            if (streamId != 0) throw ConnectionError(errorProtocol, "SETTINGS on a stream");
+            if (flags & flagAck) {
+                if (length != 0) throw ConnectionError(errorFrameSize, "SETTINGS ACK with payload");
+                break;
+            }
+            if (length % 6 != 0) throw ConnectionError(errorFrameSize, "invalid SETTINGS length");
+            applySettings(payload, length);
+            settingsReceived = true;
+            {
+                std::string frame;
+                appendFrameHeader(frame, 0, frameSettings, flagAck, 0);
+                send(frame);
+            }
+            break;
+
+        case framePushPromise:
+            throw ConnectionError(errorProtocol, "PUSH_PROMISE from client");
+
+        case framePing:
+            if (streamId != 0) throw ConnectionError(errorProtocol, "PING on a stream");
+            if (length != 8) throw ConnectionError(errorFrameSize, "invalid PING");
+            if (!(flags & flagAck)) {
+                std::string frame;
+                appendFrameHeader(frame, 8, framePing, flagAck, 0);
+                frame.append(reinterpret_cast<const char*>(payload), 8);
+                send(frame);
+            }
+            break;
+
+        case frameGoAway:
+            if (streamId != 0) throw ConnectionError(errorProtocol, "GOAWAY on a stream");
+            break;
+
+        case frameWindowUpdate: {
+            if (length != 4) throw ConnectionError(errorFrameSize, "invalid WINDOW_UPDATE");
+            uint32_t increment = readUint32(payload) & 0x7FFFFFFF;
+            std::string out;
+            std::lock_guard<std::mutex> lock(mutex);
+            if (streamId == 0) {
+                if (increment == 0) throw ConnectionError(errorProtocol, "zero WINDOW_UPDATE");
+                connectionSendWindow += increment;
+                if (connectionSendWindow > maxWindowSize) throw ConnectionError(errorFlowControl, "connection window overflow");
+            } else {
+                auto it = streams.find(streamId);
+                if (it != streams.end()) {
+                    it->second.sendWindow += increment;
+                    if (increment == 0 || it->second.sendWindow > maxWindowSize) {
+                        appendRstStream(out, streamId, increment == 0 ? errorProtocol : errorFlowControl);
+                        streams.erase(it);
+                    }
+                } else if (streamId > lastStreamId) {
+                    throw ConnectionError(errorProtocol, "WINDOW_UPDATE on idle stream");
+                }
+            }
+            flushPendingLocked(out);
+            sendLocked(out);
+            break;
+        }
+
+        default:
+            // Неизвестные типы кадров игнорируются (RFC 9113, 4.1)
+            break;
+    }
+}
+
+void Http2Server::Session::handleData(uint8_t flags, uint32_t streamId, const uint8_t* payload, size_t length) {
+    if (streamId == 0) throw ConnectionError(errorProtocol, "DATA on stream 0");
+
+    // Управление потоком учитывает кадр целиком, вместе с дополнением
+    connectionReceiveWindow -= static_cast<int64_t>(length);
+    if (connectionReceiveWindow < 0) throw ConnectionError(errorFlowControl, "connection receive window exceeded");
+    size_t padding = 0;
+    if (flags & flagPadded) {
+        if (length < 1) throw ConnectionError(errorFrameSize, "invalid padding");
+        padding = payload[0];
+        ++payload;
+        --length;
+        if (padding > length) throw ConnectionError(errorProtocol, "padding exceeds payload");
+    }
+    size_t dataLength = length - padding;
+    size_t frameLength = length + ((flags & flagPadded) ? 1 : 0);
+
+    std::string out;
+    std::lock_guard<std::mutex> lock(mutex);
+    // Окно соединения возвращаем, когда израсходована половина
+    if (connectionReceiveWindow < static_cast<int64_t>(options.connectionWindowSize / 2)) {
+        appendWindowUpdate(out, 0, static_cast<uint32_t>(options.connectionWindowSize - connectionReceiveWindow));
+        connectionReceiveWindow = options.connectionWindowSize;
+    }
+
+    auto it = streams.find(streamId);
+    if (it == streams.end() || it->second.requestDone) {
+        if (streamId > lastStreamId) throw ConnectionError(errorProtocol, "DATA on idle stream");
+        // Поток уже закрыт (сброшен клиентом или ответ 413 отправлен досрочно) - данные отбрасываются
+        sendLocked(out);
+        return;
+    }
+    Stream& stream = it->second;
+    stream.receiveWindow -= static_cast<int64_t>(frameLength);
+    if (stream.receiveWindow < 0) {
+        appendRstStream(out, streamId, errorFlowControl);
+        streams.erase(it);
+        sendLocked(out);
+        return;
+    }
+    if (stream.body.size() + dataLength > options.maxRequestBodySize) {
+        // Тело больше лимита: отвечаем 413, оставшиеся кадры DATA будут отброшены
+        stream.requestDone = true;
+        respondLocked(streamId, stream, simpleResponse(413), out);
+        sendLocked(out);
+        return;
+    }
+    stream.body.append(reinterpret_cast<const char*>(payload), dataLength);
+
+    if (flags & flagEndStream) {
+        finishRequestLocked(streamId, stream, out);
+    } else {
+        stream.unacknowledged += frameLength;
+        if (stream.unacknowledged >= options.streamWindowSize / 2) {
+            appendWindowUpdate(out, streamId, static_cast<uint32_t>(stream.unacknowledged));
+            stream.receiveWindow += static_cast<int64_t>(stream.unacknowledged);
+            stream.unacknowledged = 0;
+        }
+    }
+    sendLocked(out);
+}
+
+void Http2Server::Session::handleHeaderBlock(uint32_t streamId, bool endStream) {
+    // Блок разбирается всегда, даже для отклоняемого потока: таблица HPACK общая для соединения
+    HeaderList headers;
+    bool withinLimit;
+    try {
+        withinLimit = decoder.decode(reinterpret_cast<const uint8_t*>(headerBlock.data()), headerBlock.size(), headers,
+                                     options.maxHeaderListSize);
+    } catch (const HpackError&) {
+        throw ConnectionError(errorCompression, "HPACK decoding failed");
+    }
+    headerBlock.clear();
+
+    std::string out;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = streams.find(streamId);
+    if (it != streams.end()) {
+        // Трейлеры запроса: завершают поток, сами заголовки хендлерам не передаются
+        if (it->second.requestDone) throw ConnectionError(errorStreamClosed, "HEADERS on half-closed stream");
+        if (!endStream) throw ConnectionError(errorProtocol, "trailers without END_STREAM");
+        finishRequestLocked(streamId, it->second, out);
+        sendLocked(out);
+        return;
+    }
+    if (streamId <= lastStreamId) throw ConnectionError(errorProtocol, "HEADERS on closed stream");
+    lastStreamId = streamId;
+    if (goAwaySent) return;
+    if (streams.size() >= options.maxConcurrentStreams) {
+        appendRstStream(out, streamId, errorRefusedStream);
+        sendLocked(out);
+        return;
+    }
+
+    Stream& stream = streams[streamId];
+    stream.headers = std::move(headers);
+    stream.headersTooLarge = !withinLimit;
+    stream.receiveWindow = options.streamWindowSize;
+    stream.sendWindow = peerInitialWindow;
+    server.streamsTotal.fetch_add(1, std::memory_order_relaxed);
+    if (endStream) {
+        finishRequestLocked(streamId, stream, out);
+        sendLocked(out);
+    }
+}
+
+void Http2Server::Session::applySettings(const uint8_t* payload, size_t length) {
+    std::string out;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t offset = 0; offset + 6 <= length; offset += 6) {
+        uint16_t id = static_cast<uint16_t>((payload[offset] << 8) | payload[offset + 1]);
+        uint32_t value = readUint32(payload + offset + 2);
+        switch (id) {
+            case settingHeaderTableSize:
+                encoder.setMaxTableSize(value);
+                break;
+            case settingEnablePush:
+                if (value > 1) throw ConnectionError(errorProtocol, "invalid SETTINGS_ENABLE_PUSH");
+                break;
+            case settingInitialWindowSize: {
+                if (value > maxWindowSize) throw ConnectionError(errorFlowControl, "invalid SETTINGS_INITIAL_WINDOW_SIZE");
+                // Изменение начального окна применяется ко всем открытым потокам (RFC 9113, 6.9.2)
+                int64_t delta = int64_t(value) - int64_t(peerInitialWindow);
+                for (auto& pair : streams) {
+                    pair.second.sendWindow += delta;
+                    if (pair.second.sendWindow > maxWindowSize) throw ConnectionError(errorFlowControl, "stream window overflow");
+                }
+                peerInitialWindow = value;
+                break;
+            }
+            case settingMaxFrameSize:
+                if (value < 16384 || value > 16777215) throw ConnectionError(errorProtocol, "invalid SETTINGS_MAX_FRAME_SIZE");
+                peerMaxFrameSize = value;
+                break;
+            default:
+                // SETTINGS_MAX_CONCURRENT_STREAMS касается push-потоков сервера, которых нет; неизвестные - игнорируются
+                break;
+        }
+    }
+    flushPendingLocked(out);
+    sendLocked(out);
+}
+
+void Http2Server::Session::finishRequestLocked(uint32_t streamId, Stream& stream, std::string& out) {
+    stream.requestDone = true;
+    if (stream.headersTooLarge) {
+        respondLocked(streamId, stream, simpleResponse(431), out);
+        return;
+    }
+    std::string request, method;
+    if (!buildHttp1Request(stream.headers, stream.body, request, method)) {
+        appendRstStream(out, streamId, errorProtocol);
+        streams.erase(streamId);
+        return;
+    }
+    stream.headRequest = method == "HEAD";
+    stream.headers.clear();
+    stream.headers.shrink_to_fit();
+    std::string().swap(stream.body);
+
+    auto self = shared_from_this();
+    auto requestHandler = handler;
+    std::string path = requestPath(request);
+    try {
+        server.dispatch(method, path, [self, requestHandler, streamId, request = std::move(request)]() mutable {
+            std::string response;
+            try {
+                response = (*requestHandler)(std::move(request), self->clientIP);
+            } catch (...) {
+                response = simpleResponse(500);
+            }
+            self->complete(streamId, response);
+        });
+    } catch (const std::exception&) {
+        // Пул потоков остановлен или сервер перегружен
+        respondLocked(streamId, stream, simpleResponse(503), out);
+    }
+}
+
+void Http2Server::Session::complete(uint32_t streamId, const std::string& response) {
+    std::string out;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = streams.find(streamId);
+    if (it == streams.end() || broken) return;
+    respondLocked(streamId, it->second, response, out);
+    sendLocked(out);
+}
+
+void Http2Server::Session::respondLocked(uint32_t streamId, Stream& stream, const std::string& response, std::string& out) {
+    HeaderList headers;
+    std::string_view body;
+    if (!parseHttp1Response(response, headers, body)) {
+        headers.clear();
+        parseHttp1Response(simpleResponse(500), headers, body);
+    }
+    if (stream.headRequest) body = std::string_view();
+
+    // Блок заголовков кодируется под mutex: порядок блоков должен совпадать с порядком изменений таблицы HPACK
+    std::string block;
+    encoder.encode(headers, block);
+    size_t offset = 0;
+    bool first = true;
+    do {
+        size_t chunk = std::min<size_t>(block.size() - offset, peerMaxFrameSize);
+        bool last = offset + chunk == block.size();
+        uint8_t flags = last ? flagEndHeaders : 0;
+        if (first && body.empty()) flags |= flagEndStream;
+        appendFrameHeader(out, chunk, first ? frameHeaders : frameContinuation, flags, streamId);
+        out.append(block, offset, chunk);
+        offset += chunk;
+        first = false;
+    } while (offset < block.size());
+
+    if (body.empty()) {
+        streams.erase(streamId);
+        if (streams.empty()) drained.notify_all();
+        return;
+    }
+    stream.responding = true;
+    stream.pending.assign(body.data(), body.size());
+    stream.pendingOffset = 0;
+    flushPendingLocked(out);
+}
+
+void Http2Server::Session::flushPendingLocked(std::string& out) {
+    if (connectionSendWindow <= 0) return;
+    std::vector<uint32_t> finished;
+    for (auto& pair : streams) {
+        Stream& stream = pair.second;
+        if (!stream.responding) continue;
+        while (stream.pendingOffset < stream.pending.size() && connectionSendWindow > 0 && stream.sendWindow > 0) {
+            size_t chunk = std::min<size_t>(stream.pending.size() - stream.pendingOffset, peerMaxFrameSize);
+            chunk = static_cast<size_t>(std::min<int64_t>({int64_t(chunk), connectionSendWindow, stream.sendWindow}));
+            bool last = stream.pendingOffset + chunk == stream.pending.size();
+            appendFrameHeader(out, chunk, frameData, last ? flagEndStream : 0, pair.first);
+            out.append(stream.pending, stream.pendingOffset, chunk);
+            stream.pendingOffset += chunk;
+            connectionSendWindow -= static_cast<int64_t>(chunk);
+            stream.sendWindow -= static_cast<int64_t>(chunk);
+        }
+        if (stream.pendingOffset == stream.pending.size()) finished.push_back(pair.first);
+        if (connectionSendWindow <= 0) break;
+    }
+    for (uint32_t streamId : finished) streams.erase(streamId);
+    if (!finished.empty() && streams.empty()) drained.notify_all();
+}
+
+void Http2Server::Session::sendLocked(const std::string& data) {
+    size_t offset = 0;
+    while (offset < data.size() && !broken) {
+        ssize_t sent = ::send(socket, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            // Клиент не читает дольше таймаута записи или соединение разорвано
+            broken = true;
+            ::shutdown(socket, SHUT_RDWR);
+            drained.notify_all();
+            return;
+        }
+        offset += static_cast<size_t>(sent);
+    }
+}
+
+void Http2Server::Session::send(const std::string& data) {
+    std::lock_guard<std::mutex> lock(mutex);
+    sendLocked(data);
+}
+
+// Реализация Http2Server
+
+Http2Server::Http2Server(RequestHandler handler, Dispatch dispatch, const Http2Options& options)
+    : handler(std::make_shared<const RequestHandler>(std::move(handler))), dispatch(std::move(dispatch)),
+      options(options), nextId(1), stopping(false), streamsTotal(0) {}
+
+Http2Server::~Http2Server() {
+    stop();
+}
+
+void Http2Server::stop() {
+    std::vector<std::thread> finished;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stopping = true;
+        for (auto& pair : sessions) pair.second->goAway();
+        sessionsDone.wait(lock, [this]() { return sessions.empty(); });
+        finished.swap(finishedThreads);
+    }
+    for (auto& thread : finished) thread.join();
+}
+
+bool Http2Server::adopt(int socket, const std::string& clientIP, std::string buffered,
+                        std::string upgradeRequest, std::string_view upgradeSettings) {
+    std::vector<std::thread> finished;
+    bool adopted = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.swap(finishedThreads);
+        if (!stopping && sessions.size() < options.maxConnections) {
+            auto session = std::make_shared<Session>(*this, nextId, socket, clientIP, std::move(buffered));
+            // Поток создаётся под mutex: unregister не найдёт его в sessionThreads раньше, чем он туда попадёт
+            try {
+                sessionThreads.emplace(session->id, std::thread([this, session, upgradeRequest = std::move(upgradeRequest),
+                                                                 upgradeSettings = std::string(upgradeSettings)]() mutable {
+                    session->run(std::move(upgradeRequest), std::move(upgradeSettings));
+                    uint64_t id = session->id;
+                    session.reset();
+                    unregister(id);
+                }));
+                sessions.emplace(nextId++, std::move(session));
+                adopted = true;
+            } catch (const std::exception&) {
+                // Сокет закроет деструктор Session, поэтому вызывающий не должен закрывать его сам
+                adopted = true;
+            }
+        }
+    }
+    // Потоки завершившихся сессий уже вышли из unregister
+    for (auto& thread : finished) thread.join();
+    return adopted;
+}
+
+size_t Http2Server::connectionCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return sessions.size();
+}
+
+void Http2Server::unregister(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    sessions.erase(id);
+    // Вызывается последним действием потока сессии: сам себя он присоединить не может
+    auto it = sessionThreads.find(id);
+    if (it != sessionThreads.end()) {
+        finishedThreads.push_back(std::move(it->second));
+        sessionThreads.erase(it);
+    }
+    if (sessions.empty()) sessionsDone.notify_all();
+}
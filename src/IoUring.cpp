@@ -0,0 +1,617 @@
+#include "headers/IoUring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+int ioUringSetup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringRegister(int fd, unsigned opcode, void* arg, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+std::runtime_error ioUringError(const char* what) {
+    return std::runtime_error(std::string("io_uring: ") + what + ": " + std::strerror(errno));
+}
+
+// Тип операции в младших битах user_data; старшие - адрес IoUringClient (выровнен по 8 байт)
+enum Operation : uint64_t {
+    OpIgnore = 0,   // Результат не нужен (закрытие файла статики)
+    OpAccept = 1,
+    OpWake = 2,
+    OpRecv = 3,
+    OpSend = 4,
+    OpReadFile = 5,
+    OpCancel = 6,
+    OpClose = 7
+};
+constexpr uint64_t operationMask = 7;
+
+uint64_t userData(IoUringClient* client, Operation op) {
+    return reinterpret_cast<uint64_t>(client) | op;
+}
+}
+
+IoUring::IoUring(unsigned entries)
+    : ringFd(-1), enterFlags(0), enterFd(-1), deferTaskRun(true), ringMemory(MAP_FAILED), ringMemorySize(0),
+      sqes(static_cast<io_uring_sqe*>(MAP_FAILED)), sqesSize(0), sqeTail(0), submitted(0),
+      bufferMemory(nullptr), bufferCount(0), bufferSize(0), enters(0) {
+    // Очередь завершений вчетверо больше: multishot-операции дают много завершений на одну запись
+    io_uring_params params = {};
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+    params.cq_entries = entries * 4;
+    ringFd = ioUringSetup(entries, &params);
+    if (ringFd == -1 && errno == EINVAL) {
+        // Ядро до 6.1: задачи выполняются при любом возврате из системного вызова
+        deferTaskRun = false;
+        params = {};
+        params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL;
+        params.cq_entries = entries * 4;
+        ringFd = ioUringSetup(entries, &params);
+    }
+    if (ringFd == -1) {
+        throw ioUringError("setup failed");
+    }
+    enterFd = ringFd;
+
+    try {
+        unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+        if ((params.features & required) != required) {
+            errno = ENOTSUP;
+            throw ioUringError("kernel is too old");
+        }
+        // Multishot recv появился в 6.0 вместе с IORING_OP_SEND_ZC
+        io_uring_probe* probe = static_cast<io_uring_probe*>(calloc(1, sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op)));
+        bool probed = ioUringRegister(ringFd, IORING_REGISTER_PROBE, probe, 256) == 0;
+        bool supported = probed && probe->last_op >= IORING_OP_SEND_ZC &&
+                         (probe->ops[IORING_OP_SEND_ZC].flags & IO_URING_OP_SUPPORTED);
+        free(probe);
+        if (!supported) {
+            errno = ENOTSUP;
+            throw ioUringError("kernel is too old");
+        }
+
+        size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        size_t cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        ringMemorySize = std::max(sqSize, cqSize);
+        ringMemory = mmap(nullptr, ringMemorySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+        if (ringMemory == MAP_FAILED) {
+            throw ioUringError("mmap failed");
+        }
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) {
+            throw ioUringError("mmap failed");
+        }
+    } catch (...) {
+        if (ringMemory != MAP_FAILED) munmap(ringMemory, ringMemorySize);
+        close(ringFd);
+        throw;
+    }
+
+    char* base = static_cast<char*>(ringMemory);
+    sqHead = reinterpret_cast<const unsigned*>(base + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+    sqMask = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+    sqEntries = params.sq_entries;
+    unsigned* sqArray = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+    for (unsigned i = 0; i < sqEntries; ++i) sqArray[i] = i;
+    sqeTail = submitted = *sqTail;
+
+    cqHead = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+    cqTail = reinterpret_cast<const unsigned*>(base + params.cq_off.tail);
+    cqMask = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<const io_uring_cqe*>(base + params.cq_off.cqes);
+
+    // Зарегистрированный дескриптор кольца избавляет io_uring_enter от поиска файла (5.18+)
+    io_uring_rsrc_update update = {};
+    update.offset = static_cast<uint32_t>(-1);
+    update.data = static_cast<uint64_t>(ringFd);
+    if (ioUringRegister(ringFd, IORING_REGISTER_RING_FDS, &update, 1) == 1) {
+        enterFd = static_cast<int>(update.offset);
+        enterFlags = IORING_ENTER_REGISTERED_RING;
+    }
+}
+
+IoUring::~IoUring() {
+    if (bufferMemory) munmap(bufferMemory, size_t(bufferCount) * bufferSize);
+    munmap(sqes, sqesSize);
+    munmap(ringMemory, ringMemorySize);
+    close(ringFd);
+}
+
+io_uring_sqe* IoUring::nextSqe() {
+    if (sqeTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries) {
+        __atomic_store_n(sqTail, sqeTail, __ATOMIC_RELEASE);
+        enter(sqeTail - submitted, 0, 0, std::chrono::milliseconds(0));
+        submitted = sqeTail;
+    }
+    io_uring_sqe* sqe = &sqes[sqeTail & sqMask];
+    std::memset(sqe, 0, sizeof(*sqe));
+    ++sqeTail;
+    return sqe;
+}
+
+void IoUring::submitAndWait(std::chrono::milliseconds timeout) {
+    __atomic_store_n(sqTail, sqeTail, __ATOMIC_RELEASE);
+    enter(sqeTail - submitted, 1, IORING_ENTER_GETEVENTS, timeout);
+    submitted = sqeTail;
+}
+
+int IoUring::enter(unsigned toSubmit, unsigned minComplete, unsigned flags, std::chrono::milliseconds timeout) {
+    __kernel_timespec ts = {};
+    ts.tv_sec = timeout.count() / 1000;
+    ts.tv_nsec = (timeout.count() % 1000) * 1000000;
+    io_uring_getevents_arg arg = {};
+    arg.sigmask_sz = _NSIG / 8;
+    arg.ts = reinterpret_cast<uint64_t>(&ts);
+    enters.fetch_add(1, std::memory_order_relaxed);
+    int result = static_cast<int>(syscall(__NR_io_uring_enter, enterFd, toSubmit, minComplete,
+                                          flags | enterFlags | (minComplete ? IORING_ENTER_EXT_ARG : 0),
+                                          minComplete ? &arg : nullptr, minComplete ? sizeof(arg) : 0));
+    // ETIME - истёк таймаут, EINTR - сигнал, EBUSY - переполнена очередь завершений: всё это не ошибки цикла
+    return result;
+}
+
+void IoUring::registerFiles(const int* fds, unsigned count) {
+    if (ioUringRegister(ringFd, IORING_REGISTER_FILES, const_cast<int*>(fds), count) != 0) {
+        throw ioUringError("file registration failed");
+    }
+}
+
+void IoUring::setupBuffers(unsigned count, unsigned size) {
+    if (count == 0 || count > 65536 || size == 0) {
+        throw std::invalid_argument("io_uring: buffer count must be between 1 and 65536");
+    }
+    void* memory = mmap(nullptr, size_t(count) * size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        throw ioUringError("buffer allocation failed");
+    }
+    bufferMemory = static_cast<char*>(memory);
+    bufferCount = count;
+    bufferSize = size;
+
+    // Все буферы передаются ядру одной записью; она уйдёт с первым io_uring_enter
+    io_uring_sqe* sqe = nextSqe();
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = static_cast<int>(count);
+    sqe->addr = reinterpret_cast<uint64_t>(bufferMemory);
+    sqe->len = size;
+    sqe->off = 0;
+    sqe->buf_group = 0;
+    sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+}
+
+void IoUring::recycleBuffer(unsigned id) {
+    // Возврат буфера - запись без завершения (IOSQE_CQE_SKIP_SUCCESS), отдельного вызова не требует
+    io_uring_sqe* sqe = nextSqe();
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = 1;
+    sqe->addr = reinterpret_cast<uint64_t>(bufferMemory + size_t(id) * bufferSize);
+    sqe->len = bufferSize;
+    sqe->off = id;
+    sqe->buf_group = 0;
+    sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+}
+
+// Состояние соединения, которое видит только поток цикла
+struct IoUringClient {
+    Connection* conn;
+    int socket;
+    std::string staged;         // Данные, пришедшие, пока обрабатывается предыдущий запрос
+    size_t sent = 0;            // Отправленная часть writeBuffer
+    unsigned inflight = 0;      // Операции в ядре, ссылающиеся на клиента
+    bool recvArmed = false;
+    bool busy = false;          // Запрос в обработке или ответ отправляется
+    bool closeAfterSend = false;
+    bool peerClosed = false;
+    bool closing = false;       // Закрытие сокета поставлено в очередь
+    bool takingOver = false;    // Соединение уходит обычному пути
+    bool idle = false;
+    std::chrono::steady_clock::time_point idleSince;
+    IoUringClient* idlePrev = nullptr;
+    IoUringClient* idleNext = nullptr;
+
+    IoUringClient(Connection* conn, int socket) : conn(conn), socket(socket) {}
+};
+
+IoUringServer::IoUringServer(Callbacks callbacks, const IoUringOptions& options)
+    : callbacks(std::move(callbacks)), options(options),
+      wakeFd(eventfd(0, EFD_CLOEXEC)), wakeValue(0), wakePending(false), stopRequested(false),
+      acceptAddress{}, acceptAddressLength(sizeof(sockaddr_in)), acceptArmed(false), draining(false),
+      clientCount(0), ringEnters(0), idleHead(nullptr), idleTail(nullptr) {}
+
+IoUringServer::~IoUringServer() {
+    close(wakeFd);
+}
+
+bool IoUringServer::run(int listenSocket, const std::atomic<bool>& accepting, std::chrono::milliseconds idleTimeout,
+                        std::string& error) {
+    if (wakeFd == -1) {
+        error = "io_uring: eventfd failed";
+        return false;
+    }
+    try {
+        ring = std::make_unique<IoUring>(options.entries);
+        ring->registerFiles(&listenSocket, 1);
+        ring->setupBuffers(options.bufferCount, options.bufferSize);
+    } catch (const std::exception& e) {
+        ring.reset();
+        error = e.what();
+        return false;
+    }
+
+    armAccept();
+    armWake();
+    // Такт проверки простаивающих соединений, как у Reactor
+    const std::chrono::milliseconds tick(200);
+    std::vector<std::pair<Connection*, bool>> responses;
+    while (!stopRequested.load()) {
+        ring->submitAndWait(tick);
+        ringEnters.store(ring->enterCalls(), std::memory_order_relaxed);
+
+        // Адрес из общего для multishot accept буфера верен только для последнего принятого соединения,
+        // и только если ядро не выполняет accept между вызовами io_uring_enter
+        unsigned count = ring->ready();
+        unsigned lastAccept = count;
+        if (ring->deferredTaskRun()) {
+            for (unsigned i = 0; i < count; ++i) {
+                if (ring->completion(i).user_data == OpAccept) lastAccept = i;
+            }
+        }
+        for (unsigned i = 0; i < count; ++i) {
+            handleCompletion(ring->completion(i), i == lastAccept);
+        }
+        ring->consume(count);
+
+        {
+            std::lock_guard<std::mutex> lock(completedMutex);
+            responses.swap(completed);
+        }
+        for (auto& [conn, keepAlive] : responses) {
+            sendResponse(conn->uring, keepAlive);
+        }
+        responses.clear();
+
+        if (!accepting.load() && !draining) beginDrain();
+
+        auto deadline = std::chrono::steady_clock::now() - idleTimeout;
+        while (idleHead && idleHead->idleSince <= deadline) {
+            closeClient(idleHead);
+        }
+
+        if (draining && !acceptArmed && clientCount.load() == 0) break;
+    }
+    // При stop() незавершённые соединения остаются как есть: процесс завершается
+    ring.reset();
+    return true;
+}
+
+void IoUringServer::armAccept() {
+    io_uring_sqe* sqe = ring->nextSqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = 0; // Индекс слушающего сокета среди зарегистрированных файлов
+    sqe->flags = IOSQE_FIXED_FILE;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->addr = reinterpret_cast<uint64_t>(&acceptAddress);
+    sqe->addr2 = reinterpret_cast<uint64_t>(&acceptAddressLength);
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = OpAccept;
+    acceptArmed = true;
+}
+
+void IoUringServer::armWake() {
+    io_uring_sqe* sqe = ring->nextSqe();
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = wakeFd;
+    sqe->addr = reinterpret_cast<uint64_t>(&wakeValue);
+    sqe->len = sizeof(wakeValue);
+    sqe->user_data = OpWake;
+}
+
+void IoUringServer::armRecv(IoUringClient* client) {
+    io_uring_sqe* sqe = ring->nextSqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = client->socket;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->user_data = userData(client, OpRecv);
+    client->recvArmed = true;
+    ++client->inflight;
+}
+
+void IoUringServer::handleCompletion(const io_uring_cqe& cqe, bool lastAccept) {
+    IoUringClient* client = reinterpret_cast<IoUringClient*>(cqe.user_data & ~operationMask);
+    switch (cqe.user_data & operationMask) {
+    case OpAccept:
+        handleAccept(cqe, lastAccept);
+        return;
+    case OpWake:
+        wakePending.store(false);
+        if (!stopRequested.load()) armWake();
+        return;
+    case OpRecv:
+        handleRecv(client, cqe);
+        break;
+    case OpReadFile:
+        // Завершение приходит только при ошибке; связанная отправка будет отменена и закроет соединение
+        return;
+    case OpSend:
+        --client->inflight;
+        if (client->conn->responseFile != -1) {
+            // Файл статики прочитан (или чтение не удалось) - закрываем его без отдельного завершения
+            io_uring_sqe* sqe = ring->nextSqe();
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = client->conn->responseFile;
+            sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+            sqe->user_data = OpIgnore;
+            client->conn->responseFile = -1;
+        }
+        if (client->closing) break;
+        if (cqe.res < 0) {
+            closeClient(client);
+            break;
+        }
+        client->sent += static_cast<size_t>(cqe.res);
+        if (client->sent < client->conn->writeBuffer.size()) {
+            sendResponse(client, !client->closeAfterSend);
+        } else {
+            finishResponse(client);
+        }
+        break;
+    case OpCancel:
+        --client->inflight;
+        break;
+    case OpClose:
+        --client->inflight;
+        break;
+    default:
+        return;
+    }
+    releaseIfDone(client);
+}
+
+void IoUringServer::handleAccept(const io_uring_cqe& cqe, bool lastAccept) {
+    if (!(cqe.flags & IORING_CQE_F_MORE)) acceptArmed = false;
+    if (cqe.res >= 0) {
+        int socket = cqe.res;
+        sockaddr_in address = {};
+        if (lastAccept) {
+            address = acceptAddress;
+        } else {
+            socklen_t length = sizeof(address);
+            getpeername(socket, reinterpret_cast<sockaddr*>(&address), &length);
+        }
+        Connection* conn = callbacks.accept(socket, address);
+        if (conn) {
+            IoUringClient* client = new IoUringClient(conn, socket);
+            conn->uring = client;
+            clientCount.fetch_add(1);
+            markIdle(client);
+            armRecv(client);
+        }
+    }
+    if (!acceptArmed && !draining && cqe.res != -ECANCELED) armAccept();
+}
+
+void IoUringServer::handleRecv(IoUringClient* client, const io_uring_cqe& cqe) {
+    bool more = cqe.flags & IORING_CQE_F_MORE;
+    if (!more) {
+        client->recvArmed = false;
+        --client->inflight;
+    }
+    if (cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+        unsigned id = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+        std::string_view data = ring->buffer(id, static_cast<size_t>(cqe.res));
+        if (client->busy) {
+            client->staged.append(data);
+        } else {
+            client->conn->readBuffer.append(data);
+        }
+        ring->recycleBuffer(id);
+        if (!client->busy && !client->takingOver && !client->closing) {
+            markIdle(client);
+            processInput(client);
+        }
+    } else if (cqe.res == 0 || (cqe.res < 0 && cqe.res != -ENOBUFS && cqe.res != -ECANCELED)) {
+        client->peerClosed = true;
+        if (!client->busy && !client->takingOver) closeClient(client);
+    }
+    // Кончились буферы приёма (-ENOBUFS) или ядро завершило multishot по своим причинам
+    if (!client->recvArmed && !client->peerClosed && !client->closing && !client->takingOver) {
+        armRecv(client);
+    }
+}
+
+void IoUringServer::processInput(IoUringClient* client) {
+    Connection* conn = client->conn;
+    switch (callbacks.inspect(*conn)) {
+    case RequestState::Incomplete:
+        return;
+    case RequestState::Invalid:
+        closeClient(client);
+        return;
+    case RequestState::TakeOver:
+        client->takingOver = true;
+        unmarkIdle(client);
+        if (client->recvArmed) {
+            io_uring_sqe* sqe = ring->nextSqe();
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->addr = userData(client, OpRecv);
+            sqe->user_data = userData(client, OpCancel);
+            ++client->inflight;
+        }
+        return;
+    case RequestState::Ready:
+        client->busy = true;
+        unmarkIdle(client);
+        callbacks.dispatch(conn);
+        return;
+    }
+}
+
+void IoUringServer::complete(Connection* conn, bool keepAlive) {
+    {
+        std::lock_guard<std::mutex> lock(completedMutex);
+        completed.emplace_back(conn, keepAlive);
+    }
+    // Под нагрузкой один write будит цикл сразу для многих ответов
+    if (!wakePending.exchange(true)) {
+        wake();
+    }
+}
+
+void IoUringServer::wake() {
+    uint64_t one = 1;
+    ssize_t written = write(wakeFd, &one, sizeof(one));
+    (void)written;
+}
+
+void IoUringServer::stop() {
+    stopRequested.store(true);
+    wake();
+}
+
+void IoUringServer::sendResponse(IoUringClient* client, bool keepAlive) {
+    Connection* conn = client->conn;
+    if (client->peerClosed || draining) keepAlive = false;
+    client->closeAfterSend = !keepAlive;
+    if (conn->writeBuffer.size() == client->sent) {
+        finishResponse(client);
+        return;
+    }
+
+    // Содержимое файла статики дочитывается в конец writeBuffer; отправка выполняется только после полного чтения
+    bool readFile = conn->responseFile != -1;
+    if (readFile) {
+        io_uring_sqe* sqe = ring->nextSqe();
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = conn->responseFile;
+        sqe->addr = reinterpret_cast<uint64_t>(conn->writeBuffer.data() + conn->writeBuffer.size() - conn->responseFileSize);
+        sqe->len = static_cast<uint32_t>(conn->responseFileSize);
+        sqe->off = 0;
+        // Успешное чтение не даёт завершения: ответ на него - завершение отправки
+        sqe->flags = IOSQE_IO_LINK | IOSQE_CQE_SKIP_SUCCESS;
+        sqe->user_data = userData(client, OpReadFile);
+    }
+
+    io_uring_sqe* sqe = ring->nextSqe();
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = client->socket;
+    sqe->addr = reinterpret_cast<uint64_t>(conn->writeBuffer.data() + client->sent);
+    sqe->len = static_cast<uint32_t>(conn->writeBuffer.size() - client->sent);
+    // MSG_WAITALL: ядро досылает ответ само, завершение приходит один раз
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+    sqe->user_data = userData(client, OpSend);
+    ++client->inflight;
+
+    // Закрытие связывается с отправкой и выполняется в том же вызове io_uring_enter. После неполного
+    // чтения файла ядро отменило бы всю цепочку, поэтому ответ со статикой закрывается по завершении отправки
+    if (!keepAlive && !readFile) {
+        sqe->flags = IOSQE_IO_HARDLINK;
+        closeClient(client);
+    }
+}
+
+void IoUringServer::finishResponse(IoUringClient* client) {
+    Connection* conn = client->conn;
+    conn->writeBuffer.clear();
+    client->sent = 0;
+    client->busy = false;
+    if (client->closeAfterSend || client->peerClosed || draining) {
+        closeClient(client);
+        return;
+    }
+    // Конвейеризованный запрос мог прийти, пока обрабатывался предыдущий
+    if (!client->staged.empty()) {
+        conn->readBuffer.append(client->staged);
+        client->staged.clear();
+    }
+    markIdle(client);
+    if (conn->hasBufferedData()) processInput(client);
+}
+
+void IoUringServer::closeClient(IoUringClient* client) {
+    if (client->closing) return;
+    client->closing = true;
+    unmarkIdle(client);
+    // Multishot recv держит ссылку на сокет: без отмены close не освободил бы соединение
+    if (client->recvArmed) {
+        io_uring_sqe* sqe = ring->nextSqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = userData(client, OpRecv);
+        sqe->flags = IOSQE_IO_HARDLINK;
+        sqe->user_data = userData(client, OpCancel);
+        ++client->inflight;
+    }
+    io_uring_sqe* sqe = ring->nextSqe();
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = client->socket;
+    sqe->user_data = userData(client, OpClose);
+    ++client->inflight;
+}
+
+void IoUringServer::releaseIfDone(IoUringClient* client) {
+    if (client->inflight != 0) return;
+    Connection* conn = client->conn;
+    if (client->closing) {
+        conn->uring = nullptr;
+        conn->socket = -1;
+        if (conn->responseFile != -1) {
+            close(conn->responseFile);
+            conn->responseFile = -1;
+        }
+        callbacks.release(conn);
+    } else if (client->takingOver) {
+        conn->uring = nullptr;
+        callbacks.takeOver(conn);
+    } else {
+        return;
+    }
+    delete client;
+    clientCount.fetch_sub(1);
+}
+
+void IoUringServer::beginDrain() {
+    draining = true;
+    if (acceptArmed) {
+        io_uring_sqe* sqe = ring->nextSqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = OpAccept;
+        sqe->user_data = OpIgnore;
+    }
+    // Простаивающие соединения закрываются сразу, занятые - после ответа
+    while (idleHead) {
+        closeClient(idleHead);
+    }
+}
+
+void IoUringServer::markIdle(IoUringClient* client) {
+    unmarkIdle(client);
+    client->idleSince = std::chrono::steady_clock::now();
+    client->idlePrev = idleTail;
+    client->idleNext = nullptr;
+    if (idleTail) idleTail->idleNext = client; else idleHead = client;
+    idleTail = client;
+    client->idle = true;
+}
+
+void IoUringServer::unmarkIdle(IoUringClient* client) {
+    if (!client->idle) return;
+    if (client->idlePrev) client->idlePrev->idleNext = client->idleNext; else idleHead = client->idleNext;
+    if (client->idleNext) client->idleNext->idlePrev = client->idlePrev; else idleTail = client->idlePrev;
+    client->idlePrev = nullptr;
+    client->idleNext = nullptr;
+    client->idle = false;
+}
@@ -0,0 +1,523 @@
+#include "headers/Json.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+// Глубже рекурсивный разбор не спускается: защита стека от "[[[[..."
+constexpr size_t maxDepth = 512;
+
+[[noreturn]] void fail(const char* message, size_t pos) {
+    throw std::invalid_argument(std::string("JSON: ") + message + " at offset " + std::to_string(pos));
+}
+
+[[noreturn]] void typeError(const char* expected) {
+    throw std::runtime_error(std::string("JSON: value is not ") + expected);
+}
+
+bool isWhitespace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Первый символ строки, требующий внимания: кавычка, обратная косая черта или управляющий символ
+// (их же экранирует JsonWriter). Обычный текст проходится блоками по 16 байт
+size_t findStringSpecial(const char* data, size_t pos, size_t size) {
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    for (; pos + 16 <= size; pos += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        // Беззнаковое c <= 0x1F: max(c, 0x1F) == 0x1F (байты UTF-8 >= 0x80 не попадают)
+        __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash)),
+                                       _mm_cmpeq_epi8(_mm_max_epu8(block, control), control));
+        int mask = _mm_movemask_epi8(special);
+        if (mask) return pos + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+    }
+#endif
+    for (; pos < size; ++pos) {
+        unsigned char c = static_cast<unsigned char>(data[pos]);
+        if (c == '"' || c == '\\' || c < 0x20) return pos;
+    }
+    return size;
+}
+
+int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+unsigned parseHex4(const char* p) {
+    unsigned value = 0;
+    for (int i = 0; i < 4; ++i) value = value * 16 + static_cast<unsigned>(hexDigit(p[i]));
+    return value;
+}
+
+void appendUtf8(std::string& out, unsigned codePoint) {
+    if (codePoint < 0x80) {
+        out += static_cast<char>(codePoint);
+    } else if (codePoint < 0x800) {
+        out += static_cast<char>(0xC0 | (codePoint >> 6));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else if (codePoint < 0x10000) {
+        out += static_cast<char>(0xE0 | (codePoint >> 12));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (codePoint >> 18));
+        out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+}
+
+// Раскрывает escape-последовательности уже проверенной строки
+std::string unescape(std::string_view raw) {
+    std::string out;
+    out.reserve(raw.size());
+    size_t pos = 0;
+    while (pos < raw.size()) {
+        size_t backslash = raw.find('\\', pos);
+        if (backslash == std::string_view::npos) {
+            out.append(raw, pos);
+            break;
+        }
+        out.append(raw, pos, backslash - pos);
+        char e = raw[backslash + 1];
+        pos = backslash + 2;
+        switch (e) {
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u': {
+            unsigned codePoint = parseHex4(raw.data() + pos);
+            pos += 4;
+            if (codePoint >= 0xD800 && codePoint <= 0xDBFF) {
+                // Суррогатная пара; одиночная половина заменяется на U+FFFD
+                if (pos + 6 <= raw.size() && raw[pos] == '\\' && raw[pos + 1] == 'u') {
+                    unsigned low = parseHex4(raw.data() + pos + 2);
+                    if (low >= 0xDC00 && low <= 0xDFFF) {
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                        pos += 6;
+                    } else {
+                        codePoint = 0xFFFD;
+                    }
+                } else {
+                    codePoint = 0xFFFD;
+                }
+            } else if (codePoint >= 0xDC00 && codePoint <= 0xDFFF) {
+                codePoint = 0xFFFD;
+            }
+            appendUtf8(out, codePoint);
+            break;
+        }
+        default: out += e; break;   // " \ /
+        }
+    }
+    return out;
+}
+}
+
+void JsonDocument::parse(std::string_view source) {
+    text = source;
+    nodes.clear();
+    if (source.size() >= std::numeric_limits<uint32_t>::max()) {
+        throw std::invalid_argument("JSON: document is too large");
+    }
+    try {
+        size_t pos = skipWhitespace(parseValue(skipWhitespace(0), 0));
+        if (pos != text.size()) fail("unexpected data after the value", pos);
+    } catch (...) {
+        nodes.clear();
+        throw;
+    }
+}
+
+JsonValue JsonDocument::root() const {
+    if (nodes.empty()) throw std::runtime_error("JSON: document is empty");
+    return JsonValue(this, 0);
+}
+
+size_t JsonDocument::skipWhitespace(size_t pos) const {
+    // В компактном JSON пробелов почти нет: сначала проверяем один символ
+    if (pos >= text.size() || !isWhitespace(text[pos])) return pos;
+#if defined(__SSE2__)
+    // Отступы форматированного JSON пропускаются блоками по 16 байт
+    for (; pos + 16 <= text.size(); pos += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + pos));
+        __m128i space = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\n'))),
+                                     _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\t'))));
+        unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(space)) & 0xFFFF;
+        if (mask) return pos + static_cast<size_t>(__builtin_ctz(mask));
+    }
+#endif
+    while (pos < text.size() && isWhitespace(text[pos])) ++pos;
+    return pos;
+}
+
+size_t JsonDocument::parseValue(size_t pos, size_t depth) {
+    if (pos >= text.size()) fail("unexpected end of input", pos);
+    uint32_t index = static_cast<uint32_t>(nodes.size());
+    nodes.push_back(Node{static_cast<uint32_t>(pos), 0, 0, 0, JsonType::Null, 0});
+
+    char c = text[pos];
+    size_t end;
+    if (c == '{') {
+        end = parseObject(index, pos, depth);
+    } else if (c == '[') {
+        end = parseArray(index, pos, depth);
+    } else if (c == '"') {
+        end = parseString(index, pos);
+    } else if (c == '-' || isDigit(c)) {
+        end = parseNumber(index, pos);
+    } else if (text.compare(pos, 4, "true") == 0 || text.compare(pos, 5, "false") == 0) {
+        nodes[index].type = JsonType::Boolean;
+        end = pos + (c == 't' ? 4 : 5);
+    } else if (text.compare(pos, 4, "null") == 0) {
+        end = pos + 4;
+    } else {
+        fail("unexpected character", pos);
+    }
+    // Узлы могли переместиться при разборе вложенных значений - обращаемся по номеру
+    nodes[index].length = static_cast<uint32_t>(end - pos);
+    nodes[index].next = static_cast<uint32_t>(nodes.size());
+    return end;
+}
+
+size_t JsonDocument::parseObject(uint32_t index, size_t pos, size_t depth) {
+    if (depth >= maxDepth) fail("nesting is too deep", pos);
+    nodes[index].type = JsonType::Object;
+    pos = skipWhitespace(pos + 1);
+    if (pos < text.size() && text[pos] == '}') return pos + 1;
+
+    uint32_t count = 0;
+    while (true) {
+        if (pos >= text.size() || text[pos] != '"') fail("expected a string key", pos);
+        pos = skipWhitespace(parseValue(pos, depth + 1));
+        if (pos >= text.size() || text[pos] != ':') fail("expected ':'", pos);
+        uint32_t valueIndex = static_cast<uint32_t>(nodes.size());
+        pos = skipWhitespace(parseValue(skipWhitespace(pos + 1), depth + 1));
+        nodes[valueIndex].flags |= memberFlag;
+        ++count;
+        if (pos < text.size() && text[pos] == ',') {
+            pos = skipWhitespace(pos + 1);
+        } else if (pos < text.size() && text[pos] == '}') {
+            nodes[index].count = count;
+            return pos + 1;
+        } else {
+            fail("expected ',' or '}'", pos);
+        }
+    }
+}
+
+size_t JsonDocument::parseArray(uint32_t index, size_t pos, size_t depth) {
+    if (depth >= maxDepth) fail("nesting is too deep", pos);
+    nodes[index].type = JsonType::Array;
+    pos = skipWhitespace(pos + 1);
+    if (pos < text.size() && text[pos] == ']') return pos + 1;
+
+    uint32_t count = 0;
+    while (true) {
+        pos = skipWhitespace(parseValue(pos, depth + 1));
+        ++count;
+        if (pos < text.size() && text[pos] == ',') {
+            pos = skipWhitespace(pos + 1);
+        } else if (pos < text.size() && text[pos] == ']') {
+            nodes[index].count = count;
+            return pos + 1;
+        } else {
+            fail("expected ',' or ']'", pos);
+        }
+    }
+}
+
+size_t JsonDocument::parseString(uint32_t index, size_t pos) {
+    nodes[index].type = JsonType::String;
+    size_t i = pos + 1;
+    while (true) {
+        i = findStringSpecial(text.data(), i, text.size());
+        if (i >= text.size()) fail("unterminated string", pos);
+        char c = text[i];
+        if (c == '"') return i + 1;
+        if (c != '\\') fail("control character in string", i);
+
+        nodes[index].flags |= escapedFlag;
+        if (i + 1 >= text.size()) fail("unterminated string", pos);
+        switch (text[i + 1]) {
+        case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+            i += 2;
+            break;
+        case 'u':
+            if (i + 6 > text.size()) fail("unterminated string", pos);
+            for (size_t h = i + 2; h < i + 6; ++h) {
+                if (hexDigit(text[h]) < 0) fail("invalid \\u escape", i);
+            }
+            i += 6;
+            break;
+        default:
+            fail("invalid escape", i);
+        }
+    }
+}
+
+size_t JsonDocument::parseNumber(uint32_t index, size_t pos) {
+    nodes[index].type = JsonType::Number;
+    size_t i = pos;
+    bool integer = true;
+    if (text[i] == '-') ++i;
+    if (i >= text.size() || !isDigit(text[i])) fail("invalid number", pos);
+    if (text[i] == '0') {
+        ++i;
+    } else {
+        while (i < text.size() && isDigit(text[i])) ++i;
+    }
+    if (i < text.size() && text[i] == '.') {
+        integer = false;
+        ++i;
+        if (i >= text.size() || !isDigit(text[i])) fail("invalid number", pos);
+        while (i < text.size() && isDigit(text[i])) ++i;
+    }
+    if (i < text.size() && (text[i] == 'e' || text[i] == 'E')) {
+        integer = false;
+        ++i;
+        if (i < text.size() && (text[i] == '+' || text[i] == '-')) ++i;
+        if (i >= text.size() || !isDigit(text[i])) fail("invalid number", pos);
+        while (i < text.size() && isDigit(text[i])) ++i;
+    }
+    if (integer) nodes[index].flags |= integerFlag;
+    return i;
+}
+
+JsonType JsonValue::type() const {
+    if (!document) throw std::runtime_error("JSON: value does not exist");
+    return document->nodes[index].type;
+}
+
+bool JsonValue::asBool() const {
+    if (type() != JsonType::Boolean) typeError("a boolean");
+    return document->text[document->nodes[index].offset] == 't';
+}
+
+double JsonValue::asDouble() const {
+    if (type() != JsonType::Number) typeError("a number");
+    std::string_view text = raw();
+    double value = 0;
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (result.ec == std::errc::result_out_of_range) {
+        // Слишком большие по модулю числа - бесконечность, слишком малые - ноль, как у strtod
+        return std::strtod(std::string(text).c_str(), nullptr);
+    }
+    return value;
+}
+
+long long JsonValue::asInt() const {
+    if (type() != JsonType::Number || !(document->nodes[index].flags & JsonDocument::integerFlag)) typeError("an integer");
+    std::string_view text = raw();
+    long long value = 0;
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (result.ec != std::errc()) throw std::runtime_error("JSON: integer is out of range");
+    return value;
+}
+
+std::string_view JsonValue::rawString() const {
+    if (type() != JsonType::String) typeError("a string");
+    const JsonDocument::Node& node = document->nodes[index];
+    return document->text.substr(node.offset + 1, node.length - 2);
+}
+
+bool JsonValue::hasEscapes() const {
+    return type() == JsonType::String && (document->nodes[index].flags & JsonDocument::escapedFlag);
+}
+
+std::string JsonValue::asString() const {
+    std::string_view text = rawString();
+    return hasEscapes() ? unescape(text) : std::string(text);
+}
+
+size_t JsonValue::size() const {
+    JsonType t = type();
+    if (t != JsonType::Array && t != JsonType::Object) typeError("an array or an object");
+    return document->nodes[index].count;
+}
+
+JsonValue JsonValue::operator[](size_t position) const {
+    if (type() != JsonType::Array) typeError("an array");
+    if (position >= document->nodes[index].count) throw std::runtime_error("JSON: array index is out of range");
+    uint32_t child = index + 1;
+    for (size_t i = 0; i < position; ++i) child = document->nodes[child].next;
+    return JsonValue(document, child);
+}
+
+JsonValue JsonValue::operator[](std::string_view name) const {
+    JsonValue value = find(name);
+    if (!value.exists()) throw std::runtime_error("JSON: no field \"" + std::string(name) + "\"");
+    return value;
+}
+
+JsonValue JsonValue::find(std::string_view name) const {
+    if (type() != JsonType::Object) typeError("an object");
+    const auto& nodes = document->nodes;
+    uint32_t keyIndex = index + 1;
+    for (uint32_t i = 0; i < nodes[index].count; ++i) {
+        JsonValue keyValue(document, keyIndex);
+        // Ключи без escape-последовательностей сравниваются прямо в тексте
+        std::string_view keyText = keyValue.rawString();
+        if (keyValue.hasEscapes() ? unescape(keyText) == name : keyText == name) {
+            return JsonValue(document, keyIndex + 1);
+        }
+        keyIndex = nodes[keyIndex + 1].next;
+    }
+    return JsonValue();
+}
+
+std::string JsonValue::key() const {
+    if (!document || !(document->nodes[index].flags & JsonDocument::memberFlag)) {
+        throw std::runtime_error("JSON: value is not an object field");
+    }
+    return JsonValue(document, index - 1).asString();
+}
+
+JsonValue::Iterator JsonValue::begin() const {
+    JsonType t = type();
+    if (t != JsonType::Array && t != JsonType::Object) typeError("an array or an object");
+    return Iterator(document, index + 1, t == JsonType::Object);
+}
+
+JsonValue::Iterator JsonValue::end() const {
+    JsonType t = type();
+    if (t != JsonType::Array && t != JsonType::Object) typeError("an array or an object");
+    return Iterator(document, document->nodes[index].next, t == JsonType::Object);
+}
+
+std::string_view JsonValue::raw() const {
+    if (!document) throw std::runtime_error("JSON: value does not exist");
+    const JsonDocument::Node& node = document->nodes[index];
+    return document->text.substr(node.offset, node.length);
+}
+
+JsonValue JsonValue::Iterator::operator*() const {
+    return JsonValue(document, object ? position + 1 : position);
+}
+
+JsonValue::Iterator& JsonValue::Iterator::operator++() {
+    position = document->nodes[object ? position + 1 : position].next;
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginObject() {
+    separator();
+    out += '{';
+    needComma = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+    out += '}';
+    needComma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+    separator();
+    out += '[';
+    needComma = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+    out += ']';
+    needComma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::key(std::string_view name) {
+    separator();
+    writeString(name);
+    out += ':';
+    needComma = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(std::string_view text) {
+    separator();
+    writeString(text);
+    needComma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(bool flag) {
+    separator();
+    out += flag ? "true" : "false";
+    needComma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(double number) {
+    separator();
+    if (std::isfinite(number)) {
+        // Кратчайшая запись, из которой читается то же число
+        char buffer[32];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+        out.append(buffer, result.ptr);
+    } else {
+        out += "null";
+    }
+    needComma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(std::nullptr_t) {
+    separator();
+    out += "null";
+    needComma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::rawValue(std::string_view json) {
+    separator();
+    out += json;
+    needComma = true;
+    return *this;
+}
+
+void JsonWriter::writeString(std::string_view text) {
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    size_t pos = 0;
+    while (pos < text.size()) {
+        // Участки без спецсимволов копируются целиком
+        size_t special = findStringSpecial(text.data(), pos, text.size());
+        out.append(text.data() + pos, special - pos);
+        if (special == text.size()) break;
+        unsigned char c = static_cast<unsigned char>(text[special]);
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default: {
+            char escape[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+            out.append(escape, sizeof(escape));
+        }
+        }
+        pos = special + 1;
+    }
+    out += '"';
+}
@@ -0,0 +1,353 @@
+#include "headers/Metrics.h"
+#include <cmath>
+#include <cstdio>
+#include <array>
+#include <new>
+
+// Реализация LatencyHistogram
+
+LatencyHistogram::LatencyHistogram() : total(0), sum(0) {
+    for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t nanos) {
+    if (nanos < static_cast<uint64_t>(subBucketCount)) return static_cast<size_t>(nanos);
+    int msb = 63 - __builtin_clzll(nanos);
+    int shift = msb - subBucketBits;
+    if (shift > maxShift) return bucketCount - 1;
+    return static_cast<size_t>(shift + 1) * subBucketCount + ((nanos >> shift) & (subBucketCount - 1));
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t index) {
+    if (index < static_cast<size_t>(subBucketCount)) return index + 1;
+    int shift = static_cast<int>(index / subBucketCount) - 1;
+    uint64_t sub = index % subBucketCount;
+    return (static_cast<uint64_t>(subBucketCount) + sub + 1) << shift;
+}
+
+// Единственный писатель: обычные load/store вместо fetch_add, читатели видят согласованные значения счётчиков
+static inline void bump(std::atomic<uint64_t>& counter, uint64_t delta = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::record(uint64_t nanos) {
+    bump(buckets[bucketIndex(nanos)]);
+    bump(total);
+    bump(sum, nanos);
+}
+
+void LatencyHistogram::addTo(HistogramSnapshot& snapshot) const {
+    if (snapshot.counts.size() != bucketCount) {
+        snapshot.counts.assign(bucketCount, 0);
+    }
+    for (size_t i = 0; i < bucketCount; ++i) {
+        snapshot.counts[i] += buckets[i].load(std::memory_order_relaxed);
+    }
+    snapshot.count += total.load(std::memory_order_relaxed);
+    snapshot.sum += sum.load(std::memory_order_relaxed);
+}
+
+// Реализация HistogramSnapshot
+
+uint64_t HistogramSnapshot::quantile(double q) const {
+    uint64_t observed = 0;
+    for (uint64_t c : counts) observed += c;
+    if (observed == 0) return 0;
+
+    uint64_t target = static_cast<uint64_t>(std::ceil(q * observed));
+    if (target == 0) target = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= target) return LatencyHistogram::bucketUpperBound(i) - 1;
+    }
+    return max();
+}
+
+uint64_t HistogramSnapshot::countAtOrBelow(uint64_t limit) const {
+    uint64_t result = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        if (LatencyHistogram::bucketUpperBound(i) - 1 > limit) break;
+        result += counts[i];
+    }
+    return result;
+}
+
+uint64_t HistogramSnapshot::max() const {
+    for (size_t i = counts.size(); i > 0; --i) {
+        if (counts[i - 1]) return LatencyHistogram::bucketUpperBound(i - 1) - 1;
+    }
+    return 0;
+}
+
+// Шард метрик одного потока
+
+struct MetricsShard {
+    std::atomic<bool> inUse{true};
+
+    // Счётчики по маршрутам: классы статусов 1xx..5xx и «прочие»
+    std::atomic<uint64_t> routeRequests[Metrics::maxRoutes][6];
+    std::atomic<uint64_t> statusCounts[Metrics::maxStatus];
+    LatencyHistogram phases[static_cast<size_t>(MetricsPhase::Count)];
+
+    MetricsShard() {
+        for (auto& route : routeRequests) {
+            for (auto& counter : route) counter.store(0, std::memory_order_relaxed);
+        }
+        for (auto& counter : statusCounts) counter.store(0, std::memory_order_relaxed);
+    }
+};
+
+namespace {
+// Шарды, занятые текущим потоком. При завершении потока шарды помечаются свободными
+// и достаются новым потокам пула вместе с накопленными значениями
+struct ShardLease {
+    std::vector<std::pair<uint64_t, std::shared_ptr<MetricsShard>>> shards;
+
+    ~ShardLease() {
+        for (auto& entry : shards) {
+            entry.second->inUse.store(false);
+        }
+    }
+};
+
+thread_local ShardLease shardLease;
+thread_local uint64_t cachedMetricsId = 0;
+thread_local MetricsShard* cachedShard = nullptr;
+
+std::atomic<uint64_t> nextMetricsId{1};
+}
+
+// Реализация Metrics
+
+Metrics::Metrics() : id(nextMetricsId.fetch_add(1)) {
+    routeNames = {"static", "not_found", "other"};
+}
+
+Metrics::~Metrics() = default;
+
+size_t Metrics::registerRoute(const std::string& name) {
+    std::lock_guard<std::mutex> lock(routesMutex);
+    for (size_t i = 0; i < routeNames.size(); ++i) {
+        if (routeNames[i] == name) return i;
+    }
+    if (routeNames.size() >= maxRoutes) return otherRouteId;
+    routeNames.push_back(name);
+    return routeNames.size() - 1;
+}
+
+MetricsShard& Metrics::localShard() {
+    if (cachedMetricsId == id) return *cachedShard;
+
+    for (auto& entry : shardLease.shards) {
+        if (entry.first == id) {
+            cachedMetricsId = id;
+            cachedShard = entry.second.get();
+            return *cachedShard;
+        }
+    }
+
+    // Первое обращение потока: берём освободившийся шард или создаём новый
+    std::shared_ptr<MetricsShard> shard;
+    {
+        std::lock_guard<std::mutex> lock(shardsMutex);
+        for (size_t i = 0; i < shards.size(); ++i) {
+            // Шарды других процессов prefork не занимаем, даже если их потоки завершились
+            if (i < sharedCount && (i < leaseBegin || i >= leaseEnd)) continue;
+            bool expected = false;
+            if (shards[i]->inUse.compare_exchange_strong(expected, true)) {
+                shard = shards[i];
+                break;
+            }
+        }
+        if (!shard) {
+            // Свои общие шарды кончились: значения нового шарда увидит только этот процесс
+            shard = std::make_shared<MetricsShard>();
+            shards.push_back(shard);
+        }
+    }
+    shardLease.shards.emplace_back(id, shard);
+    cachedMetricsId = id;
+    cachedShard = shard.get();
+    return *cachedShard;
+}
+
+size_t Metrics::sharedShardsBytes(size_t count) {
+    return count * sizeof(MetricsShard);
+}
+
+void Metrics::initSharedShards(void* memory, size_t count) {
+    MetricsShard* first = static_cast<MetricsShard*>(memory);
+    for (size_t i = 0; i < count; ++i) {
+        new (first + i) MetricsShard();
+    }
+}
+
+void Metrics::useSharedShards(void* memory, size_t count, size_t leaseBegin, size_t leaseEnd) {
+    MetricsShard* first = static_cast<MetricsShard*>(memory);
+    std::vector<std::shared_ptr<MetricsShard>> region;
+    for (size_t i = 0; i < count; ++i) {
+        // Память принадлежит сегменту: шарды не удаляются вместе с Metrics
+        region.emplace_back(first + i, [](MetricsShard*) {});
+    }
+    // Шарды этого процесса могли остаться занятыми потоками упавшего предшественника с тем же номером;
+    // значения сохраняются, поэтому счётчики в /metrics не убывают после перезапуска
+    for (size_t i = leaseBegin; i < leaseEnd && i < count; ++i) {
+        first[i].inUse.store(false);
+    }
+    std::lock_guard<std::mutex> lock(shardsMutex);
+    shards.insert(shards.begin(), region.begin(), region.end());
+    sharedCount = count;
+    this->leaseBegin = leaseBegin;
+    this->leaseEnd = leaseEnd;
+}
+
+void Metrics::recordRequest(size_t routeId, int status) {
+    MetricsShard& shard = localShard();
+    if (routeId >= maxRoutes) routeId = otherRouteId;
+    size_t statusClass = (status >= 100 && status < 600) ? static_cast<size_t>(status / 100 - 1) : 5;
+    bump(shard.routeRequests[routeId][statusClass]);
+    if (status >= 0 && status < maxStatus) {
+        bump(shard.statusCounts[status]);
+    }
+}
+
+void Metrics::recordPhase(MetricsPhase phase, uint64_t nanos) {
+    localShard().phases[static_cast<size_t>(phase)].record(nanos);
+}
+
+HistogramSnapshot Metrics::phaseSnapshot(MetricsPhase phase) const {
+    HistogramSnapshot snapshot;
+    snapshot.counts.assign(LatencyHistogram::bucketCount, 0);
+    std::lock_guard<std::mutex> lock(shardsMutex);
+    for (const auto& shard : shards) {
+        shard->phases[static_cast<size_t>(phase)].addTo(snapshot);
+    }
+    return snapshot;
+}
+
+const char* Metrics::phaseName(MetricsPhase phase) {
+    switch (phase) {
+        case MetricsPhase::Parse: return "parse";
+        case MetricsPhase::Handler: return "handler";
+        case MetricsPhase::Render: return "render";
+        case MetricsPhase::Send: return "send";
+        default: return "unknown";
+    }
+}
+
+// Экранирование значения метки по правилам текстового формата Prometheus
+static std::string escapeLabel(const std::string& value) {
+    std::string result;
+    result.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\') result += "\\\\";
+        else if (c == '"') result += "\\\"";
+        else if (c == '\n') result += "\\n";
+        else result += c;
+    }
+    return result;
+}
+
+static std::string formatNumber(double value) {
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+    return buffer;
+}
+
+std::string Metrics::renderPrometheus(const std::vector<MetricsGauge>& gauges,
+                                     const std::vector<MetricsRouteSeries>& routeSeries) const {
+    // Суммируем счётчики всех шардов
+    std::vector<std::array<uint64_t, 6>> routeTotals(maxRoutes, std::array<uint64_t, 6>{});
+    std::vector<uint64_t> statusTotals(maxStatus, 0);
+    {
+        std::lock_guard<std::mutex> lock(shardsMutex);
+        for (const auto& shard : shards) {
+            for (size_t r = 0; r < maxRoutes; ++r) {
+                for (size_t c = 0; c < 6; ++c) {
+                    routeTotals[r][c] += shard->routeRequests[r][c].load(std::memory_order_relaxed);
+                }
+            }
+            for (int s = 0; s < maxStatus; ++s) {
+                statusTotals[s] += shard->statusCounts[s].load(std::memory_order_relaxed);
+            }
+        }
+    }
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(routesMutex);
+        names = routeNames;
+    }
+
+    std::string out;
+    out.reserve(16 * 1024);
+
+    static const char* statusClasses[6] = {"1xx", "2xx", "3xx", "4xx", "5xx", "other"};
+    out += "# HELP flaskcpp_http_requests_total Requests handled, by route and status class.\n";
+    out += "# TYPE flaskcpp_http_requests_total counter\n";
+    for (size_t r = 0; r < names.size(); ++r) {
+        for (size_t c = 0; c < 6; ++c) {
+            if (routeTotals[r][c] == 0) continue;
+            out += "flaskcpp_http_requests_total{route=\"" + escapeLabel(names[r]) + "\",code=\"" + statusClasses[c] + "\"} ";
+            out += std::to_string(routeTotals[r][c]) + "\n";
+        }
+    }
+
+    out += "# HELP flaskcpp_http_responses_total Responses sent, by HTTP status.\n";
+    out += "# TYPE flaskcpp_http_responses_total counter\n";
+    for (int s = 0; s < maxStatus; ++s) {
+        if (statusTotals[s] == 0) continue;
+        out += "flaskcpp_http_responses_total{status=\"" + std::to_string(s) + "\"} " + std::to_string(statusTotals[s]) + "\n";
+    }
+
+    // Гистограммы фаз: границы le в секундах
+    static const double bounds[] = {0.00001, 0.000025, 0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025,
+                                    0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+    out += "# HELP flaskcpp_request_phase_seconds Time spent in each request phase.\n";
+    out += "# TYPE flaskcpp_request_phase_seconds histogram\n";
+    std::vector<HistogramSnapshot> snapshots;
+    for (size_t p = 0; p < static_cast<size_t>(MetricsPhase::Count); ++p) {
+        MetricsPhase phase = static_cast<MetricsPhase>(p);
+        snapshots.push_back(phaseSnapshot(phase));
+        const HistogramSnapshot& snapshot = snapshots.back();
+        std::string label = std::string("phase=\"") + phaseName(phase) + "\"";
+        for (double bound : bounds) {
+            uint64_t limit = static_cast<uint64_t>(bound * 1e9);
+            out += "flaskcpp_request_phase_seconds_bucket{" + label + ",le=\"" + formatNumber(bound) + "\"} ";
+            out += std::to_string(snapshot.countAtOrBelow(limit)) + "\n";
+        }
+        out += "flaskcpp_request_phase_seconds_bucket{" + label + ",le=\"+Inf\"} " + std::to_string(snapshot.count) + "\n";
+        out += "flaskcpp_request_phase_seconds_sum{" + label + "} " + formatNumber(snapshot.sum / 1e9) + "\n";
+        out += "flaskcpp_request_phase_seconds_count{" + label + "} " + std::to_string(snapshot.count) + "\n";
+    }
+
+    // Квантили, посчитанные по полной HDR-гистограмме, точнее, чем по грубым корзинам le
+    out += "# HELP flaskcpp_request_phase_quantile_seconds Request phase latency quantiles since start.\n";
+    out += "# TYPE flaskcpp_request_phase_quantile_seconds gauge\n";
+    static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+    for (size_t p = 0; p < snapshots.size(); ++p) {
+        const char* name = phaseName(static_cast<MetricsPhase>(p));
+        for (double q : quantiles) {
+            out += std::string("flaskcpp_request_phase_quantile_seconds{phase=\"") + name + "\",quantile=\"" + formatNumber(q) + "\"} ";
+            out += formatNumber(snapshots[p].quantile(q) / 1e9) + "\n";
+        }
+    }
+
+    for (const auto& series : routeSeries) {
+        out += "# HELP " + series.name + " " + series.help + "\n";
+        out += "# TYPE " + series.name + " " + series.type + "\n";
+        for (size_t r = 0; r < names.size() && r < series.values.size(); ++r) {
+            if (series.values[r] == 0) continue;
+            out += series.name + "{route=\"" + escapeLabel(names[r]) + "\"} " + formatNumber(series.values[r]) + "\n";
+        }
+    }
+
+    for (const auto& gauge : gauges) {
+        out += "# HELP " + gauge.name + " " + gauge.help + "\n";
+        out += "# TYPE " + gauge.name + " " + gauge.type + "\n";
+        out += gauge.name + " " + formatNumber(gauge.value) + "\n";
+    }
+    return out;
+}
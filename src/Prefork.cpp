@@ -0,0 +1,366 @@
+#include "headers/Prefork.h"
+#include "headers/Metrics.h"
+#include "headers/SharedCache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace {
+const char preforkMagic[8] = {'F', 'C', 'P', 'F', 'O', 'R', 'K', '1'};
+const char* const workerVariable = "FLASKCPP_PREFORK_WORKER";
+
+// Обработчик, проживший меньше, считается упавшим при запуске: пауза перед следующим запуском растёт
+constexpr std::chrono::seconds startupWindow(1);
+constexpr std::chrono::milliseconds maxRestartDelay(5000);
+
+std::string describeExit(int status) {
+    if (WIFSIGNALED(status)) {
+        const char* name = strsignal(WTERMSIG(status));
+        return "killed by signal " + std::to_string(WTERMSIG(status)) + (name ? std::string(" (") + name + ")" : "");
+    }
+    return "exited with status " + std::to_string(WEXITSTATUS(status));
+}
+}
+
+struct PreforkSegment::Header {
+    char magic[8];
+    uint64_t workers;
+    uint64_t shardsPerWorker;
+    std::atomic<uint64_t> alive;
+    std::atomic<uint64_t> restarts;
+    char reserved[24];
+};
+
+PreforkSegment::PreforkSegment(size_t workers, size_t shardsPerWorker) : fd(-1), mapping(nullptr), mappingSize(0) {
+    static_assert(sizeof(Header) == 64, "prefork segment header must occupy one cache line");
+    if (workers == 0 || shardsPerWorker == 0) {
+        throw std::invalid_argument("prefork: workers and metrics shards per worker must be positive");
+    }
+    fd = memfd_create("flaskcpp-prefork", MFD_CLOEXEC);
+    if (fd == -1) {
+        throw std::runtime_error("prefork: memfd_create failed: " + std::string(std::strerror(errno)));
+    }
+    mappingSize = sizeof(Header) + Metrics::sharedShardsBytes(workers * shardsPerWorker);
+    if (ftruncate(fd, static_cast<off_t>(mappingSize)) == -1) {
+        close(fd);
+        throw std::runtime_error("prefork: cannot allocate " + std::to_string(mappingSize) + " bytes of shared memory");
+    }
+    map();
+    Header& h = header();
+    std::memcpy(h.magic, preforkMagic, sizeof(h.magic));
+    h.workers = workers;
+    h.shardsPerWorker = shardsPerWorker;
+    Metrics::initSharedShards(metricsShards(), workers * shardsPerWorker);
+}
+
+PreforkSegment::PreforkSegment(int fd) : fd(fd), mapping(nullptr), mappingSize(0) {
+    struct {
+        char magic[8];
+        uint64_t workers;
+        uint64_t shardsPerWorker;
+    } stored;
+    struct stat st;
+    if (fstat(fd, &st) == -1 || pread(fd, &stored, sizeof(stored), 0) != sizeof(stored) ||
+        std::memcmp(stored.magic, preforkMagic, sizeof(stored.magic)) != 0) {
+        close(fd);
+        throw std::runtime_error("prefork: descriptor " + std::to_string(fd) + " is not a prefork segment");
+    }
+    mappingSize = sizeof(Header) + Metrics::sharedShardsBytes(stored.workers * stored.shardsPerWorker);
+    if (static_cast<size_t>(st.st_size) != mappingSize) {
+        // Размер шарда зависит от сборки: главный процесс и обработчик должны быть одним исполняемым файлом
+        close(fd);
+        throw std::runtime_error("prefork: segment size does not match this build");
+    }
+    map();
+}
+
+PreforkSegment::~PreforkSegment() {
+    munmap(mapping, mappingSize);
+    close(fd);
+}
+
+void PreforkSegment::map() {
+    void* address = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) {
+        int error = errno;
+        close(fd);
+        throw std::runtime_error("prefork: mmap failed: " + std::string(std::strerror(error)));
+    }
+    mapping = static_cast<char*>(address);
+}
+
+PreforkSegment::Header& PreforkSegment::header() const {
+    return *reinterpret_cast<Header*>(mapping);
+}
+
+size_t PreforkSegment::workerCount() const {
+    return header().workers;
+}
+
+size_t PreforkSegment::shardsPerWorker() const {
+    return header().shardsPerWorker;
+}
+
+void* PreforkSegment::metricsShards() const {
+    return mapping + sizeof(Header);
+}
+
+size_t PreforkSegment::aliveWorkers() const {
+    return header().alive.load(std::memory_order_relaxed);
+}
+
+unsigned long long PreforkSegment::restartCount() const {
+    return header().restarts.load(std::memory_order_relaxed);
+}
+
+// Реализация PreforkWorker
+
+bool PreforkWorker::fromEnvironment(PreforkWorker& worker) {
+    const char* value = std::getenv(workerVariable);
+    if (!value) return false;
+    // index:listenSocket:segmentFd:cacheFd
+    long fields[4];
+    const char* pos = value;
+    for (size_t i = 0; i < 4; ++i) {
+        char* end = nullptr;
+        fields[i] = std::strtol(pos, &end, 10);
+        if (end == pos || (i < 3 ? *end != ':' : *end != '\0')) {
+            throw std::runtime_error(std::string("prefork: malformed ") + workerVariable + "=" + value);
+        }
+        pos = end + 1;
+    }
+    worker.index = static_cast<size_t>(fields[0]);
+    worker.listenSocket = static_cast<int>(fields[1]);
+    worker.segmentFd = static_cast<int>(fields[2]);
+    worker.cacheFd = static_cast<int>(fields[3]);
+    unsetenv(workerVariable);
+    // Дескрипторы больше не нужны следующему exec
+    fcntl(worker.listenSocket, F_SETFD, FD_CLOEXEC);
+    fcntl(worker.segmentFd, F_SETFD, FD_CLOEXEC);
+    if (worker.cacheFd != -1) fcntl(worker.cacheFd, F_SETFD, FD_CLOEXEC);
+    return true;
+}
+
+// Реализация PreforkMaster
+
+PreforkMaster::PreforkMaster(const PreforkOptions& options, int listenSocket, PreforkSegment& segment, SharedCache* cache,
+                             bool verbose)
+    : options(options), listenSocket(listenSocket), segment(segment), cache(cache), verbose(verbose),
+      workers(segment.workerCount()) {
+    // Аргументы командной строки читаются заранее: между fork и exec можно только асинхронно-безопасное
+    std::ifstream cmdline("/proc/self/cmdline", std::ios::binary);
+    std::string argument;
+    while (std::getline(cmdline, argument, '\0')) {
+        arguments.push_back(argument);
+    }
+    if (arguments.empty()) {
+        throw std::runtime_error("prefork: cannot read /proc/self/cmdline");
+    }
+    // Путь к файлу, а не /proc/self/exe: иначе обработчики в списке процессов назывались бы "exe"
+    char path[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    executable = length > 0 ? std::string(path, length) : "/proc/self/exe";
+
+    if (options.incomingCpu) {
+        openSteeringSockets();
+    }
+}
+
+PreforkMaster::~PreforkMaster() {
+    // Первый сокет - listenSocket, его закрывает владелец
+    for (size_t i = 1; i < workerSockets.size(); ++i) {
+        close(workerSockets[i]);
+    }
+}
+
+void PreforkMaster::openSteeringSockets() {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return;
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+    }
+    sockaddr_storage address;
+    socklen_t addressLength = sizeof(address);
+    if (cpus.empty() || getsockname(listenSocket, reinterpret_cast<sockaddr*>(&address), &addressLength) != 0) return;
+
+    // Сокеты живут в главном процессе: очередь соединений упавшего обработчика дождётся его перезапуска
+    std::vector<int> sockets = {listenSocket};
+    for (size_t i = 1; i < workers.size(); ++i) {
+        int fd = socket(address.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int on = 1;
+        if (fd == -1 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0 ||
+            setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0 ||
+            bind(fd, reinterpret_cast<sockaddr*>(&address), addressLength) != 0 || listen(fd, 100) != 0) {
+            std::cerr << "prefork: SO_INCOMING_CPU steering disabled: " << std::strerror(errno) << std::endl;
+            if (fd != -1) close(fd);
+            for (size_t j = 1; j < sockets.size(); ++j) close(sockets[j]);
+            return;
+        }
+        sockets.push_back(fd);
+    }
+    for (size_t i = 0; i < sockets.size(); ++i) {
+        int cpu = cpus[i % cpus.size()];
+        setsockopt(sockets[i], SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu));
+        workerCpus.push_back(cpu);
+    }
+    workerSockets = std::move(sockets);
+    if (verbose) {
+        std::cout << "Prefork: " << workerSockets.size() << " listening sockets steered by SO_INCOMING_CPU" << std::endl;
+    }
+}
+
+pid_t PreforkMaster::spawn(size_t index) {
+    std::vector<char*> argv;
+    for (auto& argument : arguments) argv.push_back(argument.data());
+    argv.push_back(nullptr);
+
+    int workerSocket = workerSockets.empty() ? listenSocket : workerSockets[index];
+    std::string workerValue = std::string(workerVariable) + "=" + std::to_string(index) + ":" + std::to_string(workerSocket) +
+                              ":" + std::to_string(segment.descriptor()) + ":" +
+                              std::to_string(cache ? cache->descriptor() : -1);
+    std::vector<char*> envp;
+    size_t prefixLength = std::strlen(workerVariable) + 1;
+    for (char** entry = environ; *entry; ++entry) {
+        if (std::strncmp(*entry, workerValue.c_str(), prefixLength) != 0) envp.push_back(*entry);
+    }
+    envp.push_back(workerValue.data());
+    envp.push_back(nullptr);
+
+    int inherited[3] = {workerSocket, segment.descriptor(), cache ? cache->descriptor() : -1};
+    // Привязка к ядру наследуется через exec всеми потоками обработчика
+    cpu_set_t affinity;
+    CPU_ZERO(&affinity);
+    if (!workerCpus.empty()) CPU_SET(workerCpus[index], &affinity);
+    pid_t parent = getpid();
+    pid_t pid = fork();
+    if (pid == 0) {
+        // Дочерний процесс: только асинхронно-безопасные вызовы до exec
+        for (int fd : inherited) {
+            if (fd != -1) fcntl(fd, F_SETFD, 0);
+        }
+        // Обработчик не переживает главный процесс
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        if (getppid() != parent) _exit(1);
+        if (!workerCpus.empty()) sched_setaffinity(0, sizeof(affinity), &affinity);
+        execve(executable.c_str(), argv.data(), envp.data());
+        _exit(127);
+    }
+    return pid;
+}
+
+void PreforkMaster::reap(bool restart) {
+    auto now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < workers.size(); ++i) {
+        Worker& worker = workers[i];
+        if (worker.pid <= 0) continue;
+        int status = 0;
+        pid_t result = waitpid(worker.pid, &status, WNOHANG);
+        if (result == 0 || (result == -1 && errno == EINTR)) continue;
+
+        pid_t dead = worker.pid;
+        worker.pid = 0;
+        segment.header().alive.fetch_sub(1, std::memory_order_relaxed);
+        // Ячейки кэша, которые процесс записывал в момент смерти, иначе остались бы занятыми навсегда.
+        // Шарды метрик освобождает новый обработчик с тем же номером, накопленные значения сохраняются
+        if (cache) cache->recover(dead);
+        if (!restart) continue;
+
+        if (now - worker.started < startupWindow) {
+            worker.delay = std::min(std::max(worker.delay * 2, options.restartDelay), maxRestartDelay);
+        } else {
+            worker.delay = options.restartDelay;
+        }
+        worker.restartAt = now + worker.delay;
+        segment.header().restarts.fetch_add(1, std::memory_order_relaxed);
+        std::cerr << "Prefork worker " << i << " (pid " << dead << ") " << describeExit(status) << "; restarting in "
+                  << worker.delay.count() << "ms" << std::endl;
+    }
+}
+
+void PreforkMaster::run(std::atomic<bool>& running, int wakeFd, std::chrono::milliseconds drainTimeout) {
+    size_t started = 0;
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].pid = spawn(i);
+        workers[i].started = std::chrono::steady_clock::now();
+        if (workers[i].pid > 0) {
+            segment.header().alive.fetch_add(1, std::memory_order_relaxed);
+            ++started;
+        } else {
+            workers[i].pid = 0;
+            workers[i].restartAt = workers[i].started + options.restartDelay;
+            std::cerr << "Prefork: fork failed: " << std::strerror(errno) << std::endl;
+        }
+    }
+    if (started == 0) {
+        throw std::runtime_error("prefork: no worker process could be started");
+    }
+    if (verbose) {
+        std::cout << "Prefork master " << getpid() << " started " << started << " worker(s)" << std::endl;
+    }
+
+    pollfd wake = {wakeFd, POLLIN, 0};
+    while (running.load()) {
+        if (poll(&wake, 1, 200) > 0 || !running.load()) break;
+        reap(true);
+        auto now = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < workers.size(); ++i) {
+            Worker& worker = workers[i];
+            if (worker.pid != 0 || now < worker.restartAt) continue;
+            worker.pid = spawn(i);
+            worker.started = now;
+            if (worker.pid > 0) {
+                segment.header().alive.fetch_add(1, std::memory_order_relaxed);
+                if (verbose) {
+                    std::cout << "Prefork worker " << i << " started with pid " << worker.pid << std::endl;
+                }
+            } else {
+                worker.pid = 0;
+                worker.restartAt = now + maxRestartDelay;
+                std::cerr << "Prefork: fork failed: " << std::strerror(errno) << std::endl;
+            }
+        }
+    }
+
+    // Остановка: обработчики дообслуживают принятые запросы так же, как одиночный процесс по SIGTERM
+    for (auto& worker : workers) {
+        if (worker.pid > 0) kill(worker.pid, SIGTERM);
+    }
+    auto deadline = std::chrono::steady_clock::now() + drainTimeout + std::chrono::seconds(1);
+    auto anyAlive = [this]() {
+        return std::any_of(workers.begin(), workers.end(), [](const Worker& worker) { return worker.pid > 0; });
+    };
+    while (true) {
+        reap(false);
+        if (!anyAlive() || std::chrono::steady_clock::now() >= deadline) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    for (auto& worker : workers) {
+        if (worker.pid <= 0) continue;
+        std::cerr << "Prefork worker pid " << worker.pid << " did not stop in time; killing" << std::endl;
+        kill(worker.pid, SIGKILL);
+        waitpid(worker.pid, nullptr, 0);
+        worker.pid = 0;
+        segment.header().alive.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,316 @@
+#include "headers/Profiler.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <sys/syscall.h>
+#include <vector>
+
+namespace {
+constexpr int maxFrames = 64;
+// Кольцо опрашивается раз в drainInterval: при 1000 Гц в нём успевает накопиться 100 выборок
+constexpr size_t ringCapacity = 256;
+constexpr std::chrono::milliseconds drainInterval(100);
+// Таблица потоков с открытой адресацией; степень двойки
+constexpr size_t threadTableSize = 1024;
+// Первые кадры стека в обработчике: сам обработчик и трамплин возврата из сигнала
+constexpr int skippedFrames = 2;
+
+struct Sample {
+    int depth;
+    void* frames[maxFrames];
+};
+
+// Выборки одного потока. Пишет только обработчик сигнала в этом потоке (SIGPROF не прерывает
+// собственный обработчик), читает только поток, который собирает профиль
+struct ThreadRing {
+    pid_t tid = 0;
+    std::string name;
+    timer_t timer{};
+    bool timerCreated = false;
+    std::atomic<uint64_t> head{0};
+    uint64_t tail = 0;
+    Sample samples[ringCapacity];
+};
+
+struct ThreadSlot {
+    std::atomic<pid_t> tid{0};
+    std::atomic<ThreadRing*> ring{nullptr};
+};
+
+// Профиль, который сейчас собирается: обработчик находит кольцо своего потока по tid
+struct ProfileSession {
+    ThreadSlot table[threadTableSize];
+    std::atomic<uint64_t> lost{0};
+};
+
+std::atomic<ProfileSession*> activeSession{nullptr};
+std::atomic<int> handlersRunning{0};
+std::mutex sessionMutex;
+std::once_flag handlerInstalled;
+
+pid_t currentThreadId() {
+    return static_cast<pid_t>(syscall(SYS_gettid));
+}
+
+size_t threadSlotIndex(pid_t tid) {
+    return (static_cast<uint32_t>(tid) * 2654435761u) & (threadTableSize - 1);
+}
+
+// Обработчик SIGPROF: только асинхронно-безопасные операции. backtrace обходит стек через libgcc,
+// которая загружается при первом вызове - поэтому конструктор профилировщика вызывает его заранее
+void onProfilingSignal(int, siginfo_t*, void*) {
+    int savedErrno = errno;
+    handlersRunning.fetch_add(1);
+    ProfileSession* session = activeSession.load();
+    if (session) {
+        pid_t tid = currentThreadId();
+        ThreadRing* ring = nullptr;
+        size_t index = threadSlotIndex(tid);
+        for (size_t i = 0; i < threadTableSize; ++i, index = (index + 1) & (threadTableSize - 1)) {
+            pid_t slotTid = session->table[index].tid.load(std::memory_order_acquire);
+            if (slotTid == 0) break;
+            if (slotTid == tid) {
+                ring = session->table[index].ring.load(std::memory_order_acquire);
+                break;
+            }
+        }
+        if (ring) {
+            void* frames[maxFrames + skippedFrames];
+            int depth = backtrace(frames, maxFrames + skippedFrames) - skippedFrames;
+            uint64_t head = ring->head.load(std::memory_order_relaxed);
+            Sample& sample = ring->samples[head % ringCapacity];
+            sample.depth = depth > 0 ? depth : 0;
+            if (depth > 0) std::memcpy(sample.frames, frames + skippedFrames, depth * sizeof(void*));
+            ring->head.store(head + 1, std::memory_order_release);
+        } else {
+            session->lost.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    handlersRunning.fetch_sub(1);
+    errno = savedErrno;
+}
+
+// Таймер процессорного времени потока tid. Часы чужого потока кодируются так же, как в pthread_getcpuclockid
+clockid_t threadCpuClock(pid_t tid) {
+    return static_cast<clockid_t>((~static_cast<unsigned>(tid) << 3) | 6);
+}
+
+std::string threadName(pid_t tid) {
+    std::ifstream comm("/proc/self/task/" + std::to_string(tid) + "/comm");
+    std::string name;
+    std::getline(comm, name);
+    return name.empty() ? "thread" : name;
+}
+
+std::vector<pid_t> listThreads() {
+    std::vector<pid_t> result;
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir) return result;
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] >= '0' && entry->d_name[0] <= '9') {
+            result.push_back(static_cast<pid_t>(std::atoi(entry->d_name)));
+        }
+    }
+    closedir(dir);
+    return result;
+}
+
+// Имя функции по адресу: символ из таблицы динамических символов (сервер собирается с -rdynamic),
+// иначе модуль и смещение, которые можно разрешить addr2line
+std::string symbolize(void* address, bool returnAddress) {
+    // Адрес возврата указывает на инструкцию после call, которая может принадлежать следующей функции
+    uintptr_t pc = reinterpret_cast<uintptr_t>(address) - (returnAddress ? 1 : 0);
+    char hex[32];
+    Dl_info info = {};
+    if (dladdr(reinterpret_cast<void*>(pc), &info) && info.dli_sname) {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        std::string name = (status == 0 && demangled) ? demangled : info.dli_sname;
+        std::free(demangled);
+        // ';' разделяет кадры свёрнутого стека
+        std::replace(name.begin(), name.end(), ';', ':');
+        return name;
+    }
+    if (info.dli_fname) {
+        std::string module = info.dli_fname;
+        size_t slash = module.rfind('/');
+        if (slash != std::string::npos) module.erase(0, slash + 1);
+        std::snprintf(hex, sizeof(hex), "+0x%lx", static_cast<unsigned long>(pc - reinterpret_cast<uintptr_t>(info.dli_fbase)));
+        return module + hex;
+    }
+    std::snprintf(hex, sizeof(hex), "0x%lx", static_cast<unsigned long>(pc));
+    return hex;
+}
+}
+
+SamplingProfiler::SamplingProfiler() : profiles(0), samples(0), dropped(0) {
+    void* warmup[1];
+    backtrace(warmup, 1);
+}
+
+bool SamplingProfiler::active() {
+    return activeSession.load() != nullptr;
+}
+
+std::string SamplingProfiler::profile(const ProfileOptions& options, const std::atomic<bool>& keepRunning) {
+    if (options.duration.count() <= 0 || options.frequency <= 0 || options.frequency > 1000) {
+        throw std::invalid_argument("profiler: duration must be positive and frequency within 1..1000 Hz");
+    }
+    std::unique_lock<std::mutex> sessionLock(sessionMutex, std::try_to_lock);
+    if (!sessionLock.owns_lock()) {
+        throw std::runtime_error("profiler: a profile is already being collected");
+    }
+
+    // Обработчик остаётся установленным и после профиля: сигнал, сгенерированный до удаления таймера,
+    // может прийти позже, а действие по умолчанию для SIGPROF завершает процесс
+    std::call_once(handlerInstalled, []() {
+        struct sigaction action = {};
+        action.sa_sigaction = onProfilingSignal;
+        action.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGPROF, &action, nullptr);
+    });
+
+    auto session = std::make_unique<ProfileSession>();
+    std::vector<std::unique_ptr<ThreadRing>> rings;
+    std::unordered_map<std::string, uint64_t> stacks;
+    size_t registered = 0;
+    long periodNanos = 1000000000L / options.frequency;
+    itimerspec interval = {{periodNanos / 1000000000L, periodNanos % 1000000000L},
+                           {periodNanos / 1000000000L, periodNanos % 1000000000L}};
+
+    // Новые потоки (пул растёт под нагрузкой) подключаются при каждом опросе
+    auto attachThreads = [&]() {
+        for (pid_t tid : listThreads()) {
+            size_t index = threadSlotIndex(tid);
+            bool known = false;
+            for (size_t i = 0; i < threadTableSize; ++i, index = (index + 1) & (threadTableSize - 1)) {
+                pid_t slotTid = session->table[index].tid.load(std::memory_order_relaxed);
+                if (slotTid == 0) break;
+                if (slotTid == tid) {
+                    known = true;
+                    break;
+                }
+            }
+            // Таблица заполняется не больше чем наполовину, чтобы поиск в обработчике оставался коротким
+            if (known || registered >= threadTableSize / 2) continue;
+
+            auto ring = std::make_unique<ThreadRing>();
+            ring->tid = tid;
+            ring->name = threadName(tid);
+            sigevent event = {};
+            event.sigev_notify = SIGEV_THREAD_ID;
+            event.sigev_signo = SIGPROF;
+            event._sigev_un._tid = tid;
+            session->table[index].ring.store(ring.get(), std::memory_order_release);
+            session->table[index].tid.store(tid, std::memory_order_release);
+            ++registered;
+            // Поток мог завершиться после чтения списка - тогда таймер не создаётся
+            if (timer_create(threadCpuClock(tid), &event, &ring->timer) == 0) {
+                ring->timerCreated = true;
+                timer_settime(ring->timer, 0, &interval, nullptr);
+            }
+            rings.push_back(std::move(ring));
+        }
+    };
+
+    auto drain = [&]() {
+        std::string key;
+        for (auto& ring : rings) {
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            if (head - ring->tail > ringCapacity) {
+                dropped.fetch_add(head - ring->tail - ringCapacity, std::memory_order_relaxed);
+                ring->tail = head - ringCapacity;
+            }
+            for (; ring->tail < head; ++ring->tail) {
+                const Sample& sample = ring->samples[ring->tail % ringCapacity];
+                key.assign(ring->name);
+                key.push_back('\0');
+                key.append(reinterpret_cast<const char*>(sample.frames),
+                           std::min(std::max(sample.depth, 0), maxFrames) * sizeof(void*));
+                // Выборку могли перезаписать, пока она копировалась
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (ring->head.load(std::memory_order_relaxed) - ring->tail > ringCapacity) {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                ++stacks[key];
+                samples.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    // Кольца освобождаются только после того, как ни один обработчик их больше не читает
+    auto stopSampling = [&]() {
+        for (auto& ring : rings) {
+            if (ring->timerCreated) timer_delete(ring->timer);
+        }
+        activeSession.store(nullptr);
+        while (handlersRunning.load() > 0) std::this_thread::yield();
+    };
+
+    activeSession.store(session.get());
+    auto deadline = std::chrono::steady_clock::now() + options.duration;
+    try {
+        attachThreads();
+        while (keepRunning.load() && std::chrono::steady_clock::now() < deadline) {
+            auto wait = std::min<std::chrono::steady_clock::duration>(drainInterval, deadline - std::chrono::steady_clock::now());
+            std::this_thread::sleep_for(wait);
+            drain();
+            attachThreads();
+        }
+    } catch (...) {
+        stopSampling();
+        throw;
+    }
+    stopSampling();
+    drain();
+    dropped.fetch_add(session->lost.load(), std::memory_order_relaxed);
+    profiles.fetch_add(1, std::memory_order_relaxed);
+
+    // Свёрнутые стеки: корень слева, частые первыми
+    std::vector<std::pair<const std::string*, uint64_t>> ordered;
+    ordered.reserve(stacks.size());
+    for (const auto& stack : stacks) ordered.emplace_back(&stack.first, stack.second);
+    std::sort(ordered.begin(), ordered.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+
+    std::unordered_map<void*, std::string> leafNames, callerNames;
+    std::string out;
+    for (const auto& [key, count] : ordered) {
+        size_t separator = key->find('\0');
+        size_t depth = (key->size() - separator - 1) / sizeof(void*);
+        std::vector<void*> frames(depth);
+        std::memcpy(frames.data(), key->data() + separator + 1, depth * sizeof(void*));
+
+        out.append(*key, 0, separator);
+        for (size_t i = depth; i > 0; --i) {
+            void* frame = frames[i - 1];
+            bool leaf = i == 1;
+            auto& names = leaf ? leafNames : callerNames;
+            auto it = names.find(frame);
+            if (it == names.end()) it = names.emplace(frame, symbolize(frame, !leaf)).first;
+            out += ';';
+            out += it->second;
+        }
+        out += ' ';
+        out += std::to_string(count);
+        out += '\n';
+    }
+    return out;
+}
@@ -0,0 +1,126 @@
+#include "headers/RateLimiter.h"
+
+#include <algorithm>
+
+namespace {
+// Заполнение шарда, после которого он перестраивается; цепочки проб при этом остаются короткими
+constexpr size_t maxLoadPercent = 70;
+
+// Финализатор splitmix64: перемешивает все биты, старшие выбирают шард, младшие - ячейку
+inline uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+size_t roundUpToPowerOfTwo(size_t value) {
+    size_t result = 16;
+    while (result < value) result <<= 1;
+    return result;
+}
+}
+
+RateLimiter::RateLimiter(size_t expectedKeys) : shards(new Shard[shardCount]) {
+    size_t perShard = roundUpToPowerOfTwo(expectedKeys / shardCount * 100 / maxLoadPercent + 1);
+    for (size_t i = 0; i < shardCount; ++i) {
+        shards[i].slots.resize(perShard);
+        shards[i].table.store(shards[i].slots.data(), std::memory_order_relaxed);
+        shards[i].mask.store(perShard - 1, std::memory_order_relaxed);
+    }
+}
+
+uint64_t RateLimiter::hashKey(std::string_view key, uint64_t scope) {
+    // FNV-1a по байтам ключа (IP-адреса короткие), затем перемешивание вместе с областью
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : key) {
+        hash = (hash ^ c) * 0x100000001b3ULL;
+    }
+    hash = mix(hash ^ mix(scope + 0x9e3779b97f4a7c15ULL));
+    return hash ? hash : 1;
+}
+
+bool RateLimiter::allowHash(uint64_t keyHash, const RateLimit& limit, Clock::time_point now, Clock::duration* retryAfter) {
+    if (keyHash == 0) keyHash = 1;
+    int64_t t = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+    int64_t interval = static_cast<int64_t>(1e9 / limit.requestsPerSecond);
+    int64_t tolerance = static_cast<int64_t>(interval * std::max(limit.burst, 1.0));
+
+    Shard& shard = shards[keyHash >> 58];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    while (true) {
+        size_t mask = shard.slots.size() - 1;
+        size_t index = keyHash & mask;
+        size_t reusable = SIZE_MAX;
+        Slot* slot = nullptr;
+        while (true) {
+            Slot& candidate = shard.slots[index];
+            if (candidate.key == keyHash) {
+                slot = &candidate;
+                break;
+            }
+            if (candidate.key == 0) break;
+            // Устаревшую запись можно занять, но сначала нужно убедиться, что ключа нет дальше по цепочке
+            if (reusable == SIZE_MAX && candidate.tat <= t) reusable = index;
+            index = (index + 1) & mask;
+        }
+
+        int64_t tat = slot ? std::max(slot->tat, t) : t;
+        int64_t newTat = tat + interval;
+        if (newTat - t > tolerance) {
+            if (retryAfter) *retryAfter = std::chrono::nanoseconds(newTat - tolerance - t);
+            return false;
+        }
+
+        if (!slot) {
+            if (reusable != SIZE_MAX) {
+                slot = &shard.slots[reusable];
+            } else {
+                if ((shard.used + 1) * 100 > shard.slots.size() * maxLoadPercent) {
+                    rehash(shard, t);
+                    continue;
+                }
+                slot = &shard.slots[index];
+                ++shard.used;
+            }
+            slot->key = keyHash;
+        }
+        slot->tat = newTat;
+        return true;
+    }
+}
+
+// Перестройка шарда: устаревшие записи отбрасываются, таблица растёт, только если живых записей много
+void RateLimiter::rehash(Shard& shard, int64_t now) {
+    size_t live = 0;
+    for (const Slot& slot : shard.slots) {
+        if (slot.key != 0 && slot.tat > now) ++live;
+    }
+    size_t capacity = shard.slots.size();
+    if ((live + 1) * 100 > capacity * maxLoadPercent / 2) capacity *= 2;
+
+    std::vector<Slot> slots(capacity);
+    size_t mask = capacity - 1;
+    for (const Slot& slot : shard.slots) {
+        if (slot.key == 0 || slot.tat <= now) continue;
+        size_t index = slot.key & mask;
+        while (slots[index].key != 0) index = (index + 1) & mask;
+        slots[index] = slot;
+    }
+    shard.slots.swap(slots);
+    shard.used = live;
+    shard.table.store(shard.slots.data(), std::memory_order_relaxed);
+    shard.mask.store(capacity - 1, std::memory_order_relaxed);
+}
+
+size_t RateLimiter::size() const {
+    size_t total = 0;
+    for (size_t i = 0; i < shardCount; ++i) {
+        std::lock_guard<std::mutex> lock(shards[i].mutex);
+        total += shards[i].used;
+    }
+    return total;
+}
@@ -0,0 +1,121 @@
+#include "headers/Reactor.h"
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <iostream>
+#include <vector>
+
+Reactor::Reactor(Callback onReady, Callback onExpire, std::chrono::milliseconds idleTimeout)
+    : onReady(std::move(onReady)), onExpire(std::move(onExpire)), idleTimeout(idleTimeout),
+      epollFd(-1), running(false), idleHead(nullptr), idleTail(nullptr), idleConnections(0) {}
+
+Reactor::~Reactor() {
+    stop();
+}
+
+void Reactor::start() {
+    if (running.load()) return;
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd == -1) {
+        std::cerr << "Reactor: epoll_create1 failed." << std::endl;
+        return;
+    }
+    running.store(true);
+    loopThread = std::thread(&Reactor::loop, this);
+}
+
+void Reactor::stop() {
+    bool expected = true;
+    if (!running.compare_exchange_strong(expected, false)) return;
+
+    if (loopThread.joinable()) {
+        loopThread.join();
+    }
+
+    // Закрываем все оставшиеся припаркованные соединения
+    std::vector<Connection*> remaining;
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        while (idleHead) {
+            Connection* conn = idleHead;
+            unlink(conn);
+            remaining.push_back(conn);
+        }
+    }
+    for (Connection* conn : remaining) {
+        onExpire(conn);
+    }
+
+    close(epollFd);
+    epollFd = -1;
+}
+
+bool Reactor::watch(Connection* conn) {
+    if (!running.load()) return false;
+
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        conn->idleSince = std::chrono::steady_clock::now();
+        conn->idlePrev = idleTail;
+        conn->idleNext = nullptr;
+        if (idleTail) idleTail->idleNext = conn; else idleHead = conn;
+        idleTail = conn;
+        conn->parked = true;
+        idleConnections.fetch_add(1);
+    }
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+    ev.data.ptr = conn;
+    int op = conn->reactorRegistered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if (epoll_ctl(epollFd, op, conn->socket, &ev) == -1) {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        unlink(conn);
+        return false;
+    }
+    conn->reactorRegistered = true;
+    return true;
+}
+
+void Reactor::unlink(Connection* conn) {
+    if (!conn->parked) return;
+    if (conn->idlePrev) conn->idlePrev->idleNext = conn->idleNext; else idleHead = conn->idleNext;
+    if (conn->idleNext) conn->idleNext->idlePrev = conn->idlePrev; else idleTail = conn->idlePrev;
+    conn->idlePrev = nullptr;
+    conn->idleNext = nullptr;
+    conn->parked = false;
+    idleConnections.fetch_sub(1);
+}
+
+void Reactor::loop() {
+    constexpr int maxEvents = 256;
+    epoll_event events[maxEvents];
+    std::vector<Connection*> ready;
+    std::vector<Connection*> expired;
+
+    while (running.load()) {
+        // Короткий таймаут, чтобы вовремя замечать остановку и истёкшие соединения
+        int n = epoll_wait(epollFd, events, maxEvents, 200);
+
+        ready.clear();
+        expired.clear();
+        {
+            std::lock_guard<std::mutex> lock(idleMutex);
+            for (int i = 0; i < n; ++i) {
+                Connection* conn = static_cast<Connection*>(events[i].data.ptr);
+                if (!conn->parked) continue;
+                unlink(conn);
+                ready.push_back(conn);
+            }
+
+            auto deadline = std::chrono::steady_clock::now() - idleTimeout;
+            while (idleHead && idleHead->idleSince <= deadline) {
+                Connection* conn = idleHead;
+                unlink(conn);
+                expired.push_back(conn);
+            }
+        }
+
+        for (Connection* conn : ready) onReady(conn);
+        for (Connection* conn : expired) onExpire(conn);
+    }
+}
@@ -0,0 +1,194 @@
+#include "headers/RequestData.h"
+#include "headers/StringUtils.h"
+#include <iterator>
+#include <limits>
+
+namespace {
+// Имена в порядке KnownHeader
+constexpr std::string_view knownHeaderNames[] = {
+    "Host", "Connection", "Content-Type", "Content-Length", "Transfer-Encoding", "Cookie", "Accept",
+    "Accept-Encoding", "Upgrade", "User-Agent", "Referer", "Authorization", "Origin", "If-None-Match",
+    "X-Forwarded-For", "HTTP2-Settings", "Sec-WebSocket-Key", "Sec-WebSocket-Version",
+};
+static_assert(std::size(knownHeaderNames) == static_cast<size_t>(KnownHeader::Count), "knownHeaderNames не совпадает с KnownHeader");
+
+constexpr size_t knownHeaderTableSize = 64;
+
+// Хэш не зависит от регистра: у букв отличается только бит 0x20
+constexpr size_t headerNameHash(std::string_view name) {
+    return (name.size() + 5 * (static_cast<unsigned char>(name.back()) | 0x20)) & (knownHeaderTableSize - 1);
+}
+
+struct KnownHeaderTable {
+    int8_t slots[knownHeaderTableSize];
+    bool perfect;
+};
+
+constexpr KnownHeaderTable buildKnownHeaderTable() {
+    KnownHeaderTable table{};
+    table.perfect = true;
+    for (auto& slot : table.slots) slot = -1;
+    for (size_t i = 0; i < std::size(knownHeaderNames); ++i) {
+        size_t hash = headerNameHash(knownHeaderNames[i]);
+        if (table.slots[hash] >= 0) table.perfect = false;
+        table.slots[hash] = static_cast<int8_t>(i);
+    }
+    return table;
+}
+
+constexpr KnownHeaderTable knownHeaderTable = buildKnownHeaderTable();
+static_assert(knownHeaderTable.perfect, "Имена известных заголовков дают коллизию хэша: поменяйте headerNameHash");
+
+// Номер ячейки известного заголовка или -1: хэш выбирает единственного кандидата, имя сверяется целиком
+int knownHeaderIndex(std::string_view name) {
+    if (name.empty()) return -1;
+    int index = knownHeaderTable.slots[headerNameHash(name)];
+    if (index < 0 || !equalsIgnoreCase(name, knownHeaderNames[index])) return -1;
+    return index;
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+}
+
+void parseQueryString(std::string_view queryString, std::map<std::string, std::string>& params, MapNodeCache& nodeCache) {
+    size_t pos = 0;
+    while (pos < queryString.size()) {
+        size_t ampPos = queryString.find('&', pos);
+        if (ampPos == std::string_view::npos) ampPos = queryString.size();
+        std::string_view pair = queryString.substr(pos, ampPos - pos);
+        pos = ampPos + 1;
+        if (pair.empty()) continue;
+
+        size_t equalSignPos = pair.find('=');
+        std::string_view key = pair;
+        std::string_view value;
+        if (equalSignPos != std::string_view::npos) {
+            key = pair.substr(0, equalSignPos);
+            value = pair.substr(equalSignPos + 1);
+        }
+        urlDecode(value, nodeCache.emplace(params, key));
+    }
+}
+
+void parseCookies(std::string_view cookieHeader, std::map<std::string, std::string>& cookies, MapNodeCache& nodeCache) {
+    size_t pos = 0;
+    while (pos < cookieHeader.size()) {
+        size_t semicolonPos = cookieHeader.find(';', pos);
+        if (semicolonPos == std::string_view::npos) semicolonPos = cookieHeader.size();
+        std::string_view pair = cookieHeader.substr(pos, semicolonPos - pos);
+        pos = semicolonPos + 1;
+
+        size_t equalPos = pair.find('=');
+        if (equalPos != std::string_view::npos) {
+            std::string_view key = pair.substr(0, equalPos);
+            // Удаляем пробелы в начале ключа
+            while (!key.empty() && key.front() == ' ') key.remove_prefix(1);
+            urlDecode(pair.substr(equalPos + 1), nodeCache.emplace(cookies, key));
+        }
+    }
+}
+
+void urlDecode(std::string_view value, std::string& result) {
+    result.clear();
+    result.reserve(value.size());
+    for (size_t i = 0; i < value.size(); ++i) {
+        if (value[i] == '%' && i + 2 < value.size() && hexValue(value[i + 1]) >= 0 && hexValue(value[i + 2]) >= 0) {
+            result += static_cast<char>(hexValue(value[i + 1]) * 16 + hexValue(value[i + 2]));
+            i += 2;
+        } else if (value[i] == '+') {
+            result += ' ';
+        } else {
+            result += value[i];
+        }
+    }
+}
+
+void RequestData::setHeaders(std::string_view lines) {
+    // Один проход: ищем конец заголовков и запоминаем ячейки известных; смещения внутри lines
+    // совпадают со смещениями в headerBlock, который затем получает копию этих строк
+    knownHeaders.fill(HeaderSlot());
+    size_t pos = 0;
+    size_t blockEnd = lines.size();
+    while (pos < lines.size()) {
+        size_t lineEnd = lines.find('\n', pos);
+        if (lineEnd == std::string_view::npos) lineEnd = lines.size();
+        std::string_view line = lines.substr(pos, lineEnd - pos);
+        size_t lineStart = pos;
+        pos = lineEnd + 1;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty()) {
+            blockEnd = lineStart;
+            break;
+        }
+
+        size_t colonPos = line.find(':');
+        if (colonPos == std::string_view::npos) continue;
+        int index = knownHeaderIndex(line.substr(0, colonPos));
+        if (index < 0) continue;
+        size_t valueStart = colonPos + 1;
+        while (valueStart < line.size() && (line[valueStart] == ' ' || line[valueStart] == '\t')) ++valueStart;
+        if (lineStart + line.size() > std::numeric_limits<uint32_t>::max()) continue;
+        knownHeaders[index].offset = static_cast<uint32_t>(lineStart + valueStart);
+        knownHeaders[index].length = static_cast<uint32_t>(line.size() - valueStart);
+    }
+    headerBlock.assign(lines.data(), blockEnd);
+}
+
+std::string_view RequestData::header(std::string_view name) const {
+    int index = knownHeaderIndex(name);
+    if (index >= 0) return header(static_cast<KnownHeader>(index));
+
+    std::string_view result;
+    forEachHeader([&](std::string_view headerName, std::string_view value) {
+        if (equalsIgnoreCase(headerName, name)) result = value;
+    });
+    return result;
+}
+
+const std::map<std::string, std::string>& RequestData::queryParams() const {
+    if (!(parsedFields & queryParsed)) {
+        parseQueryString(queryString, queryValues, nodeCache);
+        parsedFields |= queryParsed;
+    }
+    return queryValues;
+}
+
+const std::map<std::string, std::string>& RequestData::formData() const {
+    if (!(parsedFields & formParsed)) {
+        if (method == "POST" && containsIgnoreCase(header(KnownHeader::ContentType), "application/x-www-form-urlencoded")) {
+            parseQueryString(body, formValues, nodeCache);
+        }
+        parsedFields |= formParsed;
+    }
+    return formValues;
+}
+
+const std::map<std::string, std::string>& RequestData::cookies() const {
+    if (!(parsedFields & cookiesParsed)) {
+        parseCookies(header(KnownHeader::Cookie), cookieValues, nodeCache);
+        parsedFields |= cookiesParsed;
+    }
+    return cookieValues;
+}
+
+void RequestData::clear() {
+    method.clear();
+    path.clear();
+    queryString.clear();
+    nodeCache.recycle(routeParams);
+    headerBlock.clear();
+    knownHeaders.fill(HeaderSlot());
+    body.clear();
+    arena = nullptr;
+    session = nullptr;
+    parsedFields = 0;
+    nodeCache.recycle(queryValues);
+    nodeCache.recycle(formValues);
+    nodeCache.recycle(cookieValues);
+    jsonParsed = false;
+}
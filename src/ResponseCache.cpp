@@ -0,0 +1,213 @@
+#include "headers/ResponseCache.h"
+#include "headers/SharedCache.h"
+#include "headers/StringUtils.h"
+#include <cctype>
+#include <string_view>
+
+namespace {
+std::string_view trim(std::string_view value) {
+    while (!value.empty() && std::isspace((unsigned char)value.front())) value.remove_prefix(1);
+    while (!value.empty() && std::isspace((unsigned char)value.back())) value.remove_suffix(1);
+    return value;
+}
+}
+
+ResponseCache::ResponseCache(size_t maxBytes)
+    : maxBytes(maxBytes), usedBytes(0), hits(0), misses(0), coalesced(0), sharedHits(0) {}
+
+ResponseCache::Entry ResponseCache::fetch(const std::string& key, const CacheOptions& options,
+                                          const std::function<std::string()>& produce, std::string& response) {
+    std::shared_ptr<Pending> leader;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (Entry entry = lookupLocked(key)) {
+            hits.fetch_add(1, std::memory_order_relaxed);
+            return entry;
+        }
+        auto it = pending.find(key);
+        if (it != pending.end()) {
+            // Ответ уже формируется другим запросом - ждём его вместо повторного вызова хендлера
+            std::shared_ptr<Pending> other = it->second;
+            coalesced.fetch_add(1, std::memory_order_relaxed);
+            other->done.wait(lock, [&other]() { return other->finished; });
+            if (other->entry) return other->entry;
+            // Ответ оказался некэшируемым: у каждого запроса он свой
+        } else {
+            leader = std::make_shared<Pending>();
+            pending.emplace(key, leader);
+        }
+        misses.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (!leader) {
+        response = produce();
+        return nullptr;
+    }
+
+    Entry entry;
+    try {
+        // Ответ мог сформировать другой процесс: он хранит вариант keep-alive и оставшийся срок жизни
+        std::chrono::milliseconds remaining(0);
+        if (shared && options.ttl.count() > 0 && shared->get(key, response, &remaining) && remaining.count() > 0) {
+            entry = makeEntry(std::move(response), remaining);
+            sharedHits.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            response = produce();
+            if (isCacheable(response, options)) {
+                entry = makeEntry(std::move(response), options.ttl);
+                if (shared && options.ttl.count() > 0) shared->put(key, entry->keepAlive, options.ttl);
+            }
+        }
+    } catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            leader->finished = true;
+            pending.erase(key);
+        }
+        leader->done.notify_all();
+        throw;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (entry && options.ttl.count() > 0 && entry->size + key.size() <= maxBytes) {
+            insertLocked(key, entry);
+        }
+        leader->finished = true;
+        leader->entry = entry;
+        pending.erase(key);
+    }
+    leader->done.notify_all();
+    return entry;
+}
+
+void ResponseCache::setMaxBytes(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    maxBytes = bytes;
+    evictLocked();
+}
+
+void ResponseCache::setSharedCache(std::shared_ptr<SharedCache> cache) {
+    std::lock_guard<std::mutex> lock(mutex);
+    shared = std::move(cache);
+}
+
+void ResponseCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    lru.clear();
+    usedBytes = 0;
+}
+
+size_t ResponseCache::sizeBytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return usedBytes;
+}
+
+size_t ResponseCache::entryCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+bool ResponseCache::isCacheable(const std::string& response, const CacheOptions& options) {
+    size_t headEnd = response.find("\r\n\r\n");
+    if (headEnd == std::string::npos) return false;
+    std::string_view head(response.data(), headEnd);
+
+    size_t lineEnd = head.find("\r\n");
+    std::string_view statusLine = head.substr(0, lineEnd);
+    if (statusLine.size() < 12 || statusLine.compare(0, 5, "HTTP/") != 0 || statusLine.compare(9, 3, "200") != 0) {
+        return false;
+    }
+
+    size_t pos = lineEnd == std::string_view::npos ? head.size() : lineEnd + 2;
+    while (pos < head.size()) {
+        size_t next = head.find("\r\n", pos);
+        if (next == std::string_view::npos) next = head.size();
+        std::string_view line = head.substr(pos, next - pos);
+        pos = next + 2;
+        size_t colonPos = line.find(':');
+        if (colonPos == std::string_view::npos) continue;
+        std::string_view name = line.substr(0, colonPos);
+        std::string_view value = line.substr(colonPos + 1);
+
+        // Ответ с cookie принадлежит конкретному клиенту
+        if (equalsIgnoreCase(name, "Set-Cookie")) return false;
+        if (equalsIgnoreCase(name, "Cache-Control") &&
+            (containsIgnoreCase(value, "no-store") || containsIgnoreCase(value, "private") || containsIgnoreCase(value, "no-cache"))) {
+            return false;
+        }
+        // Ответ зависит от заголовка, которого нет в ключе - хранить его под общим ключом нельзя
+        if (equalsIgnoreCase(name, "Vary")) {
+            size_t start = 0;
+            while (start <= value.size()) {
+                size_t comma = value.find(',', start);
+                if (comma == std::string_view::npos) comma = value.size();
+                std::string_view varyName = trim(value.substr(start, comma - start));
+                start = comma + 1;
+                if (varyName.empty()) continue;
+                bool known = equalsIgnoreCase(varyName, "Accept-Encoding");
+                for (const auto& header : options.varyHeaders) {
+                    if (equalsIgnoreCase(header, varyName)) known = true;
+                }
+                if (!known) return false;
+            }
+        }
+    }
+    return true;
+}
+
+ResponseCache::Entry ResponseCache::lookupLocked(const std::string& key) {
+    auto it = entries.find(key);
+    if (it == entries.end()) return nullptr;
+    if (it->second.entry->expires <= std::chrono::steady_clock::now()) {
+        eraseLocked(it);
+        return nullptr;
+    }
+    lru.splice(lru.begin(), lru, it->second.lruPosition);
+    return it->second.entry;
+}
+
+void ResponseCache::insertLocked(const std::string& key, Entry entry) {
+    auto it = entries.find(key);
+    if (it != entries.end()) eraseLocked(it);
+    lru.push_front(key);
+    usedBytes += entry->size + key.size();
+    entries.emplace(key, Slot{std::move(entry), lru.begin()});
+    evictLocked();
+}
+
+void ResponseCache::eraseLocked(std::unordered_map<std::string, Slot>::iterator it) {
+    usedBytes -= it->second.entry->size + it->first.size();
+    lru.erase(it->second.lruPosition);
+    entries.erase(it);
+}
+
+void ResponseCache::evictLocked() {
+    while (usedBytes > maxBytes && !lru.empty()) {
+        eraseLocked(entries.find(lru.back()));
+    }
+}
+
+ResponseCache::Entry ResponseCache::makeEntry(std::string response, std::chrono::milliseconds ttl) {
+    auto entry = std::make_shared<CachedResponse>();
+    entry->expires = std::chrono::steady_clock::now() + ttl;
+
+    // Меняем только значение заголовка Connection, остальной ответ общий для всех клиентов
+    static const std::string_view connectionHeader = "\r\nConnection: ";
+    size_t headEnd = response.find("\r\n\r\n");
+    size_t valueStart = response.find(connectionHeader);
+    if (valueStart != std::string::npos && valueStart < headEnd) {
+        valueStart += connectionHeader.size();
+        size_t valueEnd = response.find("\r\n", valueStart);
+        entry->keepAlive.reserve(response.size() + 10);
+        entry->keepAlive.append(response, 0, valueStart).append("keep-alive").append(response, valueEnd, std::string::npos);
+        entry->close.reserve(response.size() + 5);
+        entry->close.append(response, 0, valueStart).append("close").append(response, valueEnd, std::string::npos);
+    } else {
+        entry->keepAlive = response;
+        entry->close = std::move(response);
+    }
+    entry->size = entry->keepAlive.size() + entry->close.size();
+    return entry;
+}
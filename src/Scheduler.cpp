@@ -0,0 +1,97 @@
+#include "headers/Scheduler.h"
+#include <algorithm>
+#include <stdexcept>
+
+// Состояние маршрута на отдельной кэш-линии: стоимость обновляют все рабочие потоки
+struct alignas(64) RouteSchedule {
+    std::atomic<int64_t> targetNanos{0}; // Явная цель; 0 - по стоимости
+    std::atomic<uint64_t> costNanos{0};  // Скользящее среднее стоимости; 0 - измерений не было
+    std::atomic<uint64_t> missed{0};
+    std::atomic<int64_t> finish{0}; // Виртуальное время (тики steady_clock) окончания выданных запросов
+};
+
+RouteScheduler::RouteScheduler(size_t routeCount, const SchedulingOptions& options)
+    : count(routeCount) {
+    if (routeCount == 0) {
+        throw std::invalid_argument("RouteScheduler: routeCount must be positive");
+    }
+    setOptions(options);
+    routes = std::make_unique<RouteSchedule[]>(count);
+}
+
+RouteScheduler::~RouteScheduler() = default;
+
+void RouteScheduler::setOptions(const SchedulingOptions& newOptions) {
+    if (newOptions.readTarget.count() <= 0 || newOptions.minTarget.count() <= 0) {
+        throw std::invalid_argument("SchedulingOptions: readTarget and minTarget must be positive");
+    }
+    if (newOptions.maxTarget < newOptions.minTarget) {
+        throw std::invalid_argument("SchedulingOptions: maxTarget must not be less than minTarget");
+    }
+    if (!(newOptions.costMultiplier > 0)) {
+        throw std::invalid_argument("SchedulingOptions: costMultiplier must be positive");
+    }
+    if (!(newOptions.costSmoothing > 0 && newOptions.costSmoothing <= 1)) {
+        throw std::invalid_argument("SchedulingOptions: costSmoothing must be in (0, 1]");
+    }
+    options = newOptions;
+}
+
+RouteSchedule& RouteScheduler::at(size_t routeId) const {
+    return routes[std::min(routeId, count - 1)];
+}
+
+void RouteScheduler::setTarget(size_t routeId, std::chrono::milliseconds target) {
+    if (target.count() < 0) {
+        throw std::invalid_argument("RouteScheduler: target must not be negative");
+    }
+    at(routeId).targetNanos.store(std::chrono::duration_cast<std::chrono::nanoseconds>(target).count(),
+                                  std::memory_order_relaxed);
+}
+
+std::chrono::steady_clock::duration RouteScheduler::target(size_t routeId) const {
+    const RouteSchedule& route = at(routeId);
+    int64_t explicitTarget = route.targetNanos.load(std::memory_order_relaxed);
+    if (explicitTarget > 0) {
+        return std::chrono::nanoseconds(explicitTarget);
+    }
+    std::chrono::steady_clock::duration learned =
+        std::chrono::nanoseconds(static_cast<int64_t>(route.costNanos.load(std::memory_order_relaxed) * options.costMultiplier));
+    return std::clamp<std::chrono::steady_clock::duration>(learned, options.minTarget, options.maxTarget);
+}
+
+TaskSchedule RouteScheduler::schedule(size_t routeId, std::chrono::steady_clock::time_point now) {
+    RouteSchedule& route = at(routeId);
+    auto cost = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::nanoseconds(route.costNanos.load(std::memory_order_relaxed)));
+    int64_t current = route.finish.load(std::memory_order_relaxed);
+    int64_t start;
+    do {
+        start = std::max<int64_t>(now.time_since_epoch().count(), current);
+    } while (!route.finish.compare_exchange_weak(current, start + cost.count(), std::memory_order_relaxed));
+    std::chrono::steady_clock::time_point startTime{std::chrono::steady_clock::duration(start)};
+    return TaskSchedule{startTime, startTime + target(routeId)};
+}
+
+void RouteScheduler::recordCost(size_t routeId, std::chrono::steady_clock::duration cost) {
+    RouteSchedule& route = at(routeId);
+    uint64_t sample = static_cast<uint64_t>(std::max<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(cost).count(), 1));
+    uint64_t average = route.costNanos.load(std::memory_order_relaxed);
+    // Первое измерение становится средним сразу, иначе маршрут долго считался бы дешёвым
+    uint64_t updated = average == 0
+        ? sample
+        : static_cast<uint64_t>(average + options.costSmoothing * (static_cast<double>(sample) - static_cast<double>(average)));
+    route.costNanos.store(std::max<uint64_t>(updated, 1), std::memory_order_relaxed);
+}
+
+void RouteScheduler::recordMiss(size_t routeId) {
+    at(routeId).missed.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t RouteScheduler::averageCost(size_t routeId) const {
+    return at(routeId).costNanos.load(std::memory_order_relaxed);
+}
+
+uint64_t RouteScheduler::misses(size_t routeId) const {
+    return at(routeId).missed.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,622 @@
+#include "headers/Session.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+// Секунды system_clock: срок жизни в файле должен пережить перезапуск процесса и перезагрузку
+int64_t unixSeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+uint64_t hashId(const std::string& id) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : id) {
+        hash = (hash ^ c) * 0x100000001b3ULL;
+    }
+    return hash ? hash : 1;
+}
+
+// Данные сессии в файле: длина ключа, ключ, длина значения, значение
+void appendField(std::string& out, const std::string& field) {
+    uint32_t length = static_cast<uint32_t>(field.size());
+    out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    out.append(field);
+}
+
+bool readField(std::string_view& in, std::string& field) {
+    uint32_t length;
+    if (in.size() < sizeof(length)) return false;
+    std::memcpy(&length, in.data(), sizeof(length));
+    in.remove_prefix(sizeof(length));
+    if (in.size() < length) return false;
+    field.assign(in.data(), length);
+    in.remove_prefix(length);
+    return true;
+}
+
+std::string encodeValues(const SessionValues& values) {
+    std::string out;
+    for (const auto& [key, value] : values) {
+        appendField(out, key);
+        appendField(out, value);
+    }
+    return out;
+}
+
+bool decodeValues(std::string_view in, SessionValues& values) {
+    values.clear();
+    std::string key, value;
+    while (!in.empty()) {
+        if (!readField(in, key) || !readField(in, value)) return false;
+        values.emplace(std::move(key), std::move(value));
+    }
+    return true;
+}
+
+std::string toHex(const uint8_t* bytes, size_t size) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out(size * 2, '0');
+    for (size_t i = 0; i < size; ++i) {
+        out[2 * i] = digits[bytes[i] >> 4];
+        out[2 * i + 1] = digits[bytes[i] & 0xf];
+    }
+    return out;
+}
+
+// SHA-256 (FIPS 180-4)
+class Sha256 {
+public:
+    void update(std::string_view data) {
+        for (unsigned char c : data) {
+            block[blockSize++] = c;
+            if (blockSize == 64) {
+                compress();
+                blockSize = 0;
+            }
+        }
+        totalBytes += data.size();
+    }
+
+    void finish(uint8_t digest[32]) {
+        uint64_t bits = totalBytes * 8;
+        block[blockSize++] = 0x80;
+        if (blockSize > 56) {
+            while (blockSize < 64) block[blockSize++] = 0;
+            compress();
+            blockSize = 0;
+        }
+        while (blockSize < 56) block[blockSize++] = 0;
+        for (int i = 7; i >= 0; --i) block[blockSize++] = static_cast<uint8_t>(bits >> (i * 8));
+        compress();
+        for (int i = 0; i < 8; ++i) {
+            digest[4 * i] = static_cast<uint8_t>(state[i] >> 24);
+            digest[4 * i + 1] = static_cast<uint8_t>(state[i] >> 16);
+            digest[4 * i + 2] = static_cast<uint8_t>(state[i] >> 8);
+            digest[4 * i + 3] = static_cast<uint8_t>(state[i]);
+        }
+    }
+
+private:
+    uint32_t state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    uint8_t block[64];
+    size_t blockSize = 0;
+    uint64_t totalBytes = 0;
+
+    static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    void compress() {
+        static const uint32_t k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = (uint32_t(block[4 * i]) << 24) | (uint32_t(block[4 * i + 1]) << 16) |
+                   (uint32_t(block[4 * i + 2]) << 8) | uint32_t(block[4 * i + 3]);
+        }
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+};
+
+// Длина идентификатора и подписи в байтах (в cookie - вдвое больше hex-символов)
+constexpr size_t idBytes = 16;
+constexpr size_t signatureBytes = 16;
+}
+
+void hmacSha256(std::string_view key, std::string_view message, uint8_t digest[32]) {
+    uint8_t keyBlock[64] = {};
+    if (key.size() > sizeof(keyBlock)) {
+        Sha256 keyHash;
+        keyHash.update(key);
+        keyHash.finish(keyBlock);
+    } else {
+        std::memcpy(keyBlock, key.data(), key.size());
+    }
+    uint8_t inner[64], outer[64];
+    for (size_t i = 0; i < 64; ++i) {
+        inner[i] = keyBlock[i] ^ 0x36;
+        outer[i] = keyBlock[i] ^ 0x5c;
+    }
+    uint8_t innerDigest[32];
+    Sha256 innerHash;
+    innerHash.update(std::string_view(reinterpret_cast<const char*>(inner), sizeof(inner)));
+    innerHash.update(message);
+    innerHash.finish(innerDigest);
+    Sha256 outerHash;
+    outerHash.update(std::string_view(reinterpret_cast<const char*>(outer), sizeof(outer)));
+    outerHash.update(std::string_view(reinterpret_cast<const char*>(innerDigest), sizeof(innerDigest)));
+    outerHash.finish(digest);
+}
+
+// ---- MemorySessionStore ----
+
+MemorySessionStore::Shard& MemorySessionStore::shardFor(const std::string& id) {
+    return shards[hashId(id) % shardCount];
+}
+
+bool MemorySessionStore::load(const std::string& id, SessionValues& values, std::chrono::seconds& remaining) {
+    Shard& shard = shardFor(id);
+    auto now = std::chrono::steady_clock::now();
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.entries.find(id);
+    if (it == shard.entries.end() || it->second.expires <= now) return false;
+    values = it->second.values;
+    remaining = std::chrono::duration_cast<std::chrono::seconds>(it->second.expires - now);
+    return true;
+}
+
+void MemorySessionStore::save(const std::string& id, const SessionValues& values, std::chrono::seconds ttl) {
+    Shard& shard = shardFor(id);
+    auto now = std::chrono::steady_clock::now();
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    Entry& entry = shard.entries[id];
+    entry.values = values;
+    entry.expires = now + ttl;
+    if (++shard.writesSinceSweep >= sweepInterval) {
+        shard.writesSinceSweep = 0;
+        for (auto it = shard.entries.begin(); it != shard.entries.end();) {
+            if (it->second.expires <= now) it = shard.entries.erase(it); else ++it;
+        }
+    }
+}
+
+void MemorySessionStore::erase(const std::string& id) {
+    Shard& shard = shardFor(id);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    shard.entries.erase(id);
+}
+
+size_t MemorySessionStore::size() {
+    auto now = std::chrono::steady_clock::now();
+    size_t total = 0;
+    for (size_t i = 0; i < shardCount; ++i) {
+        std::shared_lock<std::shared_mutex> lock(shards[i].mutex);
+        for (const auto& [id, entry] : shards[i].entries) {
+            if (entry.expires > now) ++total;
+        }
+    }
+    return total;
+}
+
+// ---- MmapSessionStore ----
+
+struct MmapSessionStore::FileHeader {
+    char magic[8];
+    uint64_t capacity;
+    uint64_t slotSize;
+    char reserved[40];
+};
+
+// Все поля, которые читаются без блокировки, атомарные; данные копируются memcpy и проверяются
+// по номеру версии. Атомарные операции над отображённой памятью безадресные и работают между процессами
+struct MmapSessionStore::Slot {
+    std::atomic<uint64_t> sequence;     // Нечётный - ячейка записывается
+    std::atomic<uint64_t> keyHash;      // 0 - свободная ячейка
+    std::atomic<int64_t> expires;       // Секунды system_clock
+    std::atomic<uint32_t> idLength;
+    std::atomic<uint32_t> dataLength;
+    char id[64];
+    // Далее данные сессии до конца ячейки
+
+    char* data() { return reinterpret_cast<char*>(this + 1); }
+};
+
+namespace {
+const char sessionFileMagic[8] = {'F', 'C', 'P', 'S', 'E', 'S', 'S', '1'};
+}
+
+MmapSessionStore::MmapSessionStore(const std::string& path, size_t capacity, size_t slotSize)
+    : fd(-1), mapping(nullptr), mappingSize(0), capacity(capacity), slotSize(slotSize) {
+    static_assert(sizeof(FileHeader) == 64, "session file header must occupy one cache line");
+    if (capacity < probeWindow || slotSize < sizeof(Slot) + 64 || slotSize % 64 != 0) {
+        throw std::invalid_argument("session store: invalid capacity or slot size");
+    }
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd == -1) {
+        throw std::runtime_error("session store: cannot open " + path + ": " + std::strerror(errno));
+    }
+    // Файл используют несколько процессов (горячий перезапуск), каждый держит разделяемую блокировку.
+    // Исключительная удаётся только единственному процессу - только он создаёт файл и чинит ячейки,
+    // брошенные посреди записи упавшим процессом
+    bool exclusive = flock(fd, LOCK_EX | LOCK_NB) == 0;
+    if (!exclusive) flock(fd, LOCK_SH);
+
+    try {
+        struct stat st;
+        if (fstat(fd, &st) == -1) {
+            throw std::runtime_error("session store: cannot stat " + path);
+        }
+        FileHeader header = {};
+        if (st.st_size == 0 && exclusive) {
+            std::memcpy(header.magic, sessionFileMagic, sizeof(header.magic));
+            header.capacity = capacity;
+            header.slotSize = slotSize;
+            if (ftruncate(fd, sizeof(FileHeader) + capacity * slotSize) == -1 ||
+                pwrite(fd, &header, sizeof(header), 0) != sizeof(header)) {
+                throw std::runtime_error("session store: cannot initialize " + path + ": " + std::strerror(errno));
+            }
+        } else if (pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+                   std::memcmp(header.magic, sessionFileMagic, sizeof(header.magic)) != 0) {
+            throw std::runtime_error("session store: " + path + " is not a session file");
+        }
+        // Размеры таблицы задаются при создании файла; существующий файл открывается как есть
+        this->capacity = header.capacity;
+        this->slotSize = header.slotSize;
+        mappingSize = sizeof(FileHeader) + this->capacity * this->slotSize;
+        if (static_cast<uint64_t>(st.st_size) < mappingSize && st.st_size != 0) {
+            throw std::runtime_error("session store: " + path + " is truncated");
+        }
+
+        void* address = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED) {
+            throw std::runtime_error("session store: mmap failed: " + std::string(std::strerror(errno)));
+        }
+        mapping = static_cast<char*>(address);
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+
+    if (exclusive) {
+        for (size_t i = 0; i < this->capacity; ++i) {
+            Slot& s = slot(i);
+            uint64_t sequence = s.sequence.load(std::memory_order_relaxed);
+            if (sequence & 1) {
+                s.keyHash.store(0, std::memory_order_relaxed);
+                s.sequence.store(sequence + 1, std::memory_order_release);
+            }
+        }
+        flock(fd, LOCK_SH);
+    }
+}
+
+MmapSessionStore::~MmapSessionStore() {
+    munmap(mapping, mappingSize);
+    close(fd);
+}
+
+MmapSessionStore::Slot& MmapSessionStore::slot(size_t index) {
+    return *reinterpret_cast<Slot*>(mapping + sizeof(FileHeader) + index * slotSize);
+}
+
+void MmapSessionStore::lockSlot(Slot& s) {
+    uint64_t sequence = s.sequence.load(std::memory_order_relaxed);
+    for (unsigned spins = 0;; ++spins) {
+        if (!(sequence & 1) &&
+            s.sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+            return;
+        }
+        // Запись ячейки - это копирование килобайта; долгое ожидание значит, что владельца вытеснили
+        if (spins >= 64) sched_yield();
+        sequence = s.sequence.load(std::memory_order_relaxed);
+    }
+}
+
+void MmapSessionStore::unlockSlot(Slot& s) {
+    s.sequence.fetch_add(1, std::memory_order_release);
+}
+
+bool MmapSessionStore::readSlot(Slot& s, uint64_t keyHash, const std::string& id, std::string* data, int64_t& expires) {
+    size_t dataCapacity = slotSize - sizeof(Slot);
+    char idCopy[sizeof(Slot::id)];
+    while (true) {
+        uint64_t before = s.sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            sched_yield();
+            continue;
+        }
+        bool matches = s.keyHash.load(std::memory_order_relaxed) == keyHash;
+        size_t idLength = s.idLength.load(std::memory_order_relaxed);
+        size_t dataLength = s.dataLength.load(std::memory_order_relaxed);
+        expires = s.expires.load(std::memory_order_relaxed);
+        matches = matches && idLength == id.size() && idLength <= sizeof(idCopy) && dataLength <= dataCapacity;
+        if (matches) {
+            std::memcpy(idCopy, s.id, idLength);
+            if (data) {
+                data->resize(dataLength);
+                std::memcpy(data->data(), s.data(), dataLength);
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s.sequence.load(std::memory_order_relaxed) != before) continue;
+        return matches && std::memcmp(idCopy, id.data(), id.size()) == 0;
+    }
+}
+
+bool MmapSessionStore::load(const std::string& id, SessionValues& values, std::chrono::seconds& remaining) {
+    uint64_t keyHash = hashId(id);
+    size_t start = keyHash % capacity;
+    int64_t now = unixSeconds();
+    std::string data;
+    for (size_t i = 0; i < probeWindow; ++i) {
+        Slot& s = slot((start + i) % capacity);
+        if (s.keyHash.load(std::memory_order_relaxed) != keyHash) continue;
+        int64_t expires;
+        if (!readSlot(s, keyHash, id, &data, expires)) continue;
+        if (expires <= now || !decodeValues(data, values)) return false;
+        remaining = std::chrono::seconds(expires - now);
+        return true;
+    }
+    return false;
+}
+
+void MmapSessionStore::save(const std::string& id, const SessionValues& values, std::chrono::seconds ttl) {
+    std::string data = encodeValues(values);
+    if (id.size() > sizeof(Slot::id) || data.size() > slotSize - sizeof(Slot)) {
+        throw std::length_error("session data exceeds " + std::to_string(slotSize - sizeof(Slot)) + " bytes");
+    }
+    uint64_t keyHash = hashId(id);
+    size_t start = keyHash % capacity;
+    int64_t now = unixSeconds();
+
+    while (true) {
+        // Ячейка выбирается без блокировок и перепроверяется после захвата: её могли занять
+        size_t target = SIZE_MAX, freeSlot = SIZE_MAX, victim = start;
+        int64_t soonest = INT64_MAX;
+        for (size_t i = 0; i < probeWindow; ++i) {
+            size_t index = (start + i) % capacity;
+            Slot& s = slot(index);
+            uint64_t slotHash = s.keyHash.load(std::memory_order_relaxed);
+            int64_t expires = s.expires.load(std::memory_order_relaxed);
+            if (slotHash == keyHash && readSlot(s, keyHash, id, nullptr, expires)) {
+                target = index;
+                break;
+            }
+            if (freeSlot == SIZE_MAX && (slotHash == 0 || expires <= now)) freeSlot = index;
+            if (expires < soonest) {
+                soonest = expires;
+                victim = index;
+            }
+        }
+        bool own = target != SIZE_MAX;
+        bool evict = !own && freeSlot == SIZE_MAX;
+        if (!own) target = evict ? victim : freeSlot;
+
+        Slot& s = slot(target);
+        lockSlot(s);
+        uint64_t slotHash = s.keyHash.load(std::memory_order_relaxed);
+        bool stillValid = own ? slotHash == keyHash && s.idLength.load(std::memory_order_relaxed) == id.size() &&
+                                    std::memcmp(s.id, id.data(), id.size()) == 0
+                        : evict || slotHash == 0 || s.expires.load(std::memory_order_relaxed) <= now;
+        if (!stillValid) {
+            unlockSlot(s);
+            continue;
+        }
+        s.keyHash.store(keyHash, std::memory_order_relaxed);
+        s.expires.store(now + ttl.count(), std::memory_order_relaxed);
+        s.idLength.store(static_cast<uint32_t>(id.size()), std::memory_order_relaxed);
+        s.dataLength.store(static_cast<uint32_t>(data.size()), std::memory_order_relaxed);
+        std::memcpy(s.id, id.data(), id.size());
+        std::memcpy(s.data(), data.data(), data.size());
+        unlockSlot(s);
+        return;
+    }
+}
+
+void MmapSessionStore::erase(const std::string& id) {
+    uint64_t keyHash = hashId(id);
+    size_t start = keyHash % capacity;
+    for (size_t i = 0; i < probeWindow; ++i) {
+        Slot& s = slot((start + i) % capacity);
+        if (s.keyHash.load(std::memory_order_relaxed) != keyHash) continue;
+        lockSlot(s);
+        if (s.keyHash.load(std::memory_order_relaxed) == keyHash && s.idLength.load(std::memory_order_relaxed) == id.size() &&
+            std::memcmp(s.id, id.data(), id.size()) == 0) {
+            s.keyHash.store(0, std::memory_order_relaxed);
+            s.expires.store(0, std::memory_order_relaxed);
+        }
+        unlockSlot(s);
+    }
+}
+
+size_t MmapSessionStore::size() {
+    int64_t now = unixSeconds();
+    size_t total = 0;
+    for (size_t i = 0; i < capacity; ++i) {
+        Slot& s = slot(i);
+        if (s.keyHash.load(std::memory_order_relaxed) != 0 && s.expires.load(std::memory_order_relaxed) > now) ++total;
+    }
+    return total;
+}
+
+// ---- Session ----
+
+void Session::ensureLoaded() {
+    if (loaded) return;
+    loaded = true;
+    std::string id;
+    if (!cookie.empty() && manager.verify(cookie, id) && manager.backend().load(id, values, remaining)) {
+        sessionId = std::move(id);
+        exists = true;
+    } else {
+        values.clear();
+        // Cookie истёкшей или поддельной сессии клиенту больше не нужна
+        expireCookie = !cookie.empty();
+    }
+}
+
+std::string Session::get(const std::string& key, const std::string& defaultValue) {
+    ensureLoaded();
+    auto it = values.find(key);
+    return it != values.end() ? it->second : defaultValue;
+}
+
+bool Session::contains(const std::string& key) {
+    ensureLoaded();
+    return values.count(key) != 0;
+}
+
+void Session::set(const std::string& key, std::string value) {
+    ensureLoaded();
+    values[key] = std::move(value);
+    modified = true;
+}
+
+void Session::erase(const std::string& key) {
+    ensureLoaded();
+    if (values.erase(key)) modified = true;
+}
+
+void Session::destroy() {
+    ensureLoaded();
+    if (exists) manager.backend().erase(sessionId);
+    expireCookie = !cookie.empty();
+    exists = false;
+    modified = false;
+    sessionId.clear();
+    values.clear();
+}
+
+void Session::regenerate() {
+    ensureLoaded();
+    if (exists) manager.backend().erase(sessionId);
+    exists = false;
+    sessionId.clear();
+    modified = !values.empty();
+}
+
+const std::string& Session::id() {
+    ensureLoaded();
+    return sessionId;
+}
+
+// ---- SessionManager ----
+
+SessionManager::SessionManager(std::string secret, SessionOptions options, std::shared_ptr<SessionStore> store)
+    : secret(std::move(secret)), options(std::move(options)), store(std::move(store)) {
+    if (this->secret.size() < 16) {
+        throw std::invalid_argument("session secret must be at least 16 bytes");
+    }
+    if (this->options.ttl.count() <= 0) {
+        throw std::invalid_argument("session ttl must be positive");
+    }
+    if (!this->store) {
+        this->store = std::make_shared<MemorySessionStore>();
+    }
+}
+
+std::string SessionManager::newId() {
+    uint8_t bytes[idBytes];
+    size_t filled = 0;
+    while (filled < sizeof(bytes)) {
+        ssize_t r = getrandom(bytes + filled, sizeof(bytes) - filled, 0);
+        if (r == -1) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("getrandom failed");
+        }
+        filled += static_cast<size_t>(r);
+    }
+    return toHex(bytes, sizeof(bytes));
+}
+
+std::string SessionManager::sign(const std::string& id) const {
+    uint8_t digest[32];
+    hmacSha256(secret, id, digest);
+    return toHex(digest, signatureBytes);
+}
+
+bool SessionManager::verify(std::string_view cookie, std::string& id) const {
+    if (cookie.size() != 2 * idBytes + 1 + 2 * signatureBytes || cookie[2 * idBytes] != '.') return false;
+    id.assign(cookie.substr(0, 2 * idBytes));
+    std::string expected = sign(id);
+    std::string_view signature = cookie.substr(2 * idBytes + 1);
+    // Сравнение за постоянное время: подпись нельзя подобрать по времени ответа
+    unsigned char difference = 0;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        difference |= static_cast<unsigned char>(expected[i] ^ signature[i]);
+    }
+    return difference == 0;
+}
+
+void SessionManager::commit(Session& session, std::string& response) {
+    // Хендлер не обращался к сессии - хранилище не трогаем
+    if (!session.loaded) return;
+
+    std::string cookie;
+    if (session.modified && !session.values.empty()) {
+        bool fresh = session.sessionId.empty();
+        if (fresh) session.sessionId = newId();
+        store->save(session.sessionId, session.values, options.ttl);
+        if (fresh) {
+            cookie = options.cookieName + "=" + session.sessionId + "." + sign(session.sessionId) + "; Path=" + options.path + "; HttpOnly";
+            if (options.secure) cookie += "; Secure";
+            if (!options.sameSite.empty()) cookie += "; SameSite=" + options.sameSite;
+        }
+    } else if (session.modified && session.exists) {
+        // Из сессии удалены все значения
+        store->erase(session.sessionId);
+        cookie = options.cookieName + "=deleted; Path=" + options.path + "; Expires=Thu, 01 Jan 1970 00:00:00 GMT; HttpOnly";
+    } else if (session.exists) {
+        // Скользящий срок жизни: продлеваем, когда прошла половина, а не при каждом запросе
+        if (session.remaining < options.ttl / 2) store->save(session.sessionId, session.values, options.ttl);
+    } else if (session.expireCookie) {
+        cookie = options.cookieName + "=deleted; Path=" + options.path + "; Expires=Thu, 01 Jan 1970 00:00:00 GMT; HttpOnly";
+    }
+
+    if (cookie.empty()) return;
+    size_t statusEnd = response.find("\r\n");
+    if (statusEnd == std::string::npos || response.compare(0, 5, "HTTP/") != 0) return;
+    response.insert(statusEnd + 2, "Set-Cookie: " + cookie + "\r\n");
+}
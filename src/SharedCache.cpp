@@ -0,0 +1,255 @@
+#include "headers/SharedCache.h"
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+const char sharedCacheMagic[8] = {'F', 'C', 'P', 'S', 'C', 'A', 'C', '1'};
+
+// Наносекунды steady_clock (CLOCK_MONOTONIC): часы общие для всех процессов машины
+int64_t monotonicNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t hashKey(std::string_view key) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : key) {
+        hash = (hash ^ c) * 0x100000001b3ULL;
+    }
+    return hash ? hash : 1;
+}
+}
+
+struct SharedCache::SegmentHeader {
+    char magic[8];
+    uint64_t capacity;
+    uint64_t slotSize;
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    char reserved[24];
+};
+
+// Как и в MmapSessionStore, поля, которые читаются без блокировки, атомарные; ключ и значение
+// копируются memcpy и проверяются по номеру версии
+struct SharedCache::Slot {
+    std::atomic<uint64_t> sequence;   // Нечётный - ячейка записывается
+    std::atomic<int32_t> owner;       // Процесс, который пишет ячейку; 0 - свободна
+    std::atomic<uint32_t> keyLength;
+    std::atomic<uint64_t> keyHash;    // 0 - пустая ячейка
+    std::atomic<int64_t> expires;     // Наносекунды steady_clock
+    std::atomic<uint32_t> valueLength;
+    // Далее ключ и значение до конца ячейки
+
+    char* data() { return reinterpret_cast<char*>(this + 1); }
+};
+
+SharedCache::SharedCache(size_t capacity, size_t slotSize)
+    : fd(-1), mapping(nullptr), mappingSize(0), capacity(capacity), slotSize(slotSize) {
+    static_assert(sizeof(SegmentHeader) == 64, "shared cache header must occupy one cache line");
+    if (capacity < probeWindow || slotSize < sizeof(Slot) + 64 || slotSize % 64 != 0) {
+        throw std::invalid_argument("shared cache: invalid capacity or slot size");
+    }
+    fd = memfd_create("flaskcpp-shared-cache", MFD_CLOEXEC);
+    if (fd == -1) {
+        throw std::runtime_error("shared cache: memfd_create failed: " + std::string(std::strerror(errno)));
+    }
+    mappingSize = sizeof(SegmentHeader) + capacity * slotSize;
+    if (ftruncate(fd, static_cast<off_t>(mappingSize)) == -1) {
+        close(fd);
+        throw std::runtime_error("shared cache: cannot allocate " + std::to_string(mappingSize) + " bytes");
+    }
+    map();
+    // Память memfd заполнена нулями: пустые ячейки и нулевые счётчики уже на месте
+    SegmentHeader& h = header();
+    std::memcpy(h.magic, sharedCacheMagic, sizeof(h.magic));
+    h.capacity = capacity;
+    h.slotSize = slotSize;
+}
+
+SharedCache::SharedCache(int fd) : fd(fd), mapping(nullptr), mappingSize(0), capacity(0), slotSize(0) {
+    struct {
+        char magic[8];
+        uint64_t capacity;
+        uint64_t slotSize;
+    } stored;
+    struct stat st;
+    if (fstat(fd, &st) == -1 || static_cast<size_t>(st.st_size) < sizeof(SegmentHeader) ||
+        pread(fd, &stored, sizeof(stored), 0) != sizeof(stored) ||
+        std::memcmp(stored.magic, sharedCacheMagic, sizeof(stored.magic)) != 0) {
+        close(fd);
+        throw std::runtime_error("shared cache: descriptor " + std::to_string(fd) + " is not a shared cache segment");
+    }
+    capacity = stored.capacity;
+    slotSize = stored.slotSize;
+    mappingSize = sizeof(SegmentHeader) + capacity * slotSize;
+    if (static_cast<size_t>(st.st_size) < mappingSize) {
+        close(fd);
+        throw std::runtime_error("shared cache: segment is truncated");
+    }
+    map();
+}
+
+SharedCache::~SharedCache() {
+    munmap(mapping, mappingSize);
+    close(fd);
+}
+
+void SharedCache::map() {
+    void* address = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) {
+        int error = errno;
+        close(fd);
+        throw std::runtime_error("shared cache: mmap failed: " + std::string(std::strerror(error)));
+    }
+    mapping = static_cast<char*>(address);
+}
+
+SharedCache::SegmentHeader& SharedCache::header() {
+    return *reinterpret_cast<SegmentHeader*>(mapping);
+}
+
+SharedCache::Slot& SharedCache::slot(size_t index) {
+    return *reinterpret_cast<Slot*>(mapping + sizeof(SegmentHeader) + index * slotSize);
+}
+
+bool SharedCache::lockSlot(Slot& s) {
+    int32_t expected = 0;
+    if (!s.owner.compare_exchange_strong(expected, static_cast<int32_t>(getpid()), std::memory_order_acquire,
+                                         std::memory_order_relaxed)) {
+        return false;
+    }
+    s.sequence.fetch_add(1, std::memory_order_acquire);
+    return true;
+}
+
+void SharedCache::unlockSlot(Slot& s) {
+    s.sequence.fetch_add(1, std::memory_order_release);
+    s.owner.store(0, std::memory_order_release);
+}
+
+bool SharedCache::get(std::string_view key, std::string& value, std::chrono::milliseconds* remaining) {
+    uint64_t keyHash = hashKey(key);
+    size_t start = keyHash % capacity;
+    size_t dataCapacity = slotSize - sizeof(Slot);
+    int64_t now = monotonicNanos();
+    for (size_t i = 0; i < probeWindow; ++i) {
+        Slot& s = slot((start + i) % capacity);
+        if (s.keyHash.load(std::memory_order_relaxed) != keyHash) continue;
+        uint64_t before = s.sequence.load(std::memory_order_acquire);
+        if (before & 1) continue;
+        size_t keyLength = s.keyLength.load(std::memory_order_relaxed);
+        size_t valueLength = s.valueLength.load(std::memory_order_relaxed);
+        int64_t expires = s.expires.load(std::memory_order_relaxed);
+        if (keyLength != key.size() || keyLength + valueLength > dataCapacity || expires <= now) continue;
+        bool matches = std::memcmp(s.data(), key.data(), keyLength) == 0;
+        if (matches) {
+            value.resize(valueLength);
+            std::memcpy(value.data(), s.data() + keyLength, valueLength);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (!matches || s.sequence.load(std::memory_order_relaxed) != before ||
+            s.keyHash.load(std::memory_order_relaxed) != keyHash) {
+            continue;
+        }
+        if (remaining) {
+            *remaining = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::nanoseconds(expires - now));
+        }
+        header().hits.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    header().misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool SharedCache::put(std::string_view key, std::string_view value, std::chrono::milliseconds ttl) {
+    if (key.size() + value.size() > slotSize - sizeof(Slot) || ttl.count() <= 0) return false;
+    uint64_t keyHash = hashKey(key);
+    size_t start = keyHash % capacity;
+    int64_t now = monotonicNanos();
+
+    // Ячейка с тем же ключом, иначе пустая или истёкшая, иначе истекающая раньше других
+    size_t target = SIZE_MAX, freeSlot = SIZE_MAX, victim = start;
+    int64_t soonest = INT64_MAX;
+    for (size_t i = 0; i < probeWindow; ++i) {
+        size_t index = (start + i) % capacity;
+        Slot& s = slot(index);
+        uint64_t slotHash = s.keyHash.load(std::memory_order_relaxed);
+        int64_t expires = s.expires.load(std::memory_order_relaxed);
+        if (slotHash == keyHash && s.keyLength.load(std::memory_order_relaxed) == key.size()) {
+            target = index;
+            break;
+        }
+        if (freeSlot == SIZE_MAX && (slotHash == 0 || expires <= now)) freeSlot = index;
+        if (expires < soonest) {
+            soonest = expires;
+            victim = index;
+        }
+    }
+    if (target == SIZE_MAX) target = freeSlot != SIZE_MAX ? freeSlot : victim;
+
+    Slot& s = slot(target);
+    if (!lockSlot(s)) return false;
+    s.keyHash.store(keyHash, std::memory_order_relaxed);
+    s.expires.store(now + std::chrono::duration_cast<std::chrono::nanoseconds>(ttl).count(), std::memory_order_relaxed);
+    s.keyLength.store(static_cast<uint32_t>(key.size()), std::memory_order_relaxed);
+    s.valueLength.store(static_cast<uint32_t>(value.size()), std::memory_order_relaxed);
+    std::memcpy(s.data(), key.data(), key.size());
+    std::memcpy(s.data() + key.size(), value.data(), value.size());
+    unlockSlot(s);
+    return true;
+}
+
+void SharedCache::erase(std::string_view key) {
+    uint64_t keyHash = hashKey(key);
+    size_t start = keyHash % capacity;
+    for (size_t i = 0; i < probeWindow; ++i) {
+        Slot& s = slot((start + i) % capacity);
+        if (s.keyHash.load(std::memory_order_relaxed) != keyHash) continue;
+        // Занятую писателем ячейку пропускать нельзя: ждём, пока запись закончится
+        while (!lockSlot(s)) sched_yield();
+        if (s.keyHash.load(std::memory_order_relaxed) == keyHash && s.keyLength.load(std::memory_order_relaxed) == key.size() &&
+            std::memcmp(s.data(), key.data(), key.size()) == 0) {
+            s.keyHash.store(0, std::memory_order_relaxed);
+            s.expires.store(0, std::memory_order_relaxed);
+        }
+        unlockSlot(s);
+    }
+}
+
+void SharedCache::recover(pid_t pid) {
+    for (size_t i = 0; i < capacity; ++i) {
+        Slot& s = slot(i);
+        if (s.owner.load(std::memory_order_acquire) != pid) continue;
+        uint64_t sequence = s.sequence.load(std::memory_order_relaxed);
+        if (sequence & 1) {
+            s.keyHash.store(0, std::memory_order_relaxed);
+            s.sequence.store(sequence + 1, std::memory_order_release);
+        }
+        s.owner.store(0, std::memory_order_release);
+    }
+}
+
+size_t SharedCache::entryCount() {
+    int64_t now = monotonicNanos();
+    size_t total = 0;
+    for (size_t i = 0; i < capacity; ++i) {
+        Slot& s = slot(i);
+        if (s.keyHash.load(std::memory_order_relaxed) != 0 && s.expires.load(std::memory_order_relaxed) > now) ++total;
+    }
+    return total;
+}
+
+unsigned long long SharedCache::hitCount() const {
+    return reinterpret_cast<const SegmentHeader*>(mapping)->hits.load(std::memory_order_relaxed);
+}
+
+unsigned long long SharedCache::missCount() const {
+    return reinterpret_cast<const SegmentHeader*>(mapping)->misses.load(std::memory_order_relaxed);
+}
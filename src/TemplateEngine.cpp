@@ -1,4 +1,5 @@
 #include "TemplateEngine.h"
+#include "Tracing.h"
 #include <sstream>
 #include <algorithm>
 #include <cctype>
@@ -17,6 +18,7 @@ std::string TemplateEngine::getTemplateContent(const std::string& name) const {
 }
 
 std::string TemplateEngine::render(const std::string& templateName, const Context& context) const {
+    TraceSpan span("render", templateName);
     std::string tpl = getTemplateContent(templateName);
     if (tpl.empty()) {
         return "Template not found: " + templateName;
@@ -262,6 +264,7 @@ std::string TemplateEngine::processFor(const std::string& block, const Context&
     const auto& list = std::get<std::vector<std::map<std::string, std::string>>>(listIt->second);
 
     // Рендеринг цикла
+    TraceSpan span("for", listName);
     std::string renderedLoop;
     renderedLoop.reserve(list.size() * innerBlock.size()); // Предварительное резервирование для повышения производительности
 
@@ -297,6 +300,8 @@ std::string TemplateEngine::processInclude(const std::string& block, const Conte
     while (rit != rend) {
         match = *rit;
         std::string includeName = match[1];  // Имя шаблона внутри кавычек
+        // Спан включает поиск в кэше включений: попадание в кэш видно по короткому спану без вложенных
+        TraceSpan span("include", includeName);
 
         // Вычисляем хэш контекста
         size_t contextHash = hashContext(context);
@@ -1,9 +1,10 @@
 #include "headers/ThreadPool.h"
+#include <algorithm>
 #include <stdexcept>
 
 // Конструктор
 ThreadPool::ThreadPool(size_t minThreads, size_t maxThreads, bool verbose)
-    : stop(false), minThreads(minThreads), maxThreads(maxThreads), currentThreads(0), verbose(verbose), threadsToTerminate(0)
+    : stop(false), minThreads(minThreads), maxThreads(maxThreads), currentThreads(0), activeThreads(0), verbose(verbose), threadsToTerminate(0)
 {
     if (minThreads > maxThreads) {
         throw std::invalid_argument("minThreads cannot be greater than maxThreads");
@@ -47,13 +48,27 @@ void ThreadPool::addThread()
                 }
 
                 if (!this->tasks.empty()) {
-                    pt = std::move(this->tasks.top());
+                    // top() константный, но элемент сразу удаляется - перемещаем без копирования функций
+                    pt = std::move(const_cast<PrioritizedTask&>(this->tasks.top()));
                     this->tasks.pop();
+                    virtualClock = std::max(virtualClock, pt.schedule.start);
                 } else {
                     continue;
                 }
+                if (admission.queueDelayTarget.count() > 0 && queueDelayExceeded(pt.enqueued) && pt.shed) {
+                    pt.task = std::move(pt.shed);
+                }
+            }
+            activeThreads.fetch_add(1);
+            // Исключение задачи не должно завершать поток пула (и процесс через std::terminate)
+            try {
+                pt.task();
+            } catch (const std::exception& e) {
+                std::cerr << "ThreadPool: Исключение в задаче: " << e.what() << std::endl;
+            } catch (...) {
+                std::cerr << "ThreadPool: Неизвестное исключение в задаче" << std::endl;
             }
-            pt.task();
+            activeThreads.fetch_sub(1);
         }
     });
     currentThreads.fetch_add(1);
@@ -62,11 +77,131 @@ void ThreadPool::addThread()
     }
 }
 
+// Постановка задачи без future
+void ThreadPool::post(int priority, std::function<void()> task)
+{
+    post(priority, TaskSchedule{}, std::move(task));
+}
+
+void ThreadPool::post(int priority, const TaskSchedule& schedule, std::function<void()> task)
+{
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+
+        if(stop.load())
+            throw std::runtime_error("post on stopped ThreadPool");
+
+        PrioritizedTask pt;
+        pt.priority = priority;
+        pt.task = std::move(task);
+        pt.schedule = schedule;
+        if (schedule.deadline == std::chrono::steady_clock::time_point()) {
+            auto now = currentVirtualTime();
+            pt.schedule = TaskSchedule{now, now};
+        }
+        pt.sequence = nextSequence++;
+        tasks.push(std::move(pt));
+    }
+    condition.notify_one();
+}
+
+void ThreadPool::setAdmission(const OverloadOptions& options)
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    admission = options;
+    delayWindowEnd = std::chrono::steady_clock::now() + admission.queueDelayInterval;
+}
+
+bool ThreadPool::tryPost(int priority, std::function<void()> task, std::function<void()> shed)
+{
+    return tryPost(priority, TaskSchedule{}, std::move(task), std::move(shed));
+}
+
+bool ThreadPool::tryPost(int priority, const TaskSchedule& schedule, std::function<void()> task,
+                         std::function<void()> shed)
+{
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+
+        if(stop.load())
+            throw std::runtime_error("post on stopped ThreadPool");
+
+        if (admission.maxQueueDepth > 0 && tasks.size() >= admission.limitFor(priority, admission.maxQueueDepth))
+            return false;
+
+        PrioritizedTask pt;
+        pt.priority = priority;
+        pt.task = std::move(task);
+        pt.shed = std::move(shed);
+        pt.schedule = schedule;
+        if (schedule.deadline == std::chrono::steady_clock::time_point()) {
+            auto now = currentVirtualTime();
+            pt.schedule = TaskSchedule{now, now};
+        }
+        pt.sequence = nextSequence++;
+        tasks.push(std::move(pt));
+    }
+    condition.notify_one();
+    return true;
+}
+
+// Задержка задачи в очереди (вызывается под queueMutex). Минимум задержки за окно показывает, успевает ли
+// пул разбирать очередь: при перегрузке очередь не пустеет и даже самые свежие задачи ждут дольше target
+bool ThreadPool::queueDelayExceeded(std::chrono::steady_clock::time_point enqueued)
+{
+    auto now = std::chrono::steady_clock::now();
+    auto delay = now - enqueued;
+    // Пустая очередь - пул справляется, сколько бы ни ждала эта задача
+    delayWindowMin = std::min(delayWindowMin, tasks.empty() ? std::chrono::steady_clock::duration::zero() : delay);
+    if (now >= delayWindowEnd) {
+        bool overloaded = delayWindowMin > admission.queueDelayTarget;
+        if (overloaded != queueOverloaded.load(std::memory_order_relaxed) && verbose) {
+            std::cout << "ThreadPool: " << (overloaded ? "Очередь перегружена, включён сброс запросов"
+                                                       : "Перегрузка очереди снята") << std::endl;
+        }
+        queueOverloaded.store(overloaded, std::memory_order_relaxed);
+        delayWindowMin = std::chrono::steady_clock::duration::max();
+        delayWindowEnd = now + admission.queueDelayInterval;
+    }
+    return delay > (queueOverloaded.load(std::memory_order_relaxed) ? admission.queueDelayTarget : admission.queueDelayInterval);
+}
+
+size_t ThreadPool::queueSize()
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return tasks.size();
+}
+
+std::chrono::steady_clock::time_point ThreadPool::earliestDeadline()
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return tasks.empty() ? std::chrono::steady_clock::time_point::max() : tasks.top().schedule.deadline;
+}
+
+std::chrono::steady_clock::time_point ThreadPool::virtualTime()
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return currentVirtualTime();
+}
+
+// Под queueMutex. Пустая очередь - пул успевает: виртуальное время догоняет steady_clock
+std::chrono::steady_clock::time_point ThreadPool::currentVirtualTime()
+{
+    if (tasks.empty()) {
+        virtualClock = std::max(virtualClock, std::chrono::steady_clock::now());
+    }
+    return virtualClock;
+}
+
 // Метод мониторинга нагрузки
 void ThreadPool::monitorLoad()
 {
     while (!stop.load()) {
-        std::this_thread::sleep_for(std::chrono::seconds(5));
+        {
+            std::unique_lock<std::mutex> lock(monitorMutex);
+            if (monitorWake.wait_for(lock, std::chrono::seconds(5), [this]() { return stop.load(); }))
+                break;
+        }
 
         size_t taskCount;
         {
@@ -108,6 +243,10 @@ void ThreadPool::shutdown()
     bool expected = false;
     if(stop.compare_exchange_strong(expected, true)) {
         condition.notify_all();
+        {
+            std::lock_guard<std::mutex> lock(monitorMutex);
+        }
+        monitorWake.notify_all();
         for(std::thread &worker: workers)
             if(worker.joinable())
                 worker.join();
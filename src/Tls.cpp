@@ -0,0 +1,174 @@
+#include "headers/Tls.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <fstream>
+#include <iterator>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <vector>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+namespace {
+std::string opensslError() {
+    unsigned long code = ERR_get_error();
+    ERR_clear_error();
+    if (code == 0) return "unknown error";
+    char buffer[256];
+    ERR_error_string_n(code, buffer, sizeof(buffer));
+    return buffer;
+}
+
+// ALPN: поверх TLS обслуживается только HTTP/1.1 (HTTP/2 - h2c без TLS). Клиент, предложивший
+// протоколы без http/1.1, получает no_application_protocol, как требует RFC 7301
+int selectProtocol(SSL*, const unsigned char** out, unsigned char* outLength,
+                   const unsigned char* in, unsigned int inLength, void*) {
+    static const unsigned char serverProtocols[] = "\x08http/1.1";
+    unsigned char* selected = nullptr;
+    if (SSL_select_next_proto(&selected, outLength, serverProtocols, sizeof(serverProtocols) - 1, in, inLength) !=
+        OPENSSL_NPN_NEGOTIATED) {
+        return SSL_TLSEXT_ERR_ALERT_FATAL;
+    }
+    *out = selected;
+    return SSL_TLSEXT_ERR_OK;
+}
+}
+
+TlsContext::TlsContext(const TlsOptions& options)
+    : context(SSL_CTX_new(TLS_server_method())), handshakeCount(0), resumedCount(0), failedCount(0), kernelTlsCount(0) {
+    if (!context) {
+        throw std::runtime_error("TLS: cannot create context: " + opensslError());
+    }
+    try {
+        if (SSL_CTX_use_certificate_chain_file(context, options.certificateFile.c_str()) != 1) {
+            throw std::runtime_error("TLS: cannot load certificate " + options.certificateFile + ": " + opensslError());
+        }
+        if (SSL_CTX_use_PrivateKey_file(context, options.privateKeyFile.c_str(), SSL_FILETYPE_PEM) != 1 ||
+            SSL_CTX_check_private_key(context) != 1) {
+            throw std::runtime_error("TLS: cannot load private key " + options.privateKeyFile + ": " + opensslError());
+        }
+        SSL_CTX_set_min_proto_version(context, TLS1_2_VERSION);
+
+        uint64_t flags = SSL_OP_NO_RENEGOTIATION | SSL_OP_CIPHER_SERVER_PREFERENCE;
+        if (!options.sessionTickets) flags |= SSL_OP_NO_TICKET;
+        if (options.kernelTls) flags |= SSL_OP_ENABLE_KTLS;
+        SSL_CTX_set_options(context, flags);
+        // Буферы записей простаивающего keep-alive соединения возвращаются в кучу
+        SSL_CTX_set_mode(context, SSL_MODE_RELEASE_BUFFERS);
+
+        // Возобновление: кэш сессий на сервере и stateless tickets (в TLS 1.3 - один билет на соединение)
+        static const unsigned char sessionContext[] = "FlaskCpp";
+        SSL_CTX_set_session_id_context(context, sessionContext, sizeof(sessionContext) - 1);
+        SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_SERVER);
+        SSL_CTX_sess_set_cache_size(context, static_cast<long>(options.sessionCacheSize));
+        SSL_CTX_set_timeout(context, static_cast<long>(options.sessionTimeout.count()));
+        SSL_CTX_set_num_tickets(context, options.sessionTickets ? 1 : 0);
+        if (!options.ticketKeyFile.empty()) {
+            std::ifstream file(options.ticketKeyFile, std::ios::binary);
+            std::vector<char> keys((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            if (!file.is_open() && keys.empty()) {
+                throw std::runtime_error("TLS: cannot read ticket key file " + options.ticketKeyFile);
+            }
+            if (keys.size() != 80) {
+                throw std::invalid_argument("TLS: ticket key file must contain exactly 80 bytes");
+            }
+            SSL_CTX_set_tlsext_ticket_keys(context, keys.data(), static_cast<long>(keys.size()));
+        }
+        SSL_CTX_set_alpn_select_cb(context, selectProtocol, nullptr);
+    } catch (...) {
+        SSL_CTX_free(context);
+        throw;
+    }
+    // OpenSSL пишет в сокет через write() без MSG_NOSIGNAL: запись в закрытое клиентом соединение
+    // не должна завершать процесс
+    std::signal(SIGPIPE, SIG_IGN);
+}
+
+TlsContext::~TlsContext() {
+    SSL_CTX_free(context);
+}
+
+bool TlsContext::accept(Connection& conn) {
+    // Рукопожатие, билеты сессии и ответ уходят несколькими записями: без TCP_NODELAY
+    // алгоритм Нейгла задерживает следующую запись до подтверждения предыдущей
+    int flag = 1;
+    setsockopt(conn.socket, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    SSL* ssl = SSL_new(context);
+    if (!ssl || SSL_set_fd(ssl, conn.socket) != 1) {
+        SSL_free(ssl);
+        ERR_clear_error();
+        failedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (SSL_accept(ssl) != 1) {
+        // Сканеры портов, клиенты без TLS и истёкший таймаут чтения: просто закрываем соединение
+        SSL_free(ssl);
+        ERR_clear_error();
+        failedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    handshakeCount.fetch_add(1, std::memory_order_relaxed);
+    if (SSL_session_reused(ssl)) {
+        resumedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (BIO_get_ktls_send(SSL_get_wbio(ssl))) {
+        kernelTlsCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    conn.tls = ssl;
+    return true;
+}
+
+ssize_t TlsContext::read(Connection& conn, char* data, size_t size) {
+    int result = SSL_read(conn.tls, data, static_cast<int>(std::min<size_t>(size, INT_MAX)));
+    if (result > 0) return result;
+    int error = SSL_get_error(conn.tls, result);
+    ERR_clear_error();
+    return error == SSL_ERROR_ZERO_RETURN ? 0 : -1;
+}
+
+bool TlsContext::write(Connection& conn, const char* data, size_t size) {
+    while (size > 0) {
+        size_t written = 0;
+        if (SSL_write_ex(conn.tls, data, size, &written) != 1) {
+            ERR_clear_error();
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool TlsContext::kernelSend(const Connection& conn) {
+    return BIO_get_ktls_send(SSL_get_wbio(conn.tls));
+}
+
+bool TlsContext::sendFile(Connection& conn, int fd, size_t size) {
+    off_t offset = 0;
+    while (static_cast<size_t>(offset) < size) {
+        ossl_ssize_t sent = SSL_sendfile(conn.tls, fd, offset, size - static_cast<size_t>(offset), 0);
+        if (sent <= 0) {
+            ERR_clear_error();
+            return false;
+        }
+        offset += sent;
+    }
+    return true;
+}
+
+bool TlsContext::pending(const Connection& conn) {
+    return SSL_pending(conn.tls) > 0;
+}
+
+void TlsContext::close(Connection& conn) {
+    // Только отправка close_notify: ответный close_notify клиента не ждём
+    SSL_shutdown(conn.tls);
+    SSL_free(conn.tls);
+    ERR_clear_error();
+    conn.tls = nullptr;
+}
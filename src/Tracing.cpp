@@ -0,0 +1,585 @@
+#include "headers/Tracing.h"
+#include "headers/Json.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static_assert((Tracer::ringCapacity & (Tracer::ringCapacity - 1)) == 0,
+              "Tracer::ringCapacity должен быть степенью двойки");
+
+namespace {
+// Строка фиксированной ёмкости: спан копируется в кольцевой буфер без выделения памяти
+template <size_t N>
+struct SpanText {
+    char data[N];
+    uint16_t size = 0;
+
+    void assign(std::string_view value) {
+        size = static_cast<uint16_t>(std::min(value.size(), N));
+        std::memcpy(data, value.data(), size);
+    }
+
+    std::string_view view() const { return std::string_view(data, size); }
+};
+}
+
+// Завершённый спан в кольцевом буфере. Спаны трассы лежат подряд, корень первым
+struct TraceRecord {
+    uint64_t traceHigh = 0;
+    uint64_t traceLow = 0;
+    uint64_t spanId = 0;
+    uint64_t parentId = 0;   // 0 - корень
+    int64_t startNanos = 0;  // С начала эпохи
+    uint64_t durationNanos = 0;
+    const char* name = nullptr;
+    uint32_t threadId = 0;
+    uint16_t spanCount = 0;  // У корня: спанов в трассе вместе с ним
+    int16_t status = 0;      // У корня: код ответа, 0 - неизвестен
+    SpanText<120> detail;    // У корня: "METHOD path"
+};
+
+// Кольцевой буфер одного рабочего потока: один писатель (рабочий поток), один читатель (поток записи)
+struct TraceRing {
+    std::atomic<bool> inUse{true};
+    alignas(64) std::atomic<size_t> head{0}; // Следующая позиция записи
+    alignas(64) std::atomic<size_t> tail{0}; // Следующая позиция чтения
+    alignas(64) std::atomic<uint64_t> dropped{0};
+    std::unique_ptr<TraceRecord[]> records;
+
+    TraceRing() : records(new TraceRecord[Tracer::ringCapacity]) {}
+};
+
+namespace {
+struct OpenSpan {
+    const char* name;
+    SpanText<120> detail;
+    std::chrono::steady_clock::time_point start;
+    uint64_t durationNanos;
+    uint64_t spanId;
+    int parent;
+};
+
+// Трасса, которую записывает поток. Буфер спанов выделяется при первой трассе потока и переиспользуется
+struct ThreadTrace {
+    Tracer* tracer = nullptr;
+    uint64_t traceHigh = 0;
+    uint64_t traceLow = 0;
+    int64_t wallStartNanos = 0;
+    std::chrono::steady_clock::time_point start;
+    std::vector<OpenSpan> spans;
+    size_t spanLimit = 0;
+    int current = -1;
+    int status = 0;
+};
+
+thread_local ThreadTrace* activeTrace = nullptr;
+thread_local std::unique_ptr<ThreadTrace> threadTrace;
+thread_local uint64_t randomState = 0;
+thread_local uint32_t cachedThreadId = 0;
+
+// Буферы, занятые текущим потоком; освобождаются при его завершении, как буферы AccessLog
+struct RingLease {
+    std::vector<std::pair<uint64_t, std::shared_ptr<TraceRing>>> rings;
+
+    ~RingLease() {
+        for (auto& entry : rings) {
+            entry.second->inUse.store(false);
+        }
+    }
+};
+
+thread_local RingLease ringLease;
+thread_local uint64_t cachedTracerId = 0;
+thread_local TraceRing* cachedRing = nullptr;
+
+std::atomic<uint64_t> nextTracerId{1};
+
+// splitmix64: выборка и идентификаторы трасс не требуют криптостойкости, но должны различаться между потоками
+uint64_t nextRandom() {
+    if (randomState == 0) {
+        std::random_device device;
+        randomState = (uint64_t(device()) << 32) ^ device() ^ uint64_t(syscall(SYS_gettid));
+    }
+    uint64_t z = (randomState += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+uint32_t currentThreadId() {
+    if (cachedThreadId == 0) cachedThreadId = static_cast<uint32_t>(syscall(SYS_gettid));
+    return cachedThreadId;
+}
+
+void appendHex(std::string& out, uint64_t value) {
+    static const char hex[] = "0123456789abcdef";
+    char buffer[16];
+    for (int i = 15; i >= 0; --i) {
+        buffer[i] = hex[value & 0xf];
+        value >>= 4;
+    }
+    out.append(buffer, sizeof(buffer));
+}
+
+std::string hexId(uint64_t high, uint64_t low) {
+    std::string id;
+    id.reserve(32);
+    appendHex(id, high);
+    appendHex(id, low);
+    return id;
+}
+
+// Микросекунды с тремя знаками после точки: единица времени Trace Event Format
+std::string micros(uint64_t nanos) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%llu.%03u", static_cast<unsigned long long>(nanos / 1000),
+                  static_cast<unsigned>(nanos % 1000));
+    return buffer;
+}
+
+void splitRequest(std::string_view request, std::string_view& method, std::string_view& path) {
+    size_t space = request.find(' ');
+    method = request.substr(0, space);
+    path = space == std::string_view::npos ? std::string_view() : request.substr(space + 1);
+}
+
+// Атрибут OTLP/JSON: {"key":...,"value":{"stringValue":...}}
+void otlpAttribute(JsonWriter& json, std::string_view key, std::string_view value) {
+    json.beginObject().field("key", key).key("value").beginObject().field("stringValue", value).endObject().endObject();
+}
+
+// intValue в OTLP/JSON - строка (int64 в proto3 JSON)
+void otlpAttribute(JsonWriter& json, std::string_view key, long long value) {
+    json.beginObject().field("key", key).key("value").beginObject().field("intValue", std::to_string(value)).endObject().endObject();
+}
+}
+
+// Реализация Tracer
+
+Tracer::Tracer(const TracingOptions& options)
+    : options(options), id(nextTracerId.fetch_add(1)), running(false),
+      fd(-1), fileSize(0), batchTraces(0), droppedOnWrite(0), written(0) {
+    if (!(options.sampleRate >= 0.0 && options.sampleRate <= 1.0)) {
+        throw std::invalid_argument("tracing: sample rate must be between 0 and 1");
+    }
+    // Корень и хотя бы один этап; индекс спана в трассе и spanCount - 16 бит
+    if (options.maxSpansPerTrace < 2 || options.maxSpansPerTrace > ringCapacity) {
+        throw std::invalid_argument("tracing: maxSpansPerTrace must be between 2 and " + std::to_string(ringCapacity));
+    }
+    sampleThreshold = options.sampleRate >= 1.0 ? UINT64_MAX
+                      : static_cast<uint64_t>(options.sampleRate * 18446744073709551616.0);
+}
+
+Tracer::~Tracer() {
+    stop();
+}
+
+void Tracer::start() {
+    if (running.load()) return;
+    std::error_code error;
+    std::filesystem::create_directories(options.directory, error);
+    openFile();
+    if (fd == -1) {
+        throw std::runtime_error("Failed to open trace file in " + options.directory);
+    }
+    running.store(true);
+    writerThread = std::thread(&Tracer::writerLoop, this);
+}
+
+void Tracer::stop() {
+    if (!writerThread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        running.store(false);
+    }
+    wakeCondition.notify_one();
+    writerThread.join();
+    closeFile();
+}
+
+bool Tracer::recording() {
+    return activeTrace != nullptr;
+}
+
+void Tracer::setStatus(int status) {
+    if (activeTrace) activeTrace->status = status;
+}
+
+bool Tracer::beginRequest() {
+    if (activeTrace) return false;
+    // Head: запрос вне выборки не стоит ничего, кроме одного случайного числа
+    if (options.sampling == TraceSampling::Head && nextRandom() >= sampleThreshold) return false;
+
+    if (!threadTrace) {
+        threadTrace = std::make_unique<ThreadTrace>();
+    }
+    ThreadTrace& trace = *threadTrace;
+    if (trace.spans.capacity() < options.maxSpansPerTrace) {
+        trace.spans.reserve(options.maxSpansPerTrace);
+    }
+    trace.tracer = this;
+    trace.spanLimit = options.maxSpansPerTrace;
+    trace.traceHigh = nextRandom();
+    trace.traceLow = nextRandom();
+    trace.start = std::chrono::steady_clock::now();
+    trace.wallStartNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    trace.status = 0;
+    trace.spans.clear();
+    trace.spans.push_back({"request", {}, trace.start, 0, nextRandom(), -1});
+    trace.current = 0;
+    activeTrace = &trace;
+    return true;
+}
+
+int Tracer::openSpan(const char* name, std::string_view detail) {
+    ThreadTrace& trace = *activeTrace;
+    if (trace.spans.size() >= trace.spanLimit) return -1;
+    trace.spans.push_back({name, {}, std::chrono::steady_clock::now(), 0, nextRandom(), trace.current});
+    trace.spans.back().detail.assign(detail);
+    trace.current = static_cast<int>(trace.spans.size() - 1);
+    return trace.current;
+}
+
+void Tracer::closeSpan(int index) {
+    ThreadTrace* trace = activeTrace;
+    // Трасса закончилась раньше спана: спан больше не принадлежит ей
+    if (!trace || static_cast<size_t>(index) >= trace->spans.size()) return;
+    OpenSpan& span = trace->spans[index];
+    span.durationNanos = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - span.start).count());
+    trace->current = span.parent;
+}
+
+void Tracer::cancelRequest() {
+    if (activeTrace && activeTrace->tracer == this) {
+        activeTrace = nullptr;
+    }
+}
+
+void Tracer::endRequest(std::string_view method, std::string_view path) {
+    ThreadTrace* trace = activeTrace;
+    if (!trace || trace->tracer != this) return;
+    activeTrace = nullptr;
+
+    OpenSpan& root = trace->spans[0];
+    root.durationNanos = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - root.start).count());
+
+    if (options.sampling == TraceSampling::Tail) {
+        bool slow = root.durationNanos >= static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(options.slowThreshold).count());
+        if (!slow && trace->status < 500 && nextRandom() >= sampleThreshold) return;
+    }
+
+    TraceRing& ring = localRing();
+    size_t count = trace->spans.size();
+    size_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) + count > ringCapacity) {
+        // Поток записи не успевает: трасса теряется целиком
+        ring.dropped.store(ring.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+
+    uint32_t threadId = currentThreadId();
+    for (size_t i = 0; i < count; ++i) {
+        const OpenSpan& span = trace->spans[i];
+        TraceRecord& record = ring.records[(head + i) & (ringCapacity - 1)];
+        record.traceHigh = trace->traceHigh;
+        record.traceLow = trace->traceLow;
+        record.spanId = span.spanId;
+        record.parentId = span.parent >= 0 ? trace->spans[span.parent].spanId : 0;
+        record.startNanos = trace->wallStartNanos + std::chrono::duration_cast<std::chrono::nanoseconds>(
+            span.start - trace->start).count();
+        record.durationNanos = span.durationNanos;
+        record.name = span.name;
+        record.threadId = threadId;
+        record.spanCount = i == 0 ? static_cast<uint16_t>(count) : 0;
+        record.status = i == 0 ? static_cast<int16_t>(trace->status) : 0;
+        if (i == 0) {
+            char request[sizeof(record.detail.data)];
+            size_t methodSize = std::min(method.size(), sizeof(request) - 1);
+            std::memcpy(request, method.data(), methodSize);
+            request[methodSize] = ' ';
+            size_t pathSize = std::min(path.size(), sizeof(request) - methodSize - 1);
+            std::memcpy(request + methodSize + 1, path.data(), pathSize);
+            record.detail.assign(std::string_view(request, methodSize + 1 + pathSize));
+        } else {
+            record.detail = span.detail;
+        }
+    }
+    ring.head.store(head + count, std::memory_order_release);
+}
+
+TraceRing& Tracer::localRing() {
+    if (cachedTracerId == id) return *cachedRing;
+
+    for (auto& entry : ringLease.rings) {
+        if (entry.first == id) {
+            cachedTracerId = id;
+            cachedRing = entry.second.get();
+            return *cachedRing;
+        }
+    }
+
+    // Первая трасса потока: берём освободившийся буфер или создаём новый
+    std::shared_ptr<TraceRing> ring;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        for (auto& candidate : rings) {
+            bool expected = false;
+            if (candidate->inUse.compare_exchange_strong(expected, true)) {
+                ring = candidate;
+                break;
+            }
+        }
+        if (!ring) {
+            ring = std::make_shared<TraceRing>();
+            rings.push_back(ring);
+        }
+    }
+    ringLease.rings.emplace_back(id, ring);
+    cachedTracerId = id;
+    cachedRing = ring.get();
+    return *cachedRing;
+}
+
+uint64_t Tracer::tracesDropped() const {
+    uint64_t total = droppedOnWrite.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    for (const auto& ring : rings) {
+        total += ring->dropped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+bool Tracer::parseFormat(const std::string& name, TraceFormat& format) {
+    if (name == "chrome") {
+        format = TraceFormat::Chrome;
+    } else if (name == "otlp") {
+        format = TraceFormat::Otlp;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool Tracer::parseSampling(const std::string& name, TraceSampling& sampling) {
+    if (name == "head") {
+        sampling = TraceSampling::Head;
+    } else if (name == "tail") {
+        sampling = TraceSampling::Tail;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void Tracer::writerLoop() {
+    while (running.load()) {
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCondition.wait_for(lock, options.flushInterval, [this]() { return !running.load(); });
+        }
+        drain();
+    }
+    // Трассы, завершённые до остановки
+    drain();
+}
+
+void Tracer::drain() {
+    std::vector<std::shared_ptr<TraceRing>> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        snapshot = rings;
+    }
+
+    // Спаны трассы могут переходить через конец буфера: форматирование получает их подряд
+    std::vector<TraceRecord> spans;
+    for (const auto& ring : snapshot) {
+        size_t tail = ring->tail.load(std::memory_order_relaxed);
+        size_t head = ring->head.load(std::memory_order_acquire);
+        while (tail != head) {
+            size_t count = ring->records[tail & (ringCapacity - 1)].spanCount;
+            spans.assign(count, TraceRecord());
+            for (size_t i = 0; i < count; ++i) {
+                spans[i] = ring->records[(tail + i) & (ringCapacity - 1)];
+            }
+            tail += count;
+            ring->tail.store(tail, std::memory_order_release);
+
+            if (options.format == TraceFormat::Chrome) {
+                formatChrome(spans.data(), count);
+            } else {
+                formatOtlp(spans.data(), count);
+            }
+            ++batchTraces;
+            if (batch.size() >= 64 * 1024) flush();
+        }
+    }
+    flush();
+}
+
+void Tracer::formatChrome(const TraceRecord* spans, size_t count) {
+    std::string traceId = hexId(spans[0].traceHigh, spans[0].traceLow);
+    long long pid = static_cast<long long>(getpid());
+    for (size_t i = 0; i < count; ++i) {
+        const TraceRecord& span = spans[i];
+        batch += ",\n";
+        JsonWriter json(batch);
+        json.beginObject()
+            .field("name", span.name)
+            .field("cat", "flaskcpp")
+            .field("ph", "X")
+            .key("ts").rawValue(micros(static_cast<uint64_t>(span.startNanos)))
+            .key("dur").rawValue(micros(span.durationNanos))
+            .field("pid", pid)
+            .field("tid", span.threadId)
+            .key("args").beginObject()
+            .field("trace_id", traceId);
+        if (i == 0) {
+            std::string_view method, path;
+            splitRequest(span.detail.view(), method, path);
+            json.field("method", method).field("path", path);
+            if (span.status) json.field("status", static_cast<int>(span.status));
+        } else if (span.detail.size) {
+            json.field("detail", span.detail.view());
+        }
+        json.endObject().endObject();
+    }
+}
+
+void Tracer::formatOtlp(const TraceRecord* spans, size_t count) {
+    std::string traceId = hexId(spans[0].traceHigh, spans[0].traceLow);
+    JsonWriter json(batch);
+    json.beginObject().key("resourceSpans").beginArray().beginObject()
+        .key("resource").beginObject().key("attributes").beginArray();
+    otlpAttribute(json, "service.name", "flaskcpp");
+    otlpAttribute(json, "process.pid", static_cast<long long>(getpid()));
+    json.endArray().endObject()
+        .key("scopeSpans").beginArray().beginObject()
+        .key("scope").beginObject().field("name", "flaskcpp").endObject()
+        .key("spans").beginArray();
+
+    std::string spanId;
+    for (size_t i = 0; i < count; ++i) {
+        const TraceRecord& span = spans[i];
+        json.beginObject().field("traceId", traceId);
+        spanId.clear();
+        appendHex(spanId, span.spanId);
+        json.field("spanId", spanId);
+        if (span.parentId) {
+            spanId.clear();
+            appendHex(spanId, span.parentId);
+            json.field("parentSpanId", spanId);
+        }
+        // SPAN_KIND_SERVER для запроса, SPAN_KIND_INTERNAL для этапов
+        json.field("name", span.name).field("kind", i == 0 ? 2 : 1)
+            .field("startTimeUnixNano", std::to_string(span.startNanos))
+            .field("endTimeUnixNano", std::to_string(span.startNanos + static_cast<int64_t>(span.durationNanos)))
+            .key("attributes").beginArray();
+        otlpAttribute(json, "thread.id", static_cast<long long>(span.threadId));
+        if (i == 0) {
+            std::string_view method, path;
+            splitRequest(span.detail.view(), method, path);
+            otlpAttribute(json, "http.request.method", method);
+            otlpAttribute(json, "url.path", path);
+            if (span.status) otlpAttribute(json, "http.response.status_code", static_cast<long long>(span.status));
+        } else if (span.detail.size) {
+            otlpAttribute(json, "flaskcpp.detail", span.detail.view());
+        }
+        json.endArray();
+        if (i == 0 && span.status >= 500) {
+            // STATUS_CODE_ERROR
+            json.key("status").beginObject().field("code", 2).endObject();
+        }
+        json.endObject();
+    }
+    json.endArray().endObject().endArray().endObject().endArray().endObject();
+    batch += '\n';
+}
+
+void Tracer::flush() {
+    if (batch.empty()) return;
+
+    if (options.rotateBytes > 0 && fd != -1 && fileSize > 0 && fileSize + batch.size() > options.rotateBytes) {
+        closeFile();
+    }
+    if (fd == -1) {
+        // Новый файл после ротации или после ошибки открытия: пробуем при каждой пачке
+        openFile();
+    }
+
+    const char* data = batch.data();
+    size_t left = batch.size();
+    while (fd != -1 && left > 0) {
+        ssize_t w = ::write(fd, data, left);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        data += w;
+        left -= static_cast<size_t>(w);
+    }
+    if (left > 0) {
+        droppedOnWrite.fetch_add(batchTraces, std::memory_order_relaxed);
+    } else {
+        written.fetch_add(batchTraces, std::memory_order_relaxed);
+    }
+    fileSize += batch.size() - left;
+
+    batch.clear();
+    batchTraces = 0;
+}
+
+void Tracer::openFile() {
+    // trace-<pid>-20260118-153000.json (с суффиксом .N, если имя уже занято)
+    std::time_t now = std::time(nullptr);
+    std::tm tm;
+    localtime_r(&now, &tm);
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm);
+
+    const char* extension = options.format == TraceFormat::Chrome ? ".json" : ".jsonl";
+    std::string base = options.directory + "/trace-" + std::to_string(getpid()) + "-" + stamp;
+    std::string path = base + extension;
+    for (int n = 1; ::access(path.c_str(), F_OK) == 0; ++n) {
+        path = base + "." + std::to_string(n) + extension;
+    }
+
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    fileSize = 0;
+    if (fd == -1) {
+        std::cerr << "Failed to open trace file " << path << ": " << std::strerror(errno) << std::endl;
+        return;
+    }
+    if (options.format == TraceFormat::Chrome) {
+        // Первое событие - имя процесса, поэтому каждое следующее начинается с запятой
+        std::string header = "[{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + std::to_string(getpid()) +
+                             ",\"args\":{\"name\":\"flaskcpp\"}}";
+        if (::write(fd, header.data(), header.size()) > 0) fileSize = header.size();
+    }
+}
+
+void Tracer::closeFile() {
+    if (fd == -1) return;
+    // Закрывающая скобка делает файл корректным JSON; незакрытый файл (процесс упал) Chrome и Perfetto тоже читают
+    if (options.format == TraceFormat::Chrome) {
+        static const char footer[] = "\n]\n";
+        if (::write(fd, footer, sizeof(footer) - 1) < 0) {
+            std::cerr << "Failed to finish trace file: " << std::strerror(errno) << std::endl;
+        }
+    }
+    close(fd);
+    fd = -1;
+}
@@ -0,0 +1,503 @@
+#include "headers/Upstream.h"
+#include "headers/StringUtils.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Сервер группы: адрес, простаивающие соединения и состояние здоровья
+struct UpstreamServer {
+    std::string name; // host:port
+    sockaddr_storage address = {};
+    socklen_t addressLength = 0;
+    bool resolved = false;
+
+    std::mutex idleMutex;
+    std::vector<int> idle;
+
+    std::atomic<size_t> active{0};
+    std::atomic<int> fails{0};
+    std::atomic<bool> healthy{true};
+};
+
+namespace {
+// Учитывает активный запрос сервера для least-connections
+struct ActiveGuard {
+    UpstreamServer& server;
+    explicit ActiveGuard(UpstreamServer& server) : server(server) { server.active.fetch_add(1); }
+    ~ActiveGuard() { server.active.fetch_sub(1); }
+};
+
+bool sendAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return false;
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+// Отслеживает границы тела в формате chunked, не изменяя передаваемые байты
+class ChunkedScanner {
+public:
+    // Возвращает, сколько байт из data относится к телу; после конца тела done() == true
+    size_t feed(const char* data, size_t size) {
+        size_t i = 0;
+        while (i < size && state != Done) {
+            char c = data[i];
+            switch (state) {
+                case Size:
+                    if (std::isxdigit((unsigned char)c)) {
+                        chunkSize = chunkSize * 16 + static_cast<size_t>(std::isdigit((unsigned char)c) ? c - '0' : std::tolower(c) - 'a' + 10);
+                    } else if (c == '\n') {
+                        endSizeLine();
+                    } else if (c != '\r') {
+                        state = SizeExtension;
+                    }
+                    ++i;
+                    break;
+                case SizeExtension:
+                    if (c == '\n') endSizeLine();
+                    ++i;
+                    break;
+                case Data: {
+                    size_t take = std::min(chunkSize, size - i);
+                    chunkSize -= take;
+                    i += take;
+                    if (chunkSize == 0) state = DataEnd;
+                    break;
+                }
+                case DataEnd:
+                    if (c == '\n') state = Size;
+                    ++i;
+                    break;
+                case Trailer:
+                    if (c == '\n') {
+                        if (lineLength == 0) state = Done;
+                        lineLength = 0;
+                    } else if (c != '\r') {
+                        ++lineLength;
+                    }
+                    ++i;
+                    break;
+                case Done:
+                    break;
+            }
+        }
+        return i;
+    }
+
+    bool done() const { return state == Done; }
+
+private:
+    enum State { Size, SizeExtension, Data, DataEnd, Trailer, Done };
+    State state = Size;
+    size_t chunkSize = 0;
+    size_t lineLength = 0;
+
+    void endSizeLine() {
+        if (chunkSize == 0) {
+            state = Trailer;
+            lineLength = 0;
+        } else {
+            state = Data;
+        }
+    }
+};
+}
+
+// Реализация UpstreamPool
+
+bool UpstreamPool::isHopByHopHeader(std::string_view name) {
+    return equalsIgnoreCase(name, "Connection") || equalsIgnoreCase(name, "Keep-Alive") ||
+           equalsIgnoreCase(name, "Proxy-Connection") || equalsIgnoreCase(name, "TE") ||
+           equalsIgnoreCase(name, "Trailer") || equalsIgnoreCase(name, "Upgrade");
+}
+
+UpstreamPool::UpstreamPool(const std::vector<std::string>& serverAddresses, const UpstreamOptions& options)
+    : options(options), nextServer(0), running(false) {
+    for (const auto& address : serverAddresses) {
+        auto server = std::make_unique<UpstreamServer>();
+        server->name = address;
+
+        size_t colonPos = address.rfind(':');
+        std::string host = colonPos == std::string::npos ? address : address.substr(0, colonPos);
+        std::string port = colonPos == std::string::npos ? "80" : address.substr(colonPos + 1);
+        addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* result = nullptr;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) == 0 && result) {
+            std::memcpy(&server->address, result->ai_addr, result->ai_addrlen);
+            server->addressLength = result->ai_addrlen;
+            server->resolved = true;
+            freeaddrinfo(result);
+        } else {
+            std::cerr << "Failed to resolve upstream: " << address << std::endl;
+            server->healthy.store(false);
+        }
+        servers.push_back(std::move(server));
+    }
+}
+
+UpstreamPool::~UpstreamPool() {
+    stop();
+    for (auto& server : servers) {
+        std::lock_guard<std::mutex> lock(server->idleMutex);
+        for (int fd : server->idle) close(fd);
+        server->idle.clear();
+    }
+}
+
+void UpstreamPool::start() {
+    if (running.load() || options.healthInterval.count() <= 0) return;
+    running.store(true);
+    healthThread = std::thread(&UpstreamPool::healthLoop, this);
+}
+
+void UpstreamPool::stop() {
+    if (!healthThread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(healthMutex);
+        running.store(false);
+    }
+    healthCondition.notify_one();
+    healthThread.join();
+}
+
+size_t UpstreamPool::healthyCount() const {
+    size_t count = 0;
+    for (const auto& server : servers) {
+        if (server->healthy.load()) ++count;
+    }
+    return count;
+}
+
+UpstreamServer* UpstreamPool::pickServer(const std::vector<UpstreamServer*>& exclude) {
+    size_t n = servers.size();
+    if (n == 0) return nullptr;
+    size_t start = nextServer.fetch_add(1);
+
+    // Сначала среди здоровых; если здоровых не осталось, пробуем остальные (лучше попытка, чем сразу 502)
+    for (int pass = 0; pass < 2; ++pass) {
+        UpstreamServer* best = nullptr;
+        for (size_t k = 0; k < n; ++k) {
+            UpstreamServer* server = servers[(start + k) % n].get();
+            if (!server->resolved) continue;
+            if (std::find(exclude.begin(), exclude.end(), server) != exclude.end()) continue;
+            if (pass == 0 && !server->healthy.load()) continue;
+            if (options.policy == BalancePolicy::RoundRobin) return server;
+            if (!best || server->active.load() < best->active.load()) best = server;
+        }
+        if (best) return best;
+    }
+    return nullptr;
+}
+
+int UpstreamPool::connectServer(UpstreamServer& server) {
+    int fd = socket(server.address.ss_family, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd == -1) return -1;
+
+    if (connect(fd, (const sockaddr*)&server.address, server.addressLength) == -1) {
+        if (errno != EINPROGRESS) {
+            close(fd);
+            return -1;
+        }
+        pollfd pfd = {fd, POLLOUT, 0};
+        int error = 0;
+        socklen_t errorLength = sizeof(error);
+        if (poll(&pfd, 1, static_cast<int>(options.connectTimeout.count())) != 1 ||
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorLength) == -1 || error != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) & ~O_NONBLOCK);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct timeval tv;
+    tv.tv_sec = static_cast<time_t>(options.readTimeout.count() / 1000);
+    tv.tv_usec = static_cast<suseconds_t>((options.readTimeout.count() % 1000) * 1000);
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+int UpstreamPool::acquire(UpstreamServer& server, bool& reused) {
+    {
+        std::lock_guard<std::mutex> lock(server.idleMutex);
+        while (!server.idle.empty()) {
+            int fd = server.idle.back();
+            server.idle.pop_back();
+            // Соединение, закрытое upstream за время простоя, читается как EOF
+            char probe;
+            ssize_t r = recv(fd, &probe, 1, MSG_PEEK | MSG_DONTWAIT);
+            if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                reused = true;
+                return fd;
+            }
+            close(fd);
+        }
+    }
+    reused = false;
+    return connectServer(server);
+}
+
+void UpstreamPool::release(UpstreamServer& server, int fd, bool reusable) {
+    if (reusable) {
+        std::lock_guard<std::mutex> lock(server.idleMutex);
+        if (server.idle.size() < options.maxIdlePerServer) {
+            server.idle.push_back(fd);
+            return;
+        }
+    }
+    close(fd);
+}
+
+bool UpstreamPool::forward(int clientSocket, std::string_view requestHead, std::string_view bufferedBody, size_t pendingBody,
+                           bool headRequest, const std::function<bool()>& clientKeepAlive, ProxyResult& result) {
+    result = ProxyResult();
+    std::vector<UpstreamServer*> failed;
+    bool bodyConsumed = false; // Часть тела уже прочитана из клиента: повторить запрос нельзя
+    char chunk[16384];
+
+    for (int attempt = 0; attempt < static_cast<int>(servers.size()) + 2; ++attempt) {
+        UpstreamServer* server = pickServer(failed);
+        if (!server) return false;
+
+        bool reused = false;
+        int fd = acquire(*server, reused);
+        if (fd == -1) {
+            if (server->fails.fetch_add(1) + 1 >= options.maxFails) server->healthy.store(false);
+            failed.push_back(server);
+            continue;
+        }
+        ActiveGuard active(*server);
+
+        // Запрос: заголовки, уже прочитанная часть тела, затем остаток тела прямо из сокета клиента
+        bool sent = sendAll(fd, requestHead.data(), requestHead.size()) &&
+                    sendAll(fd, bufferedBody.data(), bufferedBody.size());
+        size_t left = pendingBody;
+        while (sent && left > 0) {
+            bodyConsumed = true;
+            ssize_t r = recv(clientSocket, chunk, std::min(left, sizeof(chunk)), 0);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) {
+                // Клиент не дослал тело: отвечать некому
+                close(fd);
+                result.clientKeepAlive = false;
+                return true;
+            }
+            sent = sendAll(fd, chunk, static_cast<size_t>(r));
+            left -= static_cast<size_t>(r);
+        }
+
+        // Заголовки ответа
+        std::string buffer;
+        size_t headEnd = std::string::npos;
+        while (sent && (headEnd = buffer.find("\r\n\r\n")) == std::string::npos && buffer.size() < 64 * 1024) {
+            ssize_t r = recv(fd, chunk, sizeof(chunk), 0);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) break;
+            buffer.append(chunk, static_cast<size_t>(r));
+        }
+        if (headEnd == std::string::npos) {
+            close(fd);
+            if (!buffer.empty() || bodyConsumed) return false;
+            // Ничего не получили: повторяем на другом соединении. Старое keep-alive соединение
+            // могло быть закрыто upstream - это не ошибка сервера
+            if (!reused) {
+                if (server->fails.fetch_add(1) + 1 >= options.maxFails) server->healthy.store(false);
+                failed.push_back(server);
+            }
+            continue;
+        }
+        server->fails.store(0);
+
+        // Разбор стартовой строки и заголовков ответа
+        std::string_view head(buffer.data(), headEnd);
+        size_t lineEnd = head.find("\r\n");
+        std::string_view statusLine = head.substr(0, lineEnd);
+        size_t space = statusLine.find(' ');
+        std::string_view statusText = space == std::string_view::npos ? std::string_view("502 Bad Gateway") : statusLine.substr(space + 1);
+        result.status = 0;
+        for (size_t i = 0; i < 3 && i < statusText.size() && std::isdigit((unsigned char)statusText[i]); ++i) {
+            result.status = result.status * 10 + (statusText[i] - '0');
+        }
+
+        bool chunked = false;
+        bool hasLength = false;
+        size_t contentLength = 0;
+        bool upstreamClose = statusLine.compare(0, 8, "HTTP/1.0") == 0;
+        std::string clientHead;
+        std::string_view lengthLine;
+        clientHead.reserve(headEnd + 64);
+        clientHead += "HTTP/1.1 ";
+        clientHead += statusText;
+        clientHead += "\r\n";
+        size_t pos = lineEnd == std::string_view::npos ? head.size() : lineEnd + 2;
+        while (pos < head.size()) {
+            size_t next = head.find("\r\n", pos);
+            if (next == std::string_view::npos) next = head.size();
+            std::string_view line = head.substr(pos, next - pos);
+            pos = next + 2;
+            size_t colonPos = line.find(':');
+            if (colonPos == std::string_view::npos) continue;
+            std::string_view name = line.substr(0, colonPos);
+            std::string_view value = line.substr(colonPos + 1);
+            if (equalsIgnoreCase(name, "Connection")) {
+                if (containsIgnoreCase(value, "close")) upstreamClose = true;
+                else if (containsIgnoreCase(value, "keep-alive")) upstreamClose = false;
+            }
+            if (isHopByHopHeader(name)) continue;
+            if (equalsIgnoreCase(name, "Transfer-Encoding") && containsIgnoreCase(value, "chunked")) chunked = true;
+            if (equalsIgnoreCase(name, "Content-Length")) {
+                hasLength = true;
+                contentLength = 0;
+                for (char c : value) {
+                    if (c >= '0' && c <= '9') contentLength = contentLength * 10 + static_cast<size_t>(c - '0');
+                }
+                // Добавляется после разбора: при chunked заголовок отбрасывается
+                lengthLine = line;
+                continue;
+            }
+            clientHead.append(line.data(), line.size());
+            clientHead += "\r\n";
+        }
+        // RFC 9112 §6.1: при Transfer-Encoding Content-Length не передаётся дальше, иначе следующий узел
+        // может разделить ответ по другой границе. Такой ответ - признак ошибки upstream, соединение закрываем
+        bool conflictingLength = chunked && hasLength;
+        if (chunked) {
+            hasLength = false;
+        } else if (hasLength) {
+            clientHead.append(lengthLine.data(), lengthLine.size());
+            clientHead += "\r\n";
+        }
+
+        bool noBody = headRequest || (result.status >= 100 && result.status < 200) || result.status == 204 || result.status == 304;
+        bool untilClose = !noBody && !chunked && !hasLength;
+        result.clientKeepAlive = !untilClose && clientKeepAlive();
+        clientHead += "Connection: ";
+        clientHead += result.clientKeepAlive ? "keep-alive" : "close";
+        clientHead += "\r\n\r\n";
+
+        // Тело ответа передаётся клиенту по мере поступления
+        std::string_view pending(buffer.data() + headEnd + 4, buffer.size() - headEnd - 4);
+        size_t remaining = hasLength ? contentLength : 0;
+        ChunkedScanner scanner;
+        bool complete = noBody;
+        bool upstreamReusable = !upstreamClose && !untilClose && !conflictingLength;
+        bool clientOk = true;
+
+        auto relay = [&](std::string_view data) {
+            size_t take = data.size();
+            if (chunked) {
+                take = scanner.feed(data.data(), data.size());
+                complete = scanner.done();
+            } else if (hasLength) {
+                take = std::min(remaining, data.size());
+                remaining -= take;
+                complete = remaining == 0;
+            }
+            // Лишние байты после конца тела - upstream нарушил протокол, соединение не переиспользуем
+            if (take < data.size()) upstreamReusable = false;
+            result.bytes += take;
+            if (!clientOk) return;
+            if (!clientHead.empty()) {
+                // Заголовки уходят одним сегментом с первой порцией тела
+                clientHead.append(data.data(), take);
+                clientOk = sendAll(clientSocket, clientHead.data(), clientHead.size());
+                clientHead.clear();
+            } else if (take > 0) {
+                clientOk = sendAll(clientSocket, data.data(), take);
+            }
+        };
+
+        if (noBody || (hasLength && contentLength == 0)) {
+            complete = true;
+            relay(std::string_view());
+        } else {
+            if (!pending.empty()) relay(pending);
+            while (!complete && clientOk) {
+                ssize_t r = recv(fd, chunk, sizeof(chunk), 0);
+                if (r < 0 && errno == EINTR) continue;
+                if (r <= 0) {
+                    // Для ответа «до закрытия соединения» EOF и есть конец тела
+                    complete = untilClose;
+                    upstreamReusable = false;
+                    break;
+                }
+                relay(std::string_view(chunk, static_cast<size_t>(r)));
+            }
+            // Тело оказалось пустым: заголовки ещё не отправлены
+            if (!clientHead.empty() && clientOk) relay(std::string_view());
+        }
+
+        if (!complete || !clientOk) {
+            // Ответ оборван: клиент не сможет определить конец тела
+            result.clientKeepAlive = false;
+            upstreamReusable = false;
+        }
+        release(*server, fd, upstreamReusable && complete);
+        return true;
+    }
+    return false;
+}
+
+bool UpstreamPool::checkHealth(UpstreamServer& server) {
+    if (!server.resolved) return false;
+    int fd = connectServer(server);
+    if (fd == -1) return false;
+    if (options.healthPath.empty()) {
+        close(fd);
+        return true;
+    }
+
+    struct timeval tv;
+    tv.tv_sec = static_cast<time_t>(options.connectTimeout.count() / 1000);
+    tv.tv_usec = static_cast<suseconds_t>((options.connectTimeout.count() % 1000) * 1000);
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    std::string request = "GET " + options.healthPath + " HTTP/1.1\r\nHost: " + server.name +
+                          "\r\nUser-Agent: FlaskCpp-HealthCheck\r\nConnection: close\r\n\r\n";
+    bool ok = false;
+    if (sendAll(fd, request.data(), request.size())) {
+        char buffer[64];
+        size_t received = 0;
+        while (received < 12) {
+            ssize_t r = recv(fd, buffer + received, sizeof(buffer) - received, 0);
+            if (r <= 0) break;
+            received += static_cast<size_t>(r);
+        }
+        // "HTTP/1.1 200" - проверяем класс статуса
+        ok = received >= 12 && std::memcmp(buffer, "HTTP/", 5) == 0 && (buffer[9] == '2' || buffer[9] == '3');
+    }
+    close(fd);
+    return ok;
+}
+
+void UpstreamPool::healthLoop() {
+    while (running.load()) {
+        for (auto& server : servers) {
+            bool ok = checkHealth(*server);
+            bool wasHealthy = server->healthy.exchange(ok);
+            if (ok) server->fails.store(0);
+            if (ok != wasHealthy) {
+                std::cerr << "Upstream " << server->name << (ok ? " is up" : " is down") << std::endl;
+            }
+        }
+        std::unique_lock<std::mutex> lock(healthMutex);
+        healthCondition.wait_for(lock, options.healthInterval, [this]() { return !running.load(); });
+    }
+}
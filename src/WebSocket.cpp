@@ -0,0 +1,703 @@
+#include "headers/WebSocket.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+constexpr uint8_t opContinuation = 0x0;
+constexpr uint8_t opText = 0x1;
+constexpr uint8_t opBinary = 0x2;
+constexpr uint8_t opClose = 0x8;
+constexpr uint8_t opPing = 0x9;
+constexpr uint8_t opPong = 0xA;
+
+// Ответ на close-кадр, который клиент так и не прислал
+constexpr std::chrono::seconds closeHandshakeTimeout(5);
+
+uint32_t rotateLeft(uint32_t value, int bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+// SHA-1 (RFC 3174) нужен только для Sec-WebSocket-Accept, поэтому без внешней криптобиблиотеки
+std::string sha1(std::string_view data) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    std::string message(data);
+    uint64_t bitLength = static_cast<uint64_t>(data.size()) * 8;
+    message += static_cast<char>(0x80);
+    while (message.size() % 64 != 56) message += '\0';
+    for (int i = 7; i >= 0; --i) message += static_cast<char>((bitLength >> (i * 8)) & 0xFF);
+
+    for (size_t chunk = 0; chunk < message.size(); chunk += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            const unsigned char* p = reinterpret_cast<const unsigned char*>(&message[chunk + i * 4]);
+            w[i] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+        }
+        for (int i = 16; i < 80; ++i) w[i] = rotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f, k;
+            if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+            uint32_t temp = rotateLeft(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotateLeft(b, 30);
+            b = a;
+            a = temp;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+
+    std::string digest;
+    for (uint32_t word : h) {
+        for (int i = 3; i >= 0; --i) digest += static_cast<char>((word >> (i * 8)) & 0xFF);
+    }
+    return digest;
+}
+
+std::string base64(std::string_view data) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((data.size() + 2) / 3 * 4);
+    size_t i = 0;
+    for (; i + 2 < data.size(); i += 3) {
+        uint32_t n = (uint32_t((unsigned char)data[i]) << 16) | (uint32_t((unsigned char)data[i + 1]) << 8) |
+                     uint32_t((unsigned char)data[i + 2]);
+        out += alphabet[(n >> 18) & 63];
+        out += alphabet[(n >> 12) & 63];
+        out += alphabet[(n >> 6) & 63];
+        out += alphabet[n & 63];
+    }
+    if (i < data.size()) {
+        uint32_t n = uint32_t((unsigned char)data[i]) << 16;
+        if (i + 1 < data.size()) n |= uint32_t((unsigned char)data[i + 1]) << 8;
+        out += alphabet[(n >> 18) & 63];
+        out += alphabet[(n >> 12) & 63];
+        out += i + 1 < data.size() ? alphabet[(n >> 6) & 63] : '=';
+        out += '=';
+    }
+    return out;
+}
+
+// Текстовые сообщения обязаны быть корректным UTF-8 (RFC 6455, 8.1). ASCII проверяется по 8 байт
+bool isValidUtf8(std::string_view text) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(text.data());
+    const unsigned char* end = p + text.size();
+    while (p < end) {
+        if (end - p >= 8) {
+            uint64_t word;
+            std::memcpy(&word, p, sizeof(word));
+            if ((word & 0x8080808080808080ULL) == 0) {
+                p += 8;
+                continue;
+            }
+        }
+        unsigned char c = *p;
+        if (c < 0x80) {
+            ++p;
+            continue;
+        }
+        int length;
+        uint32_t codePoint;
+        if ((c & 0xE0) == 0xC0) { length = 2; codePoint = c & 0x1F; }
+        else if ((c & 0xF0) == 0xE0) { length = 3; codePoint = c & 0x0F; }
+        else if ((c & 0xF8) == 0xF0) { length = 4; codePoint = c & 0x07; }
+        else return false;
+        if (end - p < length) return false;
+        for (int i = 1; i < length; ++i) {
+            if ((p[i] & 0xC0) != 0x80) return false;
+            codePoint = (codePoint << 6) | (p[i] & 0x3F);
+        }
+        // Избыточные кодировки, суррогаты и значения за пределами Unicode
+        static const uint32_t minimum[5] = {0, 0, 0x80, 0x800, 0x10000};
+        if (codePoint < minimum[length] || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+            return false;
+        }
+        p += length;
+    }
+    return true;
+}
+
+bool setNonBlocking(int socket) {
+    int flags = fcntl(socket, F_GETFL, 0);
+    return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+}
+
+// Реализация WebSocket
+
+WebSocket::WebSocket(WebSocketHub& hub, uint64_t id, int socket, std::string clientIP, RequestData request)
+    : hub(hub), connectionId(id), ip(std::move(clientIP)), upgradeRequest(std::move(request)), socket(socket),
+      lastActivity(std::chrono::steady_clock::now()) {}
+
+bool WebSocket::sendText(std::string_view text) {
+    if (closing.load()) return false;
+    return enqueue(WebSocketHub::encodeFrame(opText, text));
+}
+
+bool WebSocket::sendBinary(std::string_view data) {
+    if (closing.load()) return false;
+    return enqueue(WebSocketHub::encodeFrame(opBinary, data));
+}
+
+void WebSocket::close(uint16_t code, std::string_view reason) {
+    hub.closeWith(*this, code, reason);
+}
+
+void WebSocket::join(const std::string& group) {
+    hub.joinGroup(connectionId, group);
+}
+
+void WebSocket::leave(const std::string& group) {
+    hub.leaveGroup(connectionId, group);
+}
+
+bool WebSocket::enqueue(std::shared_ptr<const std::string> frame) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    if (socket == -1) return false;
+    if (queuedBytes + frame->size() > hub.options.maxQueuedBytes) {
+        // Клиент не успевает читать: разрываем соединение, поток WebSocketHub увидит EOF и закроет его
+        ::shutdown(socket, SHUT_RDWR);
+        return false;
+    }
+    queuedBytes += frame->size();
+    outbox.push_back(std::move(frame));
+    if (writeArmed) return true; // Очередь разбирает поток WebSocketHub по EPOLLOUT
+
+    // Обычно буфер сокета свободен и кадр уходит сразу из вызывающего потока
+    if (!flushLocked()) {
+        ::shutdown(socket, SHUT_RDWR);
+        return false;
+    }
+    if (!outbox.empty()) {
+        writeArmed = true;
+        hub.armWrite(*this, true);
+    }
+    return true;
+}
+
+bool WebSocket::flushLocked() {
+    while (!outbox.empty()) {
+        const std::string& frame = *outbox.front();
+        ssize_t sent = ::send(socket, frame.data() + outboxOffset, frame.size() - outboxOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        outboxOffset += static_cast<size_t>(sent);
+        if (outboxOffset == frame.size()) {
+            queuedBytes -= frame.size();
+            outboxOffset = 0;
+            outbox.pop_front();
+        }
+    }
+    return true;
+}
+
+// Реализация WebSocketHub
+
+WebSocketHub::WebSocketHub(Dispatch dispatch, const WebSocketOptions& options)
+    : dispatch(std::move(dispatch)), options(options), epollFd(-1), running(false), nextId(1) {}
+
+WebSocketHub::~WebSocketHub() {
+    stop();
+}
+
+void WebSocketHub::start() {
+    if (running.exchange(true)) return;
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        running = false;
+        throw std::runtime_error("Не удалось создать epoll для WebSocket");
+    }
+    loopThread = std::thread(&WebSocketHub::loop, this);
+}
+
+void WebSocketHub::stop() {
+    if (!running.exchange(false)) return;
+    if (loopThread.joinable()) loopThread.join();
+
+    std::vector<uint64_t> ids;
+    {
+        std::lock_guard<std::mutex> lock(membersMutex);
+        for (const auto& pair : members) ids.push_back(pair.first);
+    }
+    for (uint64_t id : ids) {
+        Member member;
+        {
+            std::lock_guard<std::mutex> lock(membersMutex);
+            auto it = members.find(id);
+            if (it == members.end()) continue;
+            member = it->second;
+        }
+        closeWith(*member.socket, WebSocket::goingAway, "Server shutdown");
+        terminate(id, WebSocket::goingAway);
+    }
+    ::close(epollFd);
+    epollFd = -1;
+}
+
+bool WebSocketHub::adopt(int socket, const std::string& clientIP, const RequestData& request,
+                         std::shared_ptr<const WebSocketHandler> handler, std::string_view buffered) {
+    if (!running.load() || !setNonBlocking(socket)) return false;
+    // Сообщения WebSocket обычно маленькие: не ждём склейки сегментов
+    int flag = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+
+    uint64_t id = nextId.fetch_add(1);
+    Member member{std::shared_ptr<WebSocket>(new WebSocket(*this, id, socket, clientIP, request)), std::move(handler)};
+    member.socket->readBuffer.assign(buffered.data(), buffered.size());
+    {
+        std::lock_guard<std::mutex> lock(membersMutex);
+        members.emplace(id, member);
+    }
+    post(member, WebSocket::Event{WebSocket::Event::Open, {}, false, 0});
+
+    // Кадры, пришедшие вместе с запросом, разбираем до регистрации в epoll - поток WebSocketHub их ещё не видит
+    if (!member.socket->readBuffer.empty() && !parseFrames(member)) return true;
+
+    // Обработчик onOpen мог уже поставить кадры в очередь, тогда сразу ждём и готовности к записи
+    bool registered;
+    {
+        WebSocket& ws = *member.socket;
+        std::lock_guard<std::mutex> lock(ws.writeMutex);
+        if (ws.socket == -1) return true;
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP | (ws.writeArmed ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+        ev.data.u64 = id;
+        registered = epoll_ctl(epollFd, EPOLL_CTL_ADD, socket, &ev) == 0;
+    }
+    if (!registered) terminate(id, WebSocket::abnormalClosure);
+    return true;
+}
+
+size_t WebSocketHub::broadcast(const std::string& group, std::string_view message, bool binary) {
+    auto frame = encodeFrame(binary ? opBinary : opText, message);
+    std::vector<std::shared_ptr<WebSocket>> recipients;
+    {
+        std::lock_guard<std::mutex> lock(membersMutex);
+        auto it = groups.find(group);
+        if (it == groups.end()) return 0;
+        recipients.reserve(it->second.size());
+        for (uint64_t id : it->second) {
+            auto member = members.find(id);
+            if (member != members.end()) recipients.push_back(member->second.socket);
+        }
+    }
+    // Отправка вне membersMutex: один общий кадр, у каждого получателя своя очередь
+    size_t delivered = 0;
+    for (const auto& socket : recipients) {
+        if (!socket->closing.load() && socket->enqueue(frame)) ++delivered;
+    }
+    return delivered;
+}
+
+size_t WebSocketHub::connectionCount() {
+    std::lock_guard<std::mutex> lock(membersMutex);
+    return members.size();
+}
+
+std::string WebSocketHub::acceptKey(std::string_view clientKey) {
+    std::string source(clientKey);
+    source += "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    return base64(sha1(source));
+}
+
+void WebSocketHub::unmask(char* data, size_t size, const uint8_t key[4]) {
+    size_t i = 0;
+    uint32_t key32;
+    std::memcpy(&key32, key, sizeof(key32));
+#if defined(__SSE2__)
+    // 16 байт за итерацию: ключ повторяется каждые 4 байта, поэтому маска одна для всех блоков
+    const __m128i mask = _mm_set1_epi32(static_cast<int>(key32));
+    for (; i + 16 <= size; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), _mm_xor_si128(block, mask));
+    }
+#endif
+    uint64_t key64 = (uint64_t(key32) << 32) | key32;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        word ^= key64;
+        std::memcpy(data + i, &word, sizeof(word));
+    }
+    // Смещения кратны 4, поэтому хвост начинается с key[0]
+    for (size_t j = 0; i < size; ++i, ++j) data[i] ^= static_cast<char>(key[j & 3]);
+}
+
+void WebSocketHub::loop() {
+    constexpr int maxEvents = 256;
+    epoll_event events[maxEvents];
+    auto lastCheck = std::chrono::steady_clock::now();
+
+    while (running.load()) {
+        int count = epoll_wait(epollFd, events, maxEvents, 500);
+        if (count < 0 && errno != EINTR) {
+            std::cerr << "Ошибка epoll_wait в WebSocketHub: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        for (int i = 0; i < count; ++i) {
+            uint64_t id = events[i].data.u64;
+            Member member;
+            {
+                std::lock_guard<std::mutex> lock(membersMutex);
+                auto it = members.find(id);
+                if (it == members.end()) continue;
+                member = it->second;
+            }
+
+            if (events[i].events & EPOLLOUT) {
+                WebSocket& ws = *member.socket;
+                bool failed = false;
+                {
+                    std::lock_guard<std::mutex> lock(ws.writeMutex);
+                    if (ws.socket == -1) continue;
+                    failed = !ws.flushLocked();
+                    if (!failed && ws.outbox.empty() && ws.writeArmed) {
+                        ws.writeArmed = false;
+                        armWrite(ws, false);
+                    }
+                }
+                if (failed) {
+                    terminate(id, WebSocket::abnormalClosure);
+                    continue;
+                }
+            }
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                readFrom(member);
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastCheck >= std::chrono::seconds(1)) {
+            lastCheck = now;
+            checkTimeouts();
+        }
+    }
+}
+
+void WebSocketHub::readFrom(const Member& member) {
+    WebSocket& ws = *member.socket;
+    char buffer[16384];
+    bool received = false;
+    while (true) {
+        ssize_t r = ::recv(ws.socket, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (r > 0) {
+            ws.readBuffer.append(buffer, static_cast<size_t>(r));
+            received = true;
+            // Большое сообщение разбираем по мере поступления, чтобы буфер не рос сверх одного кадра
+            if (ws.readBuffer.size() >= 256 * 1024) {
+                if (!parseFrames(member)) return;
+            }
+            continue;
+        }
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        // EOF или ошибка: сначала отдаём обработчикам то, что успело прийти
+        if (received && !parseFrames(member)) return;
+        terminate(ws.connectionId, WebSocket::abnormalClosure);
+        return;
+    }
+    if (received) {
+        ws.lastActivity = std::chrono::steady_clock::now();
+        ws.pingOutstanding = false;
+        parseFrames(member);
+    }
+}
+
+bool WebSocketHub::parseFrames(const Member& member) {
+    WebSocket& ws = *member.socket;
+    std::string& buffer = ws.readBuffer;
+    size_t pos = 0;
+
+    auto fail = [&](uint16_t code) {
+        closeWith(ws, code, {});
+        terminate(ws.connectionId, code);
+        return false;
+    };
+
+    while (buffer.size() - pos >= 2) {
+        size_t available = buffer.size() - pos;
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(buffer.data() + pos);
+        bool fin = p[0] & 0x80;
+        uint8_t opcode = p[0] & 0x0F;
+        bool masked = p[1] & 0x80;
+        uint64_t length = p[1] & 0x7F;
+        size_t headerSize = 2;
+        if (length == 126) {
+            if (available < 4) break;
+            length = (uint64_t(p[2]) << 8) | p[3];
+            headerSize = 4;
+        } else if (length == 127) {
+            if (available < 10) break;
+            length = 0;
+            for (int i = 0; i < 8; ++i) length = (length << 8) | p[2 + i];
+            headerSize = 10;
+        }
+
+        // Расширения не согласуются, поэтому RSV-биты должны быть нулевыми; клиент обязан маскировать кадры
+        if ((p[0] & 0x70) || !masked) return fail(WebSocket::protocolError);
+        bool control = opcode & 0x08;
+        if (control && (!fin || length > 125)) return fail(WebSocket::protocolError);
+        if (length > options.maxMessageSize) return fail(WebSocket::messageTooBig);
+
+        headerSize += 4;
+        if (available < headerSize + length) break;
+        uint8_t key[4];
+        std::memcpy(key, p + headerSize - 4, 4);
+        char* payload = &buffer[pos + headerSize];
+        unmask(payload, static_cast<size_t>(length), key);
+        std::string_view data(payload, static_cast<size_t>(length));
+        pos += headerSize + static_cast<size_t>(length);
+
+        switch (opcode) {
+            case opText:
+            case opBinary:
+            case opContinuation: {
+                if (opcode == opContinuation ? ws.fragmentOpcode == 0 : ws.fragmentOpcode != 0) {
+                    return fail(WebSocket::protocolError);
+                }
+                if (ws.closing.load()) break; // После close-кадра сообщения уже не доставляются
+                if (opcode != opContinuation && fin) {
+                    if (opcode == opText && !isValidUtf8(data)) return fail(WebSocket::invalidPayload);
+                    post(member, WebSocket::Event{WebSocket::Event::Message, std::string(data), opcode == opBinary, 0});
+                    break;
+                }
+                if (opcode != opContinuation) ws.fragmentOpcode = opcode;
+                if (ws.fragments.size() + data.size() > options.maxMessageSize) return fail(WebSocket::messageTooBig);
+                ws.fragments.append(data.data(), data.size());
+                if (fin) {
+                    bool binary = ws.fragmentOpcode == opBinary;
+                    ws.fragmentOpcode = 0;
+                    if (!binary && !isValidUtf8(ws.fragments)) return fail(WebSocket::invalidPayload);
+                    post(member, WebSocket::Event{WebSocket::Event::Message, std::move(ws.fragments), binary, 0});
+                    ws.fragments.clear();
+                }
+                break;
+            }
+            case opPing:
+                ws.enqueue(encodeFrame(opPong, data));
+                break;
+            case opPong:
+                break;
+            case opClose: {
+                if (data.size() == 1) return fail(WebSocket::protocolError);
+                uint16_t code = data.size() >= 2 ? uint16_t((uint8_t(data[0]) << 8) | uint8_t(data[1])) : WebSocket::normalClosure;
+                // Ответный close-кадр (если свой ещё не отправляли), после него соединение закрывается
+                closeWith(ws, code, {});
+                terminate(ws.connectionId, code);
+                return false;
+            }
+            default:
+                return fail(WebSocket::protocolError);
+        }
+    }
+    if (pos > 0) buffer.erase(0, pos);
+    return true;
+}
+
+void WebSocketHub::checkTimeouts() {
+    std::vector<Member> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(membersMutex);
+        snapshot.reserve(members.size());
+        for (const auto& pair : members) snapshot.push_back(pair.second);
+    }
+    auto now = std::chrono::steady_clock::now();
+    for (const Member& member : snapshot) {
+        WebSocket& ws = *member.socket;
+        if (ws.closing.load()) {
+            std::chrono::steady_clock::time_point closeSentAt;
+            {
+                std::lock_guard<std::mutex> lock(ws.writeMutex);
+                closeSentAt = ws.closeSentAt;
+            }
+            // closeSentAt ещё не записан, если close() выполняется прямо сейчас
+            if (closeSentAt != std::chrono::steady_clock::time_point() && now - closeSentAt > closeHandshakeTimeout) terminate(ws.connectionId, WebSocket::abnormalClosure);
+            continue;
+        }
+        if (now - ws.lastActivity < options.pingInterval) continue;
+        if (!ws.pingOutstanding) {
+            ws.pingOutstanding = true;
+            ws.pingSentAt = now;
+            ws.enqueue(encodeFrame(opPing, {}));
+        } else if (now - ws.pingSentAt >= options.pingInterval) {
+            terminate(ws.connectionId, WebSocket::abnormalClosure);
+        }
+    }
+}
+
+void WebSocketHub::terminate(uint64_t id, uint16_t code) {
+    Member member;
+    {
+        std::lock_guard<std::mutex> lock(membersMutex);
+        auto it = members.find(id);
+        if (it == members.end()) return;
+        member = std::move(it->second);
+        members.erase(it);
+        for (const auto& group : member.socket->groupNames) {
+            auto groupIt = groups.find(group);
+            if (groupIt == groups.end()) continue;
+            groupIt->second.erase(id);
+            if (groupIt->second.empty()) groups.erase(groupIt);
+        }
+        member.socket->groupNames.clear();
+    }
+
+    WebSocket& ws = *member.socket;
+    ws.closing = true;
+    {
+        std::lock_guard<std::mutex> lock(ws.writeMutex);
+        if (ws.socket != -1) {
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, ws.socket, nullptr);
+            ::close(ws.socket);
+            ws.socket = -1;
+        }
+        ws.outbox.clear();
+        ws.queuedBytes = 0;
+    }
+    post(member, WebSocket::Event{WebSocket::Event::Close, {}, false, code});
+}
+
+void WebSocketHub::post(const Member& member, WebSocket::Event event) {
+    WebSocket& ws = *member.socket;
+    bool opening = event.type == WebSocket::Event::Open;
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(ws.inboxMutex);
+        ws.inbox.push_back(std::move(event));
+        if (!ws.scheduled) {
+            ws.scheduled = true;
+            schedule = true;
+        }
+    }
+    if (!schedule) return;
+    // Одна задача на соединение: события обрабатываются по порядку, без параллельных вызовов обработчиков
+    auto socket = member.socket;
+    auto handler = member.handler;
+    try {
+        std::function<void()> shed;
+        if (!opening) shed = [this, socket]() { reject(*socket); };
+        dispatch([this, socket, handler]() { drain(socket, handler); }, std::move(shed));
+    } catch (const std::exception& e) {
+        std::cerr << "Не удалось передать событие WebSocket в пул потоков: " << e.what() << std::endl;
+        std::lock_guard<std::mutex> lock(ws.inboxMutex);
+        ws.inbox.clear();
+        ws.scheduled = false;
+    }
+}
+
+// Пул отказал в допуске: накопленные события отбрасываются, клиенту предлагается переподключиться позже
+void WebSocketHub::reject(WebSocket& socket) {
+    {
+        std::lock_guard<std::mutex> lock(socket.inboxMutex);
+        socket.inbox.clear();
+        socket.scheduled = false;
+    }
+    closeWith(socket, WebSocket::tryAgainLater, "Try Again Later");
+}
+
+void WebSocketHub::drain(std::shared_ptr<WebSocket> socket, std::shared_ptr<const WebSocketHandler> handler) {
+    while (true) {
+        WebSocket::Event event;
+        {
+            std::lock_guard<std::mutex> lock(socket->inboxMutex);
+            if (socket->inbox.empty()) {
+                socket->scheduled = false;
+                return;
+            }
+            event = std::move(socket->inbox.front());
+            socket->inbox.pop_front();
+        }
+        try {
+            switch (event.type) {
+                case WebSocket::Event::Open:
+                    if (handler->onOpen) handler->onOpen(*socket);
+                    break;
+                case WebSocket::Event::Message:
+                    if (handler->onMessage) handler->onMessage(*socket, event.data, event.binary);
+                    break;
+                case WebSocket::Event::Close:
+                    if (handler->onClose) handler->onClose(*socket, event.code);
+                    break;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Исключение в обработчике WebSocket: " << e.what() << std::endl;
+            if (event.type != WebSocket::Event::Close) closeWith(*socket, WebSocket::internalError, "Internal error");
+        }
+    }
+}
+
+void WebSocketHub::armWrite(WebSocket& socket, bool enable) {
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLRDHUP | (enable ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    ev.data.u64 = socket.connectionId;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, socket.socket, &ev);
+}
+
+void WebSocketHub::closeWith(WebSocket& socket, uint16_t code, std::string_view reason) {
+    bool expected = false;
+    if (!socket.closing.compare_exchange_strong(expected, true)) return;
+    std::string payload;
+    payload += static_cast<char>(code >> 8);
+    payload += static_cast<char>(code & 0xFF);
+    payload.append(reason.substr(0, 123));
+    {
+        std::lock_guard<std::mutex> lock(socket.writeMutex);
+        socket.closeSentAt = std::chrono::steady_clock::now();
+    }
+    socket.enqueue(encodeFrame(opClose, payload));
+}
+
+void WebSocketHub::joinGroup(uint64_t id, const std::string& group) {
+    std::lock_guard<std::mutex> lock(membersMutex);
+    auto it = members.find(id);
+    if (it == members.end()) return;
+    groups[group].insert(id);
+    it->second.socket->groupNames.insert(group);
+}
+
+void WebSocketHub::leaveGroup(uint64_t id, const std::string& group) {
+    std::lock_guard<std::mutex> lock(membersMutex);
+    auto it = members.find(id);
+    if (it == members.end()) return;
+    it->second.socket->groupNames.erase(group);
+    auto groupIt = groups.find(group);
+    if (groupIt == groups.end()) return;
+    groupIt->second.erase(id);
+    if (groupIt->second.empty()) groups.erase(groupIt);
+}
+
+std::shared_ptr<const std::string> WebSocketHub::encodeFrame(uint8_t opcode, std::string_view payload) {
+    auto frame = std::make_shared<std::string>();
+    frame->reserve(payload.size() + 10);
+    *frame += static_cast<char>(0x80 | opcode);
+    if (payload.size() < 126) {
+        *frame += static_cast<char>(payload.size());
+    } else if (payload.size() <= 0xFFFF) {
+        *frame += static_cast<char>(126);
+        *frame += static_cast<char>((payload.size() >> 8) & 0xFF);
+        *frame += static_cast<char>(payload.size() & 0xFF);
+    } else {
+        *frame += static_cast<char>(127);
+        for (int i = 7; i >= 0; --i) *frame += static_cast<char>((uint64_t(payload.size()) >> (i * 8)) & 0xFF);
+    }
+    frame->append(payload.data(), payload.size());
+    return frame;
+}
@@ -0,0 +1,113 @@
+// headers/AccessLog.h
+#ifndef ACCESSLOG_H
+#define ACCESSLOG_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Формат строк журнала доступа
+enum class AccessLogFormat {
+    Common,   // NCSA Common Log Format
+    Combined, // Common + Referer и User-Agent
+    Json      // Одна JSON-запись на строку
+};
+
+// Данные об обработанном запросе, передаваемые в журнал.
+// Строки копируются в кольцевой буфер сразу, поэтому могут ссылаться на временные буферы запроса
+struct AccessLogRecord {
+    std::string_view clientIP;
+    std::string_view requestLine; // "GET /path?x=1 HTTP/1.1"
+    std::string_view referer;
+    std::string_view userAgent;
+    int status = 0;
+    size_t bytes = 0;             // Размер тела ответа
+    uint64_t durationMicros = 0;
+};
+
+struct AccessLogRing;
+struct AccessLogEntry;
+
+// Асинхронный журнал доступа. Рабочие потоки пишут записи в собственные кольцевые буферы
+// без блокировок; фоновый поток форматирует их и сбрасывает на диск крупными write().
+// Если диск не успевает и буфер потока заполнен, запись отбрасывается и учитывается в droppedCount()
+class AccessLog {
+public:
+    // Записей в кольцевом буфере одного потока
+    static constexpr size_t ringCapacity = 512;
+    // Размер пачки, после которого она сразу сбрасывается в файл
+    static constexpr size_t batchSize = 64 * 1024;
+
+    // path "-" означает стандартный вывод (без ротации).
+    // rotateBytes и rotateInterval задают ротацию по размеру и по времени; 0 отключает соответствующее условие
+    AccessLog(const std::string& path, AccessLogFormat format,
+              size_t rotateBytes = 0, std::chrono::seconds rotateInterval = std::chrono::seconds(0),
+              std::chrono::milliseconds flushInterval = std::chrono::milliseconds(100));
+    ~AccessLog();
+
+    AccessLog(const AccessLog&) = delete;
+    AccessLog& operator=(const AccessLog&) = delete;
+
+    // Открывает файл и запускает фоновый поток записи. Бросает std::runtime_error, если файл не открыть
+    void start();
+    // Останавливает фоновый поток, предварительно записав всё накопленное
+    void stop();
+
+    // Не блокирует: при переполнении буфера потока запись отбрасывается
+    void record(const AccessLogRecord& record);
+
+    uint64_t droppedCount() const;
+    uint64_t writtenCount() const;
+
+    static bool parseFormat(const std::string& name, AccessLogFormat& format);
+
+private:
+    std::string path;
+    AccessLogFormat format;
+    size_t rotateBytes;
+    std::chrono::seconds rotateInterval;
+    std::chrono::milliseconds flushInterval;
+
+    uint64_t id; // Уникальный идентификатор экземпляра для привязки thread_local буферов
+
+    mutable std::mutex ringsMutex;
+    std::vector<std::shared_ptr<AccessLogRing>> rings;
+
+    std::thread writerThread;
+    std::atomic<bool> running;
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+
+    // Состояние потока записи
+    int fd;
+    size_t fileSize;
+    std::chrono::steady_clock::time_point openedAt;
+    std::string batch;
+    uint64_t batchEntries;
+    std::atomic<uint64_t> droppedOnWrite;
+    std::atomic<uint64_t> written;
+
+    // Кэш отформатированного времени: пересчитывается раз в секунду
+    int64_t cachedSecond;
+    char cachedCommonTime[32];
+    char cachedIsoTime[32];
+
+    AccessLogRing& localRing();
+    void writerLoop();
+    void drain();
+    void formatEntry(const AccessLogEntry& entry);
+    void flush();
+    void openFile();
+    void rotateIfNeeded(size_t incoming);
+    void updateTimeCache(int64_t second);
+};
+
+#endif // ACCESSLOG_H
@@ -0,0 +1,65 @@
+// headers/Compression.h
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Кодирование тела ответа (Content-Encoding)
+enum class ContentEncoding {
+    Identity,
+    Gzip,
+    Deflate
+};
+
+// Значение заголовка Content-Encoding ("gzip", "deflate"; пустое для Identity)
+const char* contentEncodingName(ContentEncoding encoding);
+
+// Выбирает кодирование по заголовку Accept-Encoding с учётом q-значений; при равных весах предпочитает gzip
+ContentEncoding negotiateEncoding(std::string_view acceptEncoding);
+
+// true для текстовых и других хорошо сжимаемых типов; изображения, архивы, видео и шрифты woff/woff2 уже сжаты
+bool isCompressibleType(std::string_view contentType);
+
+// Сжимает data в формате encoding и дописывает результат в out.
+// Состояние zlib (около 256 КБ) переиспользуется в пределах потока, а не создаётся на каждый ответ
+bool compressBody(std::string_view data, ContentEncoding encoding, int level, std::string& out);
+
+// Сжимает тело готового HTTP-ответа на месте: пересчитывает Content-Length, добавляет Content-Encoding
+// и Vary: Accept-Encoding. Ответ не меняется, если тело меньше minSize, тип не сжимаемый, ответ уже
+// закодирован или помечен Cache-Control: no-transform, либо сжатие не уменьшило размер
+bool compressResponse(std::string& response, ContentEncoding encoding, int level, size_t minSize);
+
+// Сжатые версии статических файлов: каждый файл сжимается один раз и хранится, пока не изменится на диске
+class CompressedFileCache {
+public:
+    explicit CompressedFileCache(size_t maxBytes = 32 * 1024 * 1024);
+
+    // Сжатое содержимое файла path (размер и время изменения - из fstat открытого файла).
+    // При промахе файл читается из fd и сжимается с максимальной степенью
+    std::shared_ptr<const std::string> get(const std::string& path, int fd, size_t fileSize,
+                                           std::chrono::nanoseconds modified, ContentEncoding encoding);
+
+    size_t sizeBytes();
+
+private:
+    struct Entry {
+        std::shared_ptr<const std::string> data;
+        size_t fileSize;
+        std::chrono::nanoseconds modified;
+    };
+
+    std::mutex mutex;
+    size_t maxBytes;
+    size_t usedBytes;
+    std::unordered_map<std::string, Entry> entries;
+    std::deque<std::string> insertionOrder; // Вытесняются самые старые записи
+};
+
+#endif // COMPRESSION_H
@@ -0,0 +1,127 @@
+// headers/Connection.h
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <chrono>
+#include <cstddef>
+
+#include "RequestData.h"
+
+struct IoUringClient;
+struct ssl_st;
+
+// Соединение с клиентом вместе с буферами, которые переживают отдельный запрос
+struct Connection {
+    int socket = -1;
+    std::string clientIP;
+
+    // Входной буфер: полученные, но ещё не обработанные байты
+    std::string readBuffer;
+    size_t requestLength = 0; // Длина текущего запроса (заголовки + тело) в начале буфера
+    size_t pendingBody = 0;   // Байт тела, ещё не прочитанных из сокета (проксируемый запрос передаёт их потоком)
+
+    // Буфер для ответов, которые формирует сам сервер (статика, ошибки)
+    std::string writeBuffer;
+
+    // Ответ не отправляется в сокет, а передаётся сюда: запрос потока HTTP/2 (см. Http2Server)
+    // или соединение, которое обслуживает IoUringServer
+    std::string* responseSink = nullptr;
+
+    // Соединение в цикле IoUringServer; nullptr - обслуживается рабочими потоками и Reactor
+    IoUringClient* uring = nullptr;
+    // Файл статики, тело которого отправляется не из writeBuffer: IoUringServer дочитывает его
+    // в последние responseFileSize байт writeBuffer, соединение с kTLS передаёт через sendfile после него
+    int responseFile = -1;
+    size_t responseFileSize = 0;
+
+    // Сессия TLS (SSL из OpenSSL); nullptr - соединение без шифрования
+    ssl_st* tls = nullptr;
+
+    RequestData request;
+
+    bool keepAlive = false;
+    int priority = 5;
+    size_t requestsServed = 0;
+
+    // Планирование (RouteScheduler): когда запрос встал в очередь пула, получил ли он срок по маршруту
+    // (иначе стоял в очереди на чтение) и маршрут обработанного запроса для учёта стоимости
+    std::chrono::steady_clock::time_point queuedAt;
+    bool scheduled = false;
+    size_t routeId = 0;
+    // Запрос блокирующего маршрута уже передан в пул блокирующих задач (FlaskCpp::blockingRoute)
+    bool offloaded = false;
+
+    // Состояние простаивающего keep-alive соединения (управляется Reactor)
+    std::chrono::steady_clock::time_point idleSince;
+    Connection* idlePrev = nullptr;
+    Connection* idleNext = nullptr;
+    bool parked = false;
+    bool reactorRegistered = false;
+
+    // Очищает данные запроса, возвращая узлы карт в кэш (RequestData::clear)
+    void resetRequest();
+
+    // Убирает обработанный запрос из входного буфера, сохраняя данные конвейеризованных запросов
+    void consumeRequest();
+
+    bool hasBufferedData() const { return !readBuffer.empty(); }
+};
+
+// Пул объектов Connection.
+// Свободные объекты хранятся в thread_local списке рабочего потока, поэтому захват и возврат
+// не требуют блокировок, а буферы остаются «тёплыми» в кэше того же ядра
+class ConnectionPool {
+public:
+    static std::unique_ptr<Connection> acquire();
+    static void release(std::unique_ptr<Connection> conn);
+
+    // Максимальное количество свободных соединений, хранимых одним потоком
+    static constexpr size_t maxCachedPerThread = 64;
+
+    // Буферы, выросшие больше этого размера, не возвращаются в пул вместе с соединением
+    static constexpr size_t maxCachedBufferSize = 64 * 1024;
+};
+
+// Монотонная арена рабочего потока: выделение - сдвиг указателя, освобождение - сброс после запроса
+class RequestArena {
+public:
+    static RequestArena& forThisThread();
+
+    std::pmr::memory_resource* resource() { return &monotonic; }
+    void reset() { monotonic.release(); }
+
+private:
+    RequestArena();
+
+    static constexpr size_t initialSize = 16 * 1024;
+    alignas(std::max_align_t) char initialBuffer[initialSize];
+    std::pmr::monotonic_buffer_resource monotonic;
+};
+
+// Счётчики выделений памяти для тестов: при сборке с ENABLE_ALLOC_STATS=1
+// глобальные operator new/delete подменяются и считают выделения в каждом потоке
+struct AllocationStats {
+    unsigned long long requests = 0;
+    unsigned long long allocations = 0;
+    unsigned long long bytes = 0;
+
+    double allocationsPerRequest() const { return requests ? double(allocations) / requests : 0.0; }
+    double bytesPerRequest() const { return requests ? double(bytes) / requests : 0.0; }
+};
+
+class AllocationCounter {
+public:
+    // true, если библиотека собрана с подсчётом выделений
+    static bool enabled();
+    // Количество выделений и байт, запрошенных текущим потоком с момента его старта
+    static unsigned long long threadAllocations();
+    static unsigned long long threadBytes();
+};
+
+#endif // CONNECTION_H
@@ -0,0 +1,65 @@
+// headers/FastCgi.h
+#ifndef FASTCGI_H
+#define FASTCGI_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Клиент FastCGI (роль Responder) с пулом постоянных соединений к php-fpm или php-cgi -b.
+// Соединения открываются с флагом FCGI_KEEP_CONN и переиспользуются между запросами;
+// одновременные запросы распределяются по соединениям пула
+class FastCgiPool {
+public:
+    using Params = std::vector<std::pair<std::string, std::string>>;
+
+    // Максимальный размер содержимого одной записи FastCGI
+    static constexpr size_t maxRecordContent = 65535;
+
+    // address: путь к Unix-сокету ("/run/php/php-fpm.sock" или "unix:/path") либо "host:port"
+    FastCgiPool(const std::string& address, size_t maxConnections = 8,
+                std::chrono::milliseconds timeout = std::chrono::seconds(30));
+    ~FastCgiPool();
+
+    FastCgiPool(const FastCgiPool&) = delete;
+    FastCgiPool& operator=(const FastCgiPool&) = delete;
+
+    // Выполняет запрос: params - CGI-окружение, input - тело запроса (FCGI_STDIN).
+    // output получает FCGI_STDOUT (CGI-заголовки и тело), errors - FCGI_STDERR. Ответ буферизуется целиком
+    // и возвращается после FCGI_END_REQUEST: хендлеры отдают ответ одной строкой, клиенту он потоком не передаётся.
+    // FCGI_STDIN отправляется записями по maxRecordContent байт.
+    // Возвращает false, если FastCGI-сервер недоступен или оборвал соединение
+    bool execute(const Params& params, std::string_view input, std::string& output, std::string& errors);
+
+    const std::string& getAddress() const { return address; }
+    size_t openCount();
+    size_t idleCount();
+
+private:
+    std::string address;
+    size_t maxConnections;
+    std::chrono::milliseconds timeout;
+
+    std::mutex poolMutex;
+    std::condition_variable poolCondition;
+    std::vector<int> idleSockets;
+    size_t openSockets;
+
+    std::atomic<uint16_t> nextRequestId;
+
+    int acquire(bool& reused);
+    void release(int fd, bool reusable);
+    int connectSocket();
+
+    // Один запрос по уже открытому соединению. received = true, если сервер успел что-то ответить
+    bool roundTrip(int fd, uint16_t requestId, const Params& params, std::string_view input,
+                   std::string& output, std::string& errors, bool& received, bool& keepConnection);
+};
+
+#endif // FASTCGI_H
@@ -28,27 +28,57 @@
 
 #include "TemplateEngine.h"
 #include "ThreadPool.h" // Добавляем пул потоков
-
-// Структура для хранения данных запроса
-struct RequestData {
-    std::string method;
-    std::string path;
-    std::map<std::string, std::string> queryParams;
-    std::map<std::string, std::string> formData; // Для POST-запросов
-    std::map<std::string, std::string> routeParams; // Параметры из пути: /user/<id>
-    std::map<std::string, std::string> headers;
-    std::string body;
-    std::map<std::string, std::string> cookies; // Хранит парсенные cookies
-};
+#include "RequestData.h"
+#include "Connection.h"
+#include "Reactor.h"
+#include "Metrics.h"
+#include "AccessLog.h"
+#include "FastCgi.h"
+#include "Upstream.h"
+#include "ResponseCache.h"
+#include "RateLimiter.h"
+#include "Compression.h"
+#include "WebSocket.h"
+#include "Http2.h"
+#include "HotRestart.h"
+#include "Session.h"
+#include "IoUring.h"
+#include "Tls.h"
+#include "Prefork.h"
+#include "SharedCache.h"
+#include "Profiler.h"
+#include "Tracing.h"
+#include "Scheduler.h"
 
 // Типы хендлеров маршрутов
 using SimpleHandler = std::function<std::string(const RequestData&)>;
 using ComplexHandler = std::function<std::string(const RequestData&)>;
 
+// Приём соединений (FlaskCpp::setAcceptOptions)
+struct AcceptOptions {
+    // Соединений, принимаемых подряд за одно пробуждение цикла accept
+    size_t batch = 64;
+    // TCP_DEFER_ACCEPT: ядро отдаёт соединение в accept, только когда клиент прислал первые данные,
+    // и ждёт их не дольше deferAccept (затем соединение принимается как обычно). 0 - выключено
+    std::chrono::seconds deferAccept = std::chrono::seconds(5);
+    // TCP_FASTOPEN: очередь соединений с запросом в SYN; 0 - выключено. Ядро принимает TFO на сервере,
+    // только если в net.ipv4.tcp_fastopen установлен бит 2
+    int fastOpenQueue = 0;
+};
+
+// Исполнители сервера (FlaskCpp::setExecutorOptions). Приём соединений, реактор keep-alive, io_uring,
+// HTTP/2 и WebSocket работают в собственных потоках; хендлеры - в пуле обработчиков (minThreads и maxThreads
+// конструктора FlaskCpp); блокирующая работа (offload, blockingRoute) - в отдельном пуле блокирующих задач
+struct ExecutorOptions {
+    size_t blockingMinThreads = 2;
+    size_t blockingMaxThreads = 16;
+};
+
 class FlaskCpp {
 public:
     // Обновленный конструктор с дополнительными параметрами для пула потоков
     FlaskCpp(int port, bool verbose = false, bool enableHotReload = true, size_t minThreads = 2, size_t maxThreads = 8);
+    ~FlaskCpp();
 
     void setTemplate(const std::string& name, const std::string& content);
 
@@ -58,16 +88,59 @@ public:
     // Добавление маршрута с параметрами, например: /user/<id>
     void routeParam(const std::string& pattern, ComplexHandler handler);
 
+    // Включает кэширование ответов маршрута (path - путь route() или шаблон routeParam()).
+    // Кэшируются ответы 200 на GET и HEAD; одновременные промахи выполняют хендлер один раз
+    void cacheRoute(const std::string& path, const CacheOptions& options = {});
+
+    // Бюджет памяти кэша ответов в байтах (по умолчанию 64 МБ)
+    void setResponseCacheSize(size_t bytes);
+
+    // Ограничивает частоту запросов к маршруту (path - путь route() или шаблон routeParam()) для каждого IP клиента.
+    // Сверх лимита - 429 Too Many Requests с Retry-After, хендлер не вызывается
+    void rateLimit(const std::string& path, const RateLimit& limit);
+
+    // Общий лимит частоты запросов одного IP ко всем маршрутам и статическим файлам
+    void setClientRateLimit(const RateLimit& limit);
+
+    // Включает сессии: хендлер получает RequestData::session, идентификатор хранится в cookie
+    // с подписью HMAC-SHA256 ключом secret (не короче 16 байт). store - хранилище сессий,
+    // по умолчанию MemorySessionStore; MmapSessionStore сохраняет сессии между перезапусками
+    void enableSessions(const std::string& secret, const SessionOptions& options = {},
+                        std::shared_ptr<SessionStore> store = nullptr);
+
     // Загрузка шаблонов из директории
     void loadTemplatesFromDirectory(const std::string& directoryPath);
 
-    // Метод для запуска сервера в отдельном потоке
+    // Метод для запуска сервера в отдельном потоке (не в пуле обработчиков: цикл accept не занимает его поток)
     void runAsync();
 
     // Метод для запуска сервера синхронно (блокирующий)
     void run();
 
-    void stop(); // Новый метод для остановки сервера
+    // Остановка с дообслуживанием: приём прекращается, простаивающие keep-alive соединения закрываются,
+    // принятые запросы дообслуживаются не дольше setDrainTimeout
+    void stop();
+
+    // Сервер принимает соединения (false после stop() и после передачи сокета новому процессу)
+    bool isRunning() const { return running.load(); }
+
+    // Сколько stop() ждёт завершения принятых запросов (по умолчанию 30 секунд)
+    void setDrainTimeout(std::chrono::milliseconds timeout);
+
+    // Горячий перезапуск без потери соединений (вызывать до запуска сервера). Новый процесс с тем же
+    // controlSocketPath при запуске забирает слушающий сокет у работающего через Unix-сокет (SCM_RIGHTS);
+    // старый после этого перестаёт принимать соединения, isRunning() возвращает false, и остаётся вызвать stop()
+    void enableHotRestart(const std::string& controlSocketPath);
+
+    // Многопроцессный режим (вызывать до запуска сервера): главный процесс открывает порт и запускает
+    // options.workers копий программы с теми же аргументами, каждая принимает соединения на этом порту
+    // собственным пулом потоков; упавший обработчик перезапускается. /metrics любого обработчика суммирует
+    // метрики всех, кэш ответов и sharedCache() общие. Лимиты частоты, MemorySessionStore и группы WebSocket
+    // у каждого обработчика свои. Бросает std::runtime_error, если общую память не удалось выделить
+    void enablePrefork(const PreforkOptions& options = {});
+
+    // Кэш в общей памяти обработчиков prefork; nullptr без prefork или при sharedCacheSlots == 0
+    std::shared_ptr<SharedCache> sharedCache() const { return sharedCacheSegment; }
 
     std::string renderTemplate(const std::string& templateName, const TemplateEngine::Context& context);
 
@@ -78,6 +151,12 @@ public:
                               const std::string& body,
                               const std::vector<std::pair<std::string, std::string>>& extra_headers = {});
 
+    // JSON-ответ: writeBody пишет тело через JsonWriter прямо в строку ответа после заголовков,
+    // Content-Length вставляется по готовому телу
+    std::string jsonResponse(const std::string& status_code,
+                             const std::function<void(JsonWriter&)>& writeBody,
+                             const std::vector<std::pair<std::string, std::string>>& extra_headers = {});
+
     // Функции для управления cookies
 
     // Установка cookie: возвращает строку заголовка Set-Cookie
@@ -89,12 +168,115 @@ public:
     std::string deleteCookie(const std::string& name,
                              const std::string& path = "/");
 
+    // Включает сжатие gzip/deflate по Accept-Encoding: ответы хендлеров от minSize байт сжимаются
+    // с уровнем level (1-9), статические файлы отдаются из соседнего .gz или сжимаются один раз и кэшируются
+    void enableCompression(int level = 6, size_t minSize = 1024);
+
+    // Ввод-вывод соединений через io_uring вместо accept/recv/send в рабочих потоках и epoll
+    // (вызывать до запуска сервера). Если ядро не поддерживает io_uring, сервер работает как обычно
+    void enableIoUring(const IoUringOptions& options = {});
+
+    // TLS на порту сервера (вызывать до запуска): рукопожатие в рабочих потоках, возобновление сессий,
+    // ALPN http/1.1, kTLS для статики. Бросает std::runtime_error, если сертификат или ключ не загружаются
+    void enableTls(const TlsOptions& options);
+
+    // Таймаут простоя keep-alive соединения. 0 отключает keep-alive (каждый ответ с Connection: close)
+    void setKeepAliveTimeout(std::chrono::milliseconds timeout);
+
+    // Наибольшее тело запроса HTTP/1.1 в байтах (по умолчанию 16 МБ, включая проксируемые запросы).
+    // Запрос с большим Content-Length получает 413, с некорректным - 400, соединение закрывается
+    void setMaxRequestBodySize(size_t bytes);
+
+    // Статистика выделений памяти на запрос (ненулевая только при сборке с ENABLE_ALLOC_STATS=1)
+    AllocationStats getAllocationStats() const;
+
+    // Включает сбор метрик и их экспорт в формате Prometheus по указанному пути
+    void enableMetrics(const std::string& path = "/metrics");
+
+    // Текущие метрики в текстовом формате Prometheus
+    std::string renderMetrics();
+
+    // Профилировщик CPU по запросу: GET path?seconds=30&hz=99 с заголовком "Authorization: Bearer token"
+    // собирает выборки стеков всех потоков процесса (в режиме prefork - обработчика, принявшего запрос)
+    // и отвечает свёрнутыми стеками для flame graph. Запрос ждёт профиль в пуле блокирующих задач,
+    // одновременно собирается один профиль. Бросает std::invalid_argument, если token короче 16 байт
+    void enableProfiler(const std::string& token, const std::string& path = "/debug/profile");
+
+    // Трассировка этапов запроса (вызывать до запуска сервера): чтение, разбор, поиск маршрута, хендлер,
+    // рендер шаблона с include и циклами, отправка. Трассы попавших в выборку запросов пишутся в файлы
+    // options.directory в формате Chrome или OTLP/JSON. Бросает std::invalid_argument для некорректных options
+    void enableTracing(const TracingOptions& options);
+
+    // Включает асинхронный журнал доступа (вызывать до запуска сервера). path "-" - стандартный вывод.
+    // rotateBytes и rotateInterval задают ротацию файла по размеру и по времени (0 - без ротации)
+    void enableAccessLog(const std::string& path, AccessLogFormat format = AccessLogFormat::Combined,
+                         size_t rotateBytes = 0, std::chrono::seconds rotateInterval = std::chrono::seconds(0));
+
+    // Проксирует запросы с путём prefix или prefix/... на группу upstream-серверов ("host:port").
+    // Вызывать до запуска сервера
+    void proxy(const std::string& prefix, const std::vector<std::string>& servers, const UpstreamOptions& options = {});
+
+    // WebSocket-маршрут (RFC 6455): запрос на path с Upgrade: websocket переключается на протокол WebSocket.
+    // Открытые соединения обслуживает отдельный поток на epoll, обработчики выполняются в пуле потоков
+    void websocket(const std::string& path, WebSocketHandler handler);
+
+    // Параметры цикла accept и слушающего сокета (вызывать до запуска сервера)
+    void setAcceptOptions(const AcceptOptions& options);
+
+    // Пинг, лимит сообщения и очереди отправки для WebSocket-соединений (вызывать до запуска сервера)
+    void setWebSocketOptions(const WebSocketOptions& options);
+
+    // Отправляет сообщение всем WebSocket-соединениям группы (WebSocket::join). Возвращает число получателей
+    size_t broadcast(const std::string& group, std::string_view message, bool binary = false);
+
+    // Включает HTTP/2 без TLS (h2c): по preface клиента (prior knowledge) и по Upgrade: h2c.
+    // Потоки одного соединения выполняются в пуле параллельно, хендлеры и маршруты - общие с HTTP/1.1
+    void enableHttp2(const Http2Options& options = {});
+
+    // Цель задержки маршрута (path - путь route(), шаблон routeParam() или префикс proxy()): запрос ставится
+    // в очередь пула со сроком "время поступления + target", пул выполняет задачи в порядке сроков, поэтому
+    // дешёвый маршрут с короткой целью не ждёт за очередью долгих. 0 - цель по изученной стоимости маршрута.
+    // Бросает std::invalid_argument, если маршрут не зарегистрирован
+    void setLatencyTarget(const std::string& path, std::chrono::milliseconds target);
+
+    // Цели по умолчанию и изучение стоимости маршрутов (вызывать до запуска сервера).
+    // Бросает std::invalid_argument для некорректных options
+    void setSchedulingOptions(const SchedulingOptions& options);
+
+    // Размер пула блокирующих задач (вызывать до запуска сервера).
+    // Бросает std::invalid_argument, если blockingMaxThreads равен 0 или меньше blockingMinThreads
+    void setExecutorOptions(const ExecutorOptions& options);
+
+    // Хендлер маршрута блокируется (файлы, база данных, внешние сервисы): запросы маршрута (path - путь route(),
+    // шаблон routeParam() или префикс proxy()) обслуживаются в пуле блокирующих задач и не занимают
+    // потоки обработчиков. Вызывать до запуска сервера; бросает std::invalid_argument, если маршрут не зарегистрирован
+    void blockingRoute(const std::string& path);
+
+    // Выполняет f в пуле блокирующих задач и возвращает future результата: фоновая запись, параллельные
+    // обращения к базе из одного хендлера. Хендлер, ждущий future, занимает поток обработчиков - маршрут,
+    // который блокируется целиком, лучше объявить blockingRoute()
+    template<class F>
+    auto offload(F&& f) -> std::future<typename std::invoke_result<F>::type> {
+        return blockingPool->enqueue(0, std::forward<F>(f));
+    }
+
+    // Включает защиту от перегрузки (вызывать до запуска сервера): лимиты соединений, запросов в обработке
+    // и очереди пула, резервы приоритетов и сброс по задержке в очереди. Отказ - 503 с Retry-After
+    void setOverloadProtection(const OverloadOptions& options);
+
 #ifdef ENABLE_PHP
-    // Дополнительная функция для поддержки PHP через php-cgi
+    // Адрес FastCGI-сервера PHP (php-fpm или php-cgi -b) и размер пула соединений к нему.
+    // По умолчанию 127.0.0.1:9000 - адрес php-fpm из стандартной поставки. Вызывать до запуска сервера
+    void setPHPFastCgi(const std::string& address, size_t maxConnections = 8);
+
+    // Выполнение PHP-скрипта через пул FastCGI-соединений; вывод скрипта буферизуется целиком
     std::string executePHP(const RequestData& reqData, const std::filesystem::path& scriptPath);
 #endif
 
 private:
+    // Микробенчмарки (bench/microbench.cpp) измеряют закрытые методы разбора запроса
+    friend class MicroBenchmarks;
+
     int port;
     bool verbose;
     bool enableHotReload; // Новый флаг для управления hot_reload
@@ -103,35 +285,182 @@ private:
     std::map<std::string, std::filesystem::file_time_type> templatesTimestamps;
     std::atomic<bool> running; // Для остановки потока
 
-    // Пул потоков
+    // Пул обработчиков и пул блокирующих задач (offload, blockingRoute); цикл accept - в serverThread
     ThreadPool threadPool;
+    std::unique_ptr<ThreadPool> blockingPool;
+    std::thread serverThread;
+    // Блокирующие маршруты по идентификаторам Metrics (только чтение после запуска)
+    std::vector<bool> blockingRouteIds;
+    bool blockingRoutesEnabled;
+
+    // WebSocket-соединения; объявлен после пула потоков, потому что передаёт в него события
+    WebSocketOptions websocketOptions;
+    std::unique_ptr<WebSocketHub> websocketHub;
+    // Соединения HTTP/2; как и WebSocketHub, ставит задачи в пул потоков
+    bool http2Enabled;
+    Http2Options http2Options;
+    std::unique_ptr<Http2Server> http2Server;
+
+    // Защита от перегрузки: запросы в очереди и в обработке, отказы и готовый ответ 503
+    bool overloadEnabled;
+    OverloadOptions overloadOptions;
+    std::string overloadResponse;
+    std::atomic<size_t> inFlightRequests;
+    std::atomic<unsigned long long> shedRequests;
+
+    // Сроки запросов в очереди пула: цели и стоимость маршрутов по идентификаторам Metrics
+    RouteScheduler scheduler;
+
+    // Пробуждение цикла accept (stop, передача сокета) и дообслуживание при остановке
+    AcceptOptions acceptOptions;
+    int acceptWakeFd;
+    std::chrono::milliseconds drainTimeout;
+    std::atomic<bool> drained;
+    std::unique_ptr<ListenerHandoff> listenerHandoff;
+
+    // Prefork: главный процесс создаёт общую память и запускает обработчики, обработчик получает
+    // от него слушающий сокет и дескрипторы общей памяти (preforkWorker)
+    bool preforkEnabled;
+    bool preforkWorkerProcess;
+    PreforkOptions preforkOptions;
+    PreforkWorker preforkWorker;
+    std::unique_ptr<PreforkSegment> preforkSegment;
+    std::shared_ptr<SharedCache> sharedCacheSegment;
 
     // Поток для мониторинга шаблонов (hot reload)
     std::thread hotReloadThread;
 
+    // Простаивающие keep-alive соединения ждут новых запросов в реакторе, а не в рабочем потоке
+    std::chrono::milliseconds keepAliveTimeout;
+    std::unique_ptr<Reactor> keepAliveReactor;
+    size_t maxRequestBodySize;
+
+    // Цикл io_uring; соединения, которым нужен сокет (прокси, WebSocket, HTTP/2), уходят в обычный путь
+    std::unique_ptr<IoUringServer> ioUringServer;
+
+    // TLS для всех соединений; прокси, WebSocket и HTTP/2 требуют открытого сокета и поверх TLS недоступны
+    std::unique_ptr<TlsContext> tlsContext;
+
+    // Метрики: счётчики по маршрутам и статусам, гистограммы фаз, gauges пула и соединений
+    Metrics metrics;
+    bool metricsEnabled;
+    std::atomic<size_t> openConnections;
+
+    // Профилировщик CPU; создаётся enableProfiler
+    std::unique_ptr<SamplingProfiler> profiler;
+
+    // Трассировка запросов; файлы открываются в run() процессом, который обслуживает запросы
+    std::unique_ptr<Tracer> tracer;
+
+    // Сжатие ответов
+    bool compressionEnabled;
+    int compressionLevel;
+    size_t compressionMinSize;
+    CompressedFileCache compressedFiles;
+
+    // Журнал доступа; в режиме verbose без явной настройки пишет в стандартный вывод
+    std::unique_ptr<AccessLog> accessLog;
+
+    // Постоянные соединения к FastCGI-серверу PHP (используются только при ENABLE_PHP)
+    std::unique_ptr<FastCgiPool> phpPool;
+
+    // Накопленная статистика выделений памяти
+    std::atomic<unsigned long long> allocStatRequests;
+    std::atomic<unsigned long long> allocStatAllocations;
+    std::atomic<unsigned long long> allocStatBytes;
+
     void monitorTemplates();
 
+    // Лимит частоты; scope отделяет счётчики одного IP для разных маршрутов
+    struct RateLimitRule {
+        RateLimit limit;
+        uint64_t scope;
+    };
+
+    struct Route {
+        ComplexHandler handler;
+        size_t metricsId;
+        std::shared_ptr<const CacheOptions> cache;
+        std::shared_ptr<const RateLimitRule> rateLimit;
+    };
+
     struct ParamRoute {
         std::string pattern;
         ComplexHandler handler;
+        size_t metricsId;
+        std::shared_ptr<const CacheOptions> cache;
+        std::shared_ptr<const RateLimitRule> rateLimit;
     };
 
-    std::unordered_map<std::string, ComplexHandler> routes;
+    // Кэш ответов маршрутов, включённых через cacheRoute
+    static constexpr size_t defaultResponseCacheBytes = 64 * 1024 * 1024;
+    std::unique_ptr<ResponseCache> responseCache;
+
+    // Счётчики лимитов частоты по IP клиента; создаётся при первом rateLimit/setClientRateLimit
+    std::unique_ptr<RateLimiter> rateLimiter;
+    std::shared_ptr<const RateLimitRule> clientRateLimit;
+    uint64_t nextRateLimitScope;
+    std::atomic<unsigned long long> rateLimitedRequests;
+
+    std::unique_ptr<SessionManager> sessions;
+
+    struct ProxyRoute {
+        std::string prefix;
+        std::unique_ptr<UpstreamPool> pool;
+        size_t metricsId;
+    };
+
+    struct WebSocketRoute {
+        std::shared_ptr<const WebSocketHandler> handler;
+        size_t metricsId;
+    };
+
+    std::unordered_map<std::string, Route> routes;
     std::vector<ParamRoute> paramRoutes;
+    std::vector<ProxyRoute> proxyRoutes;
+    std::unordered_map<std::string, WebSocketRoute> websocketRoutes;
     std::mutex routeMutex;
 
-    void handleClient(int clientSocket, const std::string& clientIP);
-    std::string readRequest(int clientSocket);
-    void parseRequest(const std::string& request, RequestData& reqData);
-    void parseQueryString(const std::string& queryString, std::map<std::string, std::string>& queryParams);
-    bool matchParamRoute(const std::string& path, const std::string& pattern, std::map<std::string,std::string>& routeParams);
-    bool serveStaticFile(const RequestData& reqData, std::string& response);
+    bool admitRequest(int priority, const TaskSchedule& schedule, std::function<void()> task, std::function<void()> shed);
+    bool withinAdmissionLimits(int priority);
+    size_t scheduledRoute(std::string_view path);
+    TaskSchedule readSchedule();
+    TaskSchedule requestSchedule(std::string_view request);
+    size_t registeredRouteId(const std::string& path, const char* caller);
+    bool isBlockingRoute(size_t routeId) const { return blockingRoutesEnabled && blockingRouteIds[routeId]; }
+    void offloadConnection(Connection* conn);
+    void sendOverloaded(int clientSocket);
+    void sendOverloaded(Connection& conn);
+    void rejectRequest(Connection& conn, const char* status);
+    void wakeAcceptLoop();
+    void handleClient(int clientSocket, const std::string& clientIP, std::chrono::steady_clock::time_point queuedAt);
+    void handleConnection(Connection* conn);
+    void serveConnection(Connection* conn);
+    bool processRequest(Connection& conn);
+    bool serveBufferedRequest(Connection& conn);
+    Connection* acceptIoUringConnection(int clientSocket, const sockaddr_in& address);
+    IoUringServer::RequestState inspectRequest(Connection& conn);
+    void dispatchIoUringRequest(Connection* conn);
+    void closeConnection(Connection* conn);
+    bool readRequest(Connection& conn);
+    void parseRequest(std::string_view request, Connection& conn);
+    bool matchParamRoute(const std::string& path, const std::string& pattern, std::map<std::string,std::string>& routeParams, MapNodeCache& nodeCache);
+    const ComplexHandler* findHandler(Connection& conn, size_t& metricsId, const CacheOptions*& cacheOptions,
+                                      const RateLimitRule*& rateLimit);
+    bool rateLimited(const Connection& conn, const RateLimitRule* routeLimit, std::chrono::steady_clock::duration& retryAfter);
+    ProxyRoute* findProxyRoute(std::string_view path);
+    bool proxyRequest(Connection& conn, ProxyRoute& route, std::chrono::steady_clock::time_point start);
+    bool upgradeHttp2(Connection& conn, bool priorKnowledge, std::chrono::steady_clock::time_point start);
+    std::string handleHttp2Request(std::string request, const std::string& clientIP);
+    bool upgradeWebSocket(Connection& conn, const WebSocketRoute& route, std::chrono::steady_clock::time_point start);
+    // deferredFile: файл не читается, а остаётся открытым для чтения через io_uring (см. Connection::responseFile)
+    bool serveStaticFile(const RequestData& reqData, std::string& response, Connection* deferredFile = nullptr);
     void sendResponse(int clientSocket, const std::string& content);
+    void sendResponse(Connection& conn, const std::string& content);
+    void logRequest(const Connection& conn, const std::string& response, std::chrono::steady_clock::time_point start);
+    void logRequest(const Connection& conn, int status, size_t bytes, std::chrono::steady_clock::time_point start);
     std::string generate404Error();
     std::string generate500Error(const std::string& msg);
-
-    void parseCookies(const std::string& cookieHeader, std::map<std::string, std::string>& cookies);
-    std::string urlDecode(const std::string &value);
 };
 
 #endif // FLASKCPP_H
@@ -0,0 +1,47 @@
+// headers/HotRestart.h
+#ifndef HOTRESTART_H
+#define HOTRESTART_H
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+// Передача слушающего сокета между процессами через управляющий Unix-сокет (SCM_RIGHTS).
+// Работающий процесс ждёт на controlPath; новый процесс при запуске подключается к нему,
+// получает тот же слушающий сокет и сразу принимает соединения, а старый перестаёт принимать
+// и дообслуживает уже принятые. Очередь listen() при этом не закрывается ни на миг,
+// поэтому во время обновления ни одно соединение не отклоняется
+class ListenerHandoff {
+public:
+    explicit ListenerHandoff(std::string controlPath);
+    ~ListenerHandoff();
+
+    ListenerHandoff(const ListenerHandoff&) = delete;
+    ListenerHandoff& operator=(const ListenerHandoff&) = delete;
+
+    // Новый процесс: забирает слушающий сокет у работающего процесса и ждёт, пока тот перестанет
+    // принимать соединения и освободит controlPath. -1 - передавать некому (первый запуск)
+    int receive();
+
+    // Работающий процесс: в отдельном потоке ждёт новый процесс и передаёт ему listenSocket.
+    // onHandoff вызывается сразу после передачи и должен остановить приём соединений.
+    // Бросает std::runtime_error, если управляющий сокет не удалось создать
+    void serve(int listenSocket, std::function<void()> onHandoff);
+
+    // Останавливает ожидание; controlPath удаляется, если сокет ещё не передан
+    void stop();
+
+    bool handedOff() const { return transferred.load(); }
+
+private:
+    std::string path;
+    int listener;
+    int wakeFd;
+    std::atomic<bool> transferred;
+    std::thread thread;
+
+    void loop(int listenSocket, std::function<void()> onHandoff);
+};
+
+#endif // HOTRESTART_H
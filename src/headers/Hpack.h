@@ -0,0 +1,82 @@
+// headers/Hpack.h
+#ifndef HPACK_H
+#define HPACK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Ошибка разбора блока заголовков: для HTTP/2 это ошибка соединения COMPRESSION_ERROR
+class HpackError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+using HeaderList = std::vector<std::pair<std::string, std::string>>;
+
+// Динамическая таблица HPACK (RFC 7541, 2.3.2): новые записи в начале, размер записи - имя + значение + 32
+class HpackTable {
+public:
+    explicit HpackTable(size_t maxSize = 4096) : maxSize(maxSize), currentSize(0) {}
+
+    void add(std::string name, std::string value);
+    void setMaxSize(size_t size);
+    size_t capacity() const { return maxSize; }
+
+    // Индекс 1..61 - статическая таблица, дальше - динамическая
+    bool lookup(size_t index, std::string_view& name, std::string_view& value) const;
+
+    // Ищет запись в обеих таблицах: 0 - не найдено; nameOnly - совпало только имя
+    size_t find(std::string_view name, std::string_view value, bool& nameOnly) const;
+
+private:
+    std::deque<std::pair<std::string, std::string>> entries;
+    size_t maxSize;
+    size_t currentSize;
+
+    void evict(size_t required);
+};
+
+// Декодер блоков заголовков; состояние таблицы общее для всех блоков соединения
+class HpackDecoder {
+public:
+    // maxTableSize - SETTINGS_HEADER_TABLE_SIZE, объявленный нашей стороной
+    explicit HpackDecoder(size_t maxTableSize = 4096) : table(maxTableSize), maxTableSize(maxTableSize) {}
+
+    // Добавляет заголовки блока в headers; бросает HpackError при ошибке сжатия.
+    // Блок всегда разбирается целиком, чтобы таблица осталась согласованной с клиентом; если список
+    // заголовков превысил maxHeaderListSize, лишние заголовки отбрасываются и возвращается false
+    bool decode(const uint8_t* data, size_t size, HeaderList& headers, size_t maxHeaderListSize);
+
+private:
+    HpackTable table;
+    size_t maxTableSize;
+};
+
+// Кодировщик блоков заголовков. Повторяющиеся заголовки ответов (content-type, server и т.п.)
+// попадают в динамическую таблицу и в следующих ответах передаются одним индексом
+class HpackEncoder {
+public:
+    HpackEncoder() : table(4096), pendingSizeUpdate(false) {}
+
+    // Размер таблицы из SETTINGS_HEADER_TABLE_SIZE клиента; изменение объявляется в начале следующего блока
+    void setMaxTableSize(size_t size);
+
+    void encode(const HeaderList& headers, std::string& out);
+
+private:
+    HpackTable table;
+    bool pendingSizeUpdate;
+};
+
+// Примитивы HPACK, доступные для тестов и микробенчмарков
+void hpackEncodeInteger(uint64_t value, int prefixBits, uint8_t firstByte, std::string& out);
+void hpackEncodeString(std::string_view value, std::string& out);
+bool huffmanDecode(const uint8_t* data, size_t size, std::string& out);
+
+#endif // HPACK_H
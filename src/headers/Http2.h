@@ -0,0 +1,89 @@
+// headers/Http2.h
+#ifndef HTTP2_H
+#define HTTP2_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Настройки HTTP/2 (h2c - HTTP/2 без TLS)
+struct Http2Options {
+    // SETTINGS_MAX_CONCURRENT_STREAMS: сверх лимита новые потоки отклоняются с REFUSED_STREAM
+    uint32_t maxConcurrentStreams = 256;
+    // Окно приёма тела запроса для каждого потока (SETTINGS_INITIAL_WINDOW_SIZE) и для соединения целиком
+    uint32_t streamWindowSize = 1024 * 1024;
+    uint32_t connectionWindowSize = 16 * 1024 * 1024;
+    // SETTINGS_MAX_FRAME_SIZE нашей стороны (16384 - 16777215)
+    uint32_t maxFrameSize = 16384;
+    // SETTINGS_MAX_HEADER_LIST_SIZE: размер заголовков запроса после распаковки HPACK
+    size_t maxHeaderListSize = 64 * 1024;
+    size_t maxRequestBodySize = 16 * 1024 * 1024;
+    // Соединение без активных потоков закрывается (GOAWAY) после этого интервала
+    std::chrono::milliseconds idleTimeout = std::chrono::seconds(60);
+    // Одновременные соединения: у каждого свой поток чтения, сверх лимита соединение закрывается
+    size_t maxConnections = 1024;
+    // Потоки, сброшенные клиентом (RST_STREAM), за секунду. Сверх лимита - GOAWAY с ENHANCE_YOUR_CALM:
+    // HEADERS с немедленным RST_STREAM не занимают места в maxConcurrentStreams, но нагружают пул ("rapid reset")
+    uint32_t maxResetsPerSecond = 100;
+};
+
+// Сервер HTTP/2 поверх соединений, переданных из HTTP/1.1-конвейера (prior knowledge или Upgrade: h2c).
+// Кадры соединения читает отдельный поток (не больше maxConnections, все завершаются в stop()),
+// каждый завершённый поток-запрос выполняется в пуле потоков, поэтому одно соединение обслуживает
+// сотни запросов одновременно. Ответы отправляются с учётом окон управления потоком клиента
+class Http2Server {
+public:
+    // Обработчик получает запрос в виде HTTP/1.1 (стартовая строка "METHOD PATH HTTP/2.0", заголовки, тело)
+    // и возвращает ответ в формате HTTP/1.1 - так переиспользуются разбор запроса и маршрутизация FlaskCpp
+    using RequestHandler = std::function<std::string(std::string request, const std::string& clientIP)>;
+    // Ставит задачу в пул потоков: приоритет по методу, срок по маршруту path (без query string)
+    using Dispatch = std::function<void(std::string_view method, std::string_view path, std::function<void()>)>;
+
+    Http2Server(RequestHandler handler, Dispatch dispatch, const Http2Options& options = {});
+    ~Http2Server();
+
+    Http2Server(const Http2Server&) = delete;
+    Http2Server& operator=(const Http2Server&) = delete;
+
+    // Отправляет GOAWAY всем соединениям и ждёт завершения их потоков чтения
+    void stop();
+
+    // Принимает сокет. buffered - уже прочитанные байты, начиная с preface клиента.
+    // Для Upgrade: h2c upgradeRequest - исходный запрос (станет потоком 1), upgradeSettings - HTTP2-Settings.
+    // false - сервер остановлен или открыто maxConnections соединений; сокет остаётся у вызывающего
+    bool adopt(int socket, const std::string& clientIP, std::string buffered,
+               std::string upgradeRequest = {}, std::string_view upgradeSettings = {});
+
+    size_t connectionCount();
+    unsigned long long streamCount() const { return streamsTotal.load(std::memory_order_relaxed); }
+
+private:
+    class Session;
+
+    std::shared_ptr<const RequestHandler> handler;
+    Dispatch dispatch;
+    Http2Options options;
+
+    std::mutex mutex;
+    std::condition_variable sessionsDone;
+    std::unordered_map<uint64_t, std::shared_ptr<Session>> sessions;
+    // Потоки чтения сессий; завершившиеся ждут join в следующем adopt или в stop()
+    std::unordered_map<uint64_t, std::thread> sessionThreads;
+    std::vector<std::thread> finishedThreads;
+    uint64_t nextId;
+    bool stopping;
+    std::atomic<unsigned long long> streamsTotal;
+
+    void unregister(uint64_t id);
+};
+
+#endif // HTTP2_H
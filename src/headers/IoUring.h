@@ -0,0 +1,186 @@
+// headers/IoUring.h
+#ifndef IOURING_H
+#define IOURING_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <linux/io_uring.h>
+#include <netinet/in.h>
+
+#include "Connection.h"
+
+// Кольцо io_uring поверх системных вызовов (без liburing): очередь отправки, очередь завершений
+// и предоставленные ядру буферы для приёма. Используется из одного потока
+class IoUring {
+public:
+    // Бросает std::runtime_error, если ядро не поддерживает нужные возможности (нужно 6.0+)
+    explicit IoUring(unsigned entries);
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // Свободная запись очереди отправки, обнулённая; при заполненной очереди сначала отправляет накопленное
+    io_uring_sqe* nextSqe();
+
+    // Отправляет накопленные записи и ждёт хотя бы одного завершения, но не дольше timeout
+    void submitAndWait(std::chrono::milliseconds timeout);
+
+    // Завершения, готовые к обработке: completion(i) для i < ready(), затем consume(ready())
+    unsigned ready() const { return __atomic_load_n(cqTail, __ATOMIC_ACQUIRE) - *cqHead; }
+    const io_uring_cqe& completion(unsigned i) const { return cqes[(*cqHead + i) & cqMask]; }
+    void consume(unsigned count) { __atomic_store_n(cqHead, *cqHead + count, __ATOMIC_RELEASE); }
+
+    // Зарегистрированные файлы: в записях очереди указывается индекс с флагом IOSQE_FIXED_FILE
+    void registerFiles(const int* fds, unsigned count);
+
+    // Предоставленные буферы группы 0: count буферов по size байт (IORING_OP_PROVIDE_BUFFERS).
+    // Приём с IOSQE_BUFFER_SELECT берёт буфер сам, номер приходит в флагах завершения
+    void setupBuffers(unsigned count, unsigned size);
+    std::string_view buffer(unsigned id, size_t length) const { return std::string_view(bufferMemory + size_t(id) * bufferSize, length); }
+    void recycleBuffer(unsigned id);
+
+    // Задачи ядра выполняются только внутри submitAndWait (IORING_SETUP_DEFER_TASKRUN)
+    bool deferredTaskRun() const { return deferTaskRun; }
+
+    // Вызовы io_uring_enter за время жизни кольца
+    unsigned long long enterCalls() const { return enters.load(std::memory_order_relaxed); }
+
+private:
+    int ringFd;
+    unsigned enterFlags;        // IORING_ENTER_REGISTERED_RING, если дескриптор кольца зарегистрирован
+    int enterFd;                // Дескриптор или индекс зарегистрированного кольца
+    bool deferTaskRun;
+
+    void* ringMemory;
+    size_t ringMemorySize;
+    io_uring_sqe* sqes;
+    size_t sqesSize;
+    unsigned* sqTail;
+    const unsigned* sqHead;
+    unsigned sqMask;
+    unsigned sqEntries;
+    unsigned sqeTail;           // Подготовленные, но ещё не опубликованные записи
+    unsigned submitted;         // Опубликованные в sqTail
+
+    unsigned* cqHead;
+    const unsigned* cqTail;
+    unsigned cqMask;
+    const io_uring_cqe* cqes;
+
+    char* bufferMemory;
+    unsigned bufferCount;
+    unsigned bufferSize;
+
+    std::atomic<unsigned long long> enters;
+
+    int enter(unsigned toSubmit, unsigned minComplete, unsigned flags, std::chrono::milliseconds timeout);
+};
+
+// Настройки ввода-вывода через io_uring
+struct IoUringOptions {
+    unsigned entries = 1024;      // Размер очереди отправки
+    unsigned bufferCount = 1024;  // Буферы приёма (не больше 65536)
+    unsigned bufferSize = 4096;
+};
+
+// Соединение в цикле IoUringServer (определено в IoUring.cpp)
+struct IoUringClient;
+
+// HTTP-сервер на io_uring: один поток обслуживает приём соединений (multishot accept на
+// зарегистрированном слушающем сокете), чтение запросов (multishot recv в предоставленные буферы)
+// и отправку ответов (send, при закрытии связанный с close). Хендлеры по-прежнему выполняются в пуле
+// потоков: готовый запрос передаётся в dispatch, ответ возвращается через complete(). Запросы, которым
+// нужен сам сокет (проксирование, WebSocket, HTTP/2), передаются обычному пути через takeOver
+class IoUringServer {
+public:
+    enum class RequestState {
+        Incomplete, // Запрос получен не полностью
+        Ready,      // Запрос целиком в readBuffer, длина записана в requestLength
+        TakeOver,   // Запрос обслуживается вне io_uring
+        Invalid     // Соединение нужно закрыть
+    };
+
+    struct Callbacks {
+        // Новое соединение; nullptr - отказ (сокет закрывает вызываемый)
+        std::function<Connection*(int socket, const sockaddr_in& address)> accept;
+        std::function<RequestState(Connection&)> inspect;
+        // Обработка готового запроса; по её окончании - complete() из любого потока
+        std::function<void(Connection*)> dispatch;
+        // Соединение передаётся обычному пути вместе с сокетом и прочитанными данными
+        std::function<void(Connection*)> takeOver;
+        // Сокет закрыт, соединение больше не используется
+        std::function<void(Connection*)> release;
+    };
+
+    IoUringServer(Callbacks callbacks, const IoUringOptions& options);
+    ~IoUringServer();
+
+    IoUringServer(const IoUringServer&) = delete;
+    IoUringServer& operator=(const IoUringServer&) = delete;
+
+    // Цикл событий в текущем потоке. Пока accepting, принимает соединения; затем дообслуживает
+    // принятые и возвращается, когда их не осталось (или после stop()). Соединения без запросов
+    // закрываются через idleTimeout. false - io_uring недоступен, причина в error, ни одно соединение не принято
+    bool run(int listenSocket, const std::atomic<bool>& accepting, std::chrono::milliseconds idleTimeout, std::string& error);
+
+    // Ответ на запрос готов в conn->writeBuffer (и conn->responseFile); вызывается из рабочего потока
+    void complete(Connection* conn, bool keepAlive);
+
+    // Будит цикл, чтобы он заметил смену accepting
+    void wake();
+
+    // Завершает цикл, не дожидаясь оставшихся соединений
+    void stop();
+
+    size_t connectionCount() const { return clientCount.load(std::memory_order_relaxed); }
+    unsigned long long enterCalls() const { return ringEnters.load(std::memory_order_relaxed); }
+
+private:
+    Callbacks callbacks;
+    IoUringOptions options;
+
+    int wakeFd;
+    uint64_t wakeValue;
+    std::atomic<bool> wakePending;
+    std::atomic<bool> stopRequested;
+
+    // Готовые ответы от рабочих потоков
+    std::mutex completedMutex;
+    std::vector<std::pair<Connection*, bool>> completed;
+
+    std::unique_ptr<IoUring> ring;
+    sockaddr_in acceptAddress;
+    socklen_t acceptAddressLength;
+    bool acceptArmed;
+    bool draining;
+    std::atomic<size_t> clientCount;
+    std::atomic<unsigned long long> ringEnters;
+
+    // Простаивающие соединения в порядке последней активности (голова - самые старые)
+    IoUringClient* idleHead;
+    IoUringClient* idleTail;
+
+    void armAccept();
+    void armWake();
+    void armRecv(IoUringClient* client);
+    void handleCompletion(const io_uring_cqe& cqe, bool lastAccept);
+    void handleAccept(const io_uring_cqe& cqe, bool lastAccept);
+    void handleRecv(IoUringClient* client, const io_uring_cqe& cqe);
+    void processInput(IoUringClient* client);
+    void sendResponse(IoUringClient* client, bool keepAlive);
+    void finishResponse(IoUringClient* client);
+    void closeClient(IoUringClient* client);
+    void releaseIfDone(IoUringClient* client);
+    void beginDrain();
+    void markIdle(IoUringClient* client);
+    void unmarkIdle(IoUringClient* client);
+};
+
+#endif // IOURING_H
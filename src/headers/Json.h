@@ -0,0 +1,177 @@
+// headers/Json.h
+#ifndef JSON_H
+#define JSON_H
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+enum class JsonType : uint8_t { Null, Boolean, Number, String, Array, Object };
+
+class JsonDocument;
+
+// Значение внутри разобранного документа: номер узла документа, копируется по значению.
+// Строки и числа декодируются только при обращении. Живёт не дольше документа и его текста.
+// Несовпадение типа и отсутствующее поле - std::runtime_error
+class JsonValue {
+public:
+    class Iterator {
+    public:
+        JsonValue operator*() const;
+        Iterator& operator++();
+        bool operator!=(const Iterator& other) const { return position != other.position; }
+
+    private:
+        friend class JsonValue;
+        Iterator(const JsonDocument* document, uint32_t position, bool object)
+            : document(document), position(position), object(object) {}
+        const JsonDocument* document;
+        uint32_t position;   // Элемент массива или ключ поля объекта
+        bool object;
+    };
+
+    JsonValue() = default;
+
+    // false для результата find() без такого поля
+    bool exists() const { return document != nullptr; }
+    JsonType type() const;
+    bool isNull() const { return type() == JsonType::Null; }
+    bool isBool() const { return type() == JsonType::Boolean; }
+    bool isNumber() const { return type() == JsonType::Number; }
+    bool isString() const { return type() == JsonType::String; }
+    bool isArray() const { return type() == JsonType::Array; }
+    bool isObject() const { return type() == JsonType::Object; }
+
+    bool asBool() const;
+    double asDouble() const;
+    // Только целые без дробной части и экспоненты, в пределах long long
+    long long asInt() const;
+    // Строка с раскрытыми escape-последовательностями (\uXXXX - в UTF-8)
+    std::string asString() const;
+    // Содержимое строки между кавычками как в тексте, без копирования; escape-последовательности не раскрыты
+    std::string_view rawString() const;
+    bool hasEscapes() const;
+
+    // Элементов массива или полей объекта
+    size_t size() const;
+    // Элемент массива; доступ по номеру проходит элементы до него, для обхода - begin()/end()
+    JsonValue operator[](size_t index) const;
+    JsonValue operator[](std::string_view key) const;
+    // Поле объекта или значение с exists() == false
+    JsonValue find(std::string_view key) const;
+    bool contains(std::string_view key) const { return find(key).exists(); }
+    // Имя поля, если значение - поле объекта
+    std::string key() const;
+
+    // Элементы массива или значения полей объекта (имя поля - key())
+    Iterator begin() const;
+    Iterator end() const;
+
+    // Исходный текст значения - корректный JSON
+    std::string_view raw() const;
+
+private:
+    friend class JsonDocument;
+    JsonValue(const JsonDocument* document, uint32_t index) : document(document), index(index) {}
+
+    const JsonDocument* document = nullptr;
+    uint32_t index = 0;
+};
+
+// Разобранный JSON. parse() проверяет текст целиком за один проход и строит компактную ленту узлов
+// (смещение в тексте, тип, переход к следующему соседу); строки ищутся блоками по 16 байт (SSE2).
+// Текст не копируется и должен жить, пока используются значения. UTF-8 внутри строк не проверяется
+class JsonDocument {
+public:
+    JsonDocument() = default;
+    // Бросает std::invalid_argument для некорректного JSON
+    explicit JsonDocument(std::string_view text) { parse(text); }
+
+    // Разбирает новый текст; память узлов предыдущего разбора переиспользуется.
+    // Бросает std::invalid_argument с описанием и смещением ошибки
+    void parse(std::string_view text);
+    JsonValue root() const;
+
+private:
+    friend class JsonValue;
+
+    struct Node {
+        uint32_t offset;   // Начало значения в тексте (для строки - открывающая кавычка)
+        uint32_t length;
+        uint32_t next;     // Узел после поддерева этого значения
+        uint32_t count;    // Элементов массива или полей объекта
+        JsonType type;
+        uint8_t flags;
+    };
+    static constexpr uint8_t escapedFlag = 1;   // В строке есть escape-последовательности
+    static constexpr uint8_t integerFlag = 2;   // Число без дробной части и экспоненты
+    static constexpr uint8_t memberFlag = 4;    // Значение поля объекта: предыдущий узел - ключ
+
+    size_t parseValue(size_t pos, size_t depth);
+    size_t parseObject(uint32_t index, size_t pos, size_t depth);
+    size_t parseArray(uint32_t index, size_t pos, size_t depth);
+    size_t parseString(uint32_t index, size_t pos);
+    size_t parseNumber(uint32_t index, size_t pos);
+    size_t skipWhitespace(size_t pos) const;
+
+    std::string_view text;
+    std::vector<Node> nodes;
+};
+
+// Потоковая запись JSON в конец строки (например, буфера ответа) без промежуточного дерева.
+// Запятые расставляются автоматически; парность begin/end и ключи внутри объектов - забота вызывающего
+//
+//   JsonWriter json(out);
+//   json.beginObject().field("id", 42).key("tags").beginArray().value("a").value("b").endArray().endObject();
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out) : out(out) {}
+
+    JsonWriter& beginObject();
+    JsonWriter& endObject();
+    JsonWriter& beginArray();
+    JsonWriter& endArray();
+    JsonWriter& key(std::string_view name);
+
+    JsonWriter& value(std::string_view text);
+    JsonWriter& value(const char* text) { return value(std::string_view(text)); }
+    JsonWriter& value(const std::string& text) { return value(std::string_view(text)); }
+    JsonWriter& value(bool flag);
+    // Бесконечность и NaN в JSON не представимы и записываются как null
+    JsonWriter& value(double number);
+    JsonWriter& value(std::nullptr_t);
+    // Значение из разобранного документа копируется как есть
+    JsonWriter& value(const JsonValue& json) { return rawValue(json.raw()); }
+    template <typename T>
+    std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, JsonWriter&> value(T number) {
+        separator();
+        char buffer[24];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+        out.append(buffer, result.ptr);
+        needComma = true;
+        return *this;
+    }
+    // Готовый JSON-фрагмент без проверки и экранирования
+    JsonWriter& rawValue(std::string_view json);
+
+    template <typename T>
+    JsonWriter& field(std::string_view name, const T& fieldValue) {
+        key(name);
+        return value(fieldValue);
+    }
+
+private:
+    void separator() {
+        if (needComma) out += ',';
+    }
+    void writeString(std::string_view text);
+
+    std::string& out;
+    bool needComma = false;   // Перед следующим значением или ключом на этом уровне нужна запятая
+};
+
+#endif // JSON_H
@@ -0,0 +1,133 @@
+// headers/Metrics.h
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Снимок гистограммы: обычные (не атомарные) счётчики, которые можно складывать и анализировать
+struct HistogramSnapshot {
+    std::vector<uint64_t> counts;
+    uint64_t count = 0;
+    uint64_t sum = 0; // Сумма значений в наносекундах
+
+    // Значение квантиля q (0..1) в наносекундах, с точностью до ширины корзины (~6%)
+    uint64_t quantile(double q) const;
+    // Количество значений, не превышающих limit наносекунд
+    uint64_t countAtOrBelow(uint64_t limit) const;
+    uint64_t max() const;
+};
+
+// Гистограмма задержек в стиле HDR: логарифмические диапазоны (степени двойки),
+// каждый разбит на 16 линейных корзин. Относительная погрешность не хуже 1/16 во всём диапазоне
+// от наносекунд до десятков минут при фиксированном размере.
+// Запись разрешена только одному потоку-владельцу, поэтому обходится без атомарных RMW-операций;
+// читать (addTo) можно из любого потока одновременно с записью
+class LatencyHistogram {
+public:
+    static constexpr int subBucketBits = 4;
+    static constexpr int subBucketCount = 1 << subBucketBits;
+    static constexpr int maxShift = 36; // Значения до 2^41 нс (~36 минут), большие попадают в последнюю корзину
+    static constexpr size_t bucketCount = (maxShift + 2) * subBucketCount;
+
+    LatencyHistogram();
+
+    void record(uint64_t nanos);
+    void addTo(HistogramSnapshot& snapshot) const;
+
+    static size_t bucketIndex(uint64_t nanos);
+    // Верхняя (не включительная) граница корзины в наносекундах
+    static uint64_t bucketUpperBound(size_t index);
+
+private:
+    std::atomic<uint64_t> buckets[bucketCount];
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> sum;
+};
+
+// Фазы обработки запроса, для которых собираются гистограммы задержек
+enum class MetricsPhase {
+    Parse = 0,
+    Handler,
+    Render,
+    Send,
+    Count
+};
+
+// Значение метрики, вычисляемое в момент экспорта (gauge или счётчик, который ведётся вне Metrics)
+struct MetricsGauge {
+    std::string name;
+    std::string help;
+    double value;
+    std::string type = "gauge";
+};
+
+// Значения по маршрутам: индекс - идентификатор registerRoute, экспортируются с меткой route (нулевые пропускаются)
+struct MetricsRouteSeries {
+    std::string name;
+    std::string help;
+    std::vector<double> values;
+    std::string type = "gauge";
+};
+
+struct MetricsShard;
+
+// Метрики сервера: счётчики по маршрутам и статусам и гистограммы фаз запроса.
+// Каждый поток пишет в собственный шард без блокировок; при экспорте шарды суммируются
+class Metrics {
+public:
+    // Количество маршрутов, для которых ведутся отдельные счётчики; остальные попадают в "other"
+    static constexpr size_t maxRoutes = 256;
+    static constexpr int maxStatus = 600;
+
+    // Зарезервированные идентификаторы маршрутов
+    static constexpr size_t staticRouteId = 0;
+    static constexpr size_t notFoundRouteId = 1;
+    static constexpr size_t otherRouteId = 2;
+
+    Metrics();
+    ~Metrics();
+
+    // Регистрирует маршрут и возвращает его идентификатор для recordRequest
+    size_t registerRoute(const std::string& name);
+
+    void recordRequest(size_t routeId, int status);
+    void recordPhase(MetricsPhase phase, uint64_t nanos);
+
+    HistogramSnapshot phaseSnapshot(MetricsPhase phase) const;
+
+    // Экспорт в текстовом формате Prometheus
+    std::string renderPrometheus(const std::vector<MetricsGauge>& gauges,
+                                 const std::vector<MetricsRouteSeries>& routeSeries = {}) const;
+
+    static const char* phaseName(MetricsPhase phase);
+
+    // Шарды в общей памяти процессов prefork (PreforkSegment). Главный процесс размечает count шардов
+    // в memory один раз; обработчик подключает их все до первой записи: экспорт суммирует шарды всех
+    // процессов, а потоки этого процесса пишут только в шарды [leaseBegin, leaseEnd)
+    static size_t sharedShardsBytes(size_t count);
+    static void initSharedShards(void* memory, size_t count);
+    void useSharedShards(void* memory, size_t count, size_t leaseBegin, size_t leaseEnd);
+
+private:
+    uint64_t id; // Уникальный идентификатор экземпляра для привязки thread_local шардов
+
+    mutable std::mutex shardsMutex;
+    std::vector<std::shared_ptr<MetricsShard>> shards;
+    // Первые sharedCount шардов - в общей памяти; потоки процесса берут из них только свои
+    size_t sharedCount = 0;
+    size_t leaseBegin = 0;
+    size_t leaseEnd = 0;
+
+    mutable std::mutex routesMutex;
+    std::vector<std::string> routeNames;
+
+    MetricsShard& localShard();
+};
+
+#endif // METRICS_H
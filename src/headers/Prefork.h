@@ -0,0 +1,127 @@
+// headers/Prefork.h
+#ifndef PREFORK_H
+#define PREFORK_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+class SharedCache;
+
+// Настройки многопроцессного режима (FlaskCpp::enablePrefork)
+struct PreforkOptions {
+    // Количество процессов-обработчиков; 0 - по числу ядер
+    size_t workers = 0;
+    // Пауза перед перезапуском упавшего обработчика. Пока обработчики падают сразу после запуска,
+    // пауза удваивается (до 5 секунд), чтобы ошибка при старте не превращалась в непрерывный fork
+    std::chrono::milliseconds restartDelay = std::chrono::milliseconds(100);
+    // Шардов Metrics на обработчик: по одному на каждый поток, который пишет метрики
+    size_t metricsShardsPerWorker = 32;
+    // Общий кэш в памяти (FlaskCpp::sharedCache): количество ячеек и размер ячейки в байтах
+    // (ключ и значение вместе, кратно 64). 0 ячеек - без общего кэша
+    size_t sharedCacheSlots = 4096;
+    size_t sharedCacheSlotSize = 16 * 1024;
+    // Свой слушающий сокет SO_REUSEPORT у каждого обработчика, с SO_INCOMING_CPU = ядро обработчика, и сам
+    // обработчик закреплён за этим ядром: соединение принимает процесс на ядре, которое обработало его пакеты.
+    // Выбор сокета группы reuseport по SO_INCOMING_CPU есть в Linux 6.1+, раньше - по хэшу адресов
+    bool incomingCpu = false;
+};
+
+// Общая память prefork (memfd): счётчики главного процесса и шарды Metrics всех обработчиков.
+// Обработчик i пишет метрики только в свои шарды, а /metrics любого обработчика суммирует все,
+// поэтому ответ одинаков, какой бы процесс ни принял запрос
+class PreforkSegment {
+public:
+    // Новый сегмент (главный процесс). Бросает std::runtime_error, если память не выделена
+    PreforkSegment(size_t workers, size_t shardsPerWorker);
+    // Сегмент, унаследованный обработчиком; владение fd переходит объекту.
+    // Бросает std::runtime_error, если fd - не сегмент prefork
+    explicit PreforkSegment(int fd);
+    ~PreforkSegment();
+
+    PreforkSegment(const PreforkSegment&) = delete;
+    PreforkSegment& operator=(const PreforkSegment&) = delete;
+
+    int descriptor() const { return fd; }
+    size_t workerCount() const;
+    size_t shardsPerWorker() const;
+    // Память шардов для Metrics::useSharedShards
+    void* metricsShards() const;
+
+    size_t aliveWorkers() const;
+    unsigned long long restartCount() const;
+
+private:
+    friend class PreforkMaster;
+    struct Header;
+
+    int fd;
+    char* mapping;
+    size_t mappingSize;
+
+    void map();
+    Header& header() const;
+};
+
+// Параметры процесса-обработчика, переданные главным процессом через переменную окружения
+struct PreforkWorker {
+    size_t index = 0;
+    int listenSocket = -1;
+    int segmentFd = -1;
+    int cacheFd = -1; // -1 - общий кэш выключен
+
+    // false - процесс запущен не главным процессом prefork. Переменная окружения удаляется,
+    // чтобы её не унаследовали процессы, запущенные хендлерами
+    static bool fromEnvironment(PreforkWorker& worker);
+};
+
+// Главный процесс prefork: держит слушающий сокет, запускает обработчики и перезапускает упавшие.
+// Обработчик - тот же исполняемый файл с теми же аргументами (fork + exec): fork
+// многопоточного процесса без exec наследует мьютексы, захваченные другими потоками, поэтому каждый
+// обработчик заново проходит main и получает собственный пул потоков
+class PreforkMaster {
+public:
+    // При options.incomingCpu listenSocket должен быть открыт с SO_REUSEPORT; если сокеты обработчиков
+    // не открываются, все обработчики принимают соединения на listenSocket без привязки к ядрам
+    PreforkMaster(const PreforkOptions& options, int listenSocket, PreforkSegment& segment, SharedCache* cache,
+                  bool verbose);
+    ~PreforkMaster();
+
+    PreforkMaster(const PreforkMaster&) = delete;
+    PreforkMaster& operator=(const PreforkMaster&) = delete;
+
+    // Запускает обработчики и следит за ними, пока running не сброшен (проверяется при записи в wakeFd
+    // и не реже раза в 200 мс). Затем рассылает обработчикам SIGTERM, ждёт их не дольше drainTimeout
+    // плюс секунда и завершает оставшихся SIGKILL. Бросает std::runtime_error, если не удалось запустить ни одного
+    void run(std::atomic<bool>& running, int wakeFd, std::chrono::milliseconds drainTimeout);
+
+private:
+    struct Worker {
+        pid_t pid = 0;
+        std::chrono::steady_clock::time_point started;
+        std::chrono::steady_clock::time_point restartAt;
+        std::chrono::milliseconds delay{0};
+    };
+
+    PreforkOptions options;
+    int listenSocket;
+    PreforkSegment& segment;
+    SharedCache* cache;
+    bool verbose;
+    std::string executable;
+    std::vector<std::string> arguments;
+    std::vector<Worker> workers;
+    // Слушающий сокет и ядро обработчика i (incomingCpu); пустые - все на listenSocket без привязки
+    std::vector<int> workerSockets;
+    std::vector<int> workerCpus;
+
+    void openSteeringSockets();
+
+    pid_t spawn(size_t index);
+    void reap(bool restart);
+};
+
+#endif // PREFORK_H
@@ -0,0 +1,50 @@
+// headers/Profiler.h
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+// Параметры одного профиля
+struct ProfileOptions {
+    std::chrono::milliseconds duration = std::chrono::seconds(30);
+    // Выборок в секунду процессорного времени каждого потока (99 - чтобы не совпадать с периодическими задачами)
+    int frequency = 99;
+};
+
+// Семплирующий профилировщик CPU по запросу. На время профиля каждый поток процесса получает таймер
+// своего процессорного времени (timer_create с CLOCK_THREAD_CPUTIME потока и SIGEV_THREAD_ID), сигнал
+// SIGPROF приходит в тот поток, который тратит CPU. Обработчик сигнала записывает стек в кольцевой
+// буфер потока без блокировок и выделений памяти, а поток, вызвавший profile, периодически забирает
+// выборки и в конце превращает их в свёрнутые стеки (формат flamegraph.pl / speedscope).
+// Вне профиля таймеров нет и обработчик не вызывается, поэтому издержки - ноль
+class SamplingProfiler {
+public:
+    SamplingProfiler();
+
+    SamplingProfiler(const SamplingProfiler&) = delete;
+    SamplingProfiler& operator=(const SamplingProfiler&) = delete;
+
+    // Профилирует все потоки процесса options.duration и возвращает строки "поток;корень;...;лист N",
+    // самые частые стеки первыми. Блокирует вызывающий поток; профиль прерывается раньше, когда
+    // keepRunning сбрасывается. Бросает std::runtime_error, если в процессе уже собирается профиль
+    // или таймеры не созданы, std::invalid_argument - для некорректных options
+    std::string profile(const ProfileOptions& options, const std::atomic<bool>& keepRunning);
+
+    // Профиль собирается (в любом экземпляре: обработчик сигнала один на процесс)
+    static bool active();
+
+    unsigned long long profileCount() const { return profiles.load(std::memory_order_relaxed); }
+    unsigned long long sampleCount() const { return samples.load(std::memory_order_relaxed); }
+    // Выборки, потерянные из-за переполнения кольцевых буферов или таблицы потоков
+    unsigned long long droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<unsigned long long> profiles;
+    std::atomic<unsigned long long> samples;
+    std::atomic<unsigned long long> dropped;
+};
+
+#endif // PROFILER_H
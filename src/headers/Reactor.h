@@ -0,0 +1,53 @@
+// headers/Reactor.h
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#include "Connection.h"
+
+// Реактор на epoll для простаивающих keep-alive соединений.
+// Пока клиент молчит, соединение не занимает рабочий поток: оно «паркуется» здесь,
+// а как только приходят новые данные, передаётся обратно через onReady.
+// Соединения, простаивающие дольше idleTimeout, закрываются через onExpire
+class Reactor {
+public:
+    using Callback = std::function<void(Connection*)>;
+
+    Reactor(Callback onReady, Callback onExpire, std::chrono::milliseconds idleTimeout);
+    ~Reactor();
+
+    void start();
+    // Останавливает поток реактора и передаёт все припаркованные соединения в onExpire
+    void stop();
+
+    // Паркует соединение до прихода данных. Возвращает false, если реактор не запущен
+    bool watch(Connection* conn);
+
+    size_t idleCount() const { return idleConnections.load(); }
+
+private:
+    Callback onReady;
+    Callback onExpire;
+    std::chrono::milliseconds idleTimeout;
+
+    int epollFd;
+    std::atomic<bool> running;
+    std::thread loopThread;
+
+    // Интрузивный список припаркованных соединений в порядке парковки:
+    // в голове всегда самые старые, поэтому проверка таймаутов не обходит весь список
+    std::mutex idleMutex;
+    Connection* idleHead;
+    Connection* idleTail;
+    std::atomic<size_t> idleConnections;
+
+    void loop();
+    void unlink(Connection* conn);
+};
+
+#endif // REACTOR_H
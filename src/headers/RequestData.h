@@ -0,0 +1,167 @@
+// headers/RequestData.h
+#ifndef REQUESTDATA_H
+#define REQUESTDATA_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <map>
+#include <memory_resource>
+#include <vector>
+
+#include "Json.h"
+
+class Session;
+
+// Кэш узлов std::map<std::string, std::string>.
+// Вместо освобождения узлов после запроса извлекаем их через extract() и используем повторно:
+// строки ключа и значения сохраняют свою ёмкость, поэтому разбор следующего запроса
+// такой же формы не обращается к куче
+class MapNodeCache {
+public:
+    using Map = std::map<std::string, std::string>;
+    using Node = Map::node_type;
+
+    MapNodeCache() = default;
+    // Копия кэша пуста: узлы принадлежат тому, кто их накопил (копия запроса для WebSocket заводит свои)
+    MapNodeCache(const MapNodeCache&) {}
+    MapNodeCache& operator=(const MapNodeCache&) { return *this; }
+
+    // Переносит все узлы карты в кэш, оставляя карту пустой
+    void recycle(Map& map);
+
+    // Вставляет или перезаписывает значение по ключу, используя узел из кэша.
+    // Возвращает ссылку на строку значения, чтобы её можно было заполнить на месте
+    std::string& emplace(Map& map, std::string_view key);
+
+private:
+    std::vector<Node> nodes;
+};
+
+// Заголовки, которые читает сам сервер и большинство хендлеров. Каждый получает фиксированную ячейку
+// при разборе запроса (идеальный хэш по длине и последнему символу имени), поэтому их чтение -
+// обращение к массиву; остальные заголовки ищутся в исходном тексте только по запросу хендлера
+enum class KnownHeader : uint8_t {
+    Host,
+    Connection,
+    ContentType,
+    ContentLength,
+    TransferEncoding,
+    Cookie,
+    Accept,
+    AcceptEncoding,
+    Upgrade,
+    UserAgent,
+    Referer,
+    Authorization,
+    Origin,
+    IfNoneMatch,
+    XForwardedFor,
+    Http2Settings,
+    SecWebSocketKey,
+    SecWebSocketVersion,
+    Count
+};
+
+// Разбор "a=1&b=2" с URL-декодированием значений; узлы карты берутся из nodeCache
+void parseQueryString(std::string_view queryString, std::map<std::string, std::string>& params, MapNodeCache& nodeCache);
+// Разбор заголовка Cookie: "a=1; b=2"
+void parseCookies(std::string_view cookieHeader, std::map<std::string, std::string>& cookies, MapNodeCache& nodeCache);
+// Декодирует %XX и '+' из value в result, переиспользуя его ёмкость
+void urlDecode(std::string_view value, std::string& result);
+
+// Структура для хранения данных запроса.
+// Заголовки, параметры строки запроса, данные формы и cookies не раскладываются по картам при разборе:
+// хранится исходный текст, а карты строятся при первом обращении и живут до конца запроса
+struct RequestData {
+    std::string method;
+    std::string path;
+    std::string queryString; // Строка запроса после '?' без декодирования
+    std::map<std::string, std::string> routeParams; // Параметры из пути: /user/<id>
+    std::string headerBlock; // Строки заголовков как пришли от клиента, без стартовой строки
+    std::string body;
+
+    // Арена рабочего потока для временных данных хендлера.
+    // Сбрасывается после каждого запроса, поэтому ничего из неё нельзя хранить дольше запроса
+    std::pmr::memory_resource* arena = nullptr;
+
+    // Сессия клиента (FlaskCpp::enableSessions); nullptr, если сессии выключены или маршрут кэшируется
+    Session* session = nullptr;
+
+    // Значение заголовка; имя сравнивается без учёта регистра. Пустое, если заголовка нет.
+    // Из повторяющихся заголовков возвращается последний
+    std::string_view header(std::string_view name) const;
+    std::string_view header(KnownHeader name) const {
+        const HeaderSlot& slot = knownHeaders[static_cast<size_t>(name)];
+        return std::string_view(headerBlock.data() + slot.offset, slot.length);
+    }
+
+    // Все заголовки по порядку: callback(name, value)
+    template <typename Callback>
+    void forEachHeader(Callback&& callback) const {
+        std::string_view block(headerBlock);
+        size_t pos = 0;
+        while (pos < block.size()) {
+            size_t lineEnd = block.find('\n', pos);
+            if (lineEnd == std::string_view::npos) lineEnd = block.size();
+            std::string_view line = block.substr(pos, lineEnd - pos);
+            pos = lineEnd + 1;
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            size_t colonPos = line.find(':');
+            if (colonPos == std::string_view::npos || colonPos == 0) continue;
+            std::string_view value = line.substr(colonPos + 1);
+            while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+            callback(line.substr(0, colonPos), value);
+        }
+    }
+
+    // Сохраняет строки заголовков (до пустой строки) и раскладывает известные заголовки по ячейкам
+    void setHeaders(std::string_view lines);
+
+    // Параметры строки запроса с декодированными значениями
+    const std::map<std::string, std::string>& queryParams() const;
+    // Поля тела POST-запроса с Content-Type: application/x-www-form-urlencoded
+    const std::map<std::string, std::string>& formData() const;
+    // Cookies из заголовка Cookie
+    const std::map<std::string, std::string>& cookies() const;
+
+    // Тело запроса как JSON. Разбирается при первом вызове, значения живут до конца запроса.
+    // Бросает std::invalid_argument, если тело - некорректный JSON (хендлер может ответить 400)
+    JsonValue json() const {
+        if (!jsonParsed) {
+            jsonDocument.parse(body);
+            jsonParsed = true;
+        }
+        return jsonDocument.root();
+    }
+
+    // Возвращает карты в кэш узлов и очищает запрос для следующего
+    void clear();
+
+    // Узлы карт переходят от запроса к запросу соединения
+    mutable MapNodeCache nodeCache;
+
+    // Разобранное тело; узлы переиспользуются следующими запросами соединения
+    mutable JsonDocument jsonDocument;
+    mutable bool jsonParsed = false;
+
+private:
+    // Значение известного заголовка в headerBlock; offset == 0 - заголовка нет
+    // (значение не может начинаться с начала блока: перед ним имя и двоеточие)
+    struct HeaderSlot {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+    };
+    std::array<HeaderSlot, static_cast<size_t>(KnownHeader::Count)> knownHeaders{};
+
+    static constexpr uint8_t queryParsed = 1;
+    static constexpr uint8_t formParsed = 2;
+    static constexpr uint8_t cookiesParsed = 4;
+    mutable uint8_t parsedFields = 0;
+    mutable std::map<std::string, std::string> queryValues;
+    mutable std::map<std::string, std::string> formValues;
+    mutable std::map<std::string, std::string> cookieValues;
+};
+
+#endif // REQUESTDATA_H
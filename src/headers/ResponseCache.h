@@ -0,0 +1,105 @@
+// headers/ResponseCache.h
+#ifndef RESPONSECACHE_H
+#define RESPONSECACHE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class SharedCache;
+
+// Настройки кэширования ответа маршрута
+struct CacheOptions {
+    // Время жизни ответа. 0 - ответы не хранятся, но одновременные промахи всё равно объединяются
+    std::chrono::milliseconds ttl = std::chrono::seconds(1);
+    // Параметры query string, входящие в ключ; остальные параметры не влияют на ответ
+    std::vector<std::string> queryParams;
+    // Заголовки запроса, от которых зависит ответ (Vary)
+    std::vector<std::string> varyHeaders;
+};
+
+// Готовый HTTP-ответ в кэше. Хендлер формирует заголовок Connection для конкретного клиента,
+// поэтому хранятся оба варианта ответа
+struct CachedResponse {
+    std::string keepAlive;
+    std::string close;
+    std::chrono::steady_clock::time_point expires;
+    size_t size = 0;
+
+    const std::string& forConnection(bool keepAliveConnection) const { return keepAliveConnection ? keepAlive : close; }
+};
+
+// Кэш ответов с вытеснением по TTL и по бюджету памяти (LRU).
+// Одновременные промахи по одному ключу объединяются: хендлер выполняет первый запрос,
+// остальные ждут его результата
+class ResponseCache {
+public:
+    using Entry = std::shared_ptr<const CachedResponse>;
+
+    explicit ResponseCache(size_t maxBytes);
+
+    // Возвращает ответ из кэша или вызывает produce и сохраняет результат.
+    // Если ответ produce кэшировать нельзя (не 200, Set-Cookie, Cache-Control: no-store/private,
+    // Vary по заголовкам вне options.varyHeaders), возвращает nullptr, а ответ кладёт в response.
+    // Выбранное кодирование ответа вызывающий всегда включает в key, поэтому Vary: Accept-Encoding допустим
+    Entry fetch(const std::string& key, const CacheOptions& options,
+                const std::function<std::string()>& produce, std::string& response);
+
+    void setMaxBytes(size_t bytes);
+    void clear();
+
+    // Второй уровень в общей памяти процессов prefork: промах локального кэша сначала ищет ответ там,
+    // и только потом вызывает хендлер; сформированный ответ сохраняется на обоих уровнях
+    void setSharedCache(std::shared_ptr<SharedCache> cache);
+
+    size_t sizeBytes();
+    size_t entryCount();
+    unsigned long long hitCount() const { return hits.load(std::memory_order_relaxed); }
+    unsigned long long missCount() const { return misses.load(std::memory_order_relaxed); }
+    unsigned long long coalescedCount() const { return coalesced.load(std::memory_order_relaxed); }
+    // Промахи локального кэша, найденные в общем
+    unsigned long long sharedHitCount() const { return sharedHits.load(std::memory_order_relaxed); }
+
+    static bool isCacheable(const std::string& response, const CacheOptions& options);
+
+private:
+    // Промах, для которого хендлер уже выполняется
+    struct Pending {
+        std::condition_variable done;
+        bool finished = false;
+        Entry entry;
+    };
+
+    struct Slot {
+        Entry entry;
+        std::list<std::string>::iterator lruPosition;
+    };
+
+    std::mutex mutex;
+    size_t maxBytes;
+    size_t usedBytes;
+    std::unordered_map<std::string, Slot> entries;
+    std::list<std::string> lru; // В начале - недавно использованные ключи
+    std::unordered_map<std::string, std::shared_ptr<Pending>> pending;
+    std::shared_ptr<SharedCache> shared;
+
+    std::atomic<unsigned long long> hits;
+    std::atomic<unsigned long long> misses;
+    std::atomic<unsigned long long> coalesced;
+    std::atomic<unsigned long long> sharedHits;
+
+    Entry lookupLocked(const std::string& key);
+    void insertLocked(const std::string& key, Entry entry);
+    void eraseLocked(std::unordered_map<std::string, Slot>::iterator it);
+    void evictLocked();
+    static Entry makeEntry(std::string response, std::chrono::milliseconds ttl);
+};
+
+#endif // RESPONSECACHE_H
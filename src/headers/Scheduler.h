@@ -0,0 +1,75 @@
+// headers/Scheduler.h
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "ThreadPool.h"
+
+// Планирование запросов по срокам (FlaskCpp::setSchedulingOptions). Запрос стоит в очереди пула
+// со сроком "начало + цель маршрута" в виртуальном времени очереди, пул выполняет задачи в порядке сроков (EDF)
+struct SchedulingOptions {
+    // Цель для запроса, маршрут которого ещё не известен (новое соединение, keep-alive с данными):
+    // рабочий поток только читает запрос и определяет маршрут
+    std::chrono::milliseconds readTarget{5};
+    // Цель маршрута без явной (FlaskCpp::setLatencyTarget): costMultiplier × средняя стоимость обработки,
+    // в пределах [minTarget, maxTarget]. Маршрут, стоимость которого ещё не измерена, получает minTarget
+    double costMultiplier = 10;
+    std::chrono::milliseconds minTarget{5};
+    std::chrono::milliseconds maxTarget{500};
+    // Вес нового измерения в скользящем среднем стоимости (0..1]
+    double costSmoothing = 0.1;
+};
+
+struct RouteSchedule;
+
+// Цели задержки и изученная стоимость маршрутов; маршрут - идентификатор Metrics::registerRoute.
+// Запись и чтение без блокировок: одновременные измерения одного маршрута могут потерять одно из них,
+// на скользящее среднее это не влияет
+class RouteScheduler {
+public:
+    // Бросает std::invalid_argument для некорректных options
+    RouteScheduler(size_t routeCount, const SchedulingOptions& options = {});
+    ~RouteScheduler();
+
+    RouteScheduler(const RouteScheduler&) = delete;
+    RouteScheduler& operator=(const RouteScheduler&) = delete;
+
+    // Вызывать до запуска сервера; бросает std::invalid_argument для некорректных options
+    void setOptions(const SchedulingOptions& options);
+    const SchedulingOptions& settings() const { return options; }
+
+    // Явная цель маршрута; 0 - цель по изученной стоимости
+    void setTarget(size_t routeId, std::chrono::milliseconds target);
+
+    // Цель задержки маршрута: явная или по стоимости
+    std::chrono::steady_clock::duration target(size_t routeId) const;
+    // Место запроса маршрута в очереди; now - ThreadPool::virtualTime(). Запрос начинается не раньше, чем
+    // закончатся уже выданные запросы этого маршрута (по средней стоимости), и должен выполниться за цель.
+    // Поэтому накопившаяся очередь долгого маршрута не отодвигает запросы остальных (start-time fair queueing)
+    TaskSchedule schedule(size_t routeId, std::chrono::steady_clock::time_point now);
+    std::chrono::steady_clock::duration readTarget() const { return options.readTarget; }
+
+    // Время обработки запроса маршрутом (от начала разбора до отправки ответа)
+    void recordCost(size_t routeId, std::chrono::steady_clock::duration cost);
+    // Запрос завершился позже срока
+    void recordMiss(size_t routeId);
+
+    size_t routeCount() const { return count; }
+    // Средняя стоимость в наносекундах; 0 - измерений не было
+    uint64_t averageCost(size_t routeId) const;
+    uint64_t misses(size_t routeId) const;
+
+private:
+    SchedulingOptions options;
+    size_t count;
+    std::unique_ptr<RouteSchedule[]> routes;
+
+    RouteSchedule& at(size_t routeId) const;
+};
+
+#endif // SCHEDULER_H
@@ -0,0 +1,176 @@
+// headers/Session.h
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Данные сессии: строковые пары ключ-значение
+using SessionValues = std::map<std::string, std::string>;
+
+// Хранилище сессий. Реализации потокобезопасны; срок жизни записи задаётся при сохранении
+class SessionStore {
+public:
+    virtual ~SessionStore() = default;
+
+    // false - сессии нет или она истекла. remaining - сколько сессии осталось жить
+    virtual bool load(const std::string& id, SessionValues& values, std::chrono::seconds& remaining) = 0;
+    virtual void save(const std::string& id, const SessionValues& values, std::chrono::seconds ttl) = 0;
+    virtual void erase(const std::string& id) = 0;
+
+    // Число живых сессий (для метрик)
+    virtual size_t size() = 0;
+};
+
+// Сессии в памяти процесса: шарды с shared_mutex, чтение идёт под разделяемой блокировкой.
+// Истёкшие записи не возвращаются и вычищаются проходом по шарду раз в sweepInterval сохранений
+class MemorySessionStore : public SessionStore {
+public:
+    MemorySessionStore() : shards(new Shard[shardCount]) {}
+
+    bool load(const std::string& id, SessionValues& values, std::chrono::seconds& remaining) override;
+    void save(const std::string& id, const SessionValues& values, std::chrono::seconds ttl) override;
+    void erase(const std::string& id) override;
+    size_t size() override;
+
+private:
+    static constexpr size_t shardCount = 32;
+    static constexpr unsigned sweepInterval = 256;
+
+    struct Entry {
+        SessionValues values;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    struct alignas(64) Shard {
+        std::shared_mutex mutex;
+        std::unordered_map<std::string, Entry> entries;
+        unsigned writesSinceSweep = 0;
+    };
+
+    std::unique_ptr<Shard[]> shards;
+
+    Shard& shardFor(const std::string& id);
+};
+
+// Сессии в файле, отображённом в память (MAP_SHARED): переживают перезапуск процесса, в том числе
+// горячий, когда старый и новый процессы работают с файлом одновременно. Файл - таблица из capacity
+// ячеек фиксированного размера slotSize с открытой адресацией. Каждая ячейка защищена seqlock:
+// чтение не берёт блокировок (копирует ячейку и сверяет номер версии), запись захватывает ячейку
+// атомарной операцией над тем же номером, поэтому работает и между процессами
+class MmapSessionStore : public SessionStore {
+public:
+    // Бросает std::runtime_error, если файл не удалось открыть или отобразить
+    MmapSessionStore(const std::string& path, size_t capacity = 65536, size_t slotSize = 1024);
+    ~MmapSessionStore() override;
+
+    MmapSessionStore(const MmapSessionStore&) = delete;
+    MmapSessionStore& operator=(const MmapSessionStore&) = delete;
+
+    bool load(const std::string& id, SessionValues& values, std::chrono::seconds& remaining) override;
+    // Бросает std::length_error, если данные сессии не помещаются в ячейку
+    void save(const std::string& id, const SessionValues& values, std::chrono::seconds ttl) override;
+    void erase(const std::string& id) override;
+    size_t size() override;
+
+private:
+    struct FileHeader;
+    struct Slot;
+
+    // Окно проб: сессия ищется только в probeWindow ячейках подряд, при переполнении окна
+    // вытесняется сессия, истекающая раньше других
+    static constexpr size_t probeWindow = 16;
+
+    int fd;
+    char* mapping;
+    size_t mappingSize;
+    size_t capacity;
+    size_t slotSize;
+
+    Slot& slot(size_t index);
+    // Есть ли в ячейке сессия id; data (если задан) получает согласованную копию данных. Без блокировок
+    bool readSlot(Slot& slot, uint64_t keyHash, const std::string& id, std::string* data, int64_t& expires);
+    static void lockSlot(Slot& slot);
+    static void unlockSlot(Slot& slot);
+};
+
+// Настройки сессий: cookie с подписанным идентификатором и срок жизни без обращений
+struct SessionOptions {
+    std::string cookieName = "session";
+    std::chrono::seconds ttl = std::chrono::minutes(30);
+    std::string path = "/";
+    bool secure = false;
+    std::string sameSite = "Lax";
+};
+
+class SessionManager;
+
+// Сессия текущего запроса (RequestData::session). Данные загружаются из хранилища при первом
+// обращении; изменённая сессия сохраняется после хендлера, новой отправляется cookie
+class Session {
+public:
+    Session(SessionManager& manager, const std::string& cookieValue) : manager(manager), cookie(cookieValue) {}
+
+    std::string get(const std::string& key, const std::string& defaultValue = "");
+    bool contains(const std::string& key);
+    void set(const std::string& key, std::string value);
+    void erase(const std::string& key);
+
+    // Удаляет сессию из хранилища и cookie у клиента (выход из системы)
+    void destroy();
+    // Новый идентификатор с теми же данными: вызывать после входа, чтобы исключить фиксацию сессии
+    void regenerate();
+
+    // Идентификатор сессии; пустой, пока сессия не создана
+    const std::string& id();
+
+private:
+    friend class SessionManager;
+
+    SessionManager& manager;
+    std::string cookie;
+    std::string sessionId;
+    SessionValues values;
+    std::chrono::seconds remaining{0};
+    bool loaded = false;
+    bool exists = false;        // Сессия есть в хранилище под sessionId
+    bool modified = false;
+    bool expireCookie = false;  // Клиенту нужно удалить cookie старой сессии
+
+    void ensureLoaded();
+};
+
+// Подписанные идентификаторы сессий и сохранение сессии по итогам запроса.
+// Cookie: 128 случайных бит в hex, точка и HMAC-SHA256 идентификатора (первые 128 бит)
+class SessionManager {
+public:
+    SessionManager(std::string secret, SessionOptions options, std::shared_ptr<SessionStore> store);
+
+    // Сохраняет изменения и добавляет Set-Cookie в ответ хендлера
+    void commit(Session& session, std::string& response);
+
+    std::string newId();
+    std::string sign(const std::string& id) const;
+    // Проверяет подпись cookie; id - идентификатор из cookie
+    bool verify(std::string_view cookie, std::string& id) const;
+
+    const SessionOptions& settings() const { return options; }
+    SessionStore& backend() { return *store; }
+
+private:
+    std::string secret;
+    SessionOptions options;
+    std::shared_ptr<SessionStore> store;
+};
+
+// HMAC-SHA256 (RFC 2104); нужен для подписи идентификаторов сессий
+void hmacSha256(std::string_view key, std::string_view message, uint8_t digest[32]);
+
+#endif // SESSION_H
@@ -0,0 +1,65 @@
+// headers/SharedCache.h
+#ifndef SHAREDCACHE_H
+#define SHAREDCACHE_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+
+// Кэш строк в общей памяти (memfd, MAP_SHARED), общий для процессов prefork: значение, сохранённое
+// одним обработчиком, видят все остальные. Таблица из capacity ячеек фиксированного размера slotSize
+// с открытой адресацией, как MmapSessionStore: чтение без блокировок по seqlock, запись захватывает
+// ячейку номером процесса. Кэш не ждёт: занятая другим писателем ячейка - промах для чтения и
+// пропуск для записи. Значения, не помещающиеся в ячейку вместе с ключом, не сохраняются
+class SharedCache {
+public:
+    // Новый сегмент. Бросает std::invalid_argument для некорректных размеров и std::runtime_error,
+    // если память не выделена
+    SharedCache(size_t capacity, size_t slotSize);
+    // Сегмент, созданный другим процессом (дескриптор наследуется при запуске обработчика prefork);
+    // владение fd переходит объекту. Бросает std::runtime_error, если fd - не сегмент кэша
+    explicit SharedCache(int fd);
+    ~SharedCache();
+
+    SharedCache(const SharedCache&) = delete;
+    SharedCache& operator=(const SharedCache&) = delete;
+
+    // remaining (если задан) получает оставшееся время жизни значения
+    bool get(std::string_view key, std::string& value, std::chrono::milliseconds* remaining = nullptr);
+    // false - значение не поместилось в ячейку или все ячейки окна заняты писателями
+    bool put(std::string_view key, std::string_view value, std::chrono::milliseconds ttl);
+    void erase(std::string_view key);
+
+    // Освобождает ячейки, брошенные посреди записи процессом pid (вызывает главный процесс после его падения)
+    void recover(pid_t pid);
+
+    int descriptor() const { return fd; }
+    size_t slotCapacity() const { return capacity; }
+    size_t entryCount();
+    unsigned long long hitCount() const;
+    unsigned long long missCount() const;
+
+private:
+    struct SegmentHeader;
+    struct Slot;
+
+    // Ключ ищется только в probeWindow ячейках подряд; при переполнении окна вытесняется
+    // значение, истекающее раньше других
+    static constexpr size_t probeWindow = 8;
+
+    int fd;
+    char* mapping;
+    size_t mappingSize;
+    size_t capacity;
+    size_t slotSize;
+
+    void map();
+    SegmentHeader& header();
+    Slot& slot(size_t index);
+    bool lockSlot(Slot& slot);
+    static void unlockSlot(Slot& slot);
+};
+
+#endif // SHAREDCACHE_H
@@ -0,0 +1,33 @@
+// headers/StringUtils.h
+#ifndef STRINGUTILS_H
+#define STRINGUTILS_H
+
+#include <string_view>
+
+// Сравнение ASCII-строк без учёта регистра. Без std::tolower: имена заголовков и токены HTTP - ASCII,
+// а поиск по ним стоит на горячем пути
+inline char asciiLower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+inline bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (asciiLower(a[i]) != asciiLower(b[i])) return false;
+    }
+    return true;
+}
+
+inline bool startsWithIgnoreCase(std::string_view value, std::string_view prefix) {
+    return value.size() >= prefix.size() && equalsIgnoreCase(value.substr(0, prefix.size()), prefix);
+}
+
+inline bool containsIgnoreCase(std::string_view haystack, std::string_view needle) {
+    if (needle.size() > haystack.size()) return false;
+    for (size_t i = 0; i + needle.size() <= haystack.size(); ++i) {
+        if (equalsIgnoreCase(haystack.substr(i, needle.size()), needle)) return true;
+    }
+    return false;
+}
+
+#endif // STRINGUTILS_H
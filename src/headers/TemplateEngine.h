@@ -22,6 +22,9 @@ public:
     std::string render(const std::string& templateName, const Context& context) const;
 
 private:
+    // Микробенчмарки (bench/microbench.cpp) измеряют внутренние этапы рендера
+    friend class MicroBenchmarks;
+
     std::map<std::string, std::string> templates;
 
     std::string getTemplateContent(const std::string& name) const;
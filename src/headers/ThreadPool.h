@@ -10,16 +10,59 @@
 #include <future>
 #include <atomic>
 #include <chrono>
+#include <map>
+#include <cstdint>
 #include <iostream> // Для std::cout и std::endl
 
-// Структура для задач с приоритетом
+// Защита от перегрузки: лимиты допуска запросов (0 - без лимита). Запрос сверх лимита сразу получает
+// 503 с Retry-After, а не ждёт в очереди, пока клиент не отвалится по таймауту
+struct OverloadOptions {
+    size_t maxConnections = 0;      // Открытые соединения клиентов, включая ожидающие в очереди пула
+    size_t maxInFlightRequests = 0; // Запросы в очереди пула и в обработке
+    size_t maxQueueDepth = 0;       // Задачи в очереди пула потоков
+    // Резерв под приоритеты: {1, 64} - последние 64 места очереди и запросов в обработке доступны
+    // только задачам с приоритетом 1 (GET) и выше, поэтому поток POST/PUT не вытесняет GET. Соединение
+    // без прочитанного запроса допускается как GET; метод проверяется по резервам после чтения запроса
+    std::map<int, size_t> reserved;
+    // Сброс по задержке в очереди в духе CoDel: если за queueDelayInterval задержка ни разу не опускалась
+    // ниже queueDelayTarget, очередь считается перегруженной и запросы, ждавшие дольше target, получают 503.
+    // Без перегрузки сбрасываются только ждавшие дольше interval. target 0 отключает сброс
+    std::chrono::milliseconds queueDelayTarget{5};
+    std::chrono::milliseconds queueDelayInterval{100};
+    std::chrono::seconds retryAfter{1};
+
+    // Лимит для приоритета с учётом мест, зарезервированных за более высокими приоритетами
+    size_t limitFor(int priority, size_t limit) const {
+        for (const auto& [reservedPriority, slots] : reserved) {
+            if (reservedPriority >= priority) break;
+            limit = limit > slots ? limit - slots : 0;
+        }
+        return limit;
+    }
+};
+
+// Место задачи в очереди, в виртуальном времени очереди (ThreadPool::virtualTime). Задачи выполняются
+// в порядке deadline (earliest deadline first), с равным - в порядке постановки. start - виртуальное
+// время начала задачи: когда задача начинает выполняться, часы очереди доходят до него
+struct TaskSchedule {
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point deadline;
+};
+
+// Задача в очереди пула. Приоритет на порядок не влияет: по нему действуют резервы допуска
+// (OverloadOptions::reserved)
 struct PrioritizedTask {
-    int priority; // Чем меньше число, тем выше приоритет
+    int priority = 0; // Чем меньше число, тем выше приоритет
     std::function<void()> task;
-    
+    std::function<void()> shed; // Выполняется вместо task, если задача простояла в очереди слишком долго
+    std::chrono::steady_clock::time_point enqueued = std::chrono::steady_clock::now();
+    TaskSchedule schedule;
+    uint64_t sequence = 0; // Номер постановки, задаёт FIFO при равных сроках
+
     bool operator<(const PrioritizedTask& other) const {
         // Для priority_queue, которая по умолчанию максимальная, инвертируем сравнение
-        return priority > other.priority;
+        if (schedule.deadline != other.schedule.deadline) return schedule.deadline > other.schedule.deadline;
+        return sequence > other.sequence;
     }
 };
 
@@ -46,21 +89,59 @@ public:
             if(stop.load())
                 throw std::runtime_error("enqueue on stopped ThreadPool");
 
-            tasks.emplace(PrioritizedTask{priority, [task](){ (*task)(); }});
+            PrioritizedTask pt;
+            pt.priority = priority;
+            pt.task = [task](){ (*task)(); };
+            auto now = currentVirtualTime();
+            pt.schedule = TaskSchedule{now, now};
+            pt.sequence = nextSequence++;
+            tasks.push(std::move(pt));
         }
         condition.notify_one();
         return res;
     }
 
+    // Ставит задачу в очередь без packaged_task и future: для внутренних задач сервера,
+    // результат которых никому не нужен. Небольшие лямбды не требуют выделения памяти.
+    // Задача без schedule (или с TaskSchedule{}) начинается и должна выполниться в текущем виртуальном времени
+    void post(int priority, std::function<void()> task);
+    void post(int priority, const TaskSchedule& schedule, std::function<void()> task);
+
+    // Лимит очереди и сброс по задержке (OverloadOptions); вызывать до постановки задач
+    void setAdmission(const OverloadOptions& options);
+
+    // Ставит задачу, если очередь не заполнена для её приоритета; иначе возвращает false.
+    // shed выполняется вместо task, если задача простояла в очереди дольше допустимого (пустой - не сбрасывается)
+    bool tryPost(int priority, std::function<void()> task, std::function<void()> shed = nullptr);
+    bool tryPost(int priority, const TaskSchedule& schedule, std::function<void()> task,
+                 std::function<void()> shed = nullptr);
+
     // Останавливает пул потоков
     void shutdown();
 
+    // Состояние пула для метрик
+    size_t queueSize();
+    // Самый ранний срок задач в очереди; time_point::max(), если очередь пуста
+    std::chrono::steady_clock::time_point earliestDeadline();
+    // Виртуальное время очереди: start последней начатой задачи. Пока пул успевает, оно совпадает
+    // с steady_clock; при перегрузке отстаёт, поэтому накопленная очередь не становится "просроченной"
+    // и не обгоняет новые задачи с коротким сроком (start-time fair queueing)
+    std::chrono::steady_clock::time_point virtualTime();
+    size_t threadCount() const { return currentThreads.load(); }
+    size_t activeThreadCount() const { return activeThreads.load(); }
+    size_t maxThreadCount() const { return maxThreads; }
+    // Очередь перегружена по задержке (см. OverloadOptions::queueDelayTarget)
+    bool overloaded() const { return queueOverloaded.load(std::memory_order_relaxed); }
+
 private:
     // Рабочие потоки
     std::vector<std::thread> workers;
 
-    // Приоритетная очередь задач
+    // Очередь задач по срокам и виртуальное время (под queueMutex)
     std::priority_queue<PrioritizedTask> tasks;
+    uint64_t nextSequence = 0;
+    std::chrono::steady_clock::time_point virtualClock;
+    std::chrono::steady_clock::time_point currentVirtualTime();
 
     // Мьютекс для защиты очереди задач
     std::mutex queueMutex;
@@ -75,12 +156,22 @@ private:
     size_t minThreads;
     size_t maxThreads;
     std::atomic<size_t> currentThreads;
+    std::atomic<size_t> activeThreads; // Потоки, выполняющие задачу прямо сейчас
+
+    // Допуск задач (под queueMutex): лимит очереди и окно измерения задержки
+    OverloadOptions admission;
+    std::chrono::steady_clock::time_point delayWindowEnd;
+    std::chrono::steady_clock::duration delayWindowMin = std::chrono::steady_clock::duration::max();
+    std::atomic<bool> queueOverloaded{false};
+    bool queueDelayExceeded(std::chrono::steady_clock::time_point enqueued);
 
     // Флаг verbose
     bool verbose;
 
-    // Мониторинг нагрузки для динамического изменения размера пула
+    // Мониторинг нагрузки для динамического изменения размера пула; shutdown будит его, не дожидаясь интервала
     std::thread monitorThread;
+    std::mutex monitorMutex;
+    std::condition_variable monitorWake;
     void monitorLoad();
 
     // Добавление нового потока
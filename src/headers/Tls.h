@@ -0,0 +1,69 @@
+// headers/Tls.h
+#ifndef TLS_H
+#define TLS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <sys/types.h>
+
+#include "Connection.h"
+
+typedef struct ssl_ctx_st SSL_CTX;
+
+// Настройки TLS (OpenSSL): сертификат и ключ в PEM, возобновление сессий, kTLS
+struct TlsOptions {
+    std::string certificateFile;   // Цепочка сертификатов, начиная с сертификата сервера
+    std::string privateKeyFile;
+    // 80 байт ключей session tickets (имя, HMAC, AES). Общий файл позволяет возобновлять сессии
+    // после горячего перезапуска; без него ключи случайны и живут, пока жив процесс
+    std::string ticketKeyFile;
+    bool sessionTickets = true;
+    size_t sessionCacheSize = 20480;                       // Кэш сессий на сервере (TLS 1.2 без tickets)
+    std::chrono::seconds sessionTimeout = std::chrono::hours(2);
+    // Шифрование записей в ядре после рукопожатия: ответы со статикой уходят через sendfile
+    bool kernelTls = true;
+};
+
+// Контекст TLS сервера. Рукопожатие выполняется в рабочем потоке на блокирующем сокете
+// (таймаут задаёт SO_RCVTIMEO, как и для первого запроса), после него соединение живёт
+// как обычное: простаивает в Reactor, читается через read(), отвечает через write()
+class TlsContext {
+public:
+    // Бросает std::runtime_error, если сертификат или ключ не загружаются
+    explicit TlsContext(const TlsOptions& options);
+    ~TlsContext();
+
+    TlsContext(const TlsContext&) = delete;
+    TlsContext& operator=(const TlsContext&) = delete;
+
+    // Рукопожатие на conn.socket; при успехе conn.tls указывает на сессию
+    bool accept(Connection& conn);
+
+    // Аналоги recv/send для соединения с conn.tls
+    static ssize_t read(Connection& conn, char* data, size_t size);
+    static bool write(Connection& conn, const char* data, size_t size);
+    // Ядро шифрует отправляемые записи (kTLS): файлы можно передавать через sendFile
+    static bool kernelSend(const Connection& conn);
+    // Тело файла через sendfile (SSL_sendfile); только при kernelSend()
+    static bool sendFile(Connection& conn, int fd, size_t size);
+    // Расшифрованные, но ещё не прочитанные данные (конвейер внутри одной записи TLS)
+    static bool pending(const Connection& conn);
+    // Отправляет close_notify и освобождает сессию; сокет закрывает вызывающий
+    static void close(Connection& conn);
+
+    unsigned long long handshakes() const { return handshakeCount.load(std::memory_order_relaxed); }
+    unsigned long long resumedHandshakes() const { return resumedCount.load(std::memory_order_relaxed); }
+    unsigned long long failedHandshakes() const { return failedCount.load(std::memory_order_relaxed); }
+    unsigned long long kernelTlsConnections() const { return kernelTlsCount.load(std::memory_order_relaxed); }
+
+private:
+    SSL_CTX* context;
+    std::atomic<unsigned long long> handshakeCount;
+    std::atomic<unsigned long long> resumedCount;
+    std::atomic<unsigned long long> failedCount;
+    std::atomic<unsigned long long> kernelTlsCount;
+};
+
+#endif // TLS_H
@@ -0,0 +1,139 @@
+// headers/Tracing.h
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Формат файлов трасс
+enum class TraceFormat {
+    Chrome, // Trace Event Format: массив событий "ph":"X" (chrome://tracing, Perfetto, speedscope)
+    Otlp    // OTLP/JSON: одна ExportTraceServiceRequest на строку (otlpjsonfile в OpenTelemetry Collector)
+};
+
+// Когда решается, сохранять ли трассу запроса
+enum class TraceSampling {
+    Head, // В начале запроса: в выборку попадает доля sampleRate, остальные запросы спанов не пишут
+    Tail  // В конце: спаны пишутся для всех запросов, сохраняются медленные, ответы 5xx и доля sampleRate остальных
+};
+
+struct TracingOptions {
+    // Каталог файлов трасс: trace-<pid>-<время>.json (Chrome) или .jsonl (OTLP), у каждого процесса prefork свои
+    std::string directory = ".";
+    TraceFormat format = TraceFormat::Chrome;
+    TraceSampling sampling = TraceSampling::Head;
+    double sampleRate = 0.01;
+    // Tail: запросы не быстрее порога сохраняются всегда
+    std::chrono::milliseconds slowThreshold = std::chrono::milliseconds(100);
+    // Спанов в одной трассе; лишние (например, include в длинном цикле) не записываются
+    size_t maxSpansPerTrace = 128;
+    // Размер файла, после которого начинается новый; 0 - без ротации
+    size_t rotateBytes = 64 * 1024 * 1024;
+    std::chrono::milliseconds flushInterval = std::chrono::milliseconds(500);
+};
+
+struct TraceRing;
+struct TraceRecord;
+
+// Трассировка этапов запроса. Трасса живёт в рабочем потоке: beginRequest открывает корневой спан,
+// TraceSpan - вложенные, endRequest закрывает корень и копирует спаны в кольцевой буфер потока без
+// блокировок; фоновый поток переводит их в JSON и пишет в файл. Пока поток не записывает трассу,
+// TraceSpan стоит одного чтения thread_local переменной
+class Tracer {
+public:
+    // Спанов в кольцевом буфере одного потока
+    static constexpr size_t ringCapacity = 4096;
+
+    // Бросает std::invalid_argument для некорректных options
+    explicit Tracer(const TracingOptions& options);
+    ~Tracer();
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    // Создаёт каталог и первый файл, запускает поток записи. Бросает std::runtime_error, если файл не открыть
+    void start();
+    // Записывает накопленное и останавливает поток записи
+    void stop();
+
+    // Начинает трассу запроса в текущем потоке, если запрос попал в выборку. false - трасса не начата
+    // (запрос не в выборке или трасса потока уже открыта: её продолжают спаны вложенного запроса)
+    bool beginRequest();
+    // Закрывает трассу, начатую beginRequest этого потока; method, path и статус становятся атрибутами корня
+    void endRequest(std::string_view method, std::string_view path);
+    // Отбрасывает трассу (соединение закрылось, не прислав запроса)
+    void cancelRequest();
+
+    // Текущий поток записывает трассу
+    static bool recording();
+    // Код ответа для корневого спана текущей трассы
+    static void setStatus(int status);
+
+    static int openSpan(const char* name, std::string_view detail);
+    static void closeSpan(int index);
+
+    static bool parseFormat(const std::string& name, TraceFormat& format);
+    static bool parseSampling(const std::string& name, TraceSampling& sampling);
+
+    uint64_t tracesWritten() const { return written.load(std::memory_order_relaxed); }
+    // Трассы, не попавшие в файл: буфер потока переполнен или запись не удалась
+    uint64_t tracesDropped() const;
+
+private:
+    TracingOptions options;
+    uint64_t sampleThreshold; // sampleRate в долях 2^64
+    uint64_t id;              // Идентификатор экземпляра для привязки thread_local буферов
+
+    mutable std::mutex ringsMutex;
+    std::vector<std::shared_ptr<TraceRing>> rings;
+
+    std::thread writerThread;
+    std::atomic<bool> running;
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+
+    // Состояние потока записи
+    int fd;
+    size_t fileSize;
+    std::string batch;
+    uint64_t batchTraces;
+    std::atomic<uint64_t> droppedOnWrite;
+    std::atomic<uint64_t> written;
+
+    TraceRing& localRing();
+    void writerLoop();
+    void drain();
+    void formatChrome(const TraceRecord* spans, size_t count);
+    void formatOtlp(const TraceRecord* spans, size_t count);
+    void flush();
+    void openFile();
+    void closeFile();
+};
+
+// Спан этапа на время жизни объекта; вне записываемой трассы ничего не делает.
+// name должен жить до записи в файл (строковый литерал), detail копируется
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name, std::string_view detail = std::string_view())
+        : index(Tracer::recording() ? Tracer::openSpan(name, detail) : -1) {}
+    ~TraceSpan() {
+        if (index >= 0) Tracer::closeSpan(index);
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    int index;
+};
+
+#endif // TRACING_H
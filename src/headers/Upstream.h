@@ -0,0 +1,93 @@
+// headers/Upstream.h
+#ifndef UPSTREAM_H
+#define UPSTREAM_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Стратегия выбора upstream-сервера
+enum class BalancePolicy {
+    RoundRobin,
+    LeastConnections
+};
+
+struct UpstreamOptions {
+    BalancePolicy policy = BalancePolicy::RoundRobin;
+    // Путь для активной проверки здоровья (GET, ожидается 2xx/3xx). Пустой - проверяется только TCP-подключение
+    std::string healthPath;
+    std::chrono::milliseconds healthInterval = std::chrono::seconds(2);
+    std::chrono::milliseconds connectTimeout = std::chrono::seconds(2);
+    std::chrono::milliseconds readTimeout = std::chrono::seconds(30);
+    // Подряд неудачных подключений, после которых сервер исключается до успешной проверки
+    int maxFails = 3;
+    // Простаивающих keep-alive соединений на сервер
+    size_t maxIdlePerServer = 32;
+    // Убирать префикс маршрута из пути перед отправкой на upstream
+    bool stripPrefix = false;
+};
+
+// Результат проксирования одного запроса
+struct ProxyResult {
+    int status = 0;
+    uint64_t bytes = 0;        // Байт тела ответа, переданных клиенту
+    bool clientKeepAlive = false;
+};
+
+struct UpstreamServer;
+
+// Группа upstream-серверов с пулами keep-alive соединений, балансировкой и проверками здоровья.
+// Тела запроса и ответа передаются потоком, без полной буферизации
+class UpstreamPool {
+public:
+    UpstreamPool(const std::vector<std::string>& servers, const UpstreamOptions& options);
+    ~UpstreamPool();
+
+    UpstreamPool(const UpstreamPool&) = delete;
+    UpstreamPool& operator=(const UpstreamPool&) = delete;
+
+    void start();
+    void stop();
+
+    // Отправляет запрос на один из серверов и передаёт ответ клиенту.
+    // requestHead - стартовая строка и заголовки для upstream (с завершающим \r\n\r\n),
+    // bufferedBody - уже прочитанная часть тела, pendingBody - сколько байт тела ещё нужно дочитать из clientSocket.
+    // clientKeepAlive спрашивается, когда заголовки ответа готовы: пока upstream отвечал, сервер мог начать остановку.
+    // Возвращает false, если ни один сервер не ответил и клиенту ещё ничего не отправлено (нужен 502)
+    bool forward(int clientSocket, std::string_view requestHead, std::string_view bufferedBody, size_t pendingBody,
+                 bool headRequest, const std::function<bool()>& clientKeepAlive, ProxyResult& result);
+
+    const UpstreamOptions& getOptions() const { return options; }
+    size_t serverCount() const { return servers.size(); }
+    size_t healthyCount() const;
+
+    // Заголовки, относящиеся к одному соединению (RFC 7230, 6.1): не передаются между клиентом и upstream
+    static bool isHopByHopHeader(std::string_view name);
+
+private:
+    UpstreamOptions options;
+    std::vector<std::unique_ptr<UpstreamServer>> servers;
+    std::atomic<size_t> nextServer;
+
+    std::atomic<bool> running;
+    std::thread healthThread;
+    std::mutex healthMutex;
+    std::condition_variable healthCondition;
+
+    UpstreamServer* pickServer(const std::vector<UpstreamServer*>& exclude);
+    int acquire(UpstreamServer& server, bool& reused);
+    void release(UpstreamServer& server, int fd, bool reusable);
+    int connectServer(UpstreamServer& server);
+    bool checkHealth(UpstreamServer& server);
+    void healthLoop();
+};
+
+#endif // UPSTREAM_H
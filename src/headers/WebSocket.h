@@ -0,0 +1,186 @@
+// headers/WebSocket.h
+#ifndef WEBSOCKET_H
+#define WEBSOCKET_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "RequestData.h"
+
+class WebSocketHub;
+
+// Настройки WebSocket-соединений
+struct WebSocketOptions {
+    // Молчащему клиенту отправляется ping; если и после него за этот же интервал ничего не пришло - соединение закрывается
+    std::chrono::milliseconds pingInterval = std::chrono::seconds(30);
+    // Максимальный размер сообщения (с учётом фрагментов); больше - закрытие с кодом 1009
+    size_t maxMessageSize = 16 * 1024 * 1024;
+    // Неотправленные данные одного соединения; медленный клиент сверх лимита отключается
+    size_t maxQueuedBytes = 8 * 1024 * 1024;
+};
+
+// WebSocket-соединение (RFC 6455). Методы отправки можно вызывать из любого потока
+class WebSocket {
+public:
+    // Коды закрытия (RFC 6455, 7.4.1)
+    static constexpr uint16_t normalClosure = 1000;
+    static constexpr uint16_t goingAway = 1001;
+    static constexpr uint16_t protocolError = 1002;
+    static constexpr uint16_t invalidPayload = 1007;
+    static constexpr uint16_t messageTooBig = 1009;
+    static constexpr uint16_t internalError = 1011;
+    static constexpr uint16_t tryAgainLater = 1013; // Сервер перегружен: сообщение не принято к обработке
+    static constexpr uint16_t abnormalClosure = 1006; // Только для onClose: соединение оборвано без close-кадра
+
+    uint64_t id() const { return connectionId; }
+    const std::string& clientIP() const { return ip; }
+    // Запрос, на который было выполнено переключение протокола (путь, параметры, заголовки, cookies)
+    const RequestData& request() const { return upgradeRequest; }
+    bool isOpen() const { return !closing.load(); }
+
+    bool sendText(std::string_view text);
+    bool sendBinary(std::string_view data);
+    // Отправляет close-кадр; соединение закрывается после ответа клиента
+    void close(uint16_t code = normalClosure, std::string_view reason = {});
+
+    // Группы для рассылки (FlaskCpp::broadcast)
+    void join(const std::string& group);
+    void leave(const std::string& group);
+
+private:
+    friend class WebSocketHub;
+
+    WebSocket(WebSocketHub& hub, uint64_t id, int socket, std::string clientIP, RequestData request);
+
+    // Кадр или часть сообщения, пришедшая из сети, для обработчиков в рабочих потоках
+    struct Event {
+        enum Type { Open, Message, Close } type;
+        std::string data;
+        bool binary = false;
+        uint16_t code = 0;
+    };
+
+    WebSocketHub& hub;
+    uint64_t connectionId;
+    std::string ip;
+    RequestData upgradeRequest;
+
+    // Отправка: кадры общие для всех получателей рассылки, offset - отправленная часть первого кадра
+    std::mutex writeMutex;
+    int socket;
+    std::deque<std::shared_ptr<const std::string>> outbox;
+    size_t outboxOffset = 0;
+    size_t queuedBytes = 0;
+    bool writeArmed = false;
+
+    // Очередь событий для обработчиков; scheduled - задача разбора очереди уже поставлена в пул
+    std::mutex inboxMutex;
+    std::deque<Event> inbox;
+    bool scheduled = false;
+
+    // Состояние разбора кадров (только поток WebSocketHub)
+    std::string readBuffer;
+    std::string fragments;
+    uint8_t fragmentOpcode = 0;
+    std::chrono::steady_clock::time_point lastActivity;
+    std::chrono::steady_clock::time_point pingSentAt;
+    std::chrono::steady_clock::time_point closeSentAt; // Под writeMutex: close() вызывают и обработчики
+    bool pingOutstanding = false;
+
+    std::atomic<bool> closing{false};
+
+    // Группы, в которых состоит соединение (под WebSocketHub::membersMutex)
+    std::unordered_set<std::string> groupNames;
+
+    bool enqueue(std::shared_ptr<const std::string> frame);
+    bool flushLocked();
+};
+
+// Обработчики WebSocket-маршрута. Вызываются в рабочих потоках, для одного соединения - строго по очереди
+struct WebSocketHandler {
+    std::function<void(WebSocket&)> onOpen;
+    std::function<void(WebSocket&, std::string_view message, bool binary)> onMessage;
+    std::function<void(WebSocket&, uint16_t code)> onClose;
+};
+
+// Цикл событий WebSocket-соединений на epoll: один поток читает и разбирает кадры всех соединений,
+// поэтому простаивающие соединения не занимают рабочих потоков. Готовые сообщения передаются
+// обработчикам через dispatch (пул потоков сервера). При перегрузке dispatch вместо task выполняет shed -
+// сразу или в рабочем потоке, если задача слишком долго ждала в очереди; соединение закрывается с кодом 1013.
+// Событие Open передаётся без shed: его допуск - допуск запроса на переключение протокола
+class WebSocketHub {
+public:
+    using Dispatch = std::function<void(std::function<void()> task, std::function<void()> shed)>;
+
+    WebSocketHub(Dispatch dispatch, const WebSocketOptions& options = {});
+    ~WebSocketHub();
+
+    WebSocketHub(const WebSocketHub&) = delete;
+    WebSocketHub& operator=(const WebSocketHub&) = delete;
+
+    void start();
+    // Закрывает все соединения с кодом 1001 и останавливает поток
+    void stop();
+
+    // Принимает сокет после ответа 101. buffered - байты, пришедшие вслед за запросом на переключение
+    bool adopt(int socket, const std::string& clientIP, const RequestData& request,
+               std::shared_ptr<const WebSocketHandler> handler, std::string_view buffered);
+
+    // Рассылает сообщение всем участникам группы; кадр кодируется один раз. Возвращает число получателей
+    size_t broadcast(const std::string& group, std::string_view message, bool binary = false);
+
+    size_t connectionCount();
+
+    // Значение Sec-WebSocket-Accept для ключа клиента: base64(SHA-1(key + GUID))
+    static std::string acceptKey(std::string_view clientKey);
+
+    // Снимает маску клиента (XOR с 4-байтовым ключом); широкими словами, без побайтового цикла
+    static void unmask(char* data, size_t size, const uint8_t key[4]);
+
+private:
+    friend class WebSocket;
+
+    struct Member {
+        std::shared_ptr<WebSocket> socket;
+        std::shared_ptr<const WebSocketHandler> handler;
+    };
+
+    Dispatch dispatch;
+    WebSocketOptions options;
+
+    int epollFd;
+    std::atomic<bool> running;
+    std::thread loopThread;
+    std::atomic<uint64_t> nextId;
+
+    std::mutex membersMutex;
+    std::unordered_map<uint64_t, Member> members;
+    std::unordered_map<std::string, std::unordered_set<uint64_t>> groups;
+
+    void loop();
+    void readFrom(const Member& member);
+    bool parseFrames(const Member& member);
+    void checkTimeouts();
+    void terminate(uint64_t id, uint16_t code);
+    void post(const Member& member, WebSocket::Event event);
+    void drain(std::shared_ptr<WebSocket> socket, std::shared_ptr<const WebSocketHandler> handler);
+    void reject(WebSocket& socket);
+    void armWrite(WebSocket& socket, bool enable);
+    void closeWith(WebSocket& socket, uint16_t code, std::string_view reason);
+    void joinGroup(uint64_t id, const std::string& group);
+    void leaveGroup(uint64_t id, const std::string& group);
+
+    static std::shared_ptr<const std::string> encodeFrame(uint8_t opcode, std::string_view payload);
+};
+
+#endif // WEBSOCKET_H
@@ -4,10 +4,38 @@ import subprocess
 import time
 import os
 import signal
+import socket
+import struct
+
+
+def io_uring_supported():
+    """
+    Ядро принимает io_uring_setup: иначе сервер с '--io-uring' работает на epoll и проверять нечего.
+    """
+    import ctypes, platform
+    if platform.system() != "Linux":
+        return False
+    libc = ctypes.CDLL(None, use_errno=True)
+    params = ctypes.create_string_buffer(120)  # struct io_uring_params
+    fd = libc.syscall(425, 4, params)  # __NR_io_uring_setup одинаков для всех архитектур
+    if fd < 0:
+        return False
+    os.close(fd)
+    return True
+
+
+def http2_frame(frame_type, flags, stream_id, payload):
+    """
+    Кадр HTTP/2: длина (24 бита), тип, флаги, идентификатор потока и содержимое.
+    """
+    return struct.pack(">I", len(payload))[1:] + bytes([frame_type, flags]) + struct.pack(">I", stream_id) + payload
 
 class TestFlaskCppServer(unittest.TestCase):
     SERVER_URL = "http://localhost:8080"
     SERVER_PROCESS = None
+    UPSTREAM_PROCESS = None
+    # Дополнительные флаги общего сервера и отдельных серверов тестов
+    SERVER_ARGS = []
 
     @classmethod
     def setUpClass(cls):
@@ -21,9 +49,17 @@ class TestFlaskCppServer(unittest.TestCase):
         if not os.path.isfile(server_executable):
             raise FileNotFoundError(f"Исполняемый файл сервера не найден по пути: {server_executable}")
 
+        # Upstream для проверки проксирования /up
+        cls.UPSTREAM_PROCESS = subprocess.Popen(
+            ["python3", "upstream_stub.py", "9011"],
+            stdout=subprocess.DEVNULL,
+            stderr=subprocess.DEVNULL
+        )
+
         # Запуск сервера как subprocess
         cls.SERVER_PROCESS = subprocess.Popen(
-            [server_executable, "--port", "8080", "--verbose"],
+            [server_executable, "--port", "8080", "--verbose", "--compress", "--http2",
+             "--session-secret", "test-session-secret-0123456789", "--proxy", "/up=127.0.0.1:9011", *cls.SERVER_ARGS],
             stdout=subprocess.PIPE,
             stderr=subprocess.PIPE,
             text=True
@@ -63,6 +99,447 @@ class TestFlaskCppServer(unittest.TestCase):
             except subprocess.TimeoutExpired:
                 cls.SERVER_PROCESS.kill()
             cls.SERVER_PROCESS = None
+        if cls.UPSTREAM_PROCESS:
+            cls.UPSTREAM_PROCESS.kill()
+            cls.UPSTREAM_PROCESS.wait()
+            cls.UPSTREAM_PROCESS = None
+
+    def start_server(self, port, *args):
+        """
+        Запускает отдельный сервер с дополнительными флагами; он останавливается по завершении теста.
+        """
+        self.spawn_server(port, *args)
+        return self.wait_for_port(port)
+
+    def spawn_server(self, port, *args, executable=os.path.join("bin", "server")):
+        """
+        Запускает процесс сервера, не дожидаясь порта; возвращает Popen для тестов, управляющих процессом.
+        """
+        process = subprocess.Popen(
+            [executable, "--port", str(port), "--no-hot-reload", *self.SERVER_ARGS, *args],
+            stdout=subprocess.DEVNULL,
+            stderr=subprocess.DEVNULL
+        )
+        self.addCleanup(process.wait)
+        self.addCleanup(process.terminate)
+        return process
+
+    def wait_for_port(self, port):
+        """
+        Ждёт, пока сервер начнёт принимать соединения на порту.
+        """
+        start_time = time.time()
+        while True:
+            try:
+                socket.create_connection(("localhost", port), timeout=1).close()
+                return f"http://localhost:{port}"
+            except OSError:
+                if time.time() - start_time > 10:
+                    raise TimeoutError("Сервер не запустился в течение заданного времени.")
+                time.sleep(0.2)
+
+    def test_overload_shedding(self):
+        """
+        Тестируем защиту от перегрузки: все места запросов зарезервированы за GET, поэтому POST
+        сразу получает 503 с Retry-After, а GET обслуживается.
+        """
+        url = self.start_server(8091, "--max-inflight", "1", "--reserve-get", "1")
+        response = requests.post(f"{url}/submit", data={"username": "Test"})
+        self.assertEqual(response.status_code, 503)
+        self.assertEqual(response.headers.get("Retry-After"), "1")
+        self.assertEqual(requests.get(f"{url}/api/data").status_code, 200)
+
+    def test_websocket_overload(self):
+        """
+        Тестируем допуск сообщений WebSocket: пока единственное место запроса занято медленным
+        запросом к upstream, сообщение не принимается и соединение закрывается с кодом 1013.
+        """
+        import base64, threading
+        url = self.start_server(8093, "--max-inflight", "1", "--proxy", "/up=127.0.0.1:9011")
+        # Пробное соединение start_server занимает единственное место, пока рабочий поток не увидит его закрытие
+        time.sleep(0.3)
+        with socket.create_connection(("localhost", 8093), timeout=5) as sock:
+            key = base64.b64encode(os.urandom(16)).decode()
+            sock.sendall(("GET /ws HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                          "Sec-WebSocket-Key: " + key + "\r\nSec-WebSocket-Version: 13\r\n\r\n").encode())
+            data = b""
+            while b"\r\n\r\n" not in data:
+                data += sock.recv(4096)
+            self.assertTrue(data.startswith(b"HTTP/1.1 101"), data)
+            time.sleep(0.3)
+
+            slow = threading.Thread(target=requests.get, args=(f"{url}/up/slow?ms=1500",))
+            slow.start()
+            time.sleep(0.5)
+            mask = os.urandom(4)
+            sock.sendall(bytes([0x81, 0x82]) + mask + bytes(b ^ mask[i] for i, b in enumerate(b"hi")))
+            frames = b""
+            while len(frames) < 4:
+                frames += sock.recv(4096)
+            # Ответный close-кадр завершает закрытие
+            sock.sendall(bytes([0x88, 0x82]) + mask + bytes(b ^ mask[i] for i, b in enumerate(frames[2:4])))
+            while sock.recv(4096):
+                pass
+            slow.join()
+        # Единственный кадр от сервера - close с кодом 1013 (Try Again Later)
+        self.assertEqual(frames[0], 0x88, frames)
+        self.assertEqual(int.from_bytes(frames[2:4], "big"), 1013)
+
+    def test_access_log(self):
+        """
+        Тестируем журнал доступа: строка в формате CLF, кавычки и управляющие байты стартовой строки
+        экранируются, %0A остаётся как есть; при превышении '--access-log-max-size' файл ротируется.
+        """
+        import glob, re, shutil, tempfile
+        log_dir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, log_dir)
+        path = os.path.join(log_dir, "access.log")
+        self.start_server(8095, "--access-log", path, "--access-log-format", "common", "--access-log-max-size", "300")
+        for _ in range(4):
+            with socket.create_connection(("localhost", 8095), timeout=5) as sock:
+                sock.sendall(b'GET /api/data?q="x"%0A\x1b HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n')
+                while sock.recv(65536):
+                    pass
+            # Каждый запрос - отдельная пачка фонового потока записи
+            time.sleep(0.3)
+
+        rotated = glob.glob(path + ".*")
+        self.assertTrue(rotated)
+        lines = []
+        for name in [path] + rotated:
+            with open(name, "rb") as log:
+                lines += log.read().splitlines()
+        self.assertEqual(len(lines), 4)
+        for line in lines:
+            self.assertRegex(line, re.compile(
+                rb'^127\.0\.0\.1 - - \[\d{2}/\w{3}/\d{4}:\d{2}:\d{2}:\d{2} [+-]\d{4}\] '
+                rb'"GET /api/data\?q=\\"x\\"%0A\\x1b HTTP/1\.1" 200 44$'))
+
+    def test_profiler(self):
+        """
+        Тестируем '/debug/profile': без токена - 401, seconds=0 - 400, профиль за секунду под нагрузкой -
+        непустые свёрнутые стеки "кадр;кадр N".
+        """
+        import re, threading
+        token = "profile-token-0123456789"
+        url = self.start_server(8096, "--profile-token", token)
+        auth = {"Authorization": f"Bearer {token}"}
+
+        response = requests.get(f"{url}/debug/profile?seconds=1")
+        self.assertEqual(response.status_code, 401)
+        self.assertEqual(response.headers.get("WWW-Authenticate"), "Bearer")
+        self.assertEqual(requests.get(f"{url}/debug/profile?seconds=1", headers={"Authorization": "Bearer wrong"}).status_code, 401)
+        self.assertEqual(requests.get(f"{url}/debug/profile?seconds=0", headers=auth).status_code, 400)
+
+        stop = threading.Event()
+        def load():
+            with requests.Session() as session:
+                while not stop.is_set():
+                    session.get(f"{url}/metrics")
+        workers = [threading.Thread(target=load) for _ in range(4)]
+        for worker in workers:
+            worker.start()
+        try:
+            response = requests.get(f"{url}/debug/profile?seconds=1", headers=auth)
+        finally:
+            stop.set()
+            for worker in workers:
+                worker.join()
+        self.assertEqual(response.status_code, 200)
+        self.assertEqual(response.headers.get("Content-Type"), "text/plain; charset=utf-8")
+        lines = response.text.splitlines()
+        self.assertTrue(lines)
+        for line in lines:
+            self.assertRegex(line, re.compile(r"^[^;\n]+(;[^;\n]+)+ \d+$"))
+
+    def test_tls(self):
+        """
+        Тестируем HTTPS: ответ обработчика и статический файл (путь sendfile, через kTLS, если ядро его
+        поддерживает) приходят по одному соединению байт в байт.
+        """
+        import http.client, json, shutil, ssl, tempfile
+        openssl = shutil.which("openssl")
+        if openssl is None:
+            self.skipTest("нет openssl для самоподписанного сертификата")
+        directory = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, directory, True)
+        cert, key = os.path.join(directory, "cert.pem"), os.path.join(directory, "key.pem")
+        subprocess.run([openssl, "req", "-x509", "-newkey", "rsa:2048", "-nodes", "-days", "1",
+                        "-subj", "/CN=localhost", "-keyout", key, "-out", cert],
+                       check=True, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+
+        if not os.path.isdir("static"):
+            os.mkdir("static")
+            self.addCleanup(shutil.rmtree, "static", True)
+        name = f"tls-test-{os.getpid()}.bin"
+        content = os.urandom(1024 * 1024 + 17)
+        with open(os.path.join("static", name), "wb") as f:
+            f.write(content)
+        self.addCleanup(os.remove, os.path.join("static", name))
+
+        self.start_server(8098, "--tls-cert", cert, "--tls-key", key)
+        context = ssl.create_default_context()
+        context.check_hostname = False
+        context.verify_mode = ssl.CERT_NONE
+        connection = http.client.HTTPSConnection("localhost", 8098, context=context, timeout=10)
+        self.addCleanup(connection.close)
+        for path in ("/api/data", f"/static/{name}", "/api/data"):
+            connection.request("GET", path)
+            response = connection.getresponse()
+            body = response.read()
+            self.assertEqual(response.status, 200)
+            if path.startswith("/static/"):
+                self.assertEqual(int(response.getheader("Content-Length")), len(content))
+                self.assertEqual(body, content)
+            else:
+                self.assertEqual(json.loads(body), {"status": "ok", "message": "Hello from JSON!"})
+
+        connection.request("GET", "/metrics")
+        metrics = connection.getresponse().read().decode()
+        self.assertRegex(metrics, r"flaskcpp_tls_handshakes_total 1\b")
+
+    def test_tracing(self):
+        """
+        Тестируем трассировку: при выборке head с долей 1 запрос '/form' попадает в файл Chrome trace
+        со спанами чтения, разбора, поиска маршрута, обработчика, шаблона и отправки.
+        """
+        import json, shutil, tempfile
+        directory = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, directory, True)
+        process = self.spawn_server(8097, "--trace-dir", directory, "--trace-format", "chrome",
+                                    "--trace-sampling", "head", "--trace-rate", "1")
+        url = self.wait_for_port(8097)
+        self.assertEqual(requests.get(f"{url}/form").status_code, 200)
+        process.terminate()
+        self.assertEqual(process.wait(timeout=15), 0)
+
+        files = [name for name in os.listdir(directory) if name.endswith(".json")]
+        self.assertEqual(len(files), 1)
+        with open(os.path.join(directory, files[0]), encoding="utf-8") as f:
+            events = json.load(f)
+        spans = [event for event in events if event.get("ph") == "X"]
+        roots = [span for span in spans if span["args"].get("path") == "/form"]
+        self.assertEqual(len(roots), 1)
+        root = roots[0]
+        self.assertEqual(root["args"]["method"], "GET")
+        self.assertEqual(root["args"]["status"], 200)
+        trace = [span for span in spans if span["args"]["trace_id"] == root["args"]["trace_id"]]
+        names = {span["name"] for span in trace}
+        stages = ["parseRequest", "findHandler", "handler", "render", "sendResponse"]
+        if "--io-uring" not in self.SERVER_ARGS:
+            # Цикл io_uring читает запрос сам, трасса начинается в рабочем потоке уже с разбора
+            stages.insert(0, "readRequest")
+        for name in stages:
+            self.assertIn(name, names)
+        for span in trace:
+            self.assertGreaterEqual(span["ts"], root["ts"])
+            self.assertLessEqual(span["ts"] + span["dur"], root["ts"] + root["dur"] + 1)
+
+    def test_prefork(self):
+        """
+        Тестируем '--prefork 2': обработчик, убитый SIGKILL, заменяется новым, запросы продолжают
+        проходить, а /metrics любого обработчика суммирует счётчики всех, включая убитый.
+        """
+        import re
+
+        def workers(master):
+            result = subprocess.run(["pgrep", "-P", str(master.pid)], stdout=subprocess.PIPE, text=True)
+            return sorted(int(pid) for pid in result.stdout.split())
+
+        def api_requests():
+            text = requests.get(f"{url}/metrics", headers={"Connection": "close"}).text
+            match = re.search(r'^flaskcpp_http_requests_total\{route="/api/data",code="2xx"\} (\d+)$', text, re.M)
+            return int(match.group(1)) if match else 0
+
+        master = self.spawn_server(8099, "--prefork", "2")
+        url = self.wait_for_port(8099)
+        deadline = time.time() + 10
+        while len(workers(master)) < 2 and time.time() < deadline:
+            time.sleep(0.1)
+        before = workers(master)
+        self.assertEqual(len(before), 2)
+
+        for _ in range(20):
+            self.assertEqual(requests.get(f"{url}/api/data", headers={"Connection": "close"}).status_code, 200)
+        os.kill(before[0], signal.SIGKILL)
+        deadline = time.time() + 10
+        while time.time() < deadline:
+            after = workers(master)
+            if len(after) == 2 and before[0] not in after:
+                break
+            time.sleep(0.1)
+        self.assertEqual(len(after), 2)
+        self.assertNotIn(before[0], after)
+        self.assertIn(before[1], after)
+        self.assertIsNone(master.poll())
+
+        for _ in range(20):
+            self.assertEqual(requests.get(f"{url}/api/data", headers={"Connection": "close"}).status_code, 200)
+        # Новое соединение может принять любой обработчик: каждый видит сумму по всем шардам
+        self.assertEqual({api_requests() for _ in range(10)}, {40})
+        metrics = requests.get(f"{url}/metrics").text
+        self.assertRegex(metrics, r"(?m)^flaskcpp_prefork_workers 2$")
+        self.assertRegex(metrics, r"(?m)^flaskcpp_prefork_worker_restarts_total 1$")
+
+    def test_graceful_drain(self):
+        """
+        Тестируем остановку по SIGTERM: новые соединения сразу отклоняются, а запрос, уже принятый
+        в обработку (медленный ответ upstream), получает полный ответ с Connection: close.
+        """
+        import threading
+        process = self.spawn_server(8100, "--proxy", "/up=127.0.0.1:9011", "--drain-timeout", "10")
+        self.wait_for_port(8100)
+        result = {}
+
+        def slow_request():
+            with socket.create_connection(("localhost", 8100), timeout=10) as sock:
+                sock.sendall(b"GET /up/slow?ms=3000 HTTP/1.1\r\nHost: localhost\r\n\r\n")
+                data = b""
+                while True:
+                    chunk = sock.recv(4096)
+                    if not chunk:
+                        break
+                    data += chunk
+                result["response"] = data
+
+        worker = threading.Thread(target=slow_request)
+        worker.start()
+        time.sleep(0.5)
+        process.send_signal(signal.SIGTERM)
+
+        refused = False
+        deadline = time.time() + 2
+        while time.time() < deadline:
+            try:
+                socket.create_connection(("localhost", 8100), timeout=1).close()
+                time.sleep(0.05)
+            except ConnectionRefusedError:
+                refused = True
+                break
+        self.assertTrue(refused)
+        # Порт закрыт раньше, чем upstream ответил: запрос ещё обслуживается
+        self.assertTrue(worker.is_alive())
+
+        worker.join(15)
+        self.assertEqual(process.wait(timeout=15), 0)
+        head, _, body = result.get("response", b"").partition(b"\r\n\r\n")
+        self.assertTrue(head.startswith(b"HTTP/1.1 200"))
+        self.assertIn(b"connection: close", head.lower())
+        self.assertEqual(body, b"slow\n")
+
+    def test_hot_restart(self):
+        """
+        Тестируем горячий перезапуск '--hot-restart': второй процесс забирает слушающий сокет через
+        управляющий Unix-сокет, первый дообслуживает принятое и завершается; ни одно соединение
+        под непрерывной нагрузкой не отклоняется.
+        """
+        import shutil, tempfile, threading
+        directory = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, directory, True)
+        control = os.path.join(directory, "handoff.sock")
+        old = self.spawn_server(8101, "--hot-restart", control, "--drain-timeout", "5")
+        self.wait_for_port(8101)
+
+        stop = threading.Event()
+        statuses = []
+        errors = []
+
+        def load():
+            while not stop.is_set():
+                try:
+                    response = requests.get("http://localhost:8101/api/data", headers={"Connection": "close"}, timeout=5)
+                    statuses.append(response.status_code)
+                except requests.RequestException as e:
+                    errors.append(e)
+
+        workers = [threading.Thread(target=load) for _ in range(4)]
+        for worker in workers:
+            worker.start()
+        try:
+            time.sleep(0.5)
+            new = self.spawn_server(8101, "--hot-restart", control, "--drain-timeout", "5")
+            self.assertEqual(old.wait(timeout=15), 0)
+            served_by_old = len(statuses)
+            time.sleep(0.5)
+        finally:
+            stop.set()
+            for worker in workers:
+                worker.join()
+        self.assertEqual(errors, [])
+        self.assertEqual(set(statuses), {200})
+        self.assertGreater(len(statuses), served_by_old)
+        self.assertIsNone(new.poll())
+
+    def test_php_fastcgi(self):
+        """
+        Тестируем сборку ENABLE_PHP=1 и '--php-fastcgi' с fastcgi_stub.py: запрос к .php доходит до
+        FastCGI-сервера с CGI-окружением, Status и заголовки ответа передаются клиенту, а следующие
+        запросы идут по тому же соединению пула.
+        """
+        import shutil, tempfile
+        if shutil.which("make") is None or shutil.which("g++") is None:
+            self.skipTest("make или g++ не найдены")
+        directory = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, directory, True)
+        build = subprocess.run(["make", "-s", f"-j{os.cpu_count() or 1}", "ENABLE_PHP=1",
+                                f"BIN_DIR={directory}/bin", f"LIB_DIR={directory}/lib", f"{directory}/bin/server"],
+                               stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True)
+        self.assertEqual(build.returncode, 0, build.stderr)
+
+        fastcgi = os.path.join(directory, "php.sock")
+        stub = subprocess.Popen(["python3", "fastcgi_stub.py", fastcgi], stdout=subprocess.DEVNULL)
+        self.addCleanup(stub.wait)
+        self.addCleanup(stub.terminate)
+        deadline = time.time() + 10
+        while not os.path.exists(fastcgi) and time.time() < deadline:
+            time.sleep(0.1)
+
+        if not os.path.isdir("static"):
+            os.mkdir("static")
+            self.addCleanup(shutil.rmtree, "static", True)
+        name = f"fastcgi-test-{os.getpid()}.php"
+        with open(os.path.join("static", name), "w") as f:
+            f.write("<?php echo 'not executed by the stub';\n")
+        self.addCleanup(os.remove, os.path.join("static", name))
+
+        self.spawn_server(8102, "--php-fastcgi", fastcgi, executable=os.path.join(directory, "bin", "server"))
+        url = self.wait_for_port(8102)
+
+        def fields(response):
+            return dict(line.split("=", 1) for line in response.text.splitlines())
+
+        response = requests.post(f"{url}/static/{name}?a=1&b=2", data="x=y",
+                                 headers={"Content-Type": "application/x-www-form-urlencoded", "X-Stub-Status": "201 Created"})
+        self.assertEqual(response.status_code, 201)
+        self.assertEqual(response.headers.get("X-Stub"), "1")
+        self.assertTrue(response.headers["Content-Type"].startswith("text/plain"))
+        self.assertEqual(int(response.headers["Content-Length"]), len(response.content))
+        first = fields(response)
+        self.assertEqual(first["REQUEST_METHOD"], "POST")
+        self.assertEqual(first["SCRIPT_FILENAME"], os.path.join(os.getcwd(), "static", name))
+        self.assertEqual(first["QUERY_STRING"], "a=1&b=2")
+        self.assertEqual(first["CONTENT_TYPE"], "application/x-www-form-urlencoded")
+        self.assertEqual(first["CONTENT_LENGTH"], "3")
+        self.assertEqual(first["body"], "x=y")
+
+        for _ in range(3):
+            response = requests.get(f"{url}/static/{name}")
+            self.assertEqual(response.status_code, 200)
+            self.assertEqual(fields(response)["REQUEST_METHOD"], "GET")
+            # Запросы идут по одному: пул отдаёт то же соединение FastCGI
+            self.assertEqual(fields(response)["connection"], first["connection"])
+
+    def test_rate_limit(self):
+        """
+        Тестируем лимит частоты клиента '--rate-limit 5:5': всплеск из пяти запросов проходит,
+        следующий получает 429 с Retry-After.
+        """
+        url = self.start_server(8092, "--rate-limit", "5:5")
+        statuses = [requests.get(f"{url}/api/data").status_code for _ in range(5)]
+        self.assertEqual(statuses, [200] * 5)
+        response = requests.get(f"{url}/api/data")
+        self.assertEqual(response.status_code, 429)
+        self.assertTrue(response.headers.get("Retry-After", "").isdigit())
 
     def test_root_path(self):
         """
@@ -89,6 +566,26 @@ class TestFlaskCppServer(unittest.TestCase):
         self.assertEqual(response.status_code, 200)
         self.assertIn("Привет, TestUser!", response.text)
 
+    def test_lowercase_headers(self):
+        """
+        Тестируем, что имена заголовков не зависят от регистра: форма и cookie в нижнем регистре.
+        """
+        body = b"username=%D0%98%D0%B2%D0%B0%D0%BD"
+        with socket.create_connection(("localhost", 8080), timeout=5) as sock:
+            sock.sendall(b"POST /submit HTTP/1.1\r\nhost: localhost\r\n"
+                         b"content-type: application/x-www-form-urlencoded\r\n"
+                         b"content-length: " + str(len(body)).encode() + b"\r\n\r\n" + body +
+                         b"GET /get_cookie HTTP/1.1\r\nhost: localhost\r\ncookie: User=Lower%20Case\r\n"
+                         b"connection: close\r\n\r\n")
+            data = b""
+            while True:
+                chunk = sock.recv(65536)
+                if not chunk:
+                    break
+                data += chunk
+        self.assertIn("Привет, Иван!".encode(), data)
+        self.assertIn(b"Cookie 'User' = Lower Case", data)
+
     def test_user_route(self):
         """
         Тестируем маршрут с параметром '/user/<id>'.
@@ -107,6 +604,21 @@ class TestFlaskCppServer(unittest.TestCase):
         self.assertTrue(response.headers["Content-Type"].startswith("application/json"))
         self.assertEqual(response.json(), {"status": "ok", "message": "Hello from JSON!"})
 
+    def test_json_order(self):
+        """
+        Тестируем разбор JSON-тела и JSON-ответ '/api/order'.
+        """
+        order = {"items": [{"name": "Чай \"Улун\"", "price": 2.5, "quantity": 2}, {"name": "Кружка", "price": 7}]}
+        response = requests.post(f"{self.SERVER_URL}/api/order", json=order)
+        self.assertEqual(response.status_code, 200)
+        self.assertTrue(response.headers["Content-Type"].startswith("application/json"))
+        self.assertEqual(response.json(), {"items": 3, "total": 12})
+
+        response = requests.post(f"{self.SERVER_URL}/api/order", data='{"items": [1,',
+                                 headers={"Content-Type": "application/json"})
+        self.assertEqual(response.status_code, 400)
+        self.assertIn("error", response.json())
+
     def test_error_route(self):
         """
         Тестируем маршрут, генерирующий ошибку '/error'.
@@ -161,6 +673,21 @@ class TestFlaskCppServer(unittest.TestCase):
             self.assertEqual(response.status_code, 200)
             self.assertIn("Cookie 'User' не найден.", response.text)
 
+    def test_session(self):
+        """
+        Тестируем сессии: счётчик в '/visits' растёт в пределах сессии, поддельная cookie игнорируется.
+        """
+        with requests.Session() as session:
+            self.assertEqual(session.get(f"{self.SERVER_URL}/visits").json()["visits"], 1)
+            self.assertEqual(session.get(f"{self.SERVER_URL}/visits").json()["visits"], 2)
+            cookie = session.cookies.get("session")
+            session.get(f"{self.SERVER_URL}/visits", params={"logout": "1"})
+            self.assertEqual(session.get(f"{self.SERVER_URL}/visits").json()["visits"], 1)
+
+        forged = cookie[:-1] + ("0" if cookie[-1] != "0" else "1")
+        response = requests.get(f"{self.SERVER_URL}/visits", cookies={"session": forged})
+        self.assertEqual(response.json()["visits"], 1)
+
     def test_template_inheritance(self):
         """
         Тестируем страницу с наследованием шаблона '/extend'.
@@ -181,6 +708,292 @@ class TestFlaskCppServer(unittest.TestCase):
         else:
             self.assertEqual(response.status_code, 404)  # Файл может отсутствовать
 
+    def test_keep_alive(self):
+        """
+        Тестируем keep-alive: несколько запросов, включая конвейер, в одном TCP-соединении.
+        """
+        with socket.create_connection(("localhost", 8080), timeout=5) as sock:
+            sock.sendall(b"GET /api/data HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                         b"GET /user/1 HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                         b"GET /api/data HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n")
+            data = b""
+            while True:
+                chunk = sock.recv(65536)
+                if not chunk:
+                    break
+                data += chunk
+        self.assertEqual(data.count(b"HTTP/1.1 200 OK"), 3)
+        self.assertIn(b"Connection: keep-alive", data)
+        self.assertTrue(data.rstrip().endswith(b'{"status":"ok","message":"Hello from JSON!"}'))
+
+    def test_content_length_limits(self):
+        """
+        Тестируем Content-Length: переполнение и нечисловое значение - 400, тело сверх лимита - 413.
+        """
+        cases = [(b"99999999999999999999", b"HTTP/1.1 400"), (b"12a", b"HTTP/1.1 400"), (b"4000000000", b"HTTP/1.1 413")]
+        for length, status in cases:
+            with socket.create_connection(("localhost", 8080), timeout=5) as sock:
+                sock.sendall(b"POST /submit HTTP/1.1\r\nHost: localhost\r\nContent-Length: " + length + b"\r\n\r\n")
+                self.assertTrue(sock.recv(65536).startswith(status), length)
+        # Сервер продолжает работать
+        self.assertEqual(requests.get(f"{self.SERVER_URL}/api/data").status_code, 200)
+
+    def test_proxy(self):
+        """
+        Тестируем проксирование '/up' на upstream_stub.py: тело по Content-Length передаётся потоком,
+        тело chunked отклоняется 411, а Content-Length вместе с Transfer-Encoding - 400.
+        Ответ upstream с Content-Length и chunked передаётся клиенту без Content-Length.
+        """
+        response = requests.post(f"{self.SERVER_URL}/up/echo", data=b"hello")
+        self.assertEqual(response.status_code, 200)
+        self.assertIn("port=9011", response.text)
+        self.assertIn("method=POST", response.text)
+        self.assertIn("body-length=5", response.text)
+        for headers, status in [(b"Transfer-Encoding: chunked\r\n", b"HTTP/1.1 411"),
+                                (b"Content-Length: 5\r\nTransfer-Encoding: chunked\r\n", b"HTTP/1.1 400")]:
+            with socket.create_connection(("localhost", 8080), timeout=5) as sock:
+                sock.sendall(b"POST /up/echo HTTP/1.1\r\nHost: localhost\r\n" + headers +
+                             b"\r\n5\r\nhello\r\n0\r\n\r\n")
+                data = b""
+                while True:
+                    chunk = sock.recv(65536)
+                    if not chunk:
+                        break
+                    data += chunk
+            # Единственный ответ: части тела не обслуживаются как следующий запрос
+            self.assertTrue(data.startswith(status), data)
+            self.assertEqual(data.count(b"HTTP/1.1 "), 1)
+
+        with socket.create_connection(("localhost", 8080), timeout=5) as sock:
+            sock.sendall(b"GET /up/chunked?chunks=2&length=5 HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n")
+            data = b""
+            while True:
+                chunk = sock.recv(65536)
+                if not chunk:
+                    break
+                data += chunk
+        head, body = data.split(b"\r\n\r\n", 1)
+        self.assertTrue(head.startswith(b"HTTP/1.1 200"), head)
+        self.assertIn(b"\r\nTransfer-Encoding: chunked", head)
+        self.assertNotIn(b"content-length", head.lower())
+        self.assertEqual(body, b"8\r\nchunk 0\n\r\n8\r\nchunk 1\n\r\n0\r\n\r\n")
+
+    def test_silent_clients(self):
+        """
+        Тестируем приём: соединения, не приславшие запроса, не задерживают остальных клиентов.
+        """
+        silent = [socket.create_connection(("localhost", 8080), timeout=5) for _ in range(16)]
+        try:
+            start = time.time()
+            response = requests.get(f"{self.SERVER_URL}/api/data", timeout=2)
+            self.assertEqual(response.status_code, 200)
+            self.assertLess(time.time() - start, 1.0)
+            # Молчавший клиент обслуживается, когда всё же присылает запрос
+            silent[0].sendall(b"GET /api/data HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n")
+            self.assertTrue(silent[0].recv(65536).startswith(b"HTTP/1.1 200 OK"))
+        finally:
+            for sock in silent:
+                sock.close()
+
+    def test_response_cache(self):
+        """
+        Тестируем кэш ответов '/': повторный запрос берётся из кэша, заголовок Connection - по клиенту.
+        """
+        first = requests.get(f"{self.SERVER_URL}/")
+        second = requests.get(f"{self.SERVER_URL}/", headers={"Connection": "close"})
+        self.assertEqual(first.text, second.text)
+        self.assertEqual(second.headers.get("Connection"), "close")
+        metrics = requests.get(f"{self.SERVER_URL}/metrics").text
+        self.assertIn("flaskcpp_response_cache_hits_total", metrics)
+
+    def test_response_cache_key(self):
+        """
+        Тестируем ключ кэша: разделители в декодированном значении параметра не дают
+        запросу '?a=x%0Ab%3Dy' занять запись кэша запроса '?a=x&b=y'.
+        """
+        forged = requests.get(f"{self.SERVER_URL}/search?a=x%0Ab%3Dy")
+        self.assertEqual(forged.text, "a=x\nb=y\nb=\n")
+        genuine = requests.get(f"{self.SERVER_URL}/search?a=x&b=y")
+        self.assertEqual(genuine.status_code, 200)
+        self.assertEqual(genuine.text, "a=x\nb=y\n")
+
+    def test_compression(self):
+        """
+        Тестируем сжатие: большой текстовый ответ сжимается только для клиента с Accept-Encoding.
+        """
+        compressed = requests.get(f"{self.SERVER_URL}/metrics", headers={"Accept-Encoding": "gzip"})
+        self.assertEqual(compressed.headers.get("Content-Encoding"), "gzip")
+        self.assertIn("Accept-Encoding", compressed.headers.get("Vary", ""))
+        self.assertIn("flaskcpp_http_requests_total", compressed.text)
+        plain = requests.get(f"{self.SERVER_URL}/metrics", headers={"Accept-Encoding": "identity"})
+        self.assertNotIn("Content-Encoding", plain.headers)
+
+    def test_websocket(self):
+        """
+        Тестируем WebSocket '/ws': рукопожатие, эхо маскированного кадра и закрытие.
+        """
+        import base64, hashlib
+        key = base64.b64encode(os.urandom(16)).decode()
+        with socket.create_connection(("localhost", 8080), timeout=5) as sock:
+            sock.sendall(("GET /ws HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                          "Sec-WebSocket-Key: " + key + "\r\nSec-WebSocket-Version: 13\r\n\r\n").encode())
+            data = b""
+            while b"\r\n\r\n" not in data:
+                data += sock.recv(4096)
+            head, data = data.split(b"\r\n\r\n", 1)
+            self.assertTrue(head.startswith(b"HTTP/1.1 101"))
+            accept = base64.b64encode(hashlib.sha1((key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11").encode()).digest())
+            self.assertIn(b"Sec-WebSocket-Accept: " + accept, head)
+
+            mask = os.urandom(4)
+            payload = "привет".encode()
+            sock.sendall(bytes([0x81, 0x80 | len(payload)]) + mask + bytes(b ^ mask[i % 4] for i, b in enumerate(payload)))
+            while len(data) < 2 or len(data) < 2 + data[1]:
+                data += sock.recv(4096)
+            self.assertEqual(data[0], 0x81)
+            self.assertEqual(data[2:2 + data[1]], payload)
+
+            sock.sendall(bytes([0x88, 0x82]) + mask + bytes(b ^ mask[i] for i, b in enumerate(b"\x03\xe8")))
+            while sock.recv(4096):
+                pass
+
+        response = requests.get(f"{self.SERVER_URL}/ws")
+        self.assertEqual(response.status_code, 426)
+
+    def test_http2_prior_knowledge(self):
+        """
+        Тестируем HTTP/2 (h2c, prior knowledge): два запроса в одном соединении на потоках 1 и 3.
+        """
+        frame = http2_frame
+        # HPACK: :method GET (2), :scheme http (6), :path - литерал с именем из статической таблицы (4)
+        path = b"/api/data"
+        block = b"\x82\x86\x04" + bytes([len(path)]) + path
+        with socket.create_connection(("localhost", 8080), timeout=5) as sock:
+            sock.sendall(b"PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n" + frame(4, 0, 0, b"") +
+                         frame(1, 0x5, 1, block) + frame(1, 0x5, 3, block))
+            data, bodies, statuses = b"", {}, {}
+            while len(statuses) < 2 or not all(bodies.get(stream, b"").endswith(b"}") for stream in (1, 3)):
+                while len(data) < 9 or len(data) < 9 + struct.unpack(">I", b"\x00" + data[:3])[0]:
+                    chunk = sock.recv(65536)
+                    self.assertTrue(chunk)
+                    data += chunk
+                length = struct.unpack(">I", b"\x00" + data[:3])[0]
+                frame_type, stream_id = data[3], struct.unpack(">I", data[5:9])[0] & 0x7FFFFFFF
+                payload, data = data[9:9 + length], data[9 + length:]
+                if frame_type == 1:
+                    statuses[stream_id] = payload[0]
+                elif frame_type == 0:
+                    bodies[stream_id] = bodies.get(stream_id, b"") + payload
+        self.assertEqual(statuses, {1: 0x88, 3: 0x88})  # :status 200 - индекс 8 статической таблицы
+        self.assertEqual(bodies[1], b'{"status":"ok","message":"Hello from JSON!"}')
+        self.assertEqual(bodies[3], bodies[1])
+
+    def test_http2_rapid_reset(self):
+        """
+        Тестируем защиту от "rapid reset": поток за потоком открывается HEADERS и сразу сбрасывается
+        RST_STREAM; сверх лимита сбросов в секунду сервер закрывает соединение GOAWAY с ENHANCE_YOUR_CALM.
+        """
+        block = b"\x83\x86\x04\x09/api/data"  # :method POST - запрос ждёт тело и не выполняется до сброса
+        burst = b"".join(http2_frame(1, 0x4, stream, block) + http2_frame(3, 0, stream, struct.pack(">I", 8))
+                         for stream in range(1, 400, 2))
+        with socket.create_connection(("localhost", 8080), timeout=5) as sock:
+            sock.sendall(b"PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n" + http2_frame(4, 0, 0, b"") + burst)
+            data = b""
+            while True:
+                chunk = sock.recv(65536)
+                if not chunk:
+                    break
+                data += chunk
+        goaway = None
+        while len(data) >= 9:
+            length = struct.unpack(">I", b"\x00" + data[:3])[0]
+            if data[3] == 7:
+                goaway = data[9:9 + length]
+            data = data[9 + length:]
+        self.assertIsNotNone(goaway)
+        self.assertEqual(struct.unpack(">I", goaway[4:8])[0], 0xb)
+
+    def test_http2_connection_limit(self):
+        """
+        Тестируем лимит соединений HTTP/2: сверх '--http2-max-connections' соединение закрывается,
+        после закрытия первого соединения место освобождается.
+        """
+        self.start_server(8094, "--http2-max-connections", "1")
+        preface = b"PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n" + http2_frame(4, 0, 0, b"")
+        first = socket.create_connection(("localhost", 8094), timeout=5)
+        first.sendall(preface)
+        self.assertEqual(first.recv(9)[3], 4)  # SETTINGS сервера
+        with socket.create_connection(("localhost", 8094), timeout=5) as second:
+            second.sendall(preface)
+            data = b""
+            while True:
+                chunk = second.recv(65536)
+                if not chunk:
+                    break
+                data += chunk
+            self.assertNotIn(b"\x04\x00\x00\x00\x00\x00", data[:9])
+        first.close()
+        time.sleep(1.5)
+        with socket.create_connection(("localhost", 8094), timeout=5) as third:
+            third.sendall(preface)
+            self.assertEqual(third.recv(9)[3], 4)
+
+    def test_metrics(self):
+        """
+        Тестируем экспорт метрик '/metrics' в формате Prometheus.
+        """
+        requests.get(f"{self.SERVER_URL}/api/data")
+        response = requests.get(f"{self.SERVER_URL}/metrics")
+        self.assertEqual(response.status_code, 200)
+        self.assertIn('flaskcpp_http_requests_total{route="/api/data",code="2xx"}', response.text)
+        self.assertIn('flaskcpp_request_phase_seconds_count{phase="handler"}', response.text)
+        self.assertIn("flaskcpp_threadpool_queue_depth", response.text)
+        # Стоимость маршрута изучается по времени обработки и задаёт его срок в очереди пула
+        self.assertIn('flaskcpp_route_cost_seconds{route="/api/data"}', response.text)
+        # Пул блокирующих задач отдельный от пула обработчиков, у каждого своя загрузка
+        self.assertIn("flaskcpp_blocking_pool_saturation", response.text)
+
+    def test_threadpool_deadline_order(self):
+        """
+        Тестируем порядок пула потоков: задачи выполняются по сроку (EDF), с равным сроком - в порядке постановки.
+        """
+        import shutil, tempfile
+        if shutil.which("g++") is None:
+            self.skipTest("g++ не найден")
+        source = r"""
+            #include "ThreadPool.h"
+            #include <iostream>
+            int main() {
+                ThreadPool pool(1, 1);
+                std::promise<void> started, release;
+                std::shared_future<void> released = release.get_future().share();
+                // Единственный поток занят, пока в очередь ставятся остальные задачи
+                pool.post(0, [&]() { started.set_value(); released.wait(); });
+                started.get_future().wait();
+                auto now = std::chrono::steady_clock::now();
+                std::mutex orderMutex;
+                std::string order;
+                int deadlines[] = {30, 10, 20, 10, 10};
+                for (int i = 0; i < 5; ++i) {
+                    TaskSchedule schedule{now, now + std::chrono::milliseconds(deadlines[i])};
+                    pool.post(5, schedule, [&, i]() { std::lock_guard<std::mutex> lock(orderMutex); order += char('A' + i); });
+                }
+                release.set_value();
+                pool.shutdown();
+                std::cout << order << std::endl;
+            }
+        """
+        with tempfile.TemporaryDirectory() as directory:
+            driver = os.path.join(directory, "order.cpp")
+            with open(driver, "w") as f:
+                f.write(source)
+            binary = os.path.join(directory, "order")
+            subprocess.run(["g++", "-std=c++17", "-pthread", "-Isrc/headers", driver,
+                            os.path.join("src", "ThreadPool.cpp"), "-o", binary], check=True)
+            output = subprocess.run([binary], capture_output=True, text=True, timeout=10).stdout
+        # Срок 10: B, D, E в порядке постановки, затем C (20) и A (30)
+        self.assertEqual(output.strip(), "BDECA")
+
     def test_hot_reload(self):
         """
         Тестируем функциональность hot reload (обновление шаблонов на лету).
@@ -223,5 +1036,29 @@ class TestFlaskCppServer(unittest.TestCase):
             f.write(original_content)
         time.sleep(3)
 
+class TestFlaskCppServerIoUring(TestFlaskCppServer):
+    """
+    Тот же набор тестов на сервере с '--io-uring'; пропускается, только если ядро отклоняет io_uring_setup.
+    """
+    SERVER_ARGS = ["--io-uring"]
+
+    @classmethod
+    def setUpClass(cls):
+        if not io_uring_supported():
+            raise unittest.SkipTest("ядро отклоняет io_uring_setup")
+        super().setUpClass()
+
+    def test_io_uring_loop(self):
+        """
+        Тестируем, что запросы обслуживает цикл io_uring, а не запасной epoll.
+        """
+        import re
+        for _ in range(3):
+            self.assertEqual(requests.get(f"{self.SERVER_URL}/api/data").status_code, 200)
+        metrics = requests.get(f"{self.SERVER_URL}/metrics").text
+        match = re.search(r"(?m)^flaskcpp_io_uring_enter_total (\d+)", metrics)
+        self.assertIsNotNone(match)
+        self.assertGreater(int(match.group(1)), 0)
+
 if __name__ == '__main__':
     unittest.main()
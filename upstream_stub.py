@@ -0,0 +1,84 @@
+"""
+Заглушка upstream-сервера для локальной проверки проксирования.
+
+Запуск:
+    python3 upstream_stub.py 9001 &
+    python3 upstream_stub.py 9002 &
+    ./bin/server --proxy /api=127.0.0.1:9001,127.0.0.1:9002 --proxy-health /health
+
+Ответы (HTTP/1.1, keep-alive):
+    /health           - 200, пока не создан файл /tmp/upstream-<port>.down
+    /big?size=N       - N байт с Content-Length
+    /chunked?chunks=N - N частей в Transfer-Encoding: chunked
+                        (&length=M добавляет противоречащий ему Content-Length: M)
+    /slow?ms=N        - ответ через N миллисекунд
+    остальное         - текст с портом, методом, путём, X-Forwarded-For и длиной тела
+"""
+import os
+import sys
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlsplit
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    disable_nagle_algorithm = True
+
+    def log_message(self, format, *args):
+        pass
+
+    def send_body(self, status, body, content_type="text/plain"):
+        self.send_response(status)
+        self.send_header("Content-Type", content_type)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        if self.command != "HEAD":
+            self.wfile.write(body)
+
+    def handle_any(self):
+        url = urlsplit(self.path)
+        query = parse_qs(url.query)
+        length = int(self.headers.get("Content-Length", 0))
+        body = self.rfile.read(length) if length else b""
+        port = self.server.server_address[1]
+
+        if url.path.endswith("/health"):
+            down = os.path.exists(f"/tmp/upstream-{port}.down")
+            self.send_body(503 if down else 200, b"down\n" if down else b"ok\n")
+        elif url.path.endswith("/big"):
+            size = int(query.get("size", ["1048576"])[0])
+            self.send_body(200, b"x" * size, "application/octet-stream")
+        elif url.path.endswith("/slow"):
+            time.sleep(int(query.get("ms", ["1000"])[0]) / 1000)
+            self.send_body(200, b"slow\n")
+        elif url.path.endswith("/chunked"):
+            self.send_response(200)
+            self.send_header("Content-Type", "text/plain")
+            if "length" in query:
+                self.send_header("Content-Length", query["length"][0])
+            self.send_header("Transfer-Encoding", "chunked")
+            self.end_headers()
+            for i in range(int(query.get("chunks", ["3"])[0])):
+                data = f"chunk {i}\n".encode()
+                self.wfile.write(f"{len(data):x}\r\n".encode() + data + b"\r\n")
+            self.wfile.write(b"0\r\n\r\n")
+        else:
+            text = (f"port={port}\nmethod={self.command}\npath={self.path}\n"
+                    f"x-forwarded-for={self.headers.get('X-Forwarded-For', '')}\n"
+                    f"connection={self.headers.get('Connection', '')}\nbody-length={len(body)}\n")
+            self.send_body(int(self.headers.get("X-Stub-Status", 200)), text.encode())
+
+    do_GET = do_POST = do_PUT = do_DELETE = do_HEAD = handle_any
+
+
+def main():
+    port = int(sys.argv[1]) if len(sys.argv) > 1 else 9001
+    server = ThreadingHTTPServer(("127.0.0.1", port), Handler)
+    server.daemon_threads = True
+    print(f"Upstream stub listening on 127.0.0.1:{port}", flush=True)
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()